@@ -42,6 +42,7 @@
 #include "omega/PythonInterpreter.h"
 #include "omega/Texture.h"
 #include "omega/ImageUtils.h"
+#include "omega/ImagePyramid.h"
 #include "omega/TrackedObject.h"
 
 // Include the modules config file.
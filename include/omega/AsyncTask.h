@@ -47,12 +47,16 @@ namespace omega {
 		};
 
 	public:
-		AsyncTask(): myProgress(0), myComplete(false), myHandler(NULL) {}
+		AsyncTask(): myProgress(0), myComplete(false), myCancelled(false), myHandler(NULL) {}
 
 		T& getData() { return myData; }
 		void setData(const T& data) { myData = data; }
 
 		bool isComplete() { return myComplete; }
+		//! Marks this task as cancelled. Task runners check this flag and skip
+		//! tasks that have been cancelled before they started running.
+		void cancel() { myCancelled = true; }
+		bool isCancelled() { return myCancelled; }
 		int getProgress() { return myProgress; }
 		void setProgress(int value) { myProgress = value; }
 
@@ -95,6 +99,7 @@ namespace omega {
 		T myData;
 		String myTaskId;
 		bool myComplete;
+		bool myCancelled;
 		int myProgress;
 		bool myFailed;
 		String myCompletionMessage;
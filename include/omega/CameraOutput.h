@@ -73,6 +73,11 @@ namespace omega {
 
 		const Rect& getReadbackViewport() { return myReadbackViewport; }
 
+		//! Enables asynchronous readback on this output. See 
+		//! RenderTarget::setAsyncReadback.
+		void setAsyncReadback(bool enabled, int bufferCount = 3);
+		bool isAsyncReadbackEnabled() { return myAsyncReadback; }
+
 		RenderTarget* getRenderTarget() { return myRenderTarget; }
 		RenderTarget::Type getType() { return myType; }
 
@@ -92,6 +97,9 @@ namespace omega {
 
 		Rect myReadbackViewport;
 
+		bool myAsyncReadback;
+		int myReadbackBufferCount;
+
 		Lock myLock;
 	};
 }; // namespace omega
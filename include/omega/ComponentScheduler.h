@@ -0,0 +1,109 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	Runs node component updates, optionally spreading thread-safe components
+ *	across the engine job system.
+ *************************************************************************************************/
+#ifndef __COMPONENT_SCHEDULER_H__
+#define __COMPONENT_SCHEDULER_H__
+
+#include "osystem.h"
+#include "omega/JobSystem.h"
+
+namespace omega {
+	class NodeComponent;
+	struct UpdateContext;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! Runs NodeComponent updates for the scene. 
+	//! @remarks
+	//!		By default, components are updated serially by the scene node 
+	//!		traversal, like before. When parallel updates are enabled, 
+	//!		components declaring themselves thread-safe (see 
+	//!		NodeComponent::isThreadSafe) are queued during the traversal, and
+	//!		updated in batches on the engine job system once the traversal is
+	//!		done. Other components are still updated serially, in traversal 
+	//!		order.
+	//!		end() returns after all the queued components have been updated:
+	//!		bounding box update requests made by thread-safe components are 
+	//!		forwarded to their owner nodes after this barrier, so scene nodes
+	//!		are only ever touched by the calling thread.
+	//!		Queued components are referenced until end(): components detached
+	//!		from their node before end() are not updated.
+	class OMEGA_API ComponentScheduler: private ParallelLoop
+	{
+	public:
+		ComponentScheduler();
+		~ComponentScheduler();
+
+		//! Sets the job system used for parallel updates.
+		void setJobSystem(JobSystem* js) { myJobSystem = js; }
+
+		//! Enables parallel updates of thread-safe components. Parallel 
+		//! updates are disabled by default, and need job system worker 
+		//! threads.
+		void setParallelUpdateEnabled(bool value) { myParallelUpdateEnabled = value; }
+		bool isParallelUpdateEnabled() { return myParallelUpdateEnabled; }
+
+		//! Sets the number of components a thread takes from the queue at once.
+		void setBatchSize(int size) { myBatchSize = size > 0 ? size : 1; }
+		int getBatchSize() { return myBatchSize; }
+
+		//! Component update, called by the scene node traversal.
+		//@{
+		//! Starts queuing thread-safe components.
+		void begin(const UpdateContext& context);
+		//! Updates a component, or queues it for a parallel update.
+		void update(NodeComponent* component, const UpdateContext& context);
+		//! Updates all the queued components, and waits for them to finish.
+		void end();
+		//@}
+
+		//! Returns the number of components updated by workers in the last frame.
+		int getLastParallelCount() { return myLastParallelCount; }
+
+	private:
+		//! Updates a component, timing it if it has an update stat.
+		void runComponent(NodeComponent* component, const UpdateContext& context);
+		//! Updates the queued components in [first, end). Runs on the job
+		//! system threads.
+		virtual void run(int first, int end);
+
+	private:
+		JobSystem* myJobSystem;
+		bool myParallelUpdateEnabled;
+
+		bool myQueuing;
+		const UpdateContext* myContext;
+		Vector< Ref<NodeComponent> > myQueue;
+		int myBatchSize;
+
+		int myLastParallelCount;
+	};
+}; // namespace omega
+
+#endif
@@ -86,6 +86,10 @@ namespace omega
 		Renderer* renderer;
         //! The camera currently rendering this context.
         Camera* camera;
+		//! The view frustum planes in world space, as (normal, distance) with
+		//! normals pointing inside the frustum. Updated by updateTransforms.
+		//! Order is left, right, bottom, top, near, far.
+		Vector4f frustumPlanes[6];
 
 		//! Tile stack
 		//! Lets cameras push/pop tiles, to support rendering with custom tile 
@@ -132,6 +136,14 @@ namespace omega
 			float nearZ,
 			float farZ);
 
+		//! Recomputes the frustum planes from the current modelview and 
+		//! projection transforms.
+		void updateFrustum();
+		//! Returns true if the box is at least partially inside the view 
+		//! frustum. The test is conservative: boxes close to the frustum 
+		//! corners may be reported as visible.
+		bool isBoxVisible(const AlignedBox3& box) const;
+
 		//! Return true if this draw context is supposed to draw something for
 		//! the specified view rectangle
 		bool overlapsView(
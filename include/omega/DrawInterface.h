@@ -122,6 +122,7 @@ namespace omega {
 			Color startColor, Color endColor, float pc = 0.5f);
 		void drawRect(Vector2f pos, Vector2f size, Color color);
 		void drawRectOutline(Vector2f pos, Vector2f size, Color color);
+		void drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float width);
 		void drawText(const String& text, Font* font, const Vector2f& position, unsigned int align, Color color);
 		void drawRectTexture(Texture* texture, const Vector2f& position, const Vector2f size, uint flipFlags = 0, const Vector2f& minUV = Vector2f::Zero(), const Vector2f& maxUV = Vector2f::Ones());
 		void drawCircleOutline(Vector2f position, float radius, const Color& color, int segments);
@@ -130,12 +131,96 @@ namespace omega {
 		//void drawPrimitives(VertexBuffer* vertices, uint* indices, uint size, DrawType type);
 		//@}
 
+		//! Batching
+		//! When batching is enabled, 2D primitives drawn between beginBatch and
+		//! endBatch are not drawn immediately: they are appended to a vertex 
+		//! stream that is uploaded to a vertex buffer and drawn when the batch
+		//! is flushed. Consecutive primitives sharing texture, program and 
+		//! primitive type are merged into a single draw call. Primitives are
+		//! not reordered, so overlapping primitives keep their drawing order.
+		//! The current modelview matrix is applied to vertices when primitives
+		//! are recorded, so code can keep using glPushMatrix / glTranslate 
+		//! between primitives. Any other GL state change (projection, blending,
+		//! uniforms, render targets) or direct GL drawing inside a batch must 
+		//! be preceded by a call to flush(). Programs should be set through
+		//! useProgram.
+		//@{
+		void setBatchingEnabled(bool value) { myBatchingEnabled = value; }
+		bool isBatchingEnabled() { return myBatchingEnabled; }
+		void beginBatch();
+		void endBatch();
+		//! Returns true if primitives are currently being batched.
+		bool isBatching();
+		//! Draws all pending primitives and binds the current program, so 
+		//! the caller can change GL state or draw directly.
+		void flush();
+		//! Sets the gpu program used by the following primitives. If 
+		//! alphaUniform is not -1, it is set to alpha when the program is used.
+		void useProgram(GLuint program, GLint alphaUniform = -1, float alpha = 1.0f);
+		//@}
+
+		//! Draw stats
+		//@{
+		//! Returns the number of draw calls issued since the last call to
+		//! resetDrawStats. Each immediate-mode primitive counts as one call.
+		uint getNumBatches() { return myNumBatches; }
+		//! Returns the number of primitives drawn since the last call to
+		//! resetDrawStats.
+		uint getNumPrimitives() { return myNumPrimitives; }
+		void resetDrawStats();
+		//@}
+
+	private:
+		//! Vertex format of the batch vertex stream.
+		struct BatchVertex
+		{
+			float position[3];
+			float uv[2];
+			GLubyte color[4];
+		};
+
+		//! GL state shared by a run of consecutive batched vertices.
+		struct BatchState
+		{
+			GLenum mode;
+			GLuint texture;
+			GLuint program;
+			GLint alphaUniform;
+			float alpha;
+			float lineWidth;
+			//! When set, standard alpha blending is forced on.
+			bool blend;
+
+			bool operator==(const BatchState& s) const
+			{
+				return mode == s.mode && texture == s.texture && 
+					program == s.program && alphaUniform == s.alphaUniform &&
+					alpha == s.alpha && lineWidth == s.lineWidth && blend == s.blend;
+			}
+		};
+
+		struct BatchRun
+		{
+			BatchState state;
+			uint first;
+			uint count;
+		};
+
 	private:
 		void setGlColor(const Color& col);
+		Color getBrushColor(const Color& col);
+		void applyProgram();
+		//! Appends a primitive with the specified number of vertices to the 
+		//! batch, and returns a pointer to its first vertex.
+		BatchVertex* batchPrimitive(GLenum mode, uint numVertices, GLuint texture = 0, bool blend = false, float lineWidth = 1.0f);
+		BatchVertex makeBatchVertex(float x, float y, const Color& color, float s = 0, float t = 0);
+		void computeCirclePoints(const Vector2f& position, float radius, int segments);
 
 	private:
 		bool myDrawing;
 		Dictionary<String, Ref<Font> > myFonts;
+		// Glyph atlas shared by all fonts of this context.
+		Ref<GlyphAtlas> myGlyphAtlas;
 		Font* myDefaultFont;
 		Lock myLock;
 
@@ -145,12 +230,36 @@ namespace omega {
 
 		// Program cache
 		Dictionary<String, GLuint> myPrograms;
+
+		// Current program state, see useProgram.
+		GLuint myProgram;
+		GLint myAlphaUniform;
+		float myAlpha;
+
+		// Batching
+		bool myBatchingEnabled;
+		int myBatchDepth;
+		Vector<BatchVertex> myBatchVertices;
+		Vector<BatchRun> myBatchRuns;
+		GLuint myBatchBuffer;
+		// Modelview matrix of the primitive being recorded.
+		GLdouble myBatchTransform[16];
+		// Scratch buffer used to generate circle vertices.
+		Vector<Vector2f> myCirclePoints;
+
+		// Stats
+		uint myNumBatches;
+		uint myNumPrimitives;
 	};
 
 	///////////////////////////////////////////////////////////////////////////
 	inline bool DrawInterface::isDrawing()
 	{ return myDrawing; }
 
+	///////////////////////////////////////////////////////////////////////////
+	inline bool DrawInterface::isBatching()
+	{ return myBatchDepth > 0; }
+
 	///////////////////////////////////////////////////////////////////////////
 	inline Font* DrawInterface::getDefaultFont()
 	{ return myDefaultFont; }
@@ -43,6 +43,9 @@
 #include "Pointer.h"
 #include "Renderable.h"
 #include "SceneQuery.h"
+#include "TransformSystem.h"
+#include "ComponentScheduler.h"
+#include "JobSystem.h"
 #include "Camera.h"
 #include "Font.h"
 #include "omicron/SoundManager.h"
@@ -115,8 +118,17 @@ namespace omega {
         //! Scene query
         //@{
         const SceneQueryResultList& querySceneRay(const Ray& ray, uint flags = 0);
+        //! Returns the bounding volume hierarchy used by scene ray queries.
+        SceneBvh* getSceneBvh() { return &mySceneBvh; }
         //@}
 
+        //! Returns the system used to update scene node transforms.
+        TransformSystem* getTransformSystem() { return &myTransformSystem; }
+        //! Returns the job system shared by engine subsystems and modules.
+        JobSystem* getJobSystem() { return &myJobSystem; }
+        //! Returns the scheduler used to update scene node components.
+        ComponentScheduler* getComponentScheduler() { return &myComponentScheduler; }
+
         SceneNode* getScene();
 
         //! Pointer mode management
@@ -177,7 +189,15 @@ namespace omega {
         // Engine lock, used when client / server thread synchronization is needed.
         Lock myLock;
 
+        // Job system. Declared before the subsystems using it.
+        JobSystem myJobSystem;
+
+        // Scene query hierarchy. Declared before the scene root, since scene
+        // nodes remove themselves from it when destroyed.
+        SceneBvh mySceneBvh;
         Ref<SceneNode> myScene;
+        TransformSystem myTransformSystem;
+        ComponentScheduler myComponentScheduler;
 
         // Pointers
         Dictionary< int, Ref<Pointer> > myPointers;
@@ -227,6 +247,9 @@ namespace omega {
         Ref<Stat> myUpdateTimeStat;
         Ref<Stat> mySceneUpdateTimeStat;
         Ref<Stat> myModuleUpdateTimeStat;
+        Ref<Stat> mySceneQueryTimeStat;
+        Ref<Stat> mySceneTransformCountStat;
+        Ref<Stat> mySceneParallelComponentsStat;
     };
 
     ///////////////////////////////////////////////////////////////////////////
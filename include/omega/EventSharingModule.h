@@ -36,12 +36,21 @@ namespace omega
 	class OMEGA_API EventSharingModule: public EngineModule
 	{
 	public:
-		//! Max number of events.
-		static const int MaxSharedEventsQueue = 120;
+		//! Max number of events queued per frame. When the queue is full, new
+		//! Update events are dropped. Discrete events (button presses, etc.)
+		//! are never dropped: the queue grows past this limit if needed.
+		static const int MaxSharedEventsQueue = 1024;
+		//! Initial capacity of the event queue.
+		static const int InitialSharedEventsQueue = 128;
 
 		//! Flag for local events.
 		static const uint LocalEventFlag = Event::User << 2;
 
+		//! Encoding used for the event block sent to slaves every frame. The
+		//! block starts with its encoding so slaves can skip blocks they do 
+		//! not understand.
+		enum EventBlockEncoding { EncodingFull = 1, EncodingCompact = 2 };
+
 	public:
 		static void markLocal(const Event& evt);
 		static bool isLocal(const Event& evt);
@@ -50,16 +59,58 @@ namespace omega
 
 		EventSharingModule();
 
+		virtual void initialize();
 		virtual void commitSharedData(SharedOStream& out);
 		virtual void updateSharedData(SharedIStream& in);
 		virtual void dispose();
 
+		//! Queues an event for sending to slaves with the next frame. share()
+		//! queues events on the module instance after checking the engine is
+		//! running on the master node.
+		void queueEvent(const Event& evt);
+
+		//! When set to true (the default), Update events coming from the same
+		//! source replace each other in the queue, so only the latest one is
+		//! sent to slaves.
+		void setCoalesceUpdates(bool value) { myCoalesceUpdates = value; }
+		bool getCoalesceUpdates() { return myCoalesceUpdates; }
+
+	private:
+		void enqueue(const Event& evt);
+		void flushStats();
+
 	private:
 		static Ref<EventSharingModule> mysInstance;
 
 		Lock myQueueLock;
-		Event myEventQueue[MaxSharedEventsQueue];
+		//! The event queue is emptied every frame, so its storage is reused
+		//! and only grows when a frame holds more events than ever before.
+		Vector<Event> myEventQueue;
 		int myQueuedEvents;
+
+		//! Update event coalescing. Maps a source key (service type, service 
+		//! id and source id) to the queue index of its latest Update event. 
+		//! A source is removed from the index when one of its discrete events
+		//! is queued, so coalescing never reorders events of the same source.
+		bool myCoalesceUpdates;
+		Dictionary<uint64_t, int> myCoalesceIndex;
+
+		// Per-frame counters and stats
+		int myCoalescedEvents;
+		int myDroppedEvents;
+		Ref<Stat> mySharedStat;
+		Ref<Stat> myCoalescedStat;
+		Ref<Stat> myDroppedStat;
+
+		//! Encoding options, read from the config/eventSharing section of the
+		//! system configuration.
+		//@{
+		bool myCompactEncoding;
+		float myPositionStep;
+		bool myQuantizeOrientation;
+		//@}
+		//! Buffer used to assemble the event block.
+		Vector<byte> myEventBlock;
 	};
 
 	///////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,73 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * What's in this file
+ *	Event serialization for the shared data stream, in a full and a compact
+ *	encoding.
+ *************************************************************************************************/
+#ifndef __EVENT_UTILS_H__
+#define __EVENT_UTILS_H__
+
+#include "omega/osystem.h"
+#include "omega/SharedDataServices.h"
+
+namespace omicron {
+	///////////////////////////////////////////////////////////////////////////
+	//! This class provides utility methods for converting omegalib events into
+	//! the shared data stream format used to share data between nodes.
+    class OMEGA_API EventUtils
+    {
+    public:
+        //! Field presence bits used by the compact event encoding.
+        enum CompactField
+        {
+            CompactSourceId = 1 << 0,
+            CompactServiceId = 1 << 1,
+            CompactFlags = 1 << 2,
+            CompactPosition = 1 << 3,
+            CompactPositionQuantized = 1 << 4,
+            CompactOrientation = 1 << 5,
+            CompactOrientationQuantized = 1 << 6,
+            CompactExtraData = 1 << 7
+        };
+
+    public:
+        //! Full encoding: all event fields are written as-is.
+        static void serializeEvent(Event& evt, omega::SharedOStream& os);
+        static void deserializeEvent(Event& evt, omega::SharedIStream& is);
+        //! Compact encoding: the event starts with a field presence mask, and
+        //! fields with default values (zero ids and flags, zero position, 
+        //! identity orientation, no extra data) are not written. When 
+        //! positionStep is greater than zero, positions that fit in 16 bits 
+        //! at that resolution are quantized. Orientations can optionally be
+        //! quantized to 16 bits per component.
+        static void serializeCompactEvent(Event& evt, omega::SharedOStream& os, float positionStep, bool quantizeOrientation);
+        static void deserializeCompactEvent(Event& evt, omega::SharedIStream& is, float positionStep);
+    private:
+        EventUtils() {}
+    };
+};
+
+#endif
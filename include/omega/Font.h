@@ -28,8 +28,7 @@
 #define __FONT_H__
 
 #include "omega/osystem.h"
-
-class FTFont;
+#include "omega/GlyphAtlas.h"
 
 namespace omega {
 	///////////////////////////////////////////////////////////////////////////////////////////////
@@ -45,10 +44,32 @@ namespace omega {
 		int size;
 	};
 
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! A string laid out with a font: one textured quad per visible glyph.
+	//! Quad positions are relative to the pen origin on the text baseline, 
+	//! with y pointing down.
+	struct GlyphRun
+	{
+		struct Quad
+		{
+			float x0, y0, x1, y1;
+			float u0, v0, u1, v1;
+			//! The glyph atlas page containing the glyph.
+			int page;
+		};
+
+		Vector<Quad> quads;
+		//! The text size, as returned by Font::computeSize
+		Vector2f size;
+	};
+
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	class OMEGA_API Font: public ReferenceType
 	{
 	public:
+		//! Maximum number of laid out strings cached by each font.
+		static const uint MaxCachedRuns = 1024;
+
 		static void lock();
 		static void unlock();
 
@@ -56,20 +77,31 @@ namespace omega {
 		enum Align {HALeft = 1 << 0, HARight = 1 << 1, HACenter = 1 << 2,
 					VATop = 1 << 3, VABottom = 1 << 4, VAMiddle = 1 << 5};
 	public:
-		Font(FTFont* fontImpl): myFontImpl(fontImpl) {}
+		Font(GlyphAtlas* atlas, GlyphAtlas::Face* face);
 
 		void render(const String& text, float x, float y);
 
         //! Deprecated, use static getTextSize instead.
 		Vector2f computeSize(const omega::String& text);
 
+		//! Returns the layout of a string. Layouts are cached, so strings 
+		//! drawn every frame are laid out once. The returned run is valid
+		//! until the next call. The font atlas must be locked by the caller.
+		const GlyphRun& getGlyphRun(const String& text);
+		GlyphAtlas* getAtlas() { return myAtlas; }
+
         //! Computes the size of the specified text in pixels, using the specified
         //! font.
         static Vector2f getTextSize(const String& text, const String& font);
 
+	private:
+		void layout(const String& text, GlyphRun& run);
+
 	private:
 		static Lock sLock;
-		FTFont* myFontImpl;
+		Ref<GlyphAtlas> myAtlas;
+		GlyphAtlas::Face* myFace;
+		Dictionary<String, GlyphRun> myRuns;
 	};
 }; // namespace omega
 
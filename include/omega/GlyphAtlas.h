@@ -0,0 +1,126 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A glyph atlas packing FreeType rasterized glyphs into shared texture pages.
+ *************************************************************************************************/
+#ifndef __GLYPH_ATLAS_H__
+#define __GLYPH_ATLAS_H__
+
+#include "osystem.h"
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+namespace omega {
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! GlyphAtlas rasterizes glyphs with FreeType and packs them into alpha 
+	//! texture pages. Pages are filled row by row and a new page is added 
+	//! when the current one is full. Glyph bitmaps are kept in memory and 
+	//! uploaded to the GPU only when a page texture is requested, so an atlas
+	//! can also be used for text layout without a GL context.
+	//! Each DrawInterface (and therefore each GPU context) owns an atlas 
+	//! shared by all its fonts. Callers serialize access with lock / unlock.
+	class OMEGA_API GlyphAtlas: public ReferenceType
+	{
+	public:
+		//! Size in pixels of atlas pages.
+		static const int PageSize = 512;
+
+		struct Glyph
+		{
+			//! Horizontal pen advance, in pixels.
+			float advance;
+			//! Offset of the glyph bitmap from the pen position (y up).
+			int left;
+			int top;
+			//! Size of the glyph bitmap. Empty glyphs (i.e. spaces) have
+			//! zero size and are not stored in a page.
+			int width;
+			int height;
+			int page;
+			float u0, v0, u1, v1;
+		};
+
+		struct Face
+		{
+			FT_FaceRec_* face;
+			int size;
+			bool hasKerning;
+			//! Glyphs indexed by FreeType glyph index.
+			Dictionary<uint, Glyph> glyphs;
+		};
+
+	public:
+		GlyphAtlas();
+		virtual ~GlyphAtlas();
+
+		void lock() { myLock.lock(); }
+		void unlock() { myLock.unlock(); }
+
+		//! Opens a font file at the specified pixel size. Returns NULL if the
+		//! font could not be opened. Faces are owned by the atlas.
+		Face* loadFace(const String& fontPath, int size);
+		//! Returns the glyph index for a character code.
+		uint getGlyphIndex(Face* face, uint charCode);
+		//! Returns a glyph, rasterizing and packing it if needed.
+		const Glyph& getGlyph(Face* face, uint glyphIndex);
+		//! Returns the kerning offset between two glyphs, in pixels.
+		float getKerning(Face* face, uint leftIndex, uint rightIndex);
+
+		int getNumPages() { return myPages.size(); }
+		//! Returns the texture for the specified page, uploading pending 
+		//! glyphs first. Must be called with a current GL context.
+		uint getPageTexture(int page);
+
+	private:
+		struct Page
+		{
+			Vector<byte> pixels;
+			uint texture;
+			// Shelf packer state.
+			int shelfX;
+			int shelfY;
+			int shelfHeight;
+			// Rows changed since the last upload.
+			int dirtyMinY;
+			int dirtyMaxY;
+		};
+
+		//! Finds space for a width x height bitmap. Adds a page if needed.
+		//! Returns false if the bitmap is larger than a page.
+		bool allocate(int width, int height, int& outPage, int& outX, int& outY);
+		void addPage();
+
+	private:
+		Lock myLock;
+		FT_LibraryRec_* myLibrary;
+		List<Face*> myFaces;
+		Vector<Page> myPages;
+	};
+}; // namespace omega
+
+#endif
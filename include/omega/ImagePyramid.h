@@ -0,0 +1,155 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A tile pyramid reader serving view-dependent levels of detail of very large images.
+ *************************************************************************************************/
+#ifndef __IMAGE_PYRAMID_H__
+#define __IMAGE_PYRAMID_H__
+
+#include "osystem.h"
+#include "omega/ImageUtils.h"
+
+namespace omega {
+	struct DrawContext;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! ImagePyramid serves tiles of a multi-resolution image pyramid. Pyramids 
+	//! use the Deep Zoom layout: level L has size ceil(size / 2^(maxLevel - L)) 
+	//! and its tiles are stored as <tilePath>/<L>/<column>_<row>.<format>.
+	//! Tiles are loaded asynchronously by the ImageUtils loader threads and kept
+	//! in a per-pyramid tile cache with a memory budget, so each node only loads
+	//! the tiles its screens show.
+	class OMEGA_API ImagePyramid: public ReferenceType
+	{
+	public:
+		struct Tile
+		{
+			int level;
+			int column;
+			int row;
+			//! The tile area, in full resolution image pixels.
+			Rect bounds;
+			//! The tile area inside the tile pixels (tiles include overlap
+			//! borders with their neighbors).
+			Rect pixelRegion;
+			//! The tile pixels. NULL when the tile is not loaded yet.
+			Ref<PixelData> pixels;
+		};
+		typedef List<Tile> TileList;
+
+	public:
+		//! Opens a Deep Zoom pyramid from a .dzi descriptor file. Returns NULL
+		//! if the descriptor could not be read.
+		static Ref<ImagePyramid> create(const String& dziFile);
+
+		ImagePyramid();
+		virtual ~ImagePyramid();
+
+		//! Sets up the pyramid layout directly. Useful for pyramids without a 
+		//! descriptor file.
+		void initialize(const String& tilePath, int width, int height, 
+			int tileSize, int overlap, const String& format);
+		//! Reads the pyramid layout from a .dzi descriptor.
+		bool load(const String& dziFile);
+
+		int getWidth() { return myWidth; }
+		int getHeight() { return myHeight; }
+		int getTileSize() { return myTileSize; }
+		int getOverlap() { return myOverlap; }
+		int getNumLevels() { return myMaxLevel + 1; }
+		//! Returns the size in pixels of the specified level.
+		Vector2i getLevelSize(int level);
+		//! Returns the number of tile columns and rows of the specified level.
+		Vector2i getLevelTiles(int level);
+		//! Returns the path of the file storing the specified tile.
+		String getTilePath(int level, int column, int row);
+
+		//! Returns the coarsest level that shows imageRegion (in full 
+		//! resolution pixels) on screenSize pixels without magnification.
+		int getLevelForView(const Rect& imageRegion, const Vector2i& screenSize);
+		//! Collects the tiles covering imageRegion at the level best matching
+		//! screenSize. Tiles that are not loaded yet get requested, and loaded
+		//! tiles from coarser levels covering them are returned in their place.
+		//! Tiles are returned coarse to fine, so they can be drawn in order.
+		void getTiles(const Rect& imageRegion, const Vector2i& screenSize, TileList& outTiles);
+		//! Collects tiles for imageRegion drawn on the viewport of a draw context.
+		void getTiles(const DrawContext& context, const Rect& imageRegion, TileList& outTiles);
+
+		//! Tile cache
+		//@{
+		//! Sets the memory budget (in bytes) of the tile cache.
+		void setCacheSize(size_t bytes);
+		size_t getCacheSize() { return myCacheSize; }
+		size_t getCacheMemoryUsage() { return myCacheMemoryUsage; }
+		//! Sets the time (in seconds) after which pending requests for tiles
+		//! that are not visible anymore get cancelled.
+		void setRequestTimeout(float seconds) { myRequestTimeout = seconds; }
+		float getRequestTimeout() { return myRequestTimeout; }
+		void clearCache();
+		//@}
+
+	private:
+		struct CachedTile
+		{
+			Ref<PixelData> pixels;
+			Ref<ImageUtils::LoadImageAsyncTask> task;
+			double lastUsed;
+		};
+		typedef Dictionary<uint64_t, CachedTile> TileCache;
+
+		uint64_t getTileKey(int level, int column, int row)
+		{ return ((uint64_t)level << 48) | ((uint64_t)column << 24) | (uint64_t)row; }
+
+		// Returns the loaded tile pixels or NULL, requesting the tile with the
+		// given load priority if needed.
+		PixelData* requestTile(int level, int column, int row, double now, int priority);
+		// Fills in bounds and pixel region of a tile.
+		void setupTile(Tile& tile);
+		void trimCache(double now);
+
+	private:
+		String myTilePath;
+		String myFormat;
+		int myWidth;
+		int myHeight;
+		int myTileSize;
+		int myOverlap;
+		int myMaxLevel;
+
+		Lock myLock;
+		TileCache myCache;
+		size_t myCacheSize;
+		size_t myCacheMemoryUsage;
+		float myRequestTimeout;
+		Timer myTimer;
+
+		Stat* myRequestStat;
+		Stat* myMemoryStat;
+	};
+}; // namespace omega
+
+#endif
@@ -45,6 +45,15 @@ namespace omega {
 			FormatJpeg
 		};
 
+		//! Priorities for asynchronous image loads. Higher priority requests
+		//! are served first, requests with the same priority are served in
+		//! the order they were queued.
+		enum LoadPriority {
+			PriorityLow = 0,
+			PriorityNormal = 1,
+			PriorityHigh = 2
+		};
+
 		struct LoadImageAsyncTaskData
 		{
 			LoadImageAsyncTaskData() {}
@@ -78,9 +87,14 @@ namespace omega {
 		//! Load an image from a stream.
 		static Ref<PixelData> loadImageFromStream(std::istream& fin, const String& streamName);
 		//! Load image from a file (async)
-		static LoadImageAsyncTask* loadImageAsync(const String& filename, bool hasFullPath = false);
+		//! Queued requests are skipped if cancel() is called on their task 
+		//! before they are served.
+		static LoadImageAsyncTask* loadImageAsync(const String& filename, bool hasFullPath = false, int priority = PriorityNormal);
+		//! Returns the number of asynchronous load requests waiting to be served.
+		static int getImageQueueLength();
 		//! Encodes an image using the specified format. Returns a byte array containing the encoded image data.
-		static ByteArray* encode(PixelData* data, ImageFormat format);
+		//! quality (1-100) is used by lossy formats. Pass 0 to use the format default.
+		static ByteArray* encode(PixelData* data, ImageFormat format, int quality = 0);
 		//! Load an image from a memory buffer
 		static Ref<PixelData> decode(void* data, size_t size, const String& bufName = "<no_name>");
 
@@ -89,6 +103,23 @@ namespace omega {
 
 		static void setVerbose(bool value) { sVerbose = value; }
 
+		//! Decoded image cache
+		//! When enabled, images loaded from files through loadImage or 
+		//! loadImageAsync are kept in memory, keyed by their resolved path
+		//! and modification time. Cached images are shared between callers
+		//! and should be treated as read-only.
+		//@{
+		static void setCacheEnabled(bool value);
+		static bool isCacheEnabled() { return sCacheEnabled; }
+		//! Sets the cache memory budget in bytes. Least recently used images
+		//! are evicted when the budget is exceeded.
+		static void setCacheSize(size_t bytes);
+		static size_t getCacheSize() { return sCacheSize; }
+		//! Returns the number of bytes currently used by cached images.
+		static size_t getCacheMemoryUsage();
+		static void clearCache();
+		//@}
+
 		//! Sets the number if image loading threads. Must be called before the fist call to loadImageAsync.
 		static void setImageLoaderThreads(int num) { sNumLoaderThreads = num; }
 		//! Gets the number of image loading threads
@@ -96,6 +127,7 @@ namespace omega {
 		
 	private:
 		static Ref<PixelData> ffbmpToPixelData(FIBITMAP*& image, const String& filename);
+		static Ref<PixelData> loadImageFile(const String& path, const String& filename);
 
 	private:
 		static Vector<void*> sPreallocBlocks;
@@ -104,6 +136,8 @@ namespace omega {
 		static List<Thread*> sImageLoaderThread;
 		static bool sVerbose;
 		static int sNumLoaderThreads;
+		static bool sCacheEnabled;
+		static size_t sCacheSize;
 
 	private:
 		ImageUtils() {}
@@ -0,0 +1,142 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A work-stealing job system shared by engine subsystems and modules.
+ *************************************************************************************************/
+#ifndef __JOB_SYSTEM_H__
+#define __JOB_SYSTEM_H__
+
+#include "osystem.h"
+#include "omega/Semaphore.h"
+
+namespace omega {
+	class JobSystem;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! Base class for units of work run by the JobSystem.
+	class OMEGA_API Job: public ReferenceType
+	{
+	friend class JobSystem;
+	public:
+		Job(): myPendingDependencies(0), mySubmitted(false), myDone(false), myWaiters(0) {}
+		virtual ~Job() {}
+
+		//! Runs the job. Called by a worker thread, or by a thread waiting 
+		//! for jobs to finish.
+		virtual void execute() = 0;
+
+		//! Makes this job wait for another job to finish before starting.
+		//! Dependencies must be added before this job is submitted.
+		void addDependency(Job* job);
+		bool isDone();
+
+	private:
+		// Jobs waiting for this one to finish.
+		Vector< Ref<Job> > myDependents;
+		int myPendingDependencies;
+		bool mySubmitted;
+		bool myDone;
+		// Threads blocked in JobSystem::wait for this job, woken up by 
+		// myDoneSignal when it finishes.
+		int myWaiters;
+		Semaphore myDoneSignal;
+
+		// Protects dependency counts and done flags of all jobs.
+		static Lock sDependencyLock;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! Body of a JobSystem::parallelFor loop.
+	class OMEGA_API ParallelLoop
+	{
+	public:
+		virtual ~ParallelLoop() {}
+		//! Processes the items in [first, end). Called concurrently for 
+		//! disjoint ranges.
+		virtual void run(int first, int end) = 0;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! A pool of worker threads running jobs.
+	//! @remarks
+	//!		Each worker owns a job deque. Jobs submitted by a worker (for 
+	//!		instance, jobs forked by another job) go to the back of its own 
+	//!		deque, and the worker takes jobs from the back, so recently forked 
+	//!		work runs first while its data is still in cache. Jobs submitted 
+	//!		by other threads go to a shared queue. Workers with nothing to do
+	//!		steal from the front of other workers deques, where the oldest 
+	//!		(and usually largest) jobs are. Idle workers sleep on a semaphore.
+	//!		Threads waiting for a job (see wait) run other jobs meanwhile, so
+	//!		jobs can fork and join without blocking workers, and sleep until
+	//!		the job is done once there is nothing else to run. With no worker 
+	//!		threads, jobs run on the thread that waits for them.
+	class OMEGA_API JobSystem
+	{
+	public:
+		//! Returns the number of processor cores of this machine.
+		static int getNumCores();
+
+	public:
+		JobSystem();
+		~JobSystem();
+
+		//! Sets the number of worker threads. Must not be called while jobs
+		//! are running.
+		void setThreads(int threads);
+		int getThreads() { return myWorkers.size(); }
+
+		//! Queues a job. The job starts once all its dependencies are done.
+		void submit(Job* job);
+		//! Runs jobs until the specified job is done.
+		void wait(Job* job);
+		//! Splits [0, count) in ranges of at most batchSize items, runs 
+		//! loop on them in parallel and waits for all of them to finish.
+		void parallelFor(int count, int batchSize, ParallelLoop* loop);
+
+	private:
+		class WorkerThread;
+		friend class WorkerThread;
+		struct Worker;
+
+		//! Pushes a job whose dependencies are done to a queue.
+		void schedule(Job* job);
+		//! Takes a job from the queue of the specified worker, the shared
+		//! queue, or other workers. Pass -1 for threads that are not workers.
+		Ref<Job> findJob(int worker);
+		void runJob(Job* job);
+		void stopThreads();
+
+	private:
+		Vector<Worker*> myWorkers;
+		List< Ref<Job> > mySharedQueue;
+		Lock mySharedQueueLock;
+		Semaphore myWorkSignal;
+		bool myShutdown;
+	};
+}; // namespace omega
+
+#endif
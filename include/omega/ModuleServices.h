@@ -50,19 +50,28 @@ namespace omega {
 	friend class ModuleServices;
 	public:
 		enum Priority { PriorityLowest = 0, PriorityLow = 1, PriorityNormal = 2, PriorityHigh = 3, PriorityHighest = 4 };
+		//! Event service and event types up to this value can be used in
+		//! event filters.
+		static const int MaxFilterType = 63;
 
 	public:
 		EngineModule(const String& name): 
 		  myInitialized(false), myEngine(NULL), myName(name), 
 			  myPriority(PriorityNormal), mySharedDataEnabled(false),
-			  myEventTimeStat(NULL),  myUpdateTimeStat(NULL) 
+			  myParallelUpdateEnabled(false),
+			  myEventServiceMask(0), myEventTypeMask(0), 
+			  myEventSourceFirst(0), myEventSourceLast(0xffffffff),
+			  myInitializeTimeStat(NULL), myEventTimeStat(NULL),  myUpdateTimeStat(NULL) 
 		  {
 		  }
 
 		EngineModule(): 
 		  myInitialized(false), myEngine(NULL), myName(mysNameGenerator.generate()), 
 			  myPriority(PriorityNormal), mySharedDataEnabled(false),
-			  myEventTimeStat(NULL),  myUpdateTimeStat(NULL) 
+			  myParallelUpdateEnabled(false),
+			  myEventServiceMask(0), myEventTypeMask(0), 
+			  myEventSourceFirst(0), myEventSourceLast(0xffffffff),
+			  myInitializeTimeStat(NULL), myEventTimeStat(NULL),  myUpdateTimeStat(NULL) 
 	      {
 		  }
 
@@ -82,16 +91,70 @@ namespace omega {
 
 		void doInitialize(Engine* server);
 		void doDispose();
+		//! Calls update, timing it if module timing is enabled.
+		void doUpdate(const UpdateContext& context);
 
 		virtual bool isInitialized() { return myInitialized; }
 
 		Engine* getEngine() { return myEngine; }
 
 		Priority getPriority() { return myPriority; }
-		void setPriority(Priority value) { myPriority = value; }
+		void setPriority(Priority value);
 		
 		const String& getName() { return myName; }
 
+		//! Event filters
+		//! By default, modules receive all events. Filters restrict the 
+		//! events passed to handleEvent: a module only receives events 
+		//! matching all the filters that have been set. Event dispatch uses
+		//! filters to skip modules, so modules that only handle a few event
+		//! sources should set them.
+		//@{
+		//! Accepts events from the specified service type. Can be called 
+		//! multiple times to accept several service types.
+		void addEventServiceType(Service::ServiceType type);
+		//! Accepts events of the specified type. Can be called multiple 
+		//! times to accept several event types.
+		void addEventType(Event::Type type);
+		//! Accepts events whose source id is in [first, last].
+		void setEventSourceRange(uint first, uint last);
+		void clearEventFilters();
+		//! Returns true if the event passes the event filters.
+		bool isEventAccepted(const Event& evt);
+		//@}
+
+		//! Parallel update
+		//@{
+		//! When enabled, update runs as a job on the engine job system, 
+		//! concurrently with the updates of other modules with parallel 
+		//! update enabled. Parallel updates run after the updates of all 
+		//! the other modules.
+		void setParallelUpdateEnabled(bool value) { myParallelUpdateEnabled = value; }
+		bool isParallelUpdateEnabled() { return myParallelUpdateEnabled; }
+		//! Makes the parallel update of this module start after the update 
+		//! of the specified module is done. Dependencies on modules without
+		//! parallel update are always satisfied, since those modules are
+		//! updated first. Dependencies must not be circular.
+		void addUpdateDependency(EngineModule* module) { myUpdateDependencies.push_back(module); }
+		void removeUpdateDependency(EngineModule* module) { myUpdateDependencies.remove(module); }
+		//@}
+
+		//! Timing statistics. Stats are NULL unless module timing is enabled
+		//! (see ModuleServices::setTimingEnabled). Commit and shared data 
+		//! update stats are returned by getCommitTimeStat and 
+		//! getSharedUpdateTimeStat.
+		//@{
+		Stat* getInitializeTimeStat() { return myInitializeTimeStat; }
+		Stat* getUpdateTimeStat() { return myUpdateTimeStat; }
+		Stat* getEventTimeStat() { return myEventTimeStat; }
+		//! Returns the total time in milliseconds spent in this module code 
+		//! since timing was enabled.
+		double getTotalTime();
+		//@}
+
+	private:
+		void setTimingEnabled(bool value);
+
 	private:
 		Ref<Engine> myEngine;
 
@@ -99,10 +162,19 @@ namespace omega {
 		Priority myPriority;
 		bool myInitialized;
 		bool mySharedDataEnabled;
+		bool myParallelUpdateEnabled;
+		List<EngineModule*> myUpdateDependencies;
+
+		// Event filters. Zero masks accept everything.
+		uint64_t myEventServiceMask;
+		uint64_t myEventTypeMask;
+		uint myEventSourceFirst;
+		uint myEventSourceLast;
 
 		static NameGenerator mysNameGenerator;
 
 		// Statistics
+		Ref<Stat> myInitializeTimeStat;
 		Ref<Stat> myEventTimeStat;
 		Ref<Stat> myUpdateTimeStat;
 	};
@@ -126,11 +198,46 @@ namespace omega {
 		
 		static Vector<EngineModule*> getModules();
 
+		//! Module timing
+		//@{
+		//! Enables per-module timing of initialize, update, handleEvent and
+		//! shared data commit / update. Timing is disabled by default: when
+		//! disabled, module calls are not timed at all.
+		static void setTimingEnabled(bool value);
+		static bool isTimingEnabled() { return mysTimingEnabled; }
+		//! Returns up to n modules, sorted by the total time spent in their
+		//! code, slowest first.
+		static Vector<EngineModule*> getSlowestModules(int n);
+		//! Prints a timing report for the n slowest modules.
+		static void printSlowestModules(int n);
+		//@}
+
+		//! Marks the event routing table as out of date. Called when modules
+		//! are added or removed, or change their priority or event filters.
+		static void invalidateEventRoutes() { mysEventRoutesDirty = true; }
+
+	private:
+		//! Runs the update of modules with parallel update enabled as jobs.
+		static void updateParallel(Engine* srv, const Vector<EngineModule*>& modules, const UpdateContext& context);
+		//! Rebuilds the event routing table.
+		static void buildEventRoutes();
+
 	private:
 		static List< Ref<EngineModule> > mysModules;
 		static List< Ref<EngineModule> > mysModulesToRemove;
 		static List< EngineModule* > mysNonCoreModules;
 		static bool mysCoreMode;
+		static bool mysTimingEnabled;
+
+		// Event routing table. For each priority, modules interested in each
+		// service type, in module order. The last entry of each priority 
+		// lists all its modules, for service types out of the filter range.
+		static const int NumEventRoutes = EngineModule::MaxFilterType + 2;
+		static Vector<EngineModule*> mysEventRoutes[EngineModule::PriorityHighest + 1][NumEventRoutes];
+		static bool mysEventRoutesDirty;
+		// Nesting level of handleEvent calls. Routes are not rebuilt while
+		// they are being iterated.
+		static int mysEventDispatchDepth;
 		static Timer mysTimer;
 	};
 }; // namespace omega
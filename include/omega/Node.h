@@ -54,6 +54,7 @@ namespace omega {
     */
     class OMEGA_API Node: public ReferenceType 
     {
+    friend class TransformSystem;
     public:
         /** Enumeration denoting the spaces which a transform can be relative to.
         */
@@ -67,7 +68,12 @@ namespace omega {
             TransformWorld
         };
 
-        typedef Dictionary<String, Ref<Node> > ChildNodeMap;
+        //! Name lookup table for children. Does not own the nodes.
+        typedef Dictionary<String, Node*> ChildNodeMap;
+        //! Ordered list of children, used for iteration.
+        typedef List<Node*> ChildNodeList;
+        //! Indexed child slots. Owns the child nodes.
+        typedef Vector< Ref<Node> > ChildNodeSlots;
 
     public:
         /** Constructor, should only be called by parent, not directly.
@@ -355,6 +361,9 @@ namespace omega {
 
         /** Adds a (precreated) child scene node to this node. If it is attached to another node,
             it must be detached first.
+        @remarks
+            Children with an empty name are not added to the name lookup
+            table, and can only be accessed by index or through getChildren.
         @param child The Node which is to become a child node of this one
         */
         virtual void addChild(Node* child);
@@ -366,6 +375,10 @@ namespace omega {
         /** Gets a pointer to a child node.
         @remarks
             There is an alternate getChild method which returns a named child.
+            Children are indexed in the order they have been added. Indexed
+            access is constant time, unless children other than the first 
+            or last have been removed since the last compaction of the child
+            slots.
         */
         virtual Node* getChild(unsigned short index) const;    
 
@@ -401,8 +414,9 @@ namespace omega {
         */
         virtual void removeAllChildren(void);
 		
-		//! #PYPI Returns the list of children of this node
-		const List<Node*>& getChildren() const { return mChildrenList; }
+		//! #PYPI Returns the list of children of this node, in the order
+		//! they have been added.
+		const ChildNodeList& getChildren() const { return mChildrenList; }
 
 		/** Sets the final world position of the node directly.
 		@remarks 
@@ -489,19 +503,46 @@ namespace omega {
 
 		void setName(const String& name);
 		bool isUpdateNeeded() { return mNeedParentUpdate; }
-		//! Children begin iterator
-		//List<Node*>::iterator begin() { return mChildrenList.begin(); }
-		//List<Node*>::const_iterator begin() const { return mChildrenList.begin(); }
-		////! Children end iterator
-		//List<Node*>::const_iterator end() const { return mChildrenList.end(); }
+
+    private:
+        /// Detaches a child from the children list and name table, without
+        /// touching its parent pointer.
+        void detachChild(Node* child);
+        /// Removes the empty slots left by removed children from the 
+        /// child slots, and renumbers the remaining children.
+        void compactChildren();
 
     protected:
         /// Pointer to parent node
         Node* mParent;
-        /// Collection of pointers to direct children; hashmap for efficiency
+        /// Named children, for lookup by name. Unnamed children are not 
+        /// stored here.
         ChildNodeMap mChildren;
-		// Children list, used to simplify iteration.
-		List<Node*> mChildrenList;
+        /// Direct children, in insertion order. Each child keeps its position
+        /// in the list, so it can be removed in constant time.
+        ChildNodeList mChildrenList;
+        /// Direct children by index, in insertion order. Removed children 
+        /// leave an empty slot that is reclaimed by compactChildren once empty
+        /// slots make up half of the slots.
+        ChildNodeSlots mChildSlots;
+        /// Number of empty slots in mChildSlots.
+        uint mChildrenHoles;
+        /// Index of the first non-empty slot in mChildSlots. All slots before
+        /// it are empty.
+        uint mFirstChildSlot;
+        /// Index of this node in the parent child slots.
+        uint mChildIndex;
+        /// Position of this node in the parent children list.
+        ChildNodeList::iterator mChildListPos;
+        /// Changed on the root of a hierarchy every time a node parent 
+        /// changes inside it. Used by TransformSystem to know when to flatten
+        /// the hierarchy again.
+        uint mHierarchyVersion;
+        /// Source of hierarchy versions. Versions are unique, so a new root
+        /// allocated where an old one was does not look unchanged.
+        static uint sHierarchyVersion;
+        /// Index of this node in the TransformSystem flat arrays.
+        int mTransformIndex;
 
 		typedef std::set<Node*> ChildUpdateSet;
         /// List of children which need updating, used if self is not out of date but children are
@@ -540,6 +581,8 @@ namespace omega {
 
         /// Only available internally - notification of parent.
         virtual void setParent(Node* parent);
+        /// Increments the hierarchy version of the root of this node.
+        void hierarchyChanged();
 
         /** Cached combined orientation.
             @par
@@ -36,6 +36,7 @@
 #define __ISCENE_OBJECT_H__
 
 #include "osystem.h"
+#include "omega/StatsManager.h"
 
 namespace omega {
 	class Engine;
@@ -50,9 +51,18 @@ namespace omega {
 	class OMEGA_API NodeComponent: public ReferenceType
 	{
 	friend class SceneNode;
+	friend class ComponentScheduler;
 	public:
-		NodeComponent(): myNeedBoundingBoxUpdate(false), myOwner(NULL) {}
+		NodeComponent(): 
+			myNeedBoundingBoxUpdate(false), myOwner(NULL), 
+			myParallelUpdate(false), myUpdateTime(0) {}
 		virtual void update(const UpdateContext& context) = 0;
+		//! Returns true if update can run on a worker thread, concurrently 
+		//! with the updates of other thread-safe components. Thread-safe 
+		//! components must only modify their own state during update: they
+		//! must not change the scene graph or other components. They can still
+		//! call requestBoundingBoxUpdate. See ComponentScheduler.
+		virtual bool isThreadSafe() { return false; }
 		virtual void draw(const DrawContext& context) {};
 		virtual const AlignedBox3* getBoundingBox() { return NULL; }
 		virtual bool hasBoundingBox() { return false; }
@@ -69,12 +79,23 @@ namespace omega {
 
 		SceneNode* getOwner() { return myOwner; }
 
+		//! When set, the time spent in update is sampled into this stat. 
+		//! Components of the same kind can share a stat.
+		void setUpdateStat(Stat* stat) { myUpdateStat = stat; }
+		Stat* getUpdateStat() { return myUpdateStat; }
+
 	private:
 		void attach(SceneNode* owner) { myOwner = owner; onAttached(myOwner); }
 		void detach(SceneNode* owner) { onDetached(myOwner); myOwner = NULL; }
 
 		bool myNeedBoundingBoxUpdate;
 		SceneNode* myOwner;
+
+		// Set while the component is queued for a parallel update. Bounding
+		// box requests are forwarded to the owner once the update is done.
+		bool myParallelUpdate;
+		Ref<Stat> myUpdateStat;
+		double myUpdateTime;
 	};
 }; // namespace omega
 
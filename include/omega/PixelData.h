@@ -81,6 +81,17 @@ namespace omega {
 
 		void copyFrom(PixelData* other);
 
+		//! Marks the whole image as changed.
+		virtual void setDirty(bool value = true);
+		//! Marks a region of the image as changed. Textures are refreshed
+		//! uploading only the union of the regions changed since their last
+		//! update.
+		void setDirtyRegion(int x, int y, int width, int height);
+		//! Returns the region changed since the last call for the specified
+		//! GPU context, and resets it. Returns the whole image when the image
+		//! was marked as fully changed.
+		Rect takeDirtyRegion(uint contextId);
+
 		//! Simple pixel access
 		//@{
 		void beginPixelAccess();
@@ -98,6 +109,15 @@ namespace omega {
 	private:
 		void updateSize();
 
+		//! Changed image region, tracked separately for each GPU context.
+		struct DirtyRegion
+		{
+			DirtyRegion(): full(true), x0(0), y0(0), x1(0), y1(0) {}
+			bool isEmpty() { return !full && x1 <= x0; }
+			bool full;
+			int x0, y0, x1, y1;
+		};
+
 	private:
 		uint myUsageFlags;
 		bool myChangingPixels;
@@ -112,6 +132,9 @@ namespace omega {
 
 		// PBO stuff
 		GLuint myPBOId;
+
+		Lock myDirtyRegionLock;
+		DirtyRegion myDirtyRegions[GpuContext::MaxContexts];
 	};
 }; // namespace omega
 
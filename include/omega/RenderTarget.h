@@ -42,6 +42,16 @@ namespace omega
 	{
 	friend class Renderer;
 	public:
+		//! Interface for objects notified when an asynchronous readback 
+		//! completes.
+		class IReadbackListener
+		{
+		public:
+			//! Called from the render thread after the pixels of frame have
+			//! been copied to the color and depth readback targets.
+			virtual void onReadbackCompleted(RenderTarget* target, uint64_t frame) = 0;
+		};
+
 		enum Type {
 			//! Render to the main framebuffer. Supports readback targets.
 			RenderOnscreen, 
@@ -67,9 +77,33 @@ namespace omega
 		void unbind();
 		bool isBound();
 		void readback();
+		//! Reads back the depth target only. The color target is not modified
+		//! and not marked dirty.
+		void readbackDepth();
 		void clear();
 		//@}
 
+		//! Asynchronous readback
+		//! When enabled, readback() queues the transfer of the current frame
+		//! to a ring of pixel buffer objects and copies completed transfers 
+		//! to the readback targets, so the GPU pipeline is not stalled. The
+		//! readback targets lag behind the rendered frames by at most
+		//! bufferCount - 1 frames.
+		//@{
+		void setAsyncReadback(bool enabled, int bufferCount = 3);
+		bool isAsyncReadbackEnabled() { return myAsyncReadback; }
+		//! Returns the readback frame counter. It is incremented on each
+		//! readback() call.
+		uint64_t getReadbackFrame() { return myReadbackFrame; }
+		//! Returns the frame currently stored in the readback targets.
+		uint64_t getCompletedReadbackFrame() { return myCompletedReadbackFrame; }
+		//! Returns the number of frames the readback targets lag behind the
+		//! last rendered frame.
+		int getReadbackLatency() { return (int)(myReadbackFrame - myCompletedReadbackFrame); }
+		void setReadbackListener(IReadbackListener* listener) { myReadbackListener = listener; }
+		IReadbackListener* getReadbackListener() { return myReadbackListener; }
+		//@}
+
 		GLuint getId() { return myId; };
 		virtual void dispose();
 
@@ -96,6 +130,31 @@ namespace omega
 		PixelData* myReadbackColorTarget;
 		PixelData* myReadbackDepthTarget;
 		Rect myReadbackViewport;
+
+		// Asynchronous readback stuff
+		struct ReadbackBuffer
+		{
+			GLuint colorPbo;
+			GLuint depthPbo;
+			size_t colorSize;
+			size_t depthSize;
+			// Sync object (GLsync) signaled when the transfer completes.
+			void* fence;
+			bool pending;
+			uint64_t frame;
+		};
+		void readbackAsync();
+		void queueReadback(ReadbackBuffer& rb);
+		void completeReadback(ReadbackBuffer& rb);
+		void disposeReadbackBuffers();
+
+		bool myAsyncReadback;
+		int myReadbackBufferCount;
+		Vector<ReadbackBuffer> myReadbackBuffers;
+		int myNextReadbackBuffer;
+		uint64_t myReadbackFrame;
+		uint64_t myCompletedReadbackFrame;
+		IReadbackListener* myReadbackListener;
 	};
 
 	///////////////////////////////////////////////////////////////////////////////////////////////
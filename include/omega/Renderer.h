@@ -42,6 +42,7 @@
 #include "omega/ApplicationBase.h"
 #include "omega/SystemManager.h"
 #include "omega/RenderTarget.h"
+#include "omega/SceneDrawList.h"
 
 namespace omega {
 	class RenderPass;
@@ -86,6 +87,9 @@ namespace omega {
 		RenderTarget* createRenderTarget(RenderTarget::Type type);
 		//@}
 
+		//! Returns the list of scene nodes drawn by this renderer.
+		SceneDrawList* getSceneDrawList() { return &myDrawList; }
+
 	private:
 		void innerDraw(const DrawContext& context, Camera* camera);
 
@@ -104,8 +108,15 @@ namespace omega {
 
 		List< Ref<GpuResource> > myResources;
 
+		// Flattened scene, rebuilt once per frame and culled for each eye.
+		SceneDrawList myDrawList;
+
 		// Stats
 		Ref<Stat> myFrameTimeStat;
+		Ref<Stat> myNodesDrawnStat;
+		Ref<Stat> myNodesCulledStat;
+		Ref<Stat> myDrawBatchesStat;
+		Ref<Stat> myDrawPrimitivesStat;
 	};
 
 	///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,99 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A flattened, frustum-culled list of the scene nodes drawn by a renderer.
+ *************************************************************************************************/
+#ifndef __SCENE_DRAW_LIST_H__
+#define __SCENE_DRAW_LIST_H__
+
+#include "osystem.h"
+#include "omega/DrawContext.h"
+
+namespace omega {
+	class SceneNode;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! A flattened list of the visible scene nodes, built once per frame by a
+	//! renderer and reused for all the eyes, cameras and tiles it draws.
+	//! @remarks
+	//!		Nodes are stored in scene tree order, and each entry knows where 
+	//!		its subtree ends. When the world bounding box of a node is outside 
+	//!		the view frustum the node and its whole subtree are skipped. Nodes 
+	//!		with components that have no bounding box, and their ancestors, 
+	//!		are never culled.
+	//!		Building and culling the list do not need a GL context.
+	class OMEGA_API SceneDrawList
+	{
+	public:
+		SceneDrawList();
+
+		//! Rebuilds the list from the scene tree if it was not built for 
+		//! the specified frame yet.
+		void update(SceneNode* root, uint64 frameNum);
+		//! Rebuilds the list from the scene tree.
+		void build(SceneNode* root);
+
+		//! Returns the nodes whose components should be drawn in the 
+		//! specified context, in draw order.
+		void cull(const DrawContext& context, Vector<SceneNode*>& outNodes);
+		//! Culls the list and draws the visible nodes.
+		void draw(const DrawContext& context);
+
+		//! Returns the number of nodes in the list.
+		int getNumNodes() { return myEntries.size(); }
+		//! Returns the number of nodes drawn and culled by the last call to
+		//! draw.
+		int getNumDrawn() { return myNumDrawn; }
+		int getNumCulled() { return myNumCulled; }
+
+		void setCullingEnabled(bool value) { myCullingEnabled = value; }
+		bool isCullingEnabled() { return myCullingEnabled; }
+
+	private:
+		int addNode(SceneNode* node);
+
+	private:
+		struct Entry
+		{
+			SceneNode* node;
+			//! Index of the first entry after this node subtree.
+			int next;
+			//! False if the node or one of its descendants has components 
+			//! not covered by the node bounding box.
+			bool cullable;
+		};
+		Vector<Entry> myEntries;
+		Vector<SceneNode*> myVisibleNodes;
+		uint64 myFrame;
+		bool myBuilt;
+		bool myCullingEnabled;
+		int myNumDrawn;
+		int myNumCulled;
+	};
+}; // namespace omega
+
+#endif
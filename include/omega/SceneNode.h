@@ -74,6 +74,9 @@ namespace omega {
     //!				visibility change, selection change and other events.
     class OMEGA_API SceneNode: public Node
     {
+    friend class SceneBvh;
+    friend class SceneDrawList;
+    friend class TransformSystem;
     public:
 //		typedef ChildNode<SceneNode> Child;
         enum HitType { 
@@ -96,7 +99,8 @@ namespace omega {
             myTracker(NULL),
             myNeedsBoundingBoxUpdate(false),
             myFacingCameraFixedY(false),
-            myFlags(0)
+            myFlags(0),
+            myBvhEntry(-1)
             {}
 
         SceneNode(Engine* server, const String& name):
@@ -112,9 +116,12 @@ namespace omega {
             myTracker(NULL),
             myNeedsBoundingBoxUpdate(false),
             myFacingCameraFixedY(false),
-            myFlags(0)
+            myFlags(0),
+            myBvhEntry(-1)
             {}
 
+        virtual ~SceneNode();
+
         Engine* getEngine();
 
         // Object
@@ -210,13 +217,17 @@ namespace omega {
         virtual void updateTraversal(const UpdateContext& context);
         /// Only available internally - notification of parent.
         virtual void setParent(Node* parent);
+        virtual void updateFromParent(void) const;
         void onAttachedToScene();
         void onDetachedFromScene();
     
     private:
+        //! Draws the components attached to this node, but not its children.
+        void drawComponents(const DrawContext& context);
         void drawBoundingBox();
         void updateBoundingBox(bool force = false);
         bool needsBoundingBoxUpdate();
+        void invalidateBvhEntry() const;
 
     private:
         Engine* myServer;
@@ -248,6 +259,10 @@ namespace omega {
         bool myFacingCameraFixedY;
         // Tracked object. This is internally managed and does not need Ref. 
         TrackedObject* myTracker;
+
+        // Index of this node entry in the engine SceneBvh, -1 if the node is
+        // not in the hierarchy.
+        int myBvhEntry;
     };
 
     ///////////////////////////////////////////////////////////////////////////
@@ -257,6 +272,7 @@ namespace omega {
         if(!myNeedsBoundingBoxUpdate)
         {
             myNeedsBoundingBoxUpdate = true;
+            if(myBvhEntry >= 0) invalidateBvhEntry();
             SceneNode* parent = dynamic_cast<SceneNode*>(getParent());
             if(parent != NULL) parent->requestBoundingBoxUpdate();
         }
@@ -332,7 +348,9 @@ namespace omega {
     inline void NodeComponent::requestBoundingBoxUpdate() 
     { 
         myNeedBoundingBoxUpdate = true; 
-        if(myOwner) 
+        // During a parallel update the owner is notified by the component
+        // scheduler, once all the workers are done.
+        if(myOwner && !myParallelUpdate) 
         {
             myOwner->requestBoundingBoxUpdate();
         }
@@ -39,16 +39,123 @@ namespace omega {
 	};
 
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Comparison function to sort scene query results by distance.
-	inline bool SceneQueryResultDistanceCompare(SceneQueryResult& r1, SceneQueryResult& r2)
+	// Comparison function to sort scene query results by distance, nearest first.
+	inline bool SceneQueryResultDistanceCompare(const SceneQueryResult& r1, const SceneQueryResult& r2)
 	{
-		if(r1.distance < r2.distance) return false;
-		return true;
+		return r1.distance < r2.distance;
 	}
 
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// A list of scene query results.
-	typedef std::list<SceneQueryResult> SceneQueryResultList;
+	typedef Vector<SceneQueryResult> SceneQueryResultList;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	//! A bounding volume hierarchy over the scene nodes attached to the scene, 
+	//! used to accelerate ray scene queries. 
+	//! @remarks
+	//!		Scene nodes add themselves to the hierarchy when attached to the scene
+	//!		and remove themselves when detached. When the world transform or 
+	//!		bounds of a node change, its entry is marked as dirty and refitted 
+	//!		before the next query. New nodes are inserted incrementally, and the
+	//!		whole hierarchy is rebuilt once the number of insertions grows past 
+	//!		the size of the last build.
+	//!		Node entries use a cube containing both the node bounding box and 
+	//!		its bounding sphere, so they bound any hit returned by SceneNode::hit.
+	//!		Nodes without finite bounds are not culled, and are always tested.
+	//!		All methods except invalidateNode must be called from the main 
+	//!		thread. invalidateNode can be called from any thread.
+	class OMEGA_API SceneBvh
+	{
+	public:
+		//! Maximum number of scene nodes in a hierarchy leaf.
+		static const int MaxLeafSize = 4;
+
+	public:
+		SceneBvh();
+
+		void addNode(SceneNode* node);
+		void removeNode(SceneNode* node);
+		//! Marks the entry of a node as dirty. Its bounds will be updated
+		//! before the next query.
+		void invalidateNode(SceneNode* node);
+		//! Removes all nodes.
+		void clear();
+
+		int getNumNodes() { return myNumEntries; }
+
+		//! Returns all the selectable, visible nodes hit by the ray. When 
+		//! queryFirst is true, only the nearest hit is returned and traversal
+		//! stops at the first subtree farther than the current nearest hit.
+		void queryRay(const Ray& ray, bool queryFirst, SceneQueryResultList& results);
+
+	private:
+		struct Entry
+		{
+			SceneNode* node;
+			Vector3f min;
+			Vector3f max;
+			//! Index of the hierarchy leaf containing this entry, or -1 for 
+			//! nodes without finite bounds.
+			int leaf;
+			//! True when the entry is in the hierarchy or the unbounded list.
+			bool placed;
+			bool dirty;
+		};
+		struct BvhNode
+		{
+			Vector3f min;
+			Vector3f max;
+			int parent;
+			//! Child indices for internal nodes, -1 for leaves.
+			int left;
+			int right;
+			int count;
+			int entries[MaxLeafSize];
+		};
+		struct StackItem
+		{
+			int node;
+			float distance;
+		};
+		struct CentroidCompare;
+
+		//! Brings the hierarchy up to date. Called before each query.
+		void update();
+		bool updateEntryBounds(Entry& e);
+		void placeEntry(int entry);
+		void unplaceEntry(int entry);
+		void insertEntry(int entry);
+		void removeEntry(int entry);
+		int splitLeaf(int leaf, int entry);
+		void rebuild();
+		int build(int first, int count, int parent);
+		void refitNode(int node);
+		void refitUp(int node);
+		void testEntry(int entry, const Ray& ray, bool queryFirst, 
+			SceneQueryResult& nearest, SceneQueryResultList& results);
+
+	private:
+		// Protects the dirty entry list and flags, and the entry table.
+		Lock myLock;
+
+		Vector<Entry> myEntries;
+		Vector<int> myFreeEntries;
+		Vector<int> myDirtyEntries;
+		Vector<int> myUnbounded;
+		int myNumEntries;
+
+		Vector<BvhNode> myNodes;
+		// Number of entries in the tree at the last rebuild, and insertions 
+		// since then.
+		int myBuildSize;
+		int myInsertions;
+		bool myNeedsRebuild;
+
+		// Scratch buffers, kept to avoid reallocating them at each query.
+		Vector<StackItem> myStack;
+		Vector<int> myBuildEntries;
+		Vector<int> myUpdateEntries;
+	};
 
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	class OMEGA_API SceneQuery
@@ -75,18 +182,25 @@ namespace omega {
 	class OMEGA_API RaySceneQuery: public SceneQuery
 	{
 	public:
-		RaySceneQuery() {}
+		RaySceneQuery(): myBvh(NULL) {}
 
 		void setRay(const Ray& ray) { myRay = ray; }
 		const Ray& getRay() { return myRay; }
 
+		//! When a scene hierarchy is set, queries use it instead of traversing
+		//! the scene tree. The hierarchy indexes all the scene nodes attached
+		//! to the scene, so the query scene node should be the scene root.
+		void setSceneBvh(SceneBvh* value) { myBvh = value; }
+		SceneBvh* getSceneBvh() { return myBvh; }
+
 		virtual const SceneQueryResultList& execute(uint flags = 0);
 
 	private:
-		void queryNode(SceneNode* node, SceneQueryResultList& list, bool queryFirst);
+		void queryNode(SceneNode* node, SceneQueryResultList& list, bool queryFirst, SceneQueryResult& nearest);
 
 	private:
 		Ray myRay;
+		SceneBvh* myBvh;
 	};
 }; // namespace omega
 
@@ -1,50 +1,56 @@
-/**************************************************************************************************
- * THE OMEGA LIB PROJECT
- *-------------------------------------------------------------------------------------------------
- * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
- * Authors:										
- *  Alessandro Febretti		febret@gmail.com
- *-------------------------------------------------------------------------------------------------
- * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
- * All rights reserved.
- * Redistribution and use in source and binary forms, with or without modification, are permitted 
- * provided that the following conditions are met:
- * 
- * Redistributions of source code must retain the above copyright notice, this list of conditions 
- * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
- * notice, this list of conditions and the following disclaimer in the documentation and/or other 
- * materials provided with the distribution. 
- * 
- * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
- * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
- * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
- * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
- * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
- * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
- * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
- *************************************************************************************************/
-#ifndef __SHARED_DATA_SERVICES__
-#define __SHARED_DATA_SERVICES__
-
-#include "omega/osystem.h"
-
-namespace co
-{
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************************************/
+#ifndef __SHARED_DATA_SERVICES__
+#define __SHARED_DATA_SERVICES__
+
+#include "omega/osystem.h"
+#include "omega/StatsManager.h"
+#include "omega/ApplicationBase.h"
+
+namespace co
+{
     class DataOStream;
     class DataIStream;
-};
-
-namespace omega
-{
-	class SharedData;
-	class EngineModule;
-
-	///////////////////////////////////////////////////////////////////////////////////////////////
+};
+
+namespace omega
+{
+	class SharedData;
+	class EngineModule;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
     class OMEGA_API SharedOStream
     {
     public:
-		SharedOStream(co::DataOStream* stream): myStream(stream) {}
+		SharedOStream(co::DataOStream* stream): myStream(stream), myBuffer(NULL), myBytesWritten(0), myKeyframe(true), myCommitting(true) {}
+		//! Creates a shared stream that appends all data to a memory buffer.
+		//! Used when the shared data frame needs to be assembled before 
+		//! sending it (i.e. for compression)
+		SharedOStream(Vector<byte>* buffer): myStream(NULL), myBuffer(buffer), myBytesWritten(0), myKeyframe(true), myCommitting(true) {}
 
         template< typename T > SharedOStream& operator << ( const T& value )
         { write( &value, sizeof( value )); return *this; }
@@ -53,17 +59,42 @@ namespace omega
 	
 		void write( const void* data, uint64_t size );
 
+		//! Returns the underlying Equalizer stream. Returns NULL for streams
+		//! writing to memory buffers: use the stream write methods instead.
 		co::DataOStream* getInternalStream() { return myStream; }
+
+		//! Returns the number of bytes written through this stream.
+		uint64_t getBytesWritten() { return myBytesWritten; }
+
+		//! Returns true if receivers of this stream may not hold the previous
+		//! state of shared objects (new slave nodes or periodic keyframes). 
+		//! Objects that send incremental updates need to send their full 
+		//! state on keyframes.
+		bool isKeyframe() { return myKeyframe; }
+		void setKeyframe(bool value) { myKeyframe = value; }
+
+		//! Returns true if this stream carries a frame committed to all the
+		//! slave nodes. Returns false when the stream only goes to a new slave
+		//! mapping the shared data: objects must then write their full state 
+		//! without updating what they track as sent to the other slaves.
+		bool isCommitting() { return myCommitting; }
+		void setCommitting(bool value) { myCommitting = value; }
 	
 	private:
 		co::DataOStream* myStream;
+		Vector<byte>* myBuffer;
+		uint64_t myBytesWritten;
+		bool myKeyframe;
+		bool myCommitting;
 	};
 
-	///////////////////////////////////////////////////////////////////////////////////////////////
+	///////////////////////////////////////////////////////////////////////////////////////////////
     class OMEGA_API SharedIStream
     {
     public:
-		SharedIStream(co::DataIStream* stream): myStream(stream) {}
+		SharedIStream(co::DataIStream* stream): myStream(stream), myData(NULL), myDataSize(0), myBytesRead(0) {}
+		//! Creates a shared stream that reads data from a memory buffer.
+		SharedIStream(const byte* data, uint64_t size): myStream(NULL), myData(data), myDataSize(size), myBytesRead(0) {}
 
         template< typename T >
         SharedIStream& operator >> ( T& value )
@@ -73,33 +104,241 @@ namespace omega
 	
 		void read( void* data, uint64_t size );
 	
+		//! Returns the underlying Equalizer stream. Returns NULL for streams
+		//! reading from memory buffers: use the stream read methods instead.
 		co::DataIStream* getInternalStream() { return myStream; }
 
+		//! Returns the number of bytes read through this stream.
+		uint64_t getBytesRead() { return myBytesRead; }
+		//! Returns the number of bytes still available for reading.
+		uint64_t getRemainingSize();
+
 	private:
 		co::DataIStream* myStream;
+		const byte* myData;
+		uint64_t myDataSize;
+		uint64_t myBytesRead;
 	};
 
-	///////////////////////////////////////////////////////////////////////////////////////////////
+	///////////////////////////////////////////////////////////////////////////////////////////////
 	class OMEGA_API SharedObject: public ReferenceType
 	{
+	friend class SharedData;
 	public:
+		SharedObject(): 
+			mySharedDataVersioned(false), mySharedRevision(0), myCommittedRevision(0) {}
+
 		virtual void commitSharedData(SharedOStream& out) {}
 		virtual void updateSharedData(SharedIStream& in) {}
+
+		//! Shared data versioning
+		//! When versioning is enabled, the object is sent to slave nodes only 
+		//! during frames where its shared data changed, and during periodic 
+		//! keyframes. Objects that do not enable versioning are sent every 
+		//! frame. Versioning needs to be enabled in the system configuration 
+		//! (config/sharedData/versioning) to have any effect.
+		//@{
+		void setSharedDataVersioned(bool value) { mySharedDataVersioned = value; }
+		bool isSharedDataVersioned() { return mySharedDataVersioned; }
+		//! Marks the shared data of this object as changed: the object will
+		//! be sent to slave nodes during the next frame.
+		void markSharedDataChanged() { mySharedRevision++; }
+		uint getSharedRevision() { return mySharedRevision; }
+		//! Returns true if this object needs to be sent during the next frame.
+		//! The default implementation compares the current revision with the
+		//! last committed one. Objects that track changes in other ways can
+		//! override this method.
+		virtual bool hasSharedDataChanged() { return mySharedRevision != myCommittedRevision; }
+		//@}
+
+		//! Shared data timing
+		//! When set, the time spent in commitSharedData and updateSharedData
+		//! is sampled into these stats. Set to NULL to disable timing.
+		//@{
+		void setSharedDataStats(Stat* commit, Stat* update) 
+		{ myCommitTimeStat = commit; mySharedUpdateTimeStat = update; }
+		Stat* getCommitTimeStat() { return myCommitTimeStat; }
+		Stat* getSharedUpdateTimeStat() { return mySharedUpdateTimeStat; }
+		//@}
+
+	private:
+		bool mySharedDataVersioned;
+		uint mySharedRevision;
+		uint myCommittedRevision;
+		Ref<Stat> myCommitTimeStat;
+		Ref<Stat> mySharedUpdateTimeStat;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! Base class for compressors used on shared data frames. When a 
+	//! compressor is set, each frame is assembled in memory and compressed 
+	//! before being sent to slave nodes, if its size is above the compression
+	//! threshold. The same compressor must be used on the master and slaves.
+	class OMEGA_API SharedDataCompressor: public ReferenceType
+	{
+	public:
+		virtual const String& getName() = 0;
+		//! Returns the maximum compressed size for a payload of the given size.
+		virtual uint64_t getMaxCompressedSize(uint64_t size) = 0;
+		//! Compresses a payload. Returns the compressed size, or 0 if the 
+		//! payload could not be compressed.
+		virtual uint64_t compress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize) = 0;
+		//! Decompresses a payload. Returns true if the decompressed data size
+		//! is equal to dstSize.
+		virtual bool decompress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize) = 0;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! A shared data compressor based on zlib, as provided by FreeImage.
+	class OMEGA_API ZLibSharedDataCompressor: public SharedDataCompressor
+	{
+	public:
+		ZLibSharedDataCompressor(): myName("zlib") {}
+		virtual const String& getName() { return myName; }
+		virtual uint64_t getMaxCompressedSize(uint64_t size);
+		virtual uint64_t compress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize);
+		virtual bool decompress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize);
+
+	private:
+		String myName;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! Encodes registered shared objects into shared data frames, and applies
+	//! received frames to them. Holds the object id table, versioning and 
+	//! compression state. The cluster shared data object sends the frames 
+	//! written here to slave nodes, but frames can be written to and read 
+	//! from any shared stream.
+	class OMEGA_API SharedDataCodec
+	{
+	public:
+		//! Object ids are assigned by the master codec and sent to the others
+		//! as part of frames.
+		SharedDataCodec(bool master);
+		virtual ~SharedDataCodec() {}
+
+		void registerObject(SharedObject* object, const String& id);
+		void unregisterObject(const String& id);
+
+		void setUpdateContext(const UpdateContext& ctx) { myUpdateContext = ctx; }
+		const UpdateContext& getUpdateContext() { return myUpdateContext; }
+
+		//! Frame serialization
+		//@{
+		//! Writes a frame, compressing it if a compressor is set. When 
+		//! committing is false the frame goes to a new slave mapping the 
+		//! shared data: it holds the full shared state, and does not change
+		//! what is tracked as sent to the other slaves.
+		void writeFrame(SharedOStream& out, bool committing);
+		//! Reads a frame and applies it to the registered objects.
+		void readFrame(SharedIStream& in);
+		//@}
+
+		//! Versioning options
+		//@{
+		//! When versioning is enabled, frames only contain the shared objects
+		//! whose data changed (see SharedObject::hasSharedDataChanged). A full
+		//! keyframe is sent every keyframeInterval frames, so slaves can resync.
+		void setVersioningEnabled(bool value) { myVersioningEnabled = value; }
+		bool isVersioningEnabled() { return myVersioningEnabled; }
+		void setKeyframeInterval(int frames) { myKeyframeInterval = frames; }
+		int getKeyframeInterval() { return myKeyframeInterval; }
+		void requestKeyframe() { myKeyframeRequested = true; }
+		//@}
+
+		//! Compression options
+		//@{
+		//! Sets the compressor used for frames larger than threshold bytes. 
+		//! Pass NULL to disable compression.
+		void setCompressor(SharedDataCompressor* compressor, uint64_t threshold);
+		SharedDataCompressor* getCompressor() { return myCompressor; }
+		uint64_t getCompressionThreshold() { return myCompressionThreshold; }
+		//@}
+
+		//! Returns the size in bytes of the last sent or received frame, 
+		//! before compression.
+		uint64_t getLastFrameSize() { return myLastFrameSize; }
+		//! Returns the number of bytes actually transmitted for the last frame.
+		uint64_t getLastSentSize() { return myLastSentSize; }
+		//! Returns the time in milliseconds spent compressing (on the master) or
+		//! decompressing (on slaves) the last compressed frame.
+		double getLastCompressionTime() { return myLastCompressionTime; }
+		//! Returns the number of objects in the last sent or received frame.
+		int getLastFrameObjects() { return myLastFrameObjects; }
+
+	private:
+		//! Frame types. Each frame starts with a byte specifying its type.
+		enum FrameType { FrameRaw = 0, FrameCompressed = 1 };
+
+		//! Writes and reads the frame content, after the frame type header.
+		void writeFrameData(SharedOStream& out);
+		void readFrameData(SharedIStream& in);
+
+	private:
+		//! Entry in the shared object table. The entry index is the object id
+		//! used in the shared data stream.
+		struct ObjectEntry
+		{
+			ObjectEntry(): object(NULL) {}
+			String key;
+			SharedObject* object;
+		};
+
+		bool myMaster;
+
+		// Objects registered on this node, indexed by their string key.
+		Dictionary<String, SharedObject*> myObjects;
+		typedef Dictionary<String, SharedObject*>::Item SharedObjectItem;
+		// Object ids are assigned by the master when an object is first 
+		// registered, and sent to slaves once as part of the next frame (and with
+		// every keyframe). After that, frames only contain object ids.
+		Dictionary<String, uint> myObjectIds;
+		Vector<ObjectEntry> myObjectTable;
+		// Ids that have been assigned since the last commit, and whose definition
+		// still needs to be sent to slaves.
+		Vector<uint> myNewObjectIds;
+		UpdateContext myUpdateContext;
+
+		bool myVersioningEnabled;
+		int myKeyframeInterval;
+		int myFramesSinceKeyframe;
+		bool myKeyframeRequested;
+		// Set while writing a committed frame.
+		bool myCommitting;
+
+		uint64_t myLastFrameSize;
+		int myLastFrameObjects;
+
+		// Compression
+		Ref<SharedDataCompressor> myCompressor;
+		uint64_t myCompressionThreshold;
+		Vector<byte> myFrameBuffer;
+		Vector<byte> myCompressedBuffer;
+		Timer myCompressionTimer;
+		uint64_t myLastSentSize;
+		double myLastCompressionTime;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	class OMEGA_API SharedDataServices
+	{
+	public:
+		static void setSharedData(SharedData* data);
+		static void registerObject(SharedObject*, const String& id);
+		static void unregisterObject(const String& id);
+		//! Forces the next shared data frame to be a keyframe, containing the
+		//! full state of all shared objects.
+		static void requestKeyframe();
+		//! Sets the compressor used on shared data frames larger than 
+		//! threshold bytes. Pass NULL to disable compression. Needs to be 
+		//! called with the same compressor on all nodes, before the first frame.
+		static void setCompressor(SharedDataCompressor* compressor, uint64_t threshold);
+		static void cleanup();
+
+	private:
+		static SharedData* mysSharedData;
+		static Dictionary<String, SharedObject*> mysRegistrationQueue;
 	};
+}; // namespace omega
 
-	///////////////////////////////////////////////////////////////////////////////////////////////
-	class OMEGA_API SharedDataServices
-	{
-	public:
-		static void setSharedData(SharedData* data);
-		static void registerObject(SharedObject*, const String& id);
-		static void unregisterObject(const String& id);
-		static void cleanup();
-
-	private:
-		static SharedData* mysSharedData;
-		static Dictionary<String, SharedObject*> mysRegistrationQueue;
-	};
-}; // namespace omega
-
 #endif
\ No newline at end of file
@@ -40,7 +40,10 @@ namespace omega
 	{
 	friend class Renderer;
 	public:
+		//! When enabled, pixel uploads from client memory go through the 
+		//! TextureUploadRing of the texture GPU context.
 		static void enablePboTransfers(bool value) { sUsePbo = value; }
+		static bool isPboTransfersEnabled() { return sUsePbo; }
 
 	public:
 		//! Initializes this texture object
@@ -48,6 +51,9 @@ namespace omega
 		bool isInitialized() { return myInitialized; }
 
 		void writePixels(PixelData* data);
+		//! Uploads a region of the pixel data to the same region of this 
+		//! texture. The texture must have the same size as the pixel data.
+		void writePixels(PixelData* data, const Rect& region);
 		void readPixels(PixelData* data);
 
 		int getWidth();
@@ -76,11 +82,43 @@ namespace omega
 		int myHeight;
 		uint myGlFormat;
 
-		GLuint myPboId;
-
 		GpuContext::TextureUnit myTextureUnit;
 	};
 
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! Streams texture uploads through a ring of pixel unpack buffers. There
+	//! is one ring per GPU context. Each upload orphans the storage of the 
+	//! next buffer in the ring before filling it, so writing pixels never 
+	//! waits on transfers still reading the previous contents.
+	class OMEGA_API TextureUploadRing: public ReferenceType
+	{
+	public:
+		static const int NumBuffers = 4;
+		//! Returns the upload ring for the specified context, creating it if
+		//! needed. Must be called from the context render thread.
+		static TextureUploadRing* getInstance(GpuContext* context);
+
+		//! Uploads a region of pixels to the currently bound 2D texture. src
+		//! points to the first pixel of the region, srcPitch is the size in 
+		//! bytes of a source row.
+		void upload(int x, int y, int width, int height, uint format, 
+			int pixelSize, const byte* src, int srcPitch);
+
+	private:
+		TextureUploadRing(GpuContext* context);
+
+	private:
+		static Ref<TextureUploadRing> sRings[GpuContext::MaxContexts];
+
+		GLuint myBuffers[NumBuffers];
+		int myNextBuffer;
+
+		Ref<Stat> myUploadStat;
+		Ref<Stat> myUploadTimeStat;
+		Ref<Stat> myStallStat;
+		Timer myTimer;
+	};
+
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	inline int Texture::getWidth() 
 	{ return myWidth; }
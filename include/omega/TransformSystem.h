@@ -0,0 +1,134 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	Updates scene node world transforms with a linear pass over flat arrays.
+ *************************************************************************************************/
+#ifndef __TRANSFORM_SYSTEM_H__
+#define __TRANSFORM_SYSTEM_H__
+
+#include "osystem.h"
+#include "omega/JobSystem.h"
+
+namespace omega {
+	class Node;
+	class SceneNode;
+
+	///////////////////////////////////////////////////////////////////////////////////////////////
+	//! Updates the world transforms of a node hierarchy with passes over 
+	//! flat arrays, instead of the recursive Node::update traversal.
+	//! @remarks
+	//!		The hierarchy is flattened breadth-first, so nodes are sorted by 
+	//!		depth, each parent comes before its children and the children of
+	//!		a node are contiguous. World positions, orientations and scales 
+	//!		are kept in contiguous arrays indexed like the nodes, so a node 
+	//!		reads its parent transform from the arrays instead of chasing and
+	//!		querying its parent. 
+	//!		Like Node::update, an update only visits nodes that requested an
+	//!		update, and the children of nodes that changed: it walks down one
+	//!		depth level at a time, with a list of the nodes to visit in each 
+	//!		level. A mostly static scene costs little to update.
+	//!		Nodes keep their transform API: updated world transforms are 
+	//!		written back to them, so getDerived* and getFullTransform return 
+	//!		the same values they would after a recursive update.
+	//!		Nodes in the same depth level do not depend on each other: when a
+	//!		job system is set, large levels are updated in parallel.
+	//!		The flat arrays are rebuilt when the hierarchy under the root 
+	//!		changes. Changes to other hierarchies do not cause a rebuild.
+	//!		Node::updateFromParent is only called for the root: custom node
+	//!		classes overriding it should disable the transform system.
+	class OMEGA_API TransformSystem: private ParallelLoop
+	{
+	public:
+		//! Levels with at least this many nodes are updated in parallel.
+		static const int ParallelLevelSize = 4096;
+		//! Number of nodes per parallel batch.
+		static const int ParallelBatchSize = 1024;
+
+	public:
+		TransformSystem();
+
+		//! Updates all the world transforms under root that need updating.
+		void update(Node* root);
+
+		//! When disabled, update falls back to the recursive Node::update.
+		void setEnabled(bool value) { myEnabled = value; }
+		bool isEnabled() { return myEnabled; }
+
+		//! Sets the job system used to update large levels in parallel.
+		void setJobSystem(JobSystem* js) { myJobSystem = js; }
+
+		//! Rebuilds the flat arrays if the hierarchy changed since the last
+		//! build. Returns true if there is something to update.
+		bool prepare(Node* root);
+
+		//! Returns the number of nodes in the flat arrays.
+		int getNumNodes() { return myNodes.size(); }
+		//! Returns the number of world transforms updated by the last update.
+		int getLastUpdateCount() { return myLastUpdateCount; }
+
+	private:
+		void rebuild(Node* root);
+		//! Updates the nodes in [first, end) of the visit list. Returns the
+		//! number of world transforms updated.
+		int updateRange(int first, int end);
+		//! Updates a batch of the level being updated in parallel.
+		virtual void run(int first, int end);
+
+	private:
+		typedef std::vector<Quaternion, Eigen::aligned_allocator<Quaternion> > QuaternionArray;
+
+		bool myEnabled;
+		Node* myRoot;
+		uint myHierarchyVersion;
+		int myLastUpdateCount;
+
+		JobSystem* myJobSystem;
+		// Protects myLastUpdateCount during parallel updates.
+		Lock myCountLock;
+
+		Vector<Node*> myNodes;
+		// Scene node pointers, cached to avoid casting at each update. NULL 
+		// for nodes that are not scene nodes.
+		Vector<SceneNode*> mySceneNodes;
+		Vector<int> myParents;
+		// Range of the children of each node.
+		Vector<int> myChildStart;
+		Vector<int> myChildEnd;
+		// Nodes to visit in the current and next depth level.
+		Vector<int> myVisit;
+		Vector<int> myNextVisit;
+
+		// World transforms.
+		Vector<Vector3f> myPositions;
+		QuaternionArray myOrientations;
+		Vector<Vector3f> myScales;
+		// Set when the children of a node need to update their transforms.
+		Vector<char> myPropagate;
+	};
+}; // namespace omega
+
+#endif
@@ -38,6 +38,7 @@
 #include "omegaToolkitConfig.h"
 #include "omega/ImageUtils.h"
 #include "omega/ModuleServices.h"
+#include "omega/Semaphore.h"
 
 namespace omega
 {
@@ -50,10 +51,33 @@ namespace omega
 		ImageBroadcastModule();
 		~ImageBroadcastModule();
 
-		void addChannel(PixelData* channel, const String& channelName, ImageUtils::ImageFormat format = ImageUtils::FormatJpeg, int quality = 100);
+		//! Adds a channel broadcasting a PixelData object to slave nodes. 
+		//! quality is used for jpeg encoding. When tileSize is greater than 
+		//! zero, the image is split in square tiles and only tiles that changed
+		//! since the last broadcast are encoded and sent.
+		void addChannel(PixelData* channel, const String& channelName, ImageUtils::ImageFormat format = ImageUtils::FormatJpeg, int quality = 75, int tileSize = 0);
 		// Remove a publisher or subscriber channel with the specified name
 		void removeChannel(const String& channel);
 
+		//! Encoder pool
+		//! When encoder threads are enabled, dirty full-image channels are 
+		//! encoded concurrently in background threads, and commits only gather
+		//! finished buffers. Tiled and unencoded channels are still processed
+		//! during commit.
+		//@{
+		//! Sets the number of encoder threads. Zero (the default) encodes all 
+		//! channels on the main thread during commit.
+		void setEncoderThreads(int threads);
+		int getEncoderThreads() { return myEncoderThreads.size(); }
+		//! Sets how many frames a channel update can lag behind the frame it
+		//! was captured in. With zero, commits wait for all channels captured
+		//! in the same frame. With one or more, encoding overlaps with the 
+		//! following frames and commits only wait for overdue channels.
+		void setMaxEncoderLatency(int frames) { myMaxEncoderLatency = frames; }
+		int getMaxEncoderLatency() { return myMaxEncoderLatency; }
+		//@}
+
+		virtual bool hasSharedDataChanged();
 		virtual void commitSharedData(SharedOStream& out);
 		virtual void updateSharedData(SharedIStream& in);
 
@@ -64,15 +88,44 @@ namespace omega
 		public:
 			Channel():
 				encoding(ImageUtils::FormatJpeg),
-				quality(100)
+				quality(75),
+				tileSize(0),
+				encoderBusy(false),
+				encoderDone(false),
+				dispatchFrame(0),
+				encodeTime(0)
 				{}
 			
 			String name;
 			Ref<PixelData> data;
 			ImageUtils::ImageFormat encoding;
 			int quality;
+			int tileSize;
+			//! Hashes of the tiles sent during the last broadcast.
+			Vector<uint64_t> tileHashes;
+
+			//! Encoder pool state. The snapshot is a copy of the pixel data
+			//! taken when the encode job is queued.
+			Ref<PixelData> snapshot;
+			Ref<ByteArray> encoded;
+			bool encoderBusy;
+			bool encoderDone;
+			uint64_t dispatchFrame;
+			double encodeTime;
+			Ref<Stat> encodeStat;
 		};
 
+		class EncoderThread;
+		friend class EncoderThread;
+
+		bool isPooled(Channel* ch);
+		void stopEncoders();
+
+		//! Encodes and writes the current image of a channel.
+		void commitChannel(Channel* ch, SharedOStream& out);
+		void commitTiles(Channel* ch, SharedOStream& out);
+		void updateTiles(Channel* ch, ImageUtils::ImageFormat fmt, SharedIStream& in);
+
 	private:
 		static ImageBroadcastModule* mysInstance;
 
@@ -81,6 +134,20 @@ namespace omega
 		ChannelDictionary myChannels;
         Ref<Stat> myEncodingTime;
         Ref<Stat> myDecodingTime;
+        Ref<Stat> myBroadcastSize;
+        Ref<Stat> myTilesSent;
+        Ref<Stat> myEncoderQueue;
+        Ref<Stat> myEncoderWait;
+
+        // Encoder pool
+        Vector<Thread*> myEncoderThreads;
+        Queue< Ref<Channel> > myJobs;
+        Lock myJobLock;
+        Semaphore myJobSignal;
+        Semaphore myDoneSignal;
+        bool myShutdownEncoders;
+        int myMaxEncoderLatency;
+        uint64_t myCommitCount;
 	};
 }; // namespace omega
 
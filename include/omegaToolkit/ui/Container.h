@@ -108,6 +108,15 @@ namespace omegaToolkit { namespace ui {
         Widget* getChildByIndex(int index);
         Widget* getChildBefore(const Widget* w);
         Widget* getChildAfter(const Widget* w);
+        //! Updates the name lookup table after a child has been renamed.
+        void updateChildName(const String& oldName, const String& newName);
+        //@}
+
+        //! Hit testing
+        //@{
+        //! Marks the child hit test index as out of date. The index is rebuilt
+        //! the next time a pointer move reaches this container.
+        void invalidateHitIndex() { myHitIndexValid = false; }
         //@}
 
         //!Layout options
@@ -165,12 +174,15 @@ namespace omegaToolkit { namespace ui {
         virtual void activate();
 
     private:
-        int expandStep(int childSpace, Orientation orientation);
+        int expandStep(int childSpace, Orientation orientation, bool& outChanged);
         void updateChildrenLayoutPosition(Orientation orientation);
         void updateChildrenFreeBounds(Orientation orientation);
         void resetChildrenSize(Orientation orientation);
         void computeLinearLayout(Orientation orientation);
         void computeGridLayout(Orientation orientation);
+        void refreshChildName(const String& name);
+        void updateHitIndex();
+        void dispatchPointerEvent(const Event& evt);
 
     private:
         List< Ref<Widget> > myChildren;
@@ -187,6 +199,23 @@ namespace omegaToolkit { namespace ui {
 
         Ref<PixelData> myPixels;
         bool myPixelOutputEnabled;
+
+        // Children by index and by name, kept in sync with myChildren. When
+        // several children share a name, the first one is indexed.
+        Vector<Widget*> myChildIndex;
+        Dictionary<String, Widget*> myChildNames;
+
+        // Hit test index: a uniform grid of child bounds in container 
+        // coordinates. Each cell lists the indices of children overlapping it.
+        // Children that can't be culled by bounds (containers, rotated or 
+        // dragged widgets) are listed in myHitAlwaysList instead.
+        bool myHitIndexValid;
+        Vector2f myHitGridMin;
+        Vector2f myHitCellSize;
+        int myHitGridColumns;
+        int myHitGridRows;
+        Vector< Vector<int> > myHitCells;
+        Vector<int> myHitAlwaysList;
     };
 
     ////////////////////////////////////////////////////////////////////////////
@@ -90,7 +90,7 @@ namespace omegaToolkit {
         Vector2f getCenter();
         //! Sets the widget rotation
         //! @param value - the widget rotation in degrees
-        void setRotation(float value) { myRotation = value; }
+        void setRotation(float value) { myRotation = value; invalidateContainerHitIndex(); }
         //! Gets the widget position.
         float getRotation() { return myRotation; }
         //@}
@@ -169,7 +169,7 @@ namespace omegaToolkit {
         void setStyle(const String& style);
         String getStyleValue(const String& key, const String& defaultValue = "");
         void setStyleValue(const String& key, const String& value);
-        void setScale(float value) { myScale = value; }
+        void setScale(float value) { myScale = value; invalidateContainerHitIndex(); }
         //! Sets the widget scale. Scale controls the visual appearance of a 
         //! widget without changing its actual size or forcing a layout refresh 
         //! of the widget container. Scale is indicated as a proportion of the
@@ -249,6 +249,8 @@ namespace omegaToolkit {
 
         void setContainer(Container* value);
         void dispatchUIEvent(const Event& evt);
+        //! Tells the container that the hit test bounds of this widget changed.
+        void invalidateContainerHitIndex();
 
         // Menu Widget Sounds
         void playMenuScrollSound();
@@ -376,10 +378,6 @@ namespace omegaToolkit {
     inline const String& Widget::getName() 
     { return myName; }
 
-    ///////////////////////////////////////////////////////////////////////////
-    inline void Widget::setName(const String& name)
-    { myName = name; }
-
     ///////////////////////////////////////////////////////////////////////////
     inline IEventListener* Widget::getUIEventHandler() 
     { return myEventHandler; }
@@ -548,6 +546,7 @@ namespace omegaToolkit {
         else 
         {
             myPosition = value; 
+            invalidateContainerHitIndex();
         }
     }
 
@@ -569,6 +568,7 @@ namespace omegaToolkit {
         else
         {
             myPosition[dimension] = value; 
+            invalidateContainerHitIndex();
         }
     }
 
@@ -196,6 +196,7 @@ bool OmegaViewer::handleCommand(const String& cmd)
 			omsg("\t ln          - print the scene node tree");
 			omsg("\t u           - unload all running applications");
 			omsg("\t s		     - print statistics");
+			omsg("\t sm [n]      - print timing of the n slowest modules (default 10)");
 			omsg("\t w		     - toggle wand");
 			omsg("\t porthole    - (experimental) enable porthole");
 			omsg("\t check_update - (windows only) checks for omegalib updates online");
@@ -241,6 +242,20 @@ bool OmegaViewer::handleCommand(const String& cmd)
 		SystemManager::instance()->getStatsManager()->printStats();
 		return true;
 	}
+	else if(args[0] == "sm")
+	{
+		// sm: print slowest modules. Enables module timing if needed.
+		if(!ModuleServices::isTimingEnabled())
+		{
+			omsg("Module timing enabled: run sm again to see the report");
+			ModuleServices::setTimingEnabled(true);
+			return true;
+		}
+		int n = 10;
+		if(args.size() > 1) n = atoi(args[1].c_str());
+		ModuleServices::printSlowestModules(n);
+		return true;
+	}
 	//else if(args[0] == "porthole")
 	//{
 	//
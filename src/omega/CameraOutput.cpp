@@ -44,7 +44,8 @@ using namespace omega;
 CameraOutput::CameraOutput(): 
 	myEnabled(false), myRenderTarget(NULL), myType(RenderTarget::RenderOffscreen),
 	myReadbackColorTarget(NULL), myReadbackDepthTarget(NULL),
-	myTextureColorTarget(NULL), myTextureDepthTarget(NULL)
+	myTextureColorTarget(NULL), myTextureDepthTarget(NULL),
+	myAsyncReadback(false), myReadbackBufferCount(3)
 {
 	reset(RenderTarget::RenderOffscreen);
 }
@@ -96,6 +97,17 @@ void CameraOutput::setTextureTargetAndViewport(Texture* color, Texture* depth, c
 	myReadbackViewport = readbackViewport;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CameraOutput::setAsyncReadback(bool enabled, int bufferCount)
+{
+	myAsyncReadback = enabled;
+	myReadbackBufferCount = bufferCount;
+	if(myRenderTarget != NULL)
+	{
+		myRenderTarget->setAsyncReadback(myAsyncReadback, myReadbackBufferCount);
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void CameraOutput::beginDraw(const DrawContext& context)
 {
@@ -105,6 +117,7 @@ void CameraOutput::beginDraw(const DrawContext& context)
 		if(myReadbackColorTarget != NULL) 
 		{
 			myRenderTarget->setReadbackTarget(myReadbackColorTarget, myReadbackDepthTarget, myReadbackViewport);
+			myRenderTarget->setAsyncReadback(myAsyncReadback, myReadbackBufferCount);
 		}
 		else if(myTextureColorTarget != NULL)
 		{
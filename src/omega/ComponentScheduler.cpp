@@ -0,0 +1,140 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	Runs node component updates, optionally spreading thread-safe components
+ *	across the engine job system.
+ *************************************************************************************************/
+#include "omega/ComponentScheduler.h"
+#include "omega/SceneNode.h"
+#include "omega/StatsManager.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+ComponentScheduler::ComponentScheduler():
+	myJobSystem(NULL),
+	myParallelUpdateEnabled(false),
+	myQueuing(false),
+	myContext(NULL),
+	myBatchSize(4),
+	myLastParallelCount(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+ComponentScheduler::~ComponentScheduler()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ComponentScheduler::begin(const UpdateContext& context)
+{
+	myQueuing = myParallelUpdateEnabled && 
+		myJobSystem != NULL && myJobSystem->getThreads() > 0;
+	myContext = &context;
+	myLastParallelCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ComponentScheduler::update(NodeComponent* component, const UpdateContext& context)
+{
+	if(myQueuing && component->isThreadSafe())
+	{
+		component->myParallelUpdate = true;
+		myQueue.push_back(component);
+	}
+	else
+	{
+		runComponent(component, context);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ComponentScheduler::end()
+{
+	myQueuing = false;
+	if(myQueue.size() == 0) return;
+
+	// parallelFor returns once all batches are done.
+	myJobSystem->parallelFor(myQueue.size(), myBatchSize, this);
+
+	// All batches are done: sample component timings and forward the
+	// bounding box requests to the owner nodes.
+	foreach(NodeComponent* c, myQueue)
+	{
+		c->myParallelUpdate = false;
+		if(c->myOwner == NULL) continue;
+		if(!c->myUpdateStat.isNull()) c->myUpdateStat->addSample(c->myUpdateTime);
+		if(c->myNeedBoundingBoxUpdate)
+		{
+			c->myOwner->requestBoundingBoxUpdate();
+		}
+	}
+	myLastParallelCount = myQueue.size();
+	myQueue.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ComponentScheduler::run(int first, int end)
+{
+	for(int i = first; i < end; i++)
+	{
+		NodeComponent* c = myQueue[i];
+		// Skip components detached from their node during the traversal.
+		if(c->myOwner == NULL) continue;
+		if(c->myUpdateStat.isNull())
+		{
+			c->update(*myContext);
+		}
+		else
+		{
+			// Stats are not thread-safe: store the update time here, the
+			// sample is added by end() once all the batches are done.
+			Timer t;
+			t.start();
+			c->update(*myContext);
+			t.stop();
+			c->myUpdateTime = t.getElapsedTimeInMilliSec();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ComponentScheduler::runComponent(NodeComponent* component, const UpdateContext& context)
+{
+	Stat* s = component->myUpdateStat;
+	if(s == NULL)
+	{
+		component->update(context);
+	}
+	else
+	{
+		s->startTiming();
+		component->update(context);
+		s->stopTiming();
+	}
+}
@@ -46,6 +46,8 @@ DrawContext::DrawContext():
     viewMax(1, 1),
     camera(NULL)
 {
+    // Until transforms are computed, the frustum contains everything.
+    for(int i = 0; i < 6; i++) frustumPlanes[i] = Vector4f::Zero();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -464,6 +466,41 @@ void DrawContext::updateTransforms(
     newBasis = newBasis.translate(-pe);
 
     modelview = newBasis * view;
+
+    updateFrustum();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawContext::updateFrustum()
+{
+    // Extract the clip planes from the combined world to clip space matrix
+    // (Gribb / Hartmann). Planes do not need to be normalized for the 
+    // inside / outside tests we do.
+    Eigen::Matrix4f m = projection.matrix() * modelview.matrix();
+    for(int i = 0; i < 3; i++)
+    {
+        frustumPlanes[i * 2] = m.row(3).transpose() + m.row(i).transpose();
+        frustumPlanes[i * 2 + 1] = m.row(3).transpose() - m.row(i).transpose();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool DrawContext::isBoxVisible(const AlignedBox3& box) const
+{
+    const Vector3f& bmin = box.getMinimum();
+    const Vector3f& bmax = box.getMaximum();
+    for(int i = 0; i < 6; i++)
+    {
+        const Vector4f& p = frustumPlanes[i];
+        // Test the box corner farthest along the plane normal: if it is 
+        // outside, the whole box is.
+        float d = p[3] +
+            p[0] * (p[0] >= 0 ? bmax[0] : bmin[0]) +
+            p[1] * (p[1] >= 0 ? bmax[1] : bmin[1]) +
+            p[2] * (p[2] >= 0 ? bmax[2] : bmin[2]);
+        if(d < 0) return false;
+    }
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
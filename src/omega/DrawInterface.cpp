@@ -38,8 +38,6 @@
 #include "omega/glheaders.h"
 #include "omega/SystemManager.h"
 
-#include "FTGL/ftgl.h"
-
 using namespace omega;
 
 
@@ -48,8 +46,17 @@ DrawInterface::DrawInterface():
 	//myTargetTexture(NULL),
 	myDrawing(false),
 	myDefaultFont(NULL),
-	myContext(NULL)
+	myContext(NULL),
+	myProgram(0),
+	myAlphaUniform(-1),
+	myAlpha(1.0f),
+	myBatchingEnabled(false),
+	myBatchDepth(0),
+	myBatchBuffer(0),
+	myNumBatches(0),
+	myNumPrimitives(0)
 {
+	myGlyphAtlas = new GlyphAtlas();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -144,6 +151,209 @@ void DrawInterface::setGlColor(const Color& col)
 	);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+Color DrawInterface::getBrushColor(const Color& col)
+{
+	return Color(
+		col[0] * myBrush.color[0], 
+		col[1] * myBrush.color[1],
+		col[2] * myBrush.color[2],
+		col[3] * myBrush.color[3]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::beginBatch()
+{
+	if(!myBatchingEnabled) return;
+	myBatchDepth++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::endBatch()
+{
+	if(myBatchDepth == 0) return;
+	// Draw pending primitives while we are still batching, so flush does
+	// not early out.
+	if(myBatchDepth == 1) flush();
+	myBatchDepth--;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::resetDrawStats()
+{
+	myNumBatches = 0;
+	myNumPrimitives = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::useProgram(GLuint program, GLint alphaUniform, float alpha)
+{
+	myProgram = program;
+	myAlphaUniform = alphaUniform;
+	myAlpha = alpha;
+	// When batching, the program will be bound when its primitives are 
+	// flushed.
+	if(!isBatching()) applyProgram();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::applyProgram()
+{
+	glUseProgram(myProgram);
+	if(myProgram != 0 && myAlphaUniform != -1)
+	{
+		glUniform1f(myAlphaUniform, myAlpha);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+DrawInterface::BatchVertex* DrawInterface::batchPrimitive(GLenum mode, uint numVertices, GLuint texture, bool blend, float lineWidth)
+{
+	// Vertices are stored in eye space, so we can merge primitives drawn 
+	// with different modelview transforms.
+	glGetDoublev(GL_MODELVIEW_MATRIX, myBatchTransform);
+
+	BatchState state;
+	state.mode = mode;
+	state.texture = texture;
+	state.program = myProgram;
+	state.alphaUniform = myAlphaUniform;
+	state.alpha = myAlpha;
+	state.lineWidth = lineWidth;
+	state.blend = blend;
+
+	uint first = myBatchVertices.size();
+	myBatchVertices.resize(first + numVertices);
+
+	if(!myBatchRuns.empty() && myBatchRuns.back().state == state)
+	{
+		myBatchRuns.back().count += numVertices;
+	}
+	else
+	{
+		BatchRun run;
+		run.state = state;
+		run.first = first;
+		run.count = numVertices;
+		myBatchRuns.push_back(run);
+	}
+
+	myNumPrimitives++;
+	return &myBatchVertices[first];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+DrawInterface::BatchVertex DrawInterface::makeBatchVertex(float x, float y, const Color& color, float s, float t)
+{
+	const GLdouble* m = myBatchTransform;
+	BatchVertex v;
+	v.position[0] = m[0] * x + m[4] * y + m[12];
+	v.position[1] = m[1] * x + m[5] * y + m[13];
+	v.position[2] = m[2] * x + m[6] * y + m[14];
+	v.uv[0] = s;
+	v.uv[1] = t;
+	for(int i = 0; i < 4; i++)
+	{
+		float c = color[i];
+		if(c < 0) c = 0;
+		else if(c > 1) c = 1;
+		v.color[i] = (GLubyte)(c * 255.0f + 0.5f);
+	}
+	return v;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::flush()
+{
+	if(!isBatching()) return;
+
+	if(!myBatchRuns.empty())
+	{
+		if(myBatchBuffer == 0) glGenBuffers(1, &myBatchBuffer);
+
+		// Orphan the previous buffer storage before uploading, so we do not
+		// stall on draws still using it.
+		GLsizeiptr size = myBatchVertices.size() * sizeof(BatchVertex);
+		glBindBuffer(GL_ARRAY_BUFFER, myBatchBuffer);
+		glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, &myBatchVertices[0]);
+
+		glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, position));
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, color));
+		glClientActiveTexture(GL_TEXTURE0);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, uv));
+
+		// Vertices are already in eye space.
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+
+		glPushAttrib(GL_ENABLE_BIT | GL_LINE_BIT | GL_TEXTURE_BIT);
+		glActiveTexture(GL_TEXTURE0);
+
+		const BatchState* prev = NULL;
+		foreach(const BatchRun& run, myBatchRuns)
+		{
+			const BatchState& s = run.state;
+			if(prev == NULL || prev->program != s.program) 
+			{
+				glUseProgram(s.program);
+			}
+			if(s.program != 0 && s.alphaUniform != -1 && (prev == NULL ||
+				prev->program != s.program || prev->alpha != s.alpha ||
+				prev->alphaUniform != s.alphaUniform))
+			{
+				glUniform1f(s.alphaUniform, s.alpha);
+			}
+			if(prev == NULL || prev->texture != s.texture)
+			{
+				if(s.texture != 0)
+				{
+					glEnable(GL_TEXTURE_2D);
+					glBindTexture(GL_TEXTURE_2D, s.texture);
+					glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
+				}
+				else
+				{
+					glDisable(GL_TEXTURE_2D);
+				}
+			}
+			if(s.mode == GL_LINES) glLineWidth(s.lineWidth);
+
+			if(s.blend)
+			{
+				glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				glDrawArrays(s.mode, run.first, run.count);
+				glPopAttrib();
+			}
+			else
+			{
+				glDrawArrays(s.mode, run.first, run.count);
+			}
+			myNumBatches++;
+			prev = &s;
+		}
+
+		glPopAttrib();
+		glPopMatrix();
+		glPopClientAttrib();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		myBatchVertices.clear();
+		myBatchRuns.clear();
+	}
+
+	// Leave the current program bound, so the caller can set uniforms or 
+	// draw directly.
+	applyProgram();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void DrawInterface::pushTransform(const AffineTransform3& transform)
 {
@@ -170,6 +380,52 @@ void DrawInterface::drawRectGradient(Vector2f pos, Vector2f size, Orientation or
 
 	float s = 0;
 
+	if(isBatching())
+	{
+		Color sc = getBrushColor(startColor);
+		Color ec = getBrushColor(endColor);
+		BatchVertex* v = batchPrimitive(GL_TRIANGLES, 12);
+		if(orientation == Horizontal)
+		{
+			s = int(height * pc);
+			v[0] = makeBatchVertex(x, y, sc);
+			v[1] = makeBatchVertex(x + width, y, sc);
+			v[2] = makeBatchVertex(x + width, y + s, sc);
+			v[3] = v[0];
+			v[4] = v[2];
+			v[5] = makeBatchVertex(x, y + s, sc);
+			y += s;
+			height -= s;
+			v[6] = makeBatchVertex(x, y, sc);
+			v[7] = makeBatchVertex(x + width, y, sc);
+			v[8] = makeBatchVertex(x + width, y + height, ec);
+			v[9] = v[6];
+			v[10] = v[8];
+			v[11] = makeBatchVertex(x, y + height, ec);
+		}
+		else
+		{
+			s = int(width * pc);
+			v[0] = makeBatchVertex(x, y, sc);
+			v[1] = makeBatchVertex(x + s, y, sc);
+			v[2] = makeBatchVertex(x + s, y + height, sc);
+			v[3] = v[0];
+			v[4] = v[2];
+			v[5] = makeBatchVertex(x, y + height, sc);
+			x += s;
+			width -= s;
+			v[6] = makeBatchVertex(x, y + height, sc);
+			v[7] = makeBatchVertex(x, y, sc);
+			v[8] = makeBatchVertex(x + width, y, ec);
+			v[9] = v[6];
+			v[10] = v[8];
+			v[11] = makeBatchVertex(x + width, y + height, ec);
+		}
+		return;
+	}
+
+	myNumBatches += 2;
+	myNumPrimitives++;
 	setGlColor(startColor);
 	if(orientation == Horizontal)
 	{
@@ -213,6 +469,20 @@ void DrawInterface::drawRect(Vector2f pos, Vector2f size, Color color)
 	int width = size[0];
 	int height = size[1];
 
+	if(isBatching())
+	{
+		BatchVertex* v = batchPrimitive(GL_TRIANGLES, 6);
+		v[0] = makeBatchVertex(x, y, color);
+		v[1] = makeBatchVertex(x + width, y, color);
+		v[2] = makeBatchVertex(x + width, y + height, color);
+		v[3] = v[0];
+		v[4] = v[2];
+		v[5] = makeBatchVertex(x, y + height, color);
+		return;
+	}
+
+	myNumBatches++;
+	myNumPrimitives++;
 	glColor4f(color[0], color[1], color[2], color[3]);
 	glRecti(x, y, x + width, y + height);
 }
@@ -225,6 +495,23 @@ void DrawInterface::drawRectOutline(Vector2f pos, Vector2f size, Color color)
 	int width = size[0];
 	int height = size[1];
 
+	if(isBatching())
+	{
+		Color c = getBrushColor(color);
+		BatchVertex* v = batchPrimitive(GL_LINES, 8);
+		v[0] = makeBatchVertex(x, y, c);
+		v[1] = makeBatchVertex(x + width, y, c);
+		v[2] = makeBatchVertex(x, y + height, c);
+		v[3] = makeBatchVertex(x + width, y + height, c);
+		v[4] = v[0];
+		v[5] = v[2];
+		v[6] = v[1];
+		v[7] = v[3];
+		return;
+	}
+
+	myNumBatches++;
+	myNumPrimitives++;
 	setGlColor(color);
 
 	glBegin(GL_LINES);
@@ -244,12 +531,36 @@ void DrawInterface::drawRectOutline(Vector2f pos, Vector2f size, Color color)
 	glEnd();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float width)
+{
+	if(isBatching())
+	{
+		BatchVertex* v = batchPrimitive(GL_LINES, 2, 0, false, width);
+		v[0] = makeBatchVertex(start[0], start[1], color);
+		v[1] = makeBatchVertex(end[0], end[1], color);
+		return;
+	}
+
+	myNumBatches++;
+	myNumPrimitives++;
+	glLineWidth(width);
+	glColor4fv(color.data());
+	glBegin(GL_LINES);
+	glVertex2f(start[0], start[1]);
+	glVertex2f(end[0], end[1]);
+	glEnd();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void DrawInterface::drawText(const String& text, Font* font, const Vector2f& position, unsigned int align, Color color) 
 { 
-	setGlColor(color);
+	// Text is drawn as textured quads, using the glyph atlas of the font.
+	GlyphAtlas* atlas = font->getAtlas();
+	atlas->lock();
+	const GlyphRun& run = font->getGlyphRun(text);
 
-	Vector2f rect = font->computeSize(text);
+	Vector2f rect = run.size;
 	float x, y;
 
 	if(align & Font::HALeft) x = position[0];
@@ -260,17 +571,62 @@ void DrawInterface::drawText(const String& text, Font* font, const Vector2f& pos
 	else if(align & Font::VABottom) y = -position[1];
 	else y = -position[1] - rect[1] / 2;
 
-	font->render(text, x, y); 
+	// Runs are laid out with y pointing down: flip y like FTGL does.
+	float ox = x;
+	float oy = -y;
+	Color c = getBrushColor(color);
+	uint n = run.quads.size();
+	uint i = 0;
+	while(i < n)
+	{
+		// Draw consecutive glyphs from the same atlas page together.
+		int page = run.quads[i].page;
+		uint end = i + 1;
+		while(end < n && run.quads[end].page == page) end++;
+		GLuint texture = atlas->getPageTexture(page);
+
+		if(isBatching())
+		{
+			BatchVertex* v = batchPrimitive(GL_TRIANGLES, (end - i) * 6, texture);
+			for(uint j = i; j < end; j++, v += 6)
+			{
+				const GlyphRun::Quad& q = run.quads[j];
+				v[0] = makeBatchVertex(ox + q.x0, oy + q.y0, c, q.u0, q.v0);
+				v[1] = makeBatchVertex(ox + q.x1, oy + q.y0, c, q.u1, q.v0);
+				v[2] = makeBatchVertex(ox + q.x1, oy + q.y1, c, q.u1, q.v1);
+				v[3] = v[0];
+				v[4] = v[2];
+				v[5] = makeBatchVertex(ox + q.x0, oy + q.y1, c, q.u0, q.v1);
+			}
+		}
+		else
+		{
+			myNumBatches++;
+			myNumPrimitives++;
+			glEnable(GL_TEXTURE_2D);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glColor4f(c[0], c[1], c[2], c[3]);
+			glBegin(GL_QUADS);
+			for(uint j = i; j < end; j++)
+			{
+				const GlyphRun::Quad& q = run.quads[j];
+				glTexCoord2f(q.u0, q.v0); glVertex2f(ox + q.x0, oy + q.y0);
+				glTexCoord2f(q.u1, q.v0); glVertex2f(ox + q.x1, oy + q.y0);
+				glTexCoord2f(q.u1, q.v1); glVertex2f(ox + q.x1, oy + q.y1);
+				glTexCoord2f(q.u0, q.v1); glVertex2f(ox + q.x0, oy + q.y1);
+			}
+			glEnd();
+			glDisable(GL_TEXTURE_2D);
+		}
+		i = end;
+	}
+	atlas->unlock();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void DrawInterface::drawRectTexture(Texture* texture, const Vector2f& position, const Vector2f size, uint flipFlags, const Vector2f& minUV, const Vector2f& maxUV)
 {
-	glEnable(GL_TEXTURE_2D);
-	texture->bind(GpuContext::TextureUnit0);
-
-	glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
-
 	float x = position[0];
 	float y = position[1];
 
@@ -295,6 +651,28 @@ void DrawInterface::drawRectTexture(Texture* texture, const Vector2f& position,
 		maxy = tmp;
 	}
 
+	if(isBatching())
+	{
+		// Batched textured rects are modulated by the brush color, since we
+		// do not track the current GL color.
+		const Color& c = myBrush.color;
+		BatchVertex* v = batchPrimitive(GL_TRIANGLES, 6, texture->getGLTexture());
+		v[0] = makeBatchVertex(x, y, c, minx, maxy);
+		v[1] = makeBatchVertex(x + width, y, c, maxx, maxy);
+		v[2] = makeBatchVertex(x, y + height, c, minx, miny);
+		v[3] = v[1];
+		v[4] = makeBatchVertex(x + width, y + height, c, maxx, miny);
+		v[5] = v[2];
+		return;
+	}
+
+	myNumBatches++;
+	myNumPrimitives++;
+	glEnable(GL_TEXTURE_2D);
+	texture->bind(GpuContext::TextureUnit0);
+
+	glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
+
 	glBegin(GL_TRIANGLE_STRIP);
 
 	glTexCoord2f(minx, maxy);
@@ -315,9 +693,44 @@ void DrawInterface::drawRectTexture(Texture* texture, const Vector2f& position,
 	glDisable(GL_TEXTURE_2D);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void DrawInterface::computeCirclePoints(const Vector2f& position, float radius, int segments)
+{
+	// Use the same stepping as the immediate mode path, so both paths
+	// generate identical vertices.
+	myCirclePoints.clear();
+	float stp = Math::Pi * 2 / segments;
+	for(float t = 0; t < 2 * Math::Pi; t+= stp)
+	{
+		float ptx = Math::sin(t) * radius + position[0];
+		float pty = Math::cos(t) * radius + position[1];
+		myCirclePoints.push_back(Vector2f(ptx, pty));
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void DrawInterface::drawCircleOutline(Vector2f position, float radius, const Color& color, int segments)
 {
+	if(isBatching())
+	{
+		computeCirclePoints(position, radius, segments);
+		uint n = myCirclePoints.size();
+		if(n < 2) return;
+		Color c = getBrushColor(color);
+		// Convert the line loop into a list of separate segments
+		BatchVertex* v = batchPrimitive(GL_LINES, n * 2, 0, true);
+		for(uint i = 0; i < n; i++)
+		{
+			const Vector2f& a = myCirclePoints[i];
+			const Vector2f& b = myCirclePoints[(i + 1) % n];
+			v[i * 2] = makeBatchVertex(a[0], a[1], c);
+			v[i * 2 + 1] = makeBatchVertex(b[0], b[1], c);
+		}
+		return;
+	}
+
+	myNumBatches++;
+	myNumPrimitives++;
 	glPushAttrib(GL_ENABLE_BIT);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_BLEND);
@@ -340,6 +753,29 @@ void DrawInterface::drawCircleOutline(Vector2f position, float radius, const Col
 ///////////////////////////////////////////////////////////////////////////////
 void DrawInterface::drawCircle(Vector2f position, float radius, const Color& color, int segments)
 {
+	if(isBatching())
+	{
+		computeCirclePoints(position, radius, segments);
+		uint n = myCirclePoints.size();
+		if(n < 2) return;
+		Color c = getBrushColor(color);
+		// Convert the triangle fan into a triangle list. Like the fan, the 
+		// list does not close the circle between the last and first point.
+		BatchVertex* v = batchPrimitive(GL_TRIANGLES, (n - 1) * 3, 0, true);
+		BatchVertex center = makeBatchVertex(position[0], position[1], c);
+		for(uint i = 0; i < n - 1; i++)
+		{
+			const Vector2f& a = myCirclePoints[i];
+			const Vector2f& b = myCirclePoints[i + 1];
+			v[i * 3] = center;
+			v[i * 3 + 1] = makeBatchVertex(a[0], a[1], c);
+			v[i * 3 + 2] = makeBatchVertex(b[0], b[1], c);
+		}
+		return;
+	}
+
+	myNumBatches++;
+	myNumPrimitives++;
 	glPushAttrib(GL_ENABLE_BIT);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_BLEND);
@@ -363,6 +799,10 @@ void DrawInterface::drawCircle(Vector2f position, float radius, const Color& col
 ///////////////////////////////////////////////////////////////////////////////
 void DrawInterface::drawWireSphere(const Color& color, int segments, int slices)
 {
+	// Wire spheres are always drawn immediately.
+	flush();
+	myNumBatches++;
+	myNumPrimitives++;
 	glPushAttrib(GL_ENABLE_BIT);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_BLEND);
@@ -400,7 +840,6 @@ void DrawInterface::drawWireSphere(const Color& color, int segments, int slices)
 ///////////////////////////////////////////////////////////////////////////////
 Font* DrawInterface::createFont(omega::String fontName, omega::String filename, int size)
 {
-	Font::lock();
 	String fontPath;
 	if(!DataManager::findFile(filename, fontPath))
 	{
@@ -408,25 +847,14 @@ Font* DrawInterface::createFont(omega::String fontName, omega::String filename,
 		return NULL;
 	}
 
-	FTFont* fontImpl = new FTTextureFont(fontPath.c_str());
-
-	if(fontImpl->Error())
-	{
-		ofwarn("Font %1% failed to open", %filename);
-		delete fontImpl;
-		return NULL;
-	}
-
-	if(!fontImpl->FaceSize(size))
-	{
-		ofwarn("Font %1% failed to set size %2%", %filename %size);
-		delete fontImpl;
-	}
+	myGlyphAtlas->lock();
+	GlyphAtlas::Face* face = myGlyphAtlas->loadFace(fontPath, size);
+	myGlyphAtlas->unlock();
+	if(face == NULL) return NULL;
 
-	Font* font = new Font(fontImpl);
+	Font* font = new Font(myGlyphAtlas, face);
 
 	myFonts[fontName] = font;
-	Font::unlock();
 	return font;
 }
 
@@ -472,7 +900,7 @@ void DrawInterface::rect(float x, float y, float width, float height)
 {
 	if(!myBrush.texture.isNull())
 	{
-		glColor4f(myBrush.color[0], myBrush.color[1], myBrush.color[2], myBrush.color[3]);
+		if(!isBatching()) glColor4f(myBrush.color[0], myBrush.color[1], myBrush.color[2], myBrush.color[3]);
 		drawRectTexture(myBrush.texture,
 			Vector2f(x, y),
 			Vector2f(width, height),
@@ -88,6 +88,8 @@ Engine::Engine(ApplicationBase* app):
     soundEnv(NULL)
 {
     mysInstance = this;
+    myTransformSystem.setJobSystem(&myJobSystem);
+    myComponentScheduler.setJobSystem(&myJobSystem);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -105,6 +107,9 @@ void Engine::initialize()
     ModuleServices::addModule(new EventSharingModule());
 
     myScene = new SceneNode(this, "root");
+    // The root is not attached to a parent, so add it to the scene query 
+    // hierarchy explicitly.
+    mySceneBvh.addNode(myScene);
 
     // Create console.
     myConsole = Console::createAndInitialize();
@@ -139,6 +144,19 @@ void Engine::initialize()
     myDrawPointers = syscfg->getBoolValue("config/drawPointers", myDrawPointers);
     myPointerSize = Config::getIntValue("pointerSize", syscfgroot, 32);
 
+    // Job system worker threads. By default, use all cores: the thread that
+    // waits for jobs runs them too.
+    myJobSystem.setThreads(Config::getIntValue(
+        "jobThreads", syscfgroot, JobSystem::getNumCores() - 1));
+
+    // Per-module timing stats are disabled by default.
+    ModuleServices::setTimingEnabled(
+        Config::getBoolValue("moduleTiming", syscfgroot, false));
+
+    // Parallel update of thread-safe node components is disabled by default.
+    myComponentScheduler.setParallelUpdateEnabled(
+        Config::getBoolValue("parallelComponentUpdate", syscfgroot, false));
+
     myDefaultCamera = new Camera(this);
     myDefaultCamera->setName("DefaultCamera");
     // By default attach camera to scene root.
@@ -291,6 +309,9 @@ void Engine::initialize()
     myUpdateTimeStat = sm->createStat("Engine update", StatsManager::Time);
     mySceneUpdateTimeStat = sm->createStat("Scene transform update", StatsManager::Time);
     myModuleUpdateTimeStat = sm->createStat("Modules update", StatsManager::Time);
+    mySceneQueryTimeStat = sm->createStat("Scene ray query", StatsManager::Time);
+    mySceneTransformCountStat = sm->createStat("Scene transforms updated", StatsManager::Count1);
+    mySceneParallelComponentsStat = sm->createStat("Scene parallel components", StatsManager::Count1);
 
     myLock.unlock();
 }
@@ -308,6 +329,7 @@ void Engine::dispose()
 
     ImageUtils::internalDispose();
     ModuleServices::disposeAll();
+    myJobSystem.setThreads(0);
 
     // Destroy pointers.
     myPointers.clear();
@@ -317,6 +339,8 @@ void Engine::dispose()
 
     // Clear root scene node.
     myScene = NULL;
+    // Nodes still referenced elsewhere are not part of the scene anymore.
+    mySceneBvh.clear();
 
     ofmsg("Engine::dispose: cleaning up %1% cameras", %myCameras.size());
     myCameras.clear();
@@ -476,12 +500,17 @@ void Engine::update(const UpdateContext& context)
     // Then run update on modules
     myModuleUpdateTimeStat->startTiming();
     ModuleServices::update(this, context);
-    myUpdateTimeStat->stopTiming();
+    myModuleUpdateTimeStat->stopTiming();
     
     // Run update on the scene graph.
     mySceneUpdateTimeStat->startTiming();
     myScene->update(context);
+    // Refresh bounding boxes now, so renderers can cull against the cached
+    // boxes without updating them from the render threads.
+    myScene->getBoundingBox();
     mySceneUpdateTimeStat->stopTiming();
+    mySceneTransformCountStat->addSample(myTransformSystem.getLastUpdateCount());
+    mySceneParallelComponentsStat->addSample(myComponentScheduler.getLastParallelCount());
 
     // Process sound / reconnect to sound server (if sound is enabled in config and failed on init)
     if( soundEnv != NULL && soundManager->isSoundServerRunning() )
@@ -536,10 +565,14 @@ void Engine::initializeSound()
 ///////////////////////////////////////////////////////////////////////////////
 const SceneQueryResultList& Engine::querySceneRay(const Ray& ray, uint flags)
 {
+    mySceneQueryTimeStat->startTiming();
     myRaySceneQuery.clearResults();
     myRaySceneQuery.setSceneNode(myScene.get());
+    myRaySceneQuery.setSceneBvh(&mySceneBvh);
     myRaySceneQuery.setRay(ray);
-    return myRaySceneQuery.execute(flags);
+    const SceneQueryResultList& results = myRaySceneQuery.execute(flags);
+    mySceneQueryTimeStat->stopTiming();
+    return results;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -34,18 +34,29 @@ Ref<EventSharingModule> EventSharingModule::mysInstance = NULL;
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 EventSharingModule::EventSharingModule():
 	EngineModule("EventSharingModule"),
-	myQueuedEvents(0)
+	myQueuedEvents(0),
+	myCoalesceUpdates(true),
+	myCoalescedEvents(0),
+	myDroppedEvents(0),
+	myCompactEncoding(true),
+	myPositionStep(0),
+	myQuantizeOrientation(false)
 {
 	mysInstance = this;
+	myEventQueue.resize(InitialSharedEventsQueue);
 	enableSharedData();
+	// Only send the event queue during frames that have events in it.
+	setSharedDataVersioned(true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 void EventSharingModule::clearQueue()
 {
 	mysInstance->myQueueLock.lock();
-    mysInstance->myQueuedEvents = 0;
-    mysInstance->myQueueLock.unlock();
+	mysInstance->flushStats();
+	mysInstance->myQueuedEvents = 0;
+	mysInstance->myCoalesceIndex.clear();
+	mysInstance->myQueueLock.unlock();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -65,31 +76,128 @@ void EventSharingModule::share(const Event& evt)
 		}
 		else
 		{
-			if(mysInstance->myQueuedEvents >= MaxSharedEventsQueue)
-			{
-				ofwarn("EventSharingModule::share: cannot queue more than %1% events. Dropping event.", %((int)MaxSharedEventsQueue));
-			}
-			else
-			{
-				mysInstance->myQueueLock.lock();
-				mysInstance->myEventQueue[mysInstance->myQueuedEvents++].copyFrom(evt);
-				mysInstance->myQueueLock.unlock();
-			}
+			mysInstance->queueEvent(evt);
 		}
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void EventSharingModule::queueEvent(const Event& evt)
+{
+	myQueueLock.lock();
+	enqueue(evt);
+	myQueueLock.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void EventSharingModule::enqueue(const Event& evt)
+{
+	bool isUpdate = (evt.getType() == Event::Update);
+	uint64_t key = ((uint64_t)evt.getServiceType() << 48) ^ 
+		((uint64_t)(evt.getServiceId() & 0xffff) << 32) ^
+		(uint64_t)(uint)evt.getSourceId();
+
+	if(isUpdate && myCoalesceUpdates)
+	{
+		// If this source has an Update event in the queue, replace it.
+		Dictionary<uint64_t, int>::iterator it = myCoalesceIndex.find(key);
+		if(it != myCoalesceIndex.end())
+		{
+			myEventQueue[it->second].copyFrom(evt);
+			myCoalescedEvents++;
+			return;
+		}
+	}
+
+	if(myQueuedEvents >= MaxSharedEventsQueue && isUpdate)
+	{
+		// Queue full: drop continuous events only.
+		if(myDroppedEvents == 0)
+		{
+			ofwarn("EventSharingModule::share: more than %1% events queued. Dropping update events.", %((int)MaxSharedEventsQueue));
+		}
+		myDroppedEvents++;
+		return;
+	}
+
+	// Grow the queue if needed.
+	if(myQueuedEvents >= (int)myEventQueue.size())
+	{
+		myEventQueue.resize(myEventQueue.size() * 2);
+	}
+
+	if(isUpdate) myCoalesceIndex[key] = myQueuedEvents;
+	// A discrete event: following updates for this source need to be queued
+	// after it.
+	else myCoalesceIndex.erase(key);
+
+	myEventQueue[myQueuedEvents++].copyFrom(evt);
+	markSharedDataChanged();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void EventSharingModule::flushStats()
+{
+	if(mySharedStat != NULL)
+	{
+		mySharedStat->addSample(myQueuedEvents);
+		myCoalescedStat->addSample(myCoalescedEvents);
+		myDroppedStat->addSample(myDroppedEvents);
+	}
+	myCoalescedEvents = 0;
+	myDroppedEvents = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void EventSharingModule::initialize()
+{
+	Config* syscfg = SystemManager::instance()->getSystemConfig();
+	if(syscfg->exists("config/eventSharing"))
+	{
+		Setting& s = syscfg->lookup("config/eventSharing");
+		myCompactEncoding = Config::getBoolValue("compactEncoding", s, myCompactEncoding);
+		myPositionStep = Config::getFloatValue("positionQuantization", s, myPositionStep);
+		myQuantizeOrientation = Config::getBoolValue("orientationQuantization", s, myQuantizeOrientation);
+		myCoalesceUpdates = Config::getBoolValue("coalesceUpdates", s, myCoalesceUpdates);
+	}
+
+	if(SystemManager::instance()->isMaster())
+	{
+		StatsManager* sm = SystemManager::instance()->getStatsManager();
+		mySharedStat = sm->createStat("Events shared", StatsManager::Count1);
+		myCoalescedStat = sm->createStat("Events coalesced", StatsManager::Count1);
+		myDroppedStat = sm->createStat("Events dropped", StatsManager::Count1);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 void EventSharingModule::commitSharedData(SharedOStream& out)
 {
 	myQueueLock.lock();
-	out << myQueuedEvents;
-	int i = 0;
-	while(myQueuedEvents)
+
+	// Serialize all the events for this frame in a single block.
+	myEventBlock.clear();
+	SharedOStream blockStream(&myEventBlock);
+	for(int i = 0; i < myQueuedEvents; i++)
 	{
-		EventUtils::serializeEvent(myEventQueue[i++], *out.getInternalStream());
-		myQueuedEvents--;
+		if(myCompactEncoding)
+		{
+			EventUtils::serializeCompactEvent(myEventQueue[i], blockStream, myPositionStep, myQuantizeOrientation);
+		}
+		else
+		{
+			EventUtils::serializeEvent(myEventQueue[i], blockStream);
+		}
 	}
+
+	byte encoding = myCompactEncoding ? EncodingCompact : EncodingFull;
+	uint blockSize = myEventBlock.size();
+	out << encoding << myQueuedEvents << myPositionStep << blockSize;
+	if(blockSize > 0) out.write(&myEventBlock[0], blockSize);
+
+	flushStats();
+	myQueuedEvents = 0;
+	myCoalesceIndex.clear();
 	myQueueLock.unlock();
 }
 
@@ -98,17 +206,37 @@ void EventSharingModule::updateSharedData(SharedIStream& in)
 {
 	// Read the events from the network data stream, and send them to the engine for processing.
 	myQueueLock.lock();
-	in >> myQueuedEvents;
+
+	byte encoding;
+	float positionStep;
+	uint blockSize;
+	in >> encoding >> myQueuedEvents >> positionStep >> blockSize;
+
+	myEventBlock.resize(blockSize);
+	if(blockSize > 0) in.read(&myEventBlock[0], blockSize);
+
+	if(encoding != EncodingFull && encoding != EncodingCompact)
+	{
+		ofwarn("EventSharingModule::updateSharedData: unknown event encoding %1%. Skipping %2% events.", 
+			%(int)encoding %myQueuedEvents);
+		myQueuedEvents = 0;
+	}
+
 	if(myQueuedEvents != 0)
 	{
 		Engine* server = getEngine();
-		//ServiceManager* sm = getEngine()->getServiceManager();
-		//sm->lockEvents();
+		SharedIStream blockStream(&myEventBlock[0], blockSize);
 		while(myQueuedEvents)
 		{
 			Event evt;
-			//Event* evtHead = sm->writeHead();
-			EventUtils::deserializeEvent(evt, *in.getInternalStream());
+			if(encoding == EncodingCompact)
+			{
+				EventUtils::deserializeCompactEvent(evt, blockStream, positionStep);
+			}
+			else
+			{
+				EventUtils::deserializeEvent(evt, blockStream);
+			}
 
 			if(evt.isProcessed())
 			{
@@ -119,7 +247,6 @@ void EventSharingModule::updateSharedData(SharedIStream& in)
 
 			myQueuedEvents--;
 		}
-		//sm->unlockEvents();
 	}
 	myQueueLock.unlock();
 }
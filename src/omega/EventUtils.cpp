@@ -0,0 +1,233 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * What's in this file
+ *	Event serialization for the shared data stream, in a full and a compact
+ *	encoding.
+ *************************************************************************************************/
+#include "omega/EventUtils.h"
+
+using namespace omicron;
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+void EventUtils::serializeEvent(Event& evt, SharedOStream& os)
+{
+    os << evt.myTimestamp;
+    os << evt.mySourceId;
+    os << evt.myServiceId;
+    os << evt.myServiceType;
+    os << evt.myType;
+    os << evt.myFlags;
+    os << evt.myPosition[0] << evt.myPosition[1] << evt.myPosition[2];
+    os << evt.myOrientation.x() << evt.myOrientation.y() << evt.myOrientation.z() << evt.myOrientation.w();
+
+    // Serialize extra data
+    os << evt.myExtraDataType;
+    os << evt.myExtraDataItems;
+    if(evt.myExtraDataType != Event::ExtraDataNull)
+    {
+        os << evt.myExtraDataValidMask;
+        os.write(evt.myExtraData, evt.getExtraDataSize());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+void EventUtils::deserializeEvent(Event& evt, SharedIStream& is)
+{
+    is >> evt.myTimestamp;
+    is >> evt.mySourceId;
+    is >> evt.myServiceId;
+    is >> evt.myServiceType;
+    is >> evt.myType;
+    is >> evt.myFlags;
+    is >> evt.myPosition[0] >> evt.myPosition[1] >> evt.myPosition[2];
+    is >> evt.myOrientation.x() >> evt.myOrientation.y() >> evt.myOrientation.z() >> evt.myOrientation.w();
+
+    // Deserialize extra data
+    is >> evt.myExtraDataType;
+    is >> evt.myExtraDataItems;
+    if(evt.myExtraDataType != Event::ExtraDataNull)
+    {
+        is >> evt.myExtraDataValidMask;
+        is.read(evt.myExtraData, evt.getExtraDataSize());
+    }
+    if(evt.myExtraDataType == Event::ExtraDataString)
+    {
+        evt.myExtraData[evt.getExtraDataSize()] = '\0';
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Assigns an integer value read from a compact stream to an event field, 
+// whatever the field enum or integer type is.
+template<typename T> inline void assignField(T& field, int value)
+{ field = (T)value; }
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+void EventUtils::serializeCompactEvent(Event& evt, SharedOStream& os, float positionStep, bool quantizeOrientation)
+{
+    // Build the field mask
+    byte mask = 0;
+    if(evt.mySourceId != 0) mask |= CompactSourceId;
+    if(evt.myServiceId != 0) mask |= CompactServiceId;
+    if(evt.myFlags != 0) mask |= CompactFlags;
+    if(evt.myExtraDataType != Event::ExtraDataNull) mask |= CompactExtraData;
+
+    const Vector3f& pos = evt.myPosition;
+    short qpos[3];
+    if(pos[0] != 0 || pos[1] != 0 || pos[2] != 0)
+    {
+        mask |= CompactPosition;
+        // Use quantized positions only when they fit in 16 bits.
+        if(positionStep > 0)
+        {
+            bool fits = true;
+            for(int i = 0; i < 3; i++)
+            {
+                float q = floor(pos[i] / positionStep + 0.5f);
+                if(q < -32767 || q > 32767) fits = false;
+                else qpos[i] = (short)q;
+            }
+            if(fits) mask |= CompactPositionQuantized;
+        }
+    }
+
+    const Quaternion& o = evt.myOrientation;
+    if(o.x() != 0 || o.y() != 0 || o.z() != 0 || o.w() != 1)
+    {
+        mask |= CompactOrientation;
+        if(quantizeOrientation) mask |= CompactOrientationQuantized;
+    }
+
+    os << mask;
+    os << (byte)evt.myType;
+    os << (byte)evt.myServiceType;
+    os << evt.myTimestamp;
+    if(mask & CompactSourceId) os << evt.mySourceId;
+    if(mask & CompactServiceId) os << evt.myServiceId;
+    if(mask & CompactFlags) os << evt.myFlags;
+    if(mask & CompactPosition)
+    {
+        if(mask & CompactPositionQuantized) os << qpos[0] << qpos[1] << qpos[2];
+        else os << pos[0] << pos[1] << pos[2];
+    }
+    if(mask & CompactOrientation)
+    {
+        if(mask & CompactOrientationQuantized)
+        {
+            // Quaternion components are in the [-1, 1] range: store them as 
+            // normalized 16 bit integers.
+            os << (short)floor(o.x() * 32767 + 0.5f) << (short)floor(o.y() * 32767 + 0.5f)
+                << (short)floor(o.z() * 32767 + 0.5f) << (short)floor(o.w() * 32767 + 0.5f);
+        }
+        else
+        {
+            os << o.x() << o.y() << o.z() << o.w();
+        }
+    }
+    if(mask & CompactExtraData)
+    {
+        os << (byte)evt.myExtraDataType;
+        os << evt.myExtraDataItems;
+        os << evt.myExtraDataValidMask;
+        os.write(evt.myExtraData, evt.getExtraDataSize());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+void EventUtils::deserializeCompactEvent(Event& evt, SharedIStream& is, float positionStep)
+{
+    byte mask;
+    byte type;
+    byte serviceType;
+    is >> mask >> type >> serviceType;
+    assignField(evt.myType, type);
+    assignField(evt.myServiceType, serviceType);
+    is >> evt.myTimestamp;
+
+    if(mask & CompactSourceId) is >> evt.mySourceId;
+    else assignField(evt.mySourceId, 0);
+    if(mask & CompactServiceId) is >> evt.myServiceId;
+    else assignField(evt.myServiceId, 0);
+    if(mask & CompactFlags) is >> evt.myFlags;
+    else assignField(evt.myFlags, 0);
+
+    if(mask & CompactPosition)
+    {
+        if(mask & CompactPositionQuantized)
+        {
+            short qpos[3];
+            is >> qpos[0] >> qpos[1] >> qpos[2];
+            evt.myPosition = Vector3f(qpos[0], qpos[1], qpos[2]) * positionStep;
+        }
+        else
+        {
+            is >> evt.myPosition[0] >> evt.myPosition[1] >> evt.myPosition[2];
+        }
+    }
+    else
+    {
+        evt.myPosition = Vector3f::Zero();
+    }
+
+    if(mask & CompactOrientation)
+    {
+        if(mask & CompactOrientationQuantized)
+        {
+            short q[4];
+            is >> q[0] >> q[1] >> q[2] >> q[3];
+            evt.myOrientation = Quaternion(q[3] / 32767.0f, q[0] / 32767.0f, q[1] / 32767.0f, q[2] / 32767.0f);
+            evt.myOrientation.normalize();
+        }
+        else
+        {
+            is >> evt.myOrientation.x() >> evt.myOrientation.y() >> evt.myOrientation.z() >> evt.myOrientation.w();
+        }
+    }
+    else
+    {
+        evt.myOrientation = Quaternion::Identity();
+    }
+
+    if(mask & CompactExtraData)
+    {
+        byte extraDataType;
+        is >> extraDataType;
+        assignField(evt.myExtraDataType, extraDataType);
+        is >> evt.myExtraDataItems;
+        is >> evt.myExtraDataValidMask;
+        is.read(evt.myExtraData, evt.getExtraDataSize());
+        if(evt.myExtraDataType == Event::ExtraDataString)
+        {
+            evt.myExtraData[evt.getExtraDataSize()] = '\0';
+        }
+    }
+    else
+    {
+        evt.myExtraDataType = Event::ExtraDataNull;
+        assignField(evt.myExtraDataItems, 0);
+    }
+}
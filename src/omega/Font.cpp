@@ -27,8 +27,6 @@
 #include "omega/Font.h"
 #include "omega/glheaders.h"
 
-#include "FTGL/ftgl.h"
-
 using namespace omega;
 
 
@@ -46,17 +44,50 @@ void Font::unlock()
 	sLock.unlock();
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Decodes the next UTF-8 character in a string. Invalid sequences are
+// returned as single Latin-1 characters.
+static uint decodeUtf8(const byte*& s, const byte* end)
+{
+	uint c = *s++;
+	int extra = 0;
+	if((c & 0xE0) == 0xC0) { c &= 0x1F; extra = 1; }
+	else if((c & 0xF0) == 0xE0) { c &= 0x0F; extra = 2; }
+	else if((c & 0xF8) == 0xF0) { c &= 0x07; extra = 3; }
+	else return c;
+
+	if(end - s < extra) return s[-1];
+	for(int i = 0; i < extra; i++)
+	{
+		if((s[i] & 0xC0) != 0x80) return s[-1];
+	}
+	for(int i = 0; i < extra; i++) c = (c << 6) | (*s++ & 0x3F);
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Font::Font(GlyphAtlas* atlas, GlyphAtlas::Face* face):
+	myAtlas(atlas),
+	myFace(face)
+{
+}
+
 ////////////////////////////////////////////////////////////////////////////////
-Dictionary<String, FTFont*> sFontCache;
+// Fonts used by getTextSize. They share a glyph atlas that is used for layout
+// only, and never uploaded to the GPU.
+Dictionary<String, Ref<Font> > sLayoutFonts;
+Ref<GlyphAtlas> sLayoutAtlas;
 Vector2f Font::getTextSize(const String& text, const String& font)
 {
+	Font::lock();
     // Add font to cache if needed.
-    if(sFontCache.find(font) == sFontCache.end())
+    if(sLayoutFonts.find(font) == sLayoutFonts.end())
     {
 	    Vector<String> args = StringUtils::split(font);
 	    if(args.size() < 2)
 	    {
 		    owarn("Font::getTextSize: Invalid font creation arguments");
+			Font::unlock();
 		    return Vector2f::Zero();
 	    }
 	    String fontFile = args[0];
@@ -65,53 +96,120 @@ Vector2f Font::getTextSize(const String& text, const String& font)
 	    if(!DataManager::findFile(fontFile, fontPath))
 	    {
 		    ofwarn("Font::getTextSize: could not find font file %1%", %fontFile);
+			Font::unlock();
 		    return Vector2f::Zero();
 	    }
 
-	    FTFont* fontImpl = new FTBitmapFont(fontPath.c_str());
-
-	    if(fontImpl->Error())
-	    {
-		    ofwarn("Font %1% failed to open", %fontFile);
-		    delete fontImpl;
-		    return Vector2f::Zero();
-	    }
-
-	    if(!fontImpl->FaceSize(fontSize))
-	    {
-		    ofwarn("Font %1% failed to set size %2%", %fontFile %fontSize);
-		    delete fontImpl;
-	    }
+		if(sLayoutAtlas.isNull()) sLayoutAtlas = new GlyphAtlas();
+		GlyphAtlas::Face* face = sLayoutAtlas->loadFace(fontPath, fontSize);
+		if(face == NULL)
+		{
+			Font::unlock();
+			return Vector2f::Zero();
+		}
 
-        sFontCache[font] = fontImpl;
+        sLayoutFonts[font] = new Font(sLayoutAtlas, face);
     }
-    FTFont* fontImpl = sFontCache[font];
-	FTBBox bbox = fontImpl->BBox(text.c_str());
-	Vector2f size = Vector2f((int)bbox.Upper().Xf(), (int)bbox.Upper().Yf());
+	Vector2f size = sLayoutFonts[font]->getGlyphRun(text).size;
+	Font::unlock();
     return size;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 Vector2f Font::computeSize(const omega::String& text) 
 { 
-	Font::lock();
-	FTBBox bbox = myFontImpl->BBox(text.c_str());
-	Vector2f size = Vector2f((int)bbox.Upper().Xf(), (int)bbox.Upper().Yf());
-	Font::unlock();
+	myAtlas->lock();
+	Vector2f size = getGlyphRun(text).size;
+	myAtlas->unlock();
 	return size;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-void Font::render(const omega::String& text, float x, float y) 
-{ 
-	Font::lock();
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	glScalef(1.0f, -1.0f, 1.0f);
+const GlyphRun& Font::getGlyphRun(const String& text)
+{
+	Dictionary<String, GlyphRun>::iterator it = myRuns.find(text);
+	if(it != myRuns.end()) return it->second;
 
-	myFontImpl->Render(text.c_str(), text.length(), FTPoint(x, y, 0.0f)); 
+	// When the cache is full just drop it: strings still in use will be laid
+	// out again the next time they are drawn.
+	if(myRuns.size() >= MaxCachedRuns) myRuns.clear();
 
-	glPopMatrix();
-	Font::unlock();
+	GlyphRun& run = myRuns[text];
+	layout(text, run);
+	return run;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void Font::layout(const String& text, GlyphRun& run)
+{
+	run.quads.clear();
+
+	float pen = 0;
+	float maxx = 0;
+	float maxy = 0;
+	uint prevIndex = 0;
+
+	const byte* s = (const byte*)text.c_str();
+	const byte* end = s + text.size();
+	while(s < end)
+	{
+		uint index = myAtlas->getGlyphIndex(myFace, decodeUtf8(s, end));
+		pen += myAtlas->getKerning(myFace, prevIndex, index);
+
+		const GlyphAtlas::Glyph& g = myAtlas->getGlyph(myFace, index);
+		if(g.page >= 0)
+		{
+			GlyphRun::Quad q;
+			q.x0 = pen + g.left;
+			q.x1 = q.x0 + g.width;
+			q.y0 = -g.top;
+			q.y1 = q.y0 + g.height;
+			q.u0 = g.u0;
+			q.v0 = g.v0;
+			q.u1 = g.u1;
+			q.v1 = g.v1;
+			q.page = g.page;
+			run.quads.push_back(q);
+
+			if(q.x1 > maxx) maxx = q.x1;
+			if(g.top > maxy) maxy = g.top;
+		}
+		// Like FTGL bounding boxes, empty glyphs extend the text up to the 
+		// pen position.
+		else if(pen > maxx) maxx = pen;
+
+		pen += g.advance;
+		prevIndex = index;
+	}
+
+	run.size = Vector2f((int)maxx, (int)maxy);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void Font::render(const omega::String& text, float x, float y) 
+{ 
+	myAtlas->lock();
+	const GlyphRun& run = getGlyphRun(text);
+
+	// Runs are laid out with y pointing down: flip y like FTGL does.
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	glEnable(GL_TEXTURE_2D);
+	int page = -1;
+	foreach(const GlyphRun::Quad& q, run.quads)
+	{
+		if(q.page != page)
+		{
+			if(page != -1) glEnd();
+			page = q.page;
+			glBindTexture(GL_TEXTURE_2D, myAtlas->getPageTexture(page));
+			glBegin(GL_QUADS);
+		}
+		glTexCoord2f(q.u0, q.v0); glVertex2f(x + q.x0, -y + q.y0);
+		glTexCoord2f(q.u1, q.v0); glVertex2f(x + q.x1, -y + q.y0);
+		glTexCoord2f(q.u1, q.v1); glVertex2f(x + q.x1, -y + q.y1);
+		glTexCoord2f(q.u0, q.v1); glVertex2f(x + q.x0, -y + q.y1);
+	}
+	if(page != -1) glEnd();
+	glPopAttrib();
+	myAtlas->unlock();
+}
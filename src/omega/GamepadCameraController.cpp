@@ -38,6 +38,7 @@ GamepadCameraController::GamepadCameraController():
 	myPitch(0),
 	myYaw(0)
 {
+	addEventServiceType(Service::Controller);
 }
 	
 ///////////////////////////////////////////////////////////////////////////////////////////////////
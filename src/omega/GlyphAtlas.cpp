@@ -0,0 +1,241 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A glyph atlas packing FreeType rasterized glyphs into shared texture pages.
+ *************************************************************************************************/
+#include "omega/GlyphAtlas.h"
+#include "omega/glheaders.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+using namespace omega;
+
+// Padding between glyphs in a page, to avoid bleeding when filtering.
+static const int sGlyphPadding = 1;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+GlyphAtlas::GlyphAtlas():
+	myLibrary(NULL)
+{
+	if(FT_Init_FreeType(&myLibrary))
+	{
+		owarn("GlyphAtlas: could not initialize FreeType");
+		myLibrary = NULL;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+GlyphAtlas::~GlyphAtlas()
+{
+	// NOTE: page textures are released with their GL context.
+	foreach(Face* f, myFaces)
+	{
+		FT_Done_Face(f->face);
+		delete f;
+	}
+	myFaces.clear();
+	if(myLibrary != NULL) FT_Done_FreeType(myLibrary);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+GlyphAtlas::Face* GlyphAtlas::loadFace(const String& fontPath, int size)
+{
+	if(myLibrary == NULL) return NULL;
+
+	FT_Face ftface;
+	if(FT_New_Face(myLibrary, fontPath.c_str(), 0, &ftface))
+	{
+		ofwarn("GlyphAtlas::loadFace: font %1% failed to open", %fontPath);
+		return NULL;
+	}
+	if(FT_Set_Pixel_Sizes(ftface, 0, size))
+	{
+		ofwarn("GlyphAtlas::loadFace: font %1% failed to set size %2%", %fontPath %size);
+		FT_Done_Face(ftface);
+		return NULL;
+	}
+
+	Face* face = new Face();
+	face->face = ftface;
+	face->size = size;
+	face->hasKerning = FT_HAS_KERNING(ftface) != 0;
+	myFaces.push_back(face);
+	return face;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint GlyphAtlas::getGlyphIndex(Face* face, uint charCode)
+{
+	return FT_Get_Char_Index(face->face, charCode);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+float GlyphAtlas::getKerning(Face* face, uint leftIndex, uint rightIndex)
+{
+	if(!face->hasKerning || leftIndex == 0 || rightIndex == 0) return 0;
+
+	FT_Vector delta;
+	if(FT_Get_Kerning(face->face, leftIndex, rightIndex, FT_KERNING_UNFITTED, &delta)) return 0;
+	return delta.x / 64.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+const GlyphAtlas::Glyph& GlyphAtlas::getGlyph(Face* face, uint glyphIndex)
+{
+	Dictionary<uint, Glyph>::iterator it = face->glyphs.find(glyphIndex);
+	if(it != face->glyphs.end()) return it->second;
+
+	Glyph& g = face->glyphs[glyphIndex];
+	memset(&g, 0, sizeof(Glyph));
+	g.page = -1;
+
+	// Use the same load flags as FTGL, so text metrics match the ones of
+	// FTGL fonts.
+	FT_Face ftface = face->face;
+	if(FT_Load_Glyph(ftface, glyphIndex, FT_LOAD_DEFAULT | FT_LOAD_NO_HINTING) ||
+		FT_Render_Glyph(ftface->glyph, FT_RENDER_MODE_NORMAL))
+	{
+		ofwarn("GlyphAtlas::getGlyph: could not render glyph %1%", %glyphIndex);
+		return g;
+	}
+
+	FT_GlyphSlot slot = ftface->glyph;
+	const FT_Bitmap& bmp = slot->bitmap;
+	g.advance = slot->advance.x / 64.0f;
+	g.left = slot->bitmap_left;
+	g.top = slot->bitmap_top;
+
+	if(bmp.width == 0 || bmp.rows == 0) return g;
+
+	int x, y;
+	if(!allocate(bmp.width, bmp.rows, g.page, x, y))
+	{
+		ofwarn("GlyphAtlas::getGlyph: glyph %1% does not fit in an atlas page", %glyphIndex);
+		g.page = -1;
+		return g;
+	}
+
+	g.width = bmp.width;
+	g.height = bmp.rows;
+	g.u0 = (float)x / PageSize;
+	g.v0 = (float)y / PageSize;
+	g.u1 = (float)(x + g.width) / PageSize;
+	g.v1 = (float)(y + g.height) / PageSize;
+
+	// Copy the glyph bitmap into the page.
+	Page& p = myPages[g.page];
+	for(int row = 0; row < g.height; row++)
+	{
+		memcpy(&p.pixels[(y + row) * PageSize + x], bmp.buffer + row * bmp.pitch, g.width);
+	}
+	if(y < p.dirtyMinY) p.dirtyMinY = y;
+	if(y + g.height > p.dirtyMaxY) p.dirtyMaxY = y + g.height;
+
+	return g;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void GlyphAtlas::addPage()
+{
+	Page p;
+	p.pixels.resize(PageSize * PageSize, 0);
+	p.texture = 0;
+	p.shelfX = 0;
+	p.shelfY = 0;
+	p.shelfHeight = 0;
+	p.dirtyMinY = PageSize;
+	p.dirtyMaxY = 0;
+	myPages.push_back(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+bool GlyphAtlas::allocate(int width, int height, int& outPage, int& outX, int& outY)
+{
+	int w = width + sGlyphPadding;
+	int h = height + sGlyphPadding;
+	if(w > PageSize || h > PageSize) return false;
+
+	if(myPages.empty()) addPage();
+
+	Page* p = &myPages.back();
+	// Start a new shelf if the glyph does not fit in the current one.
+	if(p->shelfX + w > PageSize)
+	{
+		p->shelfY += p->shelfHeight;
+		p->shelfX = 0;
+		p->shelfHeight = 0;
+	}
+	// Start a new page if the glyph does not fit in the current page.
+	if(p->shelfY + h > PageSize)
+	{
+		addPage();
+		p = &myPages.back();
+	}
+
+	outPage = myPages.size() - 1;
+	outX = p->shelfX;
+	outY = p->shelfY;
+	p->shelfX += w;
+	if(h > p->shelfHeight) p->shelfHeight = h;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint GlyphAtlas::getPageTexture(int page)
+{
+	oassert(page >= 0 && page < (int)myPages.size());
+	Page& p = myPages[page];
+
+	if(p.texture == 0)
+	{
+		glGenTextures(1, &p.texture);
+		glBindTexture(GL_TEXTURE_2D, p.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, PageSize, PageSize, 0, GL_ALPHA, GL_UNSIGNED_BYTE, NULL);
+		// Upload the whole page.
+		p.dirtyMinY = 0;
+		p.dirtyMaxY = PageSize;
+	}
+
+	if(p.dirtyMaxY > p.dirtyMinY)
+	{
+		// Upload the changed rows only.
+		glBindTexture(GL_TEXTURE_2D, p.texture);
+		glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, p.dirtyMinY, PageSize, p.dirtyMaxY - p.dirtyMinY,
+			GL_ALPHA, GL_UNSIGNED_BYTE, &p.pixels[p.dirtyMinY * PageSize]);
+		glPopClientAttrib();
+		p.dirtyMinY = PageSize;
+		p.dirtyMaxY = 0;
+	}
+	return p.texture;
+}
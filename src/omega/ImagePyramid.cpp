@@ -0,0 +1,402 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A tile pyramid reader serving view-dependent levels of detail of very large images.
+ *************************************************************************************************/
+#include "omega/ImagePyramid.h"
+#include "omega/DrawContext.h"
+#include "omega/SystemManager.h"
+
+#include <fstream>
+#include <algorithm>
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the value of an attribute in a Deep Zoom descriptor, or an empty
+// string if the attribute is not there. The descriptor is simple enough that
+// we don't need a full xml parser.
+static String getDziAttribute(const String& xml, const String& name)
+{
+    String key = " " + name + "=\"";
+    size_t start = xml.find(key);
+    if(start == String::npos) return "";
+    start += key.size();
+    size_t end = xml.find('"', start);
+    if(end == String::npos) return "";
+    return xml.substr(start, end - start);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static bool compareTileLevel(const ImagePyramid::Tile& a, const ImagePyramid::Tile& b)
+{
+    return a.level < b.level;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static bool compareCacheAge(const std::pair<double, uint64_t>& a, const std::pair<double, uint64_t>& b)
+{
+    return a.first < b.first;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Ref<ImagePyramid> ImagePyramid::create(const String& dziFile)
+{
+    Ref<ImagePyramid> pyramid = new ImagePyramid();
+    if(!pyramid->load(dziFile)) return NULL;
+    return pyramid;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+ImagePyramid::ImagePyramid():
+    myWidth(0),
+    myHeight(0),
+    myTileSize(256),
+    myOverlap(0),
+    myMaxLevel(0),
+    myCacheSize(256 * 1024 * 1024),
+    myCacheMemoryUsage(0),
+    myRequestTimeout(1.0f),
+    myRequestStat(NULL),
+    myMemoryStat(NULL)
+{
+    myTimer.start();
+
+    StatsManager* sm = SystemManager::instance()->getStatsManager();
+    if(sm != NULL)
+    {
+        myRequestStat = sm->findStat("Pyramid tile requests");
+        if(myRequestStat == NULL) myRequestStat = sm->createStat("Pyramid tile requests", StatsManager::Count1);
+        myMemoryStat = sm->findStat("Pyramid tile memory");
+        if(myMemoryStat == NULL) myMemoryStat = sm->createStat("Pyramid tile memory", StatsManager::Memory);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+ImagePyramid::~ImagePyramid()
+{
+    clearCache();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+bool ImagePyramid::load(const String& dziFile)
+{
+    String path;
+    if(!DataManager::findFile(dziFile, path))
+    {
+        ofwarn("ImagePyramid::load: could not find %1%", %dziFile);
+        return false;
+    }
+
+    std::ifstream fin(path.c_str());
+    if(!fin.is_open())
+    {
+        ofwarn("ImagePyramid::load: could not open %1%", %path);
+        return false;
+    }
+    String xml((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+    int width = atoi(getDziAttribute(xml, "Width").c_str());
+    int height = atoi(getDziAttribute(xml, "Height").c_str());
+    int tileSize = atoi(getDziAttribute(xml, "TileSize").c_str());
+    int overlap = atoi(getDziAttribute(xml, "Overlap").c_str());
+    String format = getDziAttribute(xml, "Format");
+    if(width <= 0 || height <= 0 || tileSize <= 0 || format.empty())
+    {
+        ofwarn("ImagePyramid::load: %1% is not a valid Deep Zoom descriptor", %path);
+        return false;
+    }
+
+    // Tiles are stored in a <name>_files directory next to the descriptor.
+    String tilePath = path.substr(0, path.rfind('.')) + "_files";
+    initialize(tilePath, width, height, tileSize, overlap, format);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImagePyramid::initialize(const String& tilePath, int width, int height, 
+    int tileSize, int overlap, const String& format)
+{
+    clearCache();
+
+    myTilePath = tilePath;
+    myWidth = width;
+    myHeight = height;
+    myTileSize = tileSize;
+    myOverlap = overlap;
+    myFormat = format;
+
+    // The last level is the full resolution image, and each level above it 
+    // halves the image size, down to a single pixel.
+    int maxDim = std::max(width, height);
+    myMaxLevel = 0;
+    while((1 << myMaxLevel) < maxDim) myMaxLevel++;
+
+    ofmsg("ImagePyramid: %1% (%2%x%3%, %4% levels)", %tilePath %width %height %(myMaxLevel + 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Vector2i ImagePyramid::getLevelSize(int level)
+{
+    int scale = 1 << (myMaxLevel - level);
+    return Vector2i(
+        std::max(1, (myWidth + scale - 1) / scale),
+        std::max(1, (myHeight + scale - 1) / scale));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Vector2i ImagePyramid::getLevelTiles(int level)
+{
+    Vector2i size = getLevelSize(level);
+    return Vector2i(
+        (size[0] + myTileSize - 1) / myTileSize,
+        (size[1] + myTileSize - 1) / myTileSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+String ImagePyramid::getTilePath(int level, int column, int row)
+{
+    return ostr("%1%/%2%/%3%_%4%.%5%", %myTilePath %level %column %row %myFormat);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int ImagePyramid::getLevelForView(const Rect& imageRegion, const Vector2i& screenSize)
+{
+    if(screenSize[0] <= 0 || screenSize[1] <= 0) return myMaxLevel;
+
+    // Number of image pixels per screen pixel. Each level we go up halves it.
+    float ratio = std::max(
+        (float)imageRegion.width() / screenSize[0],
+        (float)imageRegion.height() / screenSize[1]);
+
+    int levelsUp = 0;
+    while(ratio >= 2.0f && levelsUp < myMaxLevel)
+    {
+        ratio /= 2.0f;
+        levelsUp++;
+    }
+    return myMaxLevel - levelsUp;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImagePyramid::getTiles(const DrawContext& context, const Rect& imageRegion, TileList& outTiles)
+{
+    getTiles(imageRegion, Vector2i(context.viewport.width(), context.viewport.height()), outTiles);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImagePyramid::getTiles(const Rect& imageRegion, const Vector2i& screenSize, TileList& outTiles)
+{
+    if(myWidth == 0 || myHeight == 0) return;
+
+    int level = getLevelForView(imageRegion, screenSize);
+
+    myLock.lock();
+    double now = myTimer.getElapsedTimeInSec();
+
+    // Always keep the coarsest single-tile level around, so there is
+    // something to draw while finer tiles load.
+    int baseLevel = 0;
+    while(baseLevel < myMaxLevel)
+    {
+        Vector2i baseTiles = getLevelTiles(baseLevel + 1);
+        if(baseTiles[0] > 1 || baseTiles[1] > 1) break;
+        baseLevel++;
+    }
+    // It is loaded before anything else.
+    requestTile(baseLevel, 0, 0, now, ImageUtils::PriorityHigh);
+
+    // Find the range of tiles overlapping the image region at this level.
+    int tilePixels = myTileSize << (myMaxLevel - level);
+    Vector2i numTiles = getLevelTiles(level);
+    int x0 = std::max(0, imageRegion.x() / tilePixels);
+    int y0 = std::max(0, imageRegion.y() / tilePixels);
+    int x1 = std::min(numTiles[0] - 1, (imageRegion.x() + imageRegion.width() - 1) / tilePixels);
+    int y1 = std::min(numTiles[1] - 1, (imageRegion.y() + imageRegion.height() - 1) / tilePixels);
+
+    TileList coarseTiles;
+    TileList fineTiles;
+    Dictionary<uint64_t, bool> coarseKeys;
+    for(int row = y0; row <= y1; row++)
+    {
+        for(int col = x0; col <= x1; col++)
+        {
+            Tile t;
+            t.level = level;
+            t.column = col;
+            t.row = row;
+            t.pixels = requestTile(level, col, row, now, ImageUtils::PriorityNormal);
+            if(t.pixels != NULL)
+            {
+                setupTile(t);
+                fineTiles.push_back(t);
+                continue;
+            }
+
+            // Tile not loaded yet: look for the closest loaded tile above it.
+            for(int l = level - 1; l >= 0; l--)
+            {
+                int d = level - l;
+                uint64_t key = getTileKey(l, col >> d, row >> d);
+                TileCache::iterator it = myCache.find(key);
+                if(it != myCache.end() && it->second.pixels != NULL)
+                {
+                    it->second.lastUsed = now;
+                    if(coarseKeys.find(key) == coarseKeys.end())
+                    {
+                        coarseKeys[key] = true;
+                        Tile ct;
+                        ct.level = l;
+                        ct.column = col >> d;
+                        ct.row = row >> d;
+                        ct.pixels = it->second.pixels;
+                        setupTile(ct);
+                        coarseTiles.push_back(ct);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    trimCache(now);
+    myLock.unlock();
+
+    coarseTiles.sort(compareTileLevel);
+    foreach(const Tile& t, coarseTiles) outTiles.push_back(t);
+    foreach(const Tile& t, fineTiles) outTiles.push_back(t);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+PixelData* ImagePyramid::requestTile(int level, int column, int row, double now, int priority)
+{
+    uint64_t key = getTileKey(level, column, row);
+    TileCache::iterator it = myCache.find(key);
+    if(it == myCache.end())
+    {
+        CachedTile ct;
+        ct.lastUsed = now;
+        ct.task = ImageUtils::loadImageAsync(getTilePath(level, column, row), true, priority);
+        myCache[key] = ct;
+        if(myRequestStat != NULL) myRequestStat->addSample(1);
+        return NULL;
+    }
+
+    CachedTile& ct = it->second;
+    ct.lastUsed = now;
+    if(ct.task != NULL && ct.task->isComplete())
+    {
+        // Failed loads keep an empty entry, so we don't retry them every frame.
+        ct.pixels = ct.task->getData().image;
+        ct.task = NULL;
+        if(ct.pixels != NULL) myCacheMemoryUsage += ct.pixels->getSize();
+    }
+    return ct.pixels;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImagePyramid::setupTile(Tile& tile)
+{
+    int scale = 1 << (myMaxLevel - tile.level);
+    Vector2i levelSize = getLevelSize(tile.level);
+
+    // Tile area in level pixels
+    int x = tile.column * myTileSize;
+    int y = tile.row * myTileSize;
+    int w = std::min(myTileSize, levelSize[0] - x);
+    int h = std::min(myTileSize, levelSize[1] - y);
+
+    tile.bounds = Rect(x * scale, y * scale, 
+        std::min(w * scale, myWidth - x * scale), 
+        std::min(h * scale, myHeight - y * scale));
+
+    // Tiles other than the first row / column include a left / top overlap.
+    tile.pixelRegion = Rect(
+        tile.column > 0 ? myOverlap : 0, 
+        tile.row > 0 ? myOverlap : 0, w, h);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImagePyramid::trimCache(double now)
+{
+    Vector<uint64_t> removed;
+    Vector< std::pair<double, uint64_t> > loaded;
+
+    foreach(TileCache::Item t, myCache)
+    {
+        if(t->pixels != NULL)
+        {
+            loaded.push_back(std::pair<double, uint64_t>(t->lastUsed, t.getKey()));
+        }
+        else if(t->task != NULL && now - t->lastUsed > myRequestTimeout)
+        {
+            // Cancelled requests are skipped by the loader threads if they
+            // have not started yet.
+            t->task->cancel();
+            removed.push_back(t.getKey());
+        }
+    }
+
+    // Evict least recently used tiles, but never tiles used in this request.
+    if(myCacheMemoryUsage > myCacheSize)
+    {
+        std::sort(loaded.begin(), loaded.end(), compareCacheAge);
+        for(int i = 0; i < loaded.size() && myCacheMemoryUsage > myCacheSize; i++)
+        {
+            if(loaded[i].first >= now) break;
+            CachedTile& ct = myCache[loaded[i].second];
+            myCacheMemoryUsage -= ct.pixels->getSize();
+            removed.push_back(loaded[i].second);
+        }
+    }
+
+    foreach(uint64_t key, removed) myCache.erase(key);
+
+    if(myMemoryStat != NULL) myMemoryStat->addSample(myCacheMemoryUsage);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImagePyramid::setCacheSize(size_t bytes)
+{
+    myLock.lock();
+    myCacheSize = bytes;
+    trimCache(myTimer.getElapsedTimeInSec());
+    myLock.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImagePyramid::clearCache()
+{
+    myLock.lock();
+    foreach(TileCache::Item t, myCache)
+    {
+        if(t->task != NULL) t->task->cancel();
+    }
+    myCache.clear();
+    myCacheMemoryUsage = 0;
+    myLock.unlock();
+}
@@ -26,6 +26,7 @@
  *************************************************************************************************/
 #include "omega/ImageUtils.h"
 #include "omega/SystemManager.h"
+#include "omega/Semaphore.h"
 
 #define FREEIMAGE_BIGENDIAN
 #include "FreeImage.h"
@@ -34,6 +35,12 @@
 #include "image.h"
 #endif
 
+#include <queue>
+#include <string.h>
+#include <list>
+#include <sys/types.h>
+#include <sys/stat.h>
+
 using namespace omega;
 
 // Vector of preallocated memory blocks for image loading.
@@ -41,12 +48,183 @@ Vector<void*> ImageUtils::sPreallocBlocks;
 size_t ImageUtils::sPreallocBlockSize;
 int ImageUtils::sLoadPreallocBlock = -1;
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// A queued async load request. Requests are ordered by priority first, then
+// by submission order.
+struct ImageQueueItem
+{
+    Ref<ImageUtils::LoadImageAsyncTask> task;
+    int priority;
+    uint64_t sequence;
+    double queueTime;
+
+    bool operator<(const ImageQueueItem& other) const
+    {
+        if(priority != other.priority) return priority < other.priority;
+        return sequence > other.sequence;
+    }
+};
+
 Lock sImageQueueLock;
 //Lock sImageLoaderLock;
 
-Queue< Ref<ImageUtils::LoadImageAsyncTask> > sImageQueue;
+std::priority_queue<ImageQueueItem> sImageQueue;
+Semaphore sImageQueueSignal;
+uint64_t sImageQueueSequence = 0;
+Timer sImageQueueTimer;
 bool sShutdownLoaderThread = false;
 
+// Image queue statistics, created when loader threads start.
+Stat* sImageQueueDepthStat = NULL;
+Stat* sImageQueueLatencyStat = NULL;
+Stat* sImageLoadTimeStat = NULL;
+Stat* sImageCancelledStat = NULL;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Process-wide cache of decoded images, with least recently used eviction.
+class ImageCache
+{
+public:
+    struct Entry
+    {
+        String path;
+        time_t mtime;
+        size_t size;
+        Ref<PixelData> data;
+    };
+    typedef std::list<Entry> EntryList;
+
+public:
+    ImageCache(): myMemoryUsage(0), myHits(0), myMisses(0),
+        myHitStat(NULL), myMissStat(NULL), myMemoryStat(NULL)
+    {}
+
+    void initializeStats()
+    {
+        StatsManager* sm = SystemManager::instance()->getStatsManager();
+        if(sm != NULL && myHitStat == NULL)
+        {
+            myHitStat = sm->createStat("Image cache hits", StatsManager::Count1);
+            myMissStat = sm->createStat("Image cache misses", StatsManager::Count1);
+            myMemoryStat = sm->createStat("Image cache memory", StatsManager::Memory);
+        }
+    }
+
+    Ref<PixelData> find(const String& path, time_t mtime)
+    {
+        Ref<PixelData> result;
+        myLock.lock();
+        Dictionary<String, EntryList::iterator>::iterator it = myIndex.find(path);
+        if(it != myIndex.end())
+        {
+            EntryList::iterator e = it->second;
+            if(e->mtime == mtime)
+            {
+                // Move the entry to the front of the LRU list.
+                myEntries.splice(myEntries.begin(), myEntries, e);
+                result = e->data;
+            }
+            else
+            {
+                // The file changed on disk: drop the stale entry.
+                remove(e);
+            }
+        }
+        if(result != NULL) myHits++;
+        else myMisses++;
+        if(myHitStat != NULL)
+        {
+            myHitStat->addSample(myHits);
+            myMissStat->addSample(myMisses);
+        }
+        myLock.unlock();
+        return result;
+    }
+
+    void insert(const String& path, time_t mtime, PixelData* data, size_t budget)
+    {
+        size_t size = data->getSize();
+        // Images larger than the whole budget are never cached.
+        if(size > budget) return;
+
+        myLock.lock();
+        Dictionary<String, EntryList::iterator>::iterator it = myIndex.find(path);
+        if(it != myIndex.end()) remove(it->second);
+
+        Entry e;
+        e.path = path;
+        e.mtime = mtime;
+        e.size = size;
+        e.data = data;
+        myEntries.push_front(e);
+        myIndex[path] = myEntries.begin();
+        myMemoryUsage += size;
+
+        trim(budget);
+        myLock.unlock();
+    }
+
+    void setBudget(size_t budget)
+    {
+        myLock.lock();
+        trim(budget);
+        myLock.unlock();
+    }
+
+    void clear()
+    {
+        myLock.lock();
+        myEntries.clear();
+        myIndex.clear();
+        myMemoryUsage = 0;
+        if(myMemoryStat != NULL) myMemoryStat->addSample(myMemoryUsage);
+        myLock.unlock();
+    }
+
+    size_t getMemoryUsage()
+    {
+        myLock.lock();
+        size_t usage = myMemoryUsage;
+        myLock.unlock();
+        return usage;
+    }
+
+private:
+    // Must be called with the cache lock held.
+    void trim(size_t budget)
+    {
+        while(myMemoryUsage > budget && !myEntries.empty())
+        {
+            EntryList::iterator last = myEntries.end();
+            remove(--last);
+        }
+        if(myMemoryStat != NULL) myMemoryStat->addSample(myMemoryUsage);
+    }
+
+    // Must be called with the cache lock held.
+    void remove(EntryList::iterator e)
+    {
+        myMemoryUsage -= e->size;
+        myIndex.erase(e->path);
+        myEntries.erase(e);
+    }
+
+private:
+    Lock myLock;
+    EntryList myEntries;
+    Dictionary<String, EntryList::iterator> myIndex;
+    size_t myMemoryUsage;
+    uint64_t myHits;
+    uint64_t myMisses;
+    Stat* myHitStat;
+    Stat* myMissStat;
+    Stat* myMemoryStat;
+};
+
+ImageCache sImageCache;
+bool ImageUtils::sCacheEnabled = false;
+size_t ImageUtils::sCacheSize = 256 * 1024 * 1024;
+
 bool ImageUtils::sVerbose = false;
 
 int ImageUtils::sNumLoaderThreads = 4;
@@ -66,30 +244,50 @@ public:
 
         while(!sShutdownLoaderThread)
         {
+            // Sleep until a request is queued or we are shutting down.
+            sImageQueueSignal.wait();
+
             sImageQueueLock.lock();
-            if(sImageQueue.size() > 0)
+            if(sShutdownLoaderThread || sImageQueue.empty())
             {
+                sImageQueueLock.unlock();
+                continue;
+            }
 
-                Ref<ImageUtils::LoadImageAsyncTask> task = sImageQueue.front();
-                sImageQueue.pop();
+            ImageQueueItem item = sImageQueue.top();
+            sImageQueue.pop();
 
+            // Skip requests that have been cancelled.
+            Ref<ImageUtils::LoadImageAsyncTask> task = item.task;
+            item.task = NULL;
+            if(task->isCancelled())
+            {
+                if(sImageCancelledStat != NULL) sImageCancelledStat->addSample(1);
                 sImageQueueLock.unlock();
+                continue;
+            }
 
-                Ref<PixelData> res = ImageUtils::loadImage(task->getData().path, task->getData().isFullPath);
-                
-                if(!sShutdownLoaderThread)
-                {
-                    task->getData().image = res;
-                    task->notifyComplete();
-                }
-                //sImageQueueLock.unlock();
-
+            double startTime = sImageQueueTimer.getElapsedTimeInMilliSec();
+            if(sImageQueueLatencyStat != NULL)
+            {
+                sImageQueueLatencyStat->addSample(startTime - item.queueTime);
             }
-            else
+            sImageQueueLock.unlock();
+
+            Ref<PixelData> res = ImageUtils::loadImage(task->getData().path, task->getData().isFullPath);
+            
+            if(!sShutdownLoaderThread)
             {
-                sImageQueueLock.unlock();
+                if(sImageLoadTimeStat != NULL)
+                {
+                    sImageQueueLock.lock();
+                    sImageLoadTimeStat->addSample(
+                        sImageQueueTimer.getElapsedTimeInMilliSec() - startTime);
+                    sImageQueueLock.unlock();
+                }
+                task->getData().image = res;
+                task->notifyComplete();
             }
-            osleep(100);
         }
 
         omsg("ImageLoaderThread: shutdown");
@@ -148,8 +346,16 @@ void ImageUtils::internalDispose()
 {
     sShutdownLoaderThread = true;
 
+    // Wake up all loader threads so they can see the shutdown flag.
+    sImageQueueSignal.post(sImageLoaderThread.size());
     foreach(Thread* t, sImageLoaderThread) t->stop();
 
+    sImageQueueLock.lock();
+    while(!sImageQueue.empty()) sImageQueue.pop();
+    sImageQueueLock.unlock();
+
+    sImageCache.clear();
+
     FreeImage_DeInitialise();
 
     // Clean up preallocated memory blocks.
@@ -161,10 +367,20 @@ void ImageUtils::internalDispose()
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-ImageUtils::LoadImageAsyncTask* ImageUtils::loadImageAsync(const String& filename, bool hasFullPath)
+ImageUtils::LoadImageAsyncTask* ImageUtils::loadImageAsync(const String& filename, bool hasFullPath, int priority)
 {
     if(sImageLoaderThread.size() == 0)
     {
+        StatsManager* sm = SystemManager::instance()->getStatsManager();
+        if(sm != NULL)
+        {
+            sImageQueueDepthStat = sm->createStat("Image queue depth", StatsManager::Count1);
+            sImageQueueLatencyStat = sm->createStat("Image queue latency", StatsManager::Time);
+            sImageLoadTimeStat = sm->createStat("Image load time", StatsManager::Time);
+            sImageCancelledStat = sm->createStat("Image loads skipped", StatsManager::Count1);
+        }
+
+        sImageQueueTimer.start();
         for(int i = 0; i < sNumLoaderThreads; i++)
         {
             Thread* t = new ImageLoaderThread();
@@ -173,15 +389,60 @@ ImageUtils::LoadImageAsyncTask* ImageUtils::loadImageAsync(const String& filenam
         }
     }
 
-    sImageQueueLock.lock();
-    LoadImageAsyncTask* task = new LoadImageAsyncTask();
+    Ref<LoadImageAsyncTask> task = new LoadImageAsyncTask();
     task->setData( LoadImageAsyncTask::Data(filename, hasFullPath) );
     task->setTaskId(filename);
-    sImageQueue.push(task);
+
+    sImageQueueLock.lock();
+    ImageQueueItem item;
+    item.task = task;
+    item.priority = priority;
+    item.sequence = sImageQueueSequence++;
+    item.queueTime = sImageQueueTimer.getElapsedTimeInMilliSec();
+    sImageQueue.push(item);
+    if(sImageQueueDepthStat != NULL) sImageQueueDepthStat->addSample(sImageQueue.size());
     sImageQueueLock.unlock();
+
+    sImageQueueSignal.post();
     return task;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int ImageUtils::getImageQueueLength()
+{
+    sImageQueueLock.lock();
+    int length = sImageQueue.size();
+    sImageQueueLock.unlock();
+    return length;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImageUtils::setCacheEnabled(bool value)
+{
+    sCacheEnabled = value;
+    if(sCacheEnabled) sImageCache.initializeStats();
+    else sImageCache.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImageUtils::setCacheSize(size_t bytes)
+{
+    sCacheSize = bytes;
+    sImageCache.setBudget(sCacheSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ImageUtils::getCacheMemoryUsage()
+{
+    return sImageCache.getMemoryUsage();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void ImageUtils::clearCache()
+{
+    sImageCache.clear();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 Ref<PixelData> ImageUtils::ffbmpToPixelData(FIBITMAP*& image, const String& filename)
 {
@@ -223,19 +484,21 @@ Ref<PixelData> ImageUtils::ffbmpToPixelData(FIBITMAP*& image, const String& file
     if(sVerbose) ofmsg("Image loaded: %1%. Size: %2%x%3%", %filename %width %height);
     
     byte* data = pixelData->map();
-    
-    for(int i = 0; i < height; i++)
+
+    // We force FreeImage to big endian mode, so scanlines already have the
+    // channel order PixelData expects: conversion is a plain copy. Scanlines
+    // are padded to 32 bits, PixelData rows are tightly packed.
+    size_t rowSize = width * pixelOffset;
+    size_t srcPitch = FreeImage_GetPitch(image);
+    if(srcPitch == rowSize)
+    {
+        memcpy(data, FreeImage_GetBits(image), rowSize * height);
+    }
+    else
     {
-        char* pixels = (char*)FreeImage_GetScanLine(image, i);
-        for(int j = 0; j < width; j++)
+        for(int i = 0; i < height; i++)
         {
-            int k = i * width + j;
-            // TODO: optimize this with memcpy
-            data[k * pixelOffset + 0] = pixels[j * pixelOffset + 0];
-            data[k * pixelOffset + 1] = pixels[j * pixelOffset + 1];
-            data[k * pixelOffset + 2] = pixels[j * pixelOffset + 2];
-            if(bpp == 32) data[k * pixelOffset + 3] = pixels[j * pixelOffset + 3];
-            //data[j * pixelOffset + 3] = pixels[j * pixelOffset + 3];
+            memcpy(data + i * rowSize, FreeImage_GetScanLine(image, i), rowSize);
         }
     }
     pixelData->unmap();
@@ -265,6 +528,34 @@ Ref<PixelData> ImageUtils::loadImage(const String& filename, bool hasFullPath)
         path = filename;
     }
 
+    // Images decoded into a preallocated block get overwritten by the next
+    // load, so they can't be cached.
+    if(!sCacheEnabled || sLoadPreallocBlock != -1)
+    {
+        return loadImageFile(path, filename);
+    }
+
+    struct stat fileInfo;
+    if(stat(path.c_str(), &fileInfo) != 0)
+    {
+        return loadImageFile(path, filename);
+    }
+
+    Ref<PixelData> pixelData = sImageCache.find(path, fileInfo.st_mtime);
+    if(pixelData == NULL)
+    {
+        pixelData = loadImageFile(path, filename);
+        if(pixelData != NULL)
+        {
+            sImageCache.insert(path, fileInfo.st_mtime, pixelData, sCacheSize);
+        }
+    }
+    return pixelData;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Ref<PixelData> ImageUtils::loadImageFile(const String& path, const String& filename)
+{
     uint bpp = 0;
     int width = 0;
     int height = 0;
@@ -369,7 +660,7 @@ Ref<PixelData> ImageUtils::decode(void* data, size_t size, const String& bufName
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-ByteArray* ImageUtils::encode(PixelData* data, ImageFormat format)
+ByteArray* ImageUtils::encode(PixelData* data, ImageFormat format, int quality)
 {
     switch (format){
     // PNG
@@ -431,8 +722,11 @@ ByteArray* ImageUtils::encode(PixelData* data, ImageFormat format)
             // Swap needed for jpegs?
             
 
-            // Encode the bitmap to a freeimage memory buffer
-            FreeImage_SaveToMemory(FIF_JPEG, fibmp24, fmem);
+            // Encode the bitmap to a freeimage memory buffer. FreeImage takes
+            // jpeg quality values in the 1-100 range directly as save flags.
+            int flags = JPEG_DEFAULT;
+            if(quality > 0) flags = quality > 100 ? 100 : quality;
+            FreeImage_SaveToMemory(FIF_JPEG, fibmp24, fmem, flags);
 
             // Copy the freeimage memory buffer to omegalib bytearray
             BYTE* fmemdata = NULL;
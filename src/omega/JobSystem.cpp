@@ -0,0 +1,349 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A work-stealing job system shared by engine subsystems and modules.
+ *************************************************************************************************/
+#include "omega/JobSystem.h"
+
+#ifdef OMEGA_OS_WIN
+    #include <Windows.h>
+    #define JOB_THREAD_LOCAL __declspec(thread)
+#else
+    #include <unistd.h>
+    #define JOB_THREAD_LOCAL __thread
+#endif
+
+using namespace omega;
+
+Lock Job::sDependencyLock;
+
+// Job system and worker index of the current thread. Used to push jobs 
+// submitted by workers to their own deque.
+static JOB_THREAD_LOCAL JobSystem* sCurrentSystem = NULL;
+static JOB_THREAD_LOCAL int sCurrentWorker = -1;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void Job::addDependency(Job* job)
+{
+	sDependencyLock.lock();
+	oassert(!mySubmitted);
+	if(!job->myDone)
+	{
+		myPendingDependencies++;
+		job->myDependents.push_back(this);
+	}
+	sDependencyLock.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+bool Job::isDone()
+{
+	sDependencyLock.lock();
+	bool done = myDone;
+	sDependencyLock.unlock();
+	return done;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct JobSystem::Worker
+{
+	Worker(): thread(NULL) {}
+	Thread* thread;
+	// Owner pushes and pops at the back, thieves take from the front.
+	List< Ref<Job> > queue;
+	Lock lock;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class JobSystem::WorkerThread: public Thread
+{
+public:
+	WorkerThread(JobSystem* owner, int index): myOwner(owner), myIndex(index)
+	{}
+
+	virtual void threadProc()
+	{
+		sCurrentSystem = myOwner;
+		sCurrentWorker = myIndex;
+		while(true)
+		{
+			Ref<Job> job = myOwner->findJob(myIndex);
+			if(!job.isNull())
+			{
+				myOwner->runJob(job);
+			}
+			else
+			{
+				// Every scheduled job posts the signal once, so a job queued
+				// after findJob failed wakes us up right away.
+				myOwner->myWorkSignal.wait();
+				if(myOwner->myShutdown) break;
+			}
+		}
+	}
+
+private:
+	JobSystem* myOwner;
+	int myIndex;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// A parallelFor range.
+class RangeJob: public Job
+{
+public:
+	RangeJob(ParallelLoop* loop, int first, int end): 
+		myLoop(loop), myFirst(first), myEnd(end) {}
+
+	virtual void execute() { myLoop->run(myFirst, myEnd); }
+
+private:
+	ParallelLoop* myLoop;
+	int myFirst;
+	int myEnd;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int JobSystem::getNumCores()
+{
+#ifdef OMEGA_OS_WIN
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return si.dwNumberOfProcessors;
+#else
+	int cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? cores : 1;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+JobSystem::JobSystem():
+	myShutdown(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+JobSystem::~JobSystem()
+{
+	stopThreads();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void JobSystem::setThreads(int threads)
+{
+	stopThreads();
+	for(int i = 0; i < threads; i++) myWorkers.push_back(new Worker());
+	// Start threads once all the workers exist, since they steal from each
+	// other.
+	for(int i = 0; i < threads; i++)
+	{
+		myWorkers[i]->thread = new WorkerThread(this, i);
+		myWorkers[i]->thread->start();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void JobSystem::stopThreads()
+{
+	if(myWorkers.size() == 0) return;
+
+	myShutdown = true;
+	myWorkSignal.post(myWorkers.size());
+	foreach(Worker* w, myWorkers)
+	{
+		w->thread->stop();
+		delete w->thread;
+	}
+	// Jobs left in worker queues go to the shared queue, so waiting threads
+	// can still run them.
+	foreach(Worker* w, myWorkers)
+	{
+		foreach(Job* j, w->queue) mySharedQueue.push_back(j);
+		delete w;
+	}
+	myWorkers.clear();
+	myShutdown = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void JobSystem::submit(Job* job)
+{
+	Job::sDependencyLock.lock();
+	job->mySubmitted = true;
+	bool ready = (job->myPendingDependencies == 0);
+	Job::sDependencyLock.unlock();
+
+	// Jobs with pending dependencies are scheduled by the last dependency
+	// to finish.
+	if(ready) schedule(job);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void JobSystem::schedule(Job* job)
+{
+	if(sCurrentSystem == this && sCurrentWorker >= 0)
+	{
+		Worker* w = myWorkers[sCurrentWorker];
+		w->lock.lock();
+		w->queue.push_back(job);
+		w->lock.unlock();
+	}
+	else
+	{
+		mySharedQueueLock.lock();
+		mySharedQueue.push_back(job);
+		mySharedQueueLock.unlock();
+	}
+	if(myWorkers.size() > 0) myWorkSignal.post();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Ref<Job> JobSystem::findJob(int worker)
+{
+	Ref<Job> job;
+	int numWorkers = myWorkers.size();
+
+	// Own queue first, newest job.
+	if(worker >= 0)
+	{
+		Worker* w = myWorkers[worker];
+		w->lock.lock();
+		if(!w->queue.empty())
+		{
+			job = w->queue.back();
+			w->queue.pop_back();
+		}
+		w->lock.unlock();
+		if(!job.isNull()) return job;
+	}
+
+	// Then jobs submitted from outside the workers.
+	mySharedQueueLock.lock();
+	if(!mySharedQueue.empty())
+	{
+		job = mySharedQueue.front();
+		mySharedQueue.pop_front();
+	}
+	mySharedQueueLock.unlock();
+	if(!job.isNull()) return job;
+
+	// Then steal the oldest job of another worker, starting from the next 
+	// one so thieves spread over victims.
+	for(int i = 1; i <= numWorkers; i++)
+	{
+		int victim = (worker + i) % numWorkers;
+		if(victim == worker) continue;
+		Worker* w = myWorkers[victim];
+		w->lock.lock();
+		if(!w->queue.empty())
+		{
+			job = w->queue.front();
+			w->queue.pop_front();
+		}
+		w->lock.unlock();
+		if(!job.isNull()) return job;
+	}
+	return job;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void JobSystem::runJob(Job* job)
+{
+	job->execute();
+
+	// Release the dependents whose last dependency was this job.
+	Vector< Ref<Job> > ready;
+	Job::sDependencyLock.lock();
+	job->myDone = true;
+	int waiters = job->myWaiters;
+	job->myWaiters = 0;
+	foreach(Job* d, job->myDependents)
+	{
+		d->myPendingDependencies--;
+		if(d->myPendingDependencies == 0 && d->mySubmitted) ready.push_back(d);
+	}
+	job->myDependents.clear();
+	Job::sDependencyLock.unlock();
+
+	if(waiters > 0) job->myDoneSignal.post(waiters);
+	foreach(Job* d, ready) schedule(d);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void JobSystem::wait(Job* job)
+{
+	int worker = (sCurrentSystem == this) ? sCurrentWorker : -1;
+	while(!job->isDone())
+	{
+		// Help instead of blocking: the job we wait for may be queued behind
+		// other jobs, or be waiting for jobs nobody else is running.
+		Ref<Job> other = findJob(worker);
+		if(!other.isNull())
+		{
+			runJob(other);
+		}
+		else
+		{
+			// Nothing else to run: the job is running on another thread, or
+			// waits for jobs that are. Sleep until it is done.
+			Job::sDependencyLock.lock();
+			if(job->myDone)
+			{
+				Job::sDependencyLock.unlock();
+				break;
+			}
+			job->myWaiters++;
+			Job::sDependencyLock.unlock();
+			job->myDoneSignal.wait();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void JobSystem::parallelFor(int count, int batchSize, ParallelLoop* loop)
+{
+	if(count <= 0) return;
+	if(batchSize < 1) batchSize = 1;
+
+	// Nothing to split: run in place.
+	if(myWorkers.size() == 0 || count <= batchSize)
+	{
+		loop->run(0, count);
+		return;
+	}
+
+	Vector< Ref<Job> > jobs;
+	for(int first = 0; first < count; first += batchSize)
+	{
+		int end = first + batchSize;
+		if(end > count) end = count;
+		Ref<Job> j = new RangeJob(loop, first, end);
+		jobs.push_back(j);
+		submit(j);
+	}
+	foreach(Job* j, jobs) wait(j);
+}
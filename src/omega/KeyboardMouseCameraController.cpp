@@ -50,6 +50,8 @@ KeyboardMouseCameraController::KeyboardMouseCameraController():
     myRotating(false),
     myAltRotating(false)
 {
+    addEventServiceType(Service::Keyboard);
+    addEventServiceType(Service::Pointer);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
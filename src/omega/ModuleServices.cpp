@@ -34,15 +34,73 @@
  *	the engine and receive update, event and command calls.
  ******************************************************************************/
 #include "omega/ModuleServices.h"
+#include "omega/JobSystem.h"
+#include "omega/SystemManager.h"
+
+#include <algorithm>
 
 using namespace omega;
 
+///////////////////////////////////////////////////////////////////////////////
+// Runs a module update on the engine job system.
+class ModuleUpdateJob: public Job
+{
+public:
+	ModuleUpdateJob(EngineModule* module, const UpdateContext& context):
+		myModule(module), myContext(context), myTimed(false), myTime(0) {}
+
+	virtual void execute() 
+	{ 
+		if(!myTimed)
+		{
+			myModule->update(myContext); 
+		}
+		else
+		{
+			// Stats are not thread-safe: the sample is added once the job is
+			// done.
+			Timer t;
+			t.start();
+			myModule->update(myContext); 
+			t.stop();
+			myTime = t.getElapsedTimeInMilliSec();
+		}
+	}
+
+	EngineModule* myModule;
+	const UpdateContext& myContext;
+	bool myTimed;
+	double myTime;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the average of a stat, or zero if the stat is not set or has no 
+// samples.
+static double statAvg(Stat* s)
+{ return (s != NULL && s->isValid()) ? s->getAvg() : 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+static double statMax(Stat* s)
+{ return (s != NULL && s->isValid()) ? s->getMax() : 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+static double statTotal(Stat* s)
+{ return (s != NULL && s->isValid()) ? s->getTotal() : 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+static bool slowerModule(EngineModule* a, EngineModule* b)
+{ return a->getTotalTime() > b->getTotalTime(); }
+
 NameGenerator EngineModule::mysNameGenerator("Module_");
 
 List< Ref<EngineModule> > ModuleServices::mysModules;
 List< Ref<EngineModule> > ModuleServices::mysModulesToRemove;
 List< EngineModule* > ModuleServices::mysNonCoreModules;
 bool ModuleServices::mysCoreMode = true;
+bool ModuleServices::mysTimingEnabled = false;
+Vector<EngineModule*> ModuleServices::mysEventRoutes[EngineModule::PriorityHighest + 1][ModuleServices::NumEventRoutes];
+bool ModuleServices::mysEventRoutesDirty = true;
+int ModuleServices::mysEventDispatchDepth = 0;
 
 ///////////////////////////////////////////////////////////////////////////////
 void EngineModule::enableSharedData() 
@@ -63,11 +121,13 @@ void EngineModule::doInitialize(Engine* server)
 	if(myEngine == NULL) myEngine = server; 
 	if(!myInitialized) 
 	{
+		if(!myInitializeTimeStat.isNull()) myInitializeTimeStat->startTiming();
 		initialize(); 
 		foreach(Renderer* r, server->getRendererList())
 		{
 			initializeRenderer(r);
 		}
+		if(!myInitializeTimeStat.isNull()) myInitializeTimeStat->stopTiming();
 
 		if(mySharedDataEnabled) SharedDataServices::registerObject(this, myName);
 		myInitialized = true; 
@@ -85,11 +145,129 @@ void EngineModule::doDispose()
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void EngineModule::doUpdate(const UpdateContext& context)
+{
+	if(myUpdateTimeStat.isNull())
+	{
+		update(context);
+	}
+	else
+	{
+		myUpdateTimeStat->startTiming();
+		update(context);
+		myUpdateTimeStat->stopTiming();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EngineModule::setPriority(Priority value) 
+{ 
+	myPriority = value; 
+	ModuleServices::invalidateEventRoutes();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EngineModule::addEventServiceType(Service::ServiceType type)
+{
+	if(type >= 0 && type <= MaxFilterType)
+	{
+		myEventServiceMask |= (uint64_t)1 << type;
+		ModuleServices::invalidateEventRoutes();
+	}
+	else
+	{
+		ofwarn("EngineModule::addEventServiceType: %1%: service type %2% cannot be filtered", 
+			%myName %type);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EngineModule::addEventType(Event::Type type)
+{
+	if(type >= 0 && type <= MaxFilterType)
+	{
+		myEventTypeMask |= (uint64_t)1 << type;
+	}
+	else
+	{
+		ofwarn("EngineModule::addEventType: %1%: event type %2% cannot be filtered", 
+			%myName %type);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EngineModule::setEventSourceRange(uint first, uint last)
+{
+	myEventSourceFirst = first;
+	myEventSourceLast = last;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EngineModule::clearEventFilters()
+{
+	myEventServiceMask = 0;
+	myEventTypeMask = 0;
+	myEventSourceFirst = 0;
+	myEventSourceLast = 0xffffffff;
+	ModuleServices::invalidateEventRoutes();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool EngineModule::isEventAccepted(const Event& evt)
+{
+	uint st = evt.getServiceType();
+	if(myEventServiceMask != 0 && 
+		(st > MaxFilterType || (myEventServiceMask & ((uint64_t)1 << st)) == 0)) return false;
+	uint et = evt.getType();
+	if(myEventTypeMask != 0 && 
+		(et > MaxFilterType || (myEventTypeMask & ((uint64_t)1 << et)) == 0)) return false;
+	uint src = evt.getSourceId();
+	return src >= myEventSourceFirst && src <= myEventSourceLast;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EngineModule::setTimingEnabled(bool value)
+{
+	if(value)
+	{
+		if(myUpdateTimeStat.isNull())
+		{
+			StatsManager* sm = SystemManager::instance()->getStatsManager();
+			myInitializeTimeStat = sm->createStat(ostr("Module %1% initialize", %myName), StatsManager::Time);
+			myUpdateTimeStat = sm->createStat(ostr("Module %1% update", %myName), StatsManager::Time);
+			myEventTimeStat = sm->createStat(ostr("Module %1% event", %myName), StatsManager::Time);
+			setSharedDataStats(
+				sm->createStat(ostr("Module %1% commit", %myName), StatsManager::Time),
+				sm->createStat(ostr("Module %1% shared update", %myName), StatsManager::Time));
+		}
+	}
+	else
+	{
+		// Releasing the stats destroys them, which removes them from the 
+		// stats manager.
+		myInitializeTimeStat = NULL;
+		myUpdateTimeStat = NULL;
+		myEventTimeStat = NULL;
+		setSharedDataStats(NULL, NULL);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double EngineModule::getTotalTime()
+{
+	return statTotal(myInitializeTimeStat) + statTotal(myUpdateTimeStat) + 
+		statTotal(myEventTimeStat) + statTotal(getCommitTimeStat()) + 
+		statTotal(getSharedUpdateTimeStat());
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void ModuleServices::addModule(EngineModule* module)
 { 
 	ofmsg("ModuleServices::addModule: %1%", %module->getName());
+	if(mysTimingEnabled) module->setTimingEnabled(true);
 	mysModules.push_back(module); 
+	invalidateEventRoutes();
 	if(!mysCoreMode) mysNonCoreModules.push_back(module);
 }
 
@@ -106,35 +284,124 @@ void ModuleServices::removeModule(EngineModule* module)
 ///////////////////////////////////////////////////////////////////////////////
 void ModuleServices::update(Engine* srv, const UpdateContext& context)
 {
+	// Modules with parallel update enabled are collected here, and updated
+	// once all the other modules are done.
+	Vector<EngineModule*> parallelModules;
 	foreach(EngineModule* module, mysModules)
 	{
 		module->doInitialize(srv);
-		module->update(context);
+		if(module->isParallelUpdateEnabled()) 
+		{
+			parallelModules.push_back(module);
+		}
+		else
+		{
+			module->doUpdate(context);
+		}
 	}
+	if(!parallelModules.empty()) updateParallel(srv, parallelModules, context);
 
 	// Remove modules
 	foreach(EngineModule* module, mysModulesToRemove)
 	{
 		module->doDispose();
 		mysModules.remove(module);
+		invalidateEventRoutes();
 	}
 	mysModulesToRemove.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void ModuleServices::handleEvent(const Event& evt, EngineModule::Priority p)
+void ModuleServices::updateParallel(Engine* srv, const Vector<EngineModule*>& modules, const UpdateContext& context)
+{
+	typedef Dictionary<EngineModule*, Ref<ModuleUpdateJob> > JobDictionary;
+	JobDictionary jobs;
+	foreach(EngineModule* module, modules)
+	{
+		ModuleUpdateJob* job = new ModuleUpdateJob(module, context);
+		job->myTimed = !module->myUpdateTimeStat.isNull();
+		jobs[module] = job;
+	}
+	// Dependencies on modules that are not in the parallel set are ignored:
+	// those modules have already been updated.
+	foreach(EngineModule* module, modules)
+	{
+		Job* job = jobs[module];
+		foreach(EngineModule* dep, module->myUpdateDependencies)
+		{
+			JobDictionary::iterator it = jobs.find(dep);
+			if(it != jobs.end()) job->addDependency(it->second);
+		}
+	}
+
+	JobSystem* js = srv->getJobSystem();
+	foreach(EngineModule* module, modules) js->submit(jobs[module]);
+	foreach(EngineModule* module, modules) js->wait(jobs[module]);
+
+	foreach(EngineModule* module, modules)
+	{
+		ModuleUpdateJob* job = jobs[module];
+		if(job->myTimed) module->myUpdateTimeStat->addSample(job->myTime);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ModuleServices::buildEventRoutes()
 {
+	for(int p = 0; p <= EngineModule::PriorityHighest; p++)
+	{
+		for(int r = 0; r < NumEventRoutes; r++) mysEventRoutes[p][r].clear();
+	}
 	foreach(EngineModule* module, mysModules)
 	{
+		Vector<EngineModule*>* routes = mysEventRoutes[module->getPriority()];
+		for(int st = 0; st <= EngineModule::MaxFilterType; st++)
+		{
+			if(module->myEventServiceMask == 0 ||
+				(module->myEventServiceMask & ((uint64_t)1 << st)) != 0)
+			{
+				routes[st].push_back(module);
+			}
+		}
+		routes[NumEventRoutes - 1].push_back(module);
+	}
+	mysEventRoutesDirty = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ModuleServices::handleEvent(const Event& evt, EngineModule::Priority p)
+{
+	if(mysEventRoutesDirty && mysEventDispatchDepth == 0) buildEventRoutes();
+
+	uint st = evt.getServiceType();
+	if(st > EngineModule::MaxFilterType) st = NumEventRoutes - 1;
+	const Vector<EngineModule*>& routes = mysEventRoutes[p][st];
+
+	// Modules can be added or removed by event handlers: iterate by index, 
+	// and do not rebuild routes until we are done.
+	mysEventDispatchDepth++;
+	for(int i = 0; i < routes.size(); i++)
+	{
+		EngineModule* module = routes[i];
 		// Only send events to initialized modules.
 		if(module->isInitialized())
 		{
-			if(module->getPriority() == p)
+			if(module->isEventAccepted(evt))
 			{
-				module->handleEvent(evt);
+				if(module->myEventTimeStat.isNull())
+				{
+					module->handleEvent(evt);
+				}
+				else
+				{
+					module->myEventTimeStat->startTiming();
+					module->handleEvent(evt);
+					module->myEventTimeStat->stopTiming();
+				}
 			}
 		}
 	}
+	mysEventDispatchDepth--;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -178,6 +445,7 @@ void ModuleServices::disposeAll()
 	}
 	mysModules.clear();
 	mysNonCoreModules.clear();
+	invalidateEventRoutes();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -191,6 +459,7 @@ void ModuleServices::disposeNonCoreModules()
 		mysModules.remove(module);
 	}
 	mysNonCoreModules.clear();
+	invalidateEventRoutes();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -201,6 +470,46 @@ Vector<EngineModule*> ModuleServices::getModules()
 	return ret;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void ModuleServices::setTimingEnabled(bool value)
+{
+	mysTimingEnabled = value;
+	foreach(EngineModule* m, mysModules) m->setTimingEnabled(value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Vector<EngineModule*> ModuleServices::getSlowestModules(int n)
+{
+	Vector<EngineModule*> ret = getModules();
+	std::sort(ret.begin(), ret.end(), slowerModule);
+	if(n >= 0 && (int)ret.size() > n) ret.resize(n);
+	return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ModuleServices::printSlowestModules(int n)
+{
+	if(!mysTimingEnabled)
+	{
+		owarn("ModuleServices::printSlowestModules: module timing is disabled");
+		return;
+	}
+	omsg("-------------------------------------------------------------------------------- MODULES");
+	omsg("NAME                     TOTAL      UPD AVG  UPD MAX  EVT AVG  COMMIT   SHARED");
+	foreach(EngineModule* m, getSlowestModules(n))
+	{
+		ofmsg("%-24s %-10.1f %-8.2f %-8.2f %-8.3f %-8.2f %-8.2f", 
+			%m->getName().c_str()
+			%m->getTotalTime()
+			%statAvg(m->getUpdateTimeStat())
+			%statMax(m->getUpdateTimeStat())
+			%statAvg(m->getEventTimeStat())
+			%statAvg(m->getCommitTimeStat())
+			%statAvg(m->getSharedUpdateTimeStat()));
+	}
+	omsg("-------------------------------------------------------------------------------- MODULES");
+}
+
 //static void preDraw(Engine* srv, Renderer* r, const DrawContext& context)
 //{
 //	foreach(EngineModule* module, mysModules)
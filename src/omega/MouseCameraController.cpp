@@ -40,6 +40,7 @@ MouseCameraController::MouseCameraController():
 	myMoving(false)
 {
 	myMoveDir = Vector3f::Zero();
+	addEventServiceType(Service::Pointer);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -42,10 +42,16 @@ using namespace omega;
 
 
 NameGenerator Node::msNameGenerator("Unnamed_");
+uint Node::sHierarchyVersion = 0;
 
 ///////////////////////////////////////////////////////////////////////////////
 Node::Node()
 	:mParent(0),
+	mChildrenHoles(0),
+	mFirstChildSlot(0),
+	mChildIndex(0),
+	mHierarchyVersion(0),
+	mTransformIndex(-1),
 	mNeedParentUpdate(false),
 	mNeedChildUpdate(false),
 	mParentNotified(false),
@@ -71,6 +77,11 @@ Node::Node()
 Node::Node(const String& name)
 	:
 	mParent(0),
+	mChildrenHoles(0),
+	mFirstChildSlot(0),
+	mChildIndex(0),
+	mHierarchyVersion(0),
+	mTransformIndex(-1),
 	mNeedParentUpdate(false),
 	mNeedChildUpdate(false),
 	mParentNotified(false),
@@ -107,10 +118,16 @@ Node::~Node()
 ///////////////////////////////////////////////////////////////////////////////
 void Node::setName(const String& name) 
 { 
-	if(mParent != NULL)
+	if(mParent != NULL && name != mName)
 	{
-		mParent->mChildren[name] = this;
-		mParent->mChildren.erase(mName);
+		// Only drop the old name if it refers to us: a sibling may be using
+		// the same name.
+		ChildNodeMap::iterator i = mParent->mChildren.find(mName);
+		if(i != mParent->mChildren.end() && i->second == this)
+		{
+			mParent->mChildren.erase(i);
+		}
+		if(!name.empty()) mParent->mChildren[name] = this;
 	}
 	mName = name; 
 }
@@ -126,13 +143,24 @@ void Node::setParent(Node* parent)
 {
 	bool different = (parent != mParent);
 
+	// Both the hierarchy we leave and the one we join changed.
+	if(mParent != NULL) mParent->hierarchyChanged();
     mParent = parent;
+    hierarchyChanged();
     // Request update from parent
 	mParentNotified = false ;
     needUpdate();
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void Node::hierarchyChanged()
+{
+	Node* root = this;
+	while(root->mParent != NULL) root = root->mParent;
+	root->mHierarchyVersion = ++sHierarchyVersion;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 const AffineTransform3& Node::getFullTransform(void) const
 {
@@ -171,11 +199,9 @@ void Node::update(bool updateChildren, bool parentHasChanged)
 	if (mNeedChildUpdate || parentHasChanged)
 	{
 
-        ChildNodeMap::iterator it, itend;
-		itend = mChildren.end();
-        for (it = mChildren.begin(); it != itend; ++it)
+        foreach(Node* child, mChildrenList)
         {
-			it->second->update(true, true);
+			child->update(true, true);
         }
         mChildrenToUpdate.clear();
     }
@@ -252,56 +278,135 @@ void Node::updateFromParent(void) const
 ///////////////////////////////////////////////////////////////////////////////
 void Node::addChild(Node* child)
 {
+	// Keep the child alive while we move it: its previous parent may hold
+	// the only reference to it.
+	Ref<Node> tempRef = child;
     if (child->mParent)
     {
         // NOTE: We do not call removeChild here and remove the node manually
         // instead. We do this to avoid having the Scene nodes generate unneeded
         // onDetachedFromScene + onAttachedToScene event pairs
 		//child->mParent->removeChild(child);
-        child->mParent->cancelUpdate(child);
-        child->mParent->mChildren.erase(child->getName());
-		child->mParent->mChildrenList.remove(child);
+        child->mParent->detachChild(child);
     }
 
-    mChildren.insert(ChildNodeMap::value_type(child->getName(), child));
-	mChildrenList.push_back(child);
+	child->mChildIndex = mChildSlots.size();
+	mChildSlots.push_back(child);
+	child->mChildListPos = mChildrenList.insert(mChildrenList.end(), child);
+	if(!child->mName.empty())
+	{
+		mChildren.insert(ChildNodeMap::value_type(child->mName, child));
+	}
     child->setParent(this);
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void Node::detachChild(Node* child)
+{
+    // cancel any pending update
+    cancelUpdate(child);
+
+	if(!child->mName.empty())
+	{
+		ChildNodeMap::iterator i = mChildren.find(child->mName);
+		if(i != mChildren.end() && i->second == child) mChildren.erase(i);
+	}
+
+	mChildrenList.erase(child->mChildListPos);
+
+	uint index = child->mChildIndex;
+	if(index + 1 == mChildSlots.size())
+	{
+		// Removing the last child is the common case when tearing down a 
+		// hierarchy: just shrink the slots, dropping trailing empty ones.
+		mChildSlots.pop_back();
+		while(!mChildSlots.empty() && mChildSlots.back().isNull())
+		{
+			mChildSlots.pop_back();
+			mChildrenHoles--;
+		}
+	}
+	else
+	{
+		mChildSlots[index] = NULL;
+		mChildrenHoles++;
+	}
+
+	// Track leading empty slots, so removing the first child repeatedly
+	// keeps indexed access constant time.
+	if(mChildSlots.empty())
+	{
+		mFirstChildSlot = 0;
+	}
+	else if(index == mFirstChildSlot)
+	{
+		while(mChildSlots[mFirstChildSlot].isNull()) mFirstChildSlot++;
+	}
+
+	// Reclaim empty slots once they make up half of the slots.
+	if(mChildrenHoles > mChildSlots.size() / 2) compactChildren();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Node::compactChildren()
+{
+	if(mChildrenHoles == 0) return;
+
+	uint j = 0;
+	for(uint i = mFirstChildSlot; i < mChildSlots.size(); i++)
+	{
+		if(!mChildSlots[i].isNull())
+		{
+			if(i != j)
+			{
+				mChildSlots[j] = mChildSlots[i];
+				mChildSlots[i] = NULL;
+			}
+			mChildSlots[j]->mChildIndex = j;
+			j++;
+		}
+	}
+	mChildSlots.resize(j);
+	mChildrenHoles = 0;
+	mFirstChildSlot = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 unsigned short Node::numChildren(void) const
 {
-    return static_cast< unsigned short >( mChildren.size() );
+    return static_cast< unsigned short >( mChildSlots.size() - mChildrenHoles );
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 Node* Node::getChild(unsigned short index) const
 {
-    if( index < mChildren.size() )
-    {
-        ChildNodeMap::const_iterator i = mChildren.begin();
-        while (index--) ++i;
-        return i->second.get();
-    }
-    else
-        return NULL;
+    if(index >= numChildren()) return NULL;
+
+	// If all empty slots are leading ones, children are contiguous. 
+	// Otherwise skip empty slots.
+	if(mChildrenHoles == mFirstChildSlot)
+	{
+		return mChildSlots[mFirstChildSlot + index];
+	}
+	for(uint i = mFirstChildSlot; i < mChildSlots.size(); i++)
+	{
+		if(!mChildSlots[i].isNull())
+		{
+			if(index == 0) return mChildSlots[i];
+			index--;
+		}
+	}
+	return NULL;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void Node::removeChild(unsigned short index)
 {
-    Ref<Node> ret;
-    if (index < mChildren.size())
+    if (index < numChildren())
     {
-        ChildNodeMap::iterator i = mChildren.begin();
-        while (index--) ++i;
-        ret = i->second.get();
-        // cancel any pending update
-        cancelUpdate(ret);
-
-		mChildrenList.remove(i->second.get());
-        mChildren.erase(i);
+        Ref<Node> ret = getChild(index);
+        detachChild(ret);
         ret->setParent(NULL);
     }
     else
@@ -314,19 +419,13 @@ void Node::removeChild(unsigned short index)
 void Node::removeChild(Node* child)
 {
 	Ref<Node> tempRef = child;
-    if (child)
+    // ensure it's our child
+    if (child && child->mParent == this && 
+		child->mChildIndex < mChildSlots.size() &&
+		mChildSlots[child->mChildIndex] == child)
     {
-        ChildNodeMap::iterator i = mChildren.find(child->getName());
-        // ensure it's our child
-        if (i != mChildren.end() && i->second == child)
-        {
-            // cancel any pending update
-            cancelUpdate(child);
-
-            mChildren.erase(i);
-			mChildrenList.remove(child);
-            child->setParent(NULL);
-        }
+        detachChild(child);
+        child->setParent(NULL);
     }
 }
 
@@ -617,15 +716,19 @@ Quaternion Node::convertLocalToWorldOrientation( const Quaternion &localOrientat
 ///////////////////////////////////////////////////////////////////////////////
 void Node::removeAllChildren(void)
 {
-	ChildNodeMap::iterator i, iend;
-	iend = mChildren.end();
-	for (i = mChildren.begin(); i != iend; ++i)
+	// Loop over a copy: setParent may trigger listeners that remove other
+	// children from this node.
+	ChildNodeSlots children = mChildSlots;
+	foreach(Node* child, children)
 	{
-		i->second->setParent(0);
+		if(child != NULL && child->mParent == this) child->setParent(0);
 	}
     mChildren.clear();
 	mChildrenToUpdate.clear();
 	mChildrenList.clear();
+	mChildSlots.clear();
+	mChildrenHoles = 0;
+	mFirstChildSlot = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -702,31 +805,30 @@ const String& Node::getName(void) const
 Node* Node::getChild(const String& name) const
 {
     ChildNodeMap::const_iterator i = mChildren.find(name);
-
-    if (i == mChildren.end())
-    {
-        owarn(String("Child node named " + name + " does not exist.").c_str());
-    }
-    return i->second.get();
+    if (i != mChildren.end()) return i->second;
+
+	// The name table keeps a single node per name. If a sibling with the
+	// same name was registered and then removed, the child may be missing 
+	// from the table: look for it in the list. 
+	// NOTE: we don't register it again here, since this method may be 
+	// called concurrently by multiple threads.
+	if(!name.empty())
+	{
+		foreach(Node* child, mChildrenList)
+		{
+			if(child->mName == name) return child;
+		}
+	}
+    owarn(String("Child node named " + name + " does not exist.").c_str());
+    return NULL;
 
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void Node::removeChild(const String& name)
 {
-    ChildNodeMap::iterator i = mChildren.find(name);
-
-    if (i == mChildren.end())
-    {
-		owarn(String("Child node named " + name + " does not exist.").c_str());
-    }
-
-    Ref<Node> ret = i->second.get();
-    // Cancel any pending update
-    cancelUpdate(ret);
-
-    mChildren.erase(i);
-    ret->setParent(NULL);
+    Node* child = getChild(name);
+    if(child != NULL) removeChild(child);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -34,6 +34,9 @@
  ******************************************************************************/
 #include "omega/PixelData.h"
 #include "omega/glheaders.h"
+#include "omega/DrawContext.h"
+
+#include <algorithm>
 
 using namespace omega;
 
@@ -267,11 +270,73 @@ void PixelData::copyFrom(PixelData* other)
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void PixelData::setDirty(bool value)
+{
+	if(value)
+	{
+		myDirtyRegionLock.lock();
+		for(int i = 0; i < GpuContext::MaxContexts; i++) myDirtyRegions[i].full = true;
+		myDirtyRegionLock.unlock();
+	}
+	TextureSource::setDirty(value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PixelData::setDirtyRegion(int x, int y, int width, int height)
+{
+	int x0 = std::max(x, 0);
+	int y0 = std::max(y, 0);
+	int x1 = std::min(x + width, myWidth);
+	int y1 = std::min(y + height, myHeight);
+	if(x1 <= x0 || y1 <= y0) return;
+
+	myDirtyRegionLock.lock();
+	for(int i = 0; i < GpuContext::MaxContexts; i++)
+	{
+		DirtyRegion& r = myDirtyRegions[i];
+		if(r.full) continue;
+		if(r.isEmpty())
+		{
+			r.x0 = x0; r.y0 = y0; r.x1 = x1; r.y1 = y1;
+		}
+		else
+		{
+			r.x0 = std::min(r.x0, x0); r.y0 = std::min(r.y0, y0);
+			r.x1 = std::max(r.x1, x1); r.y1 = std::max(r.y1, y1);
+		}
+	}
+	myDirtyRegionLock.unlock();
+	TextureSource::setDirty(true);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void PixelData::refreshTexture(Texture* texture, const DrawContext& context)
 {
-	if(!texture->isInitialized()) texture->initialize(myWidth, myHeight);
-	texture->writePixels(this);
+	bool initialized = texture->isInitialized();
+	if(!initialized) texture->initialize(myWidth, myHeight);
+
+	// A newly initialized texture always needs a full upload.
+	Rect region = takeDirtyRegion(context.gpuContext->getId());
+	if(!initialized) region = Rect(0, 0, myWidth, myHeight);
+
+	texture->writePixels(this, region);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Rect PixelData::takeDirtyRegion(uint contextId)
+{
+	myDirtyRegionLock.lock();
+	DirtyRegion& dr = myDirtyRegions[contextId];
+	Rect region(0, 0, myWidth, myHeight);
+	if(!dr.full && !dr.isEmpty())
+	{
+		region = Rect(dr.x0, dr.y0, dr.x1 - dr.x0, dr.y1 - dr.y0);
+	}
+	dr.full = false;
+	dr.x0 = dr.y0 = dr.x1 = dr.y1 = 0;
+	myDirtyRegionLock.unlock();
+	return region;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -312,7 +377,7 @@ void PixelData::setPixel(int x, int y, int r, int g, int b, int a)
 			myData[offset] = r;
 			break;
 		}
-		setDirty();
+		setDirtyRegion(x, y, 1, 1);
 	}
 }
 
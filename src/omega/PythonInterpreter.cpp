@@ -173,7 +173,9 @@ void PythonInterpreter::setup(const Setting& setting)
 ///////////////////////////////////////////////////////////////////////////////
 void PythonInterpreter::initialize(const char* programName)
 {
-	// Register self as shared object
+	// Register self as shared object. The interpreter only needs to be sent
+	// to slaves when commands are queued (see queueCommand)
+	setSharedDataVersioned(true);
 	SharedDataServices::registerObject(this, "interp");
 
 	// Set the program name, so that we can ask python to provide us
@@ -571,6 +573,7 @@ void PythonInterpreter::queueCommand(const String& command, bool local)
 	
 	myInteractiveCommandLock.lock();
 	myCommandQueue.push_back(new QueuedCommand(command, true, !local));
+	if(!local) markSharedDataChanged();
 	myInteractiveCommandLock.unlock();
 }
 
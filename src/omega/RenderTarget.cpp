@@ -29,6 +29,9 @@
 #include "omega/PixelData.h"
 #include "omega/glheaders.h"
 
+#include <string.h>
+#include <algorithm>
+
 using namespace omega;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -42,7 +45,15 @@ RenderTarget::RenderTarget(GpuContext* context, Type type, GLuint id):
     myRbHeight(0),
     myTextureColorTarget(NULL),
     myTextureDepthTarget(NULL),
-    myBound(false)
+    myReadbackColorTarget(NULL),
+    myReadbackDepthTarget(NULL),
+    myBound(false),
+    myAsyncReadback(false),
+    myReadbackBufferCount(3),
+    myNextReadbackBuffer(0),
+    myReadbackFrame(0),
+    myCompletedReadbackFrame(0),
+    myReadbackListener(NULL)
 {
     if(myType != RenderOnscreen && myId == 0)
     {
@@ -60,6 +71,7 @@ RenderTarget::~RenderTarget()
 ///////////////////////////////////////////////////////////////////////////////////////////////
 void RenderTarget::dispose() 
 {
+    disposeReadbackBuffers();
     if(myId != 0)
     {
         glDeleteFramebuffers(1, &myId);
@@ -142,6 +154,17 @@ void RenderTarget::readback()
     if(myType != RenderOnscreen && !myBound) needBinding = true;
     if(needBinding) bind();
 
+    myReadbackFrame++;
+
+    if(myAsyncReadback)
+    {
+        readbackAsync();
+        if(needBinding) unbind();
+        return;
+    }
+    // Async readback got disabled: release the pixel buffers.
+    if(myReadbackBuffers.size() > 0) disposeReadbackBuffers();
+
     if(myReadbackColorTarget != NULL)
     {
         if(myReadbackColorTarget->getFormat() == PixelData::FormatRgb)
@@ -176,9 +199,188 @@ void RenderTarget::readback()
             myReadbackViewport.width(), myReadbackViewport.height(), GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 
             target);
         myReadbackDepthTarget->unbind();
-        myReadbackColorTarget->setDirty();
+        myReadbackDepthTarget->setDirty();
     }
     if(needBinding) unbind();
+
+    myCompletedReadbackFrame = myReadbackFrame;
+    if(myReadbackListener != NULL)
+    {
+        myReadbackListener->onReadbackCompleted(this, myCompletedReadbackFrame);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderTarget::readbackDepth()
+{
+    if(myReadbackDepthTarget == NULL) return;
+
+    bool needBinding = false;
+
+    if(myType != RenderOnscreen && !myBound) needBinding = true;
+    if(needBinding) bind();
+
+    GLvoid* target = myReadbackDepthTarget->bind(getContext());
+    glReadPixels(
+        myReadbackViewport.x(), myReadbackViewport.y(), 
+        myReadbackViewport.width(), myReadbackViewport.height(), GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 
+        target);
+    myReadbackDepthTarget->unbind();
+    myReadbackDepthTarget->setDirty();
+
+    if(needBinding) unbind();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderTarget::setAsyncReadback(bool enabled, int bufferCount)
+{
+    // Pixel buffers are (re)allocated by the next readback call, since we 
+    // need to be on the render thread to do that.
+    myAsyncReadback = enabled;
+    myReadbackBufferCount = bufferCount < 1 ? 1 : bufferCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderTarget::readbackAsync()
+{
+    if(myReadbackBuffers.size() != (size_t)myReadbackBufferCount)
+    {
+        disposeReadbackBuffers();
+        myReadbackBuffers.resize(myReadbackBufferCount);
+        foreach(ReadbackBuffer& rb, myReadbackBuffers)
+        {
+            glGenBuffers(1, &rb.colorPbo);
+            glGenBuffers(1, &rb.depthPbo);
+            rb.colorSize = 0;
+            rb.depthSize = 0;
+            rb.fence = NULL;
+            rb.pending = false;
+            rb.frame = 0;
+        }
+        myNextReadbackBuffer = 0;
+    }
+
+    // Buffers are filled in ring order, so the oldest transfer is always in
+    // the next buffer. Copy out all transfers that already completed, oldest
+    // first, without blocking.
+    int n = myReadbackBuffers.size();
+    for(int i = 0; i < n; i++)
+    {
+        ReadbackBuffer& rb = myReadbackBuffers[(myNextReadbackBuffer + i) % n];
+        if(!rb.pending) continue;
+        if(rb.fence == NULL) break;
+        GLenum res = glClientWaitSync((GLsync)rb.fence, 0, 0);
+        if(res == GL_TIMEOUT_EXPIRED) break;
+        completeReadback(rb);
+    }
+
+    // If the oldest transfer is still running, wait for it: we need its 
+    // buffer for this frame.
+    ReadbackBuffer& rb = myReadbackBuffers[myNextReadbackBuffer];
+    if(rb.pending) completeReadback(rb);
+    queueReadback(rb);
+    myNextReadbackBuffer = (myNextReadbackBuffer + 1) % n;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderTarget::queueReadback(ReadbackBuffer& rb)
+{
+    int w = myReadbackViewport.width();
+    int h = myReadbackViewport.height();
+
+    // Rows are padded to the default 4 byte pack alignment, same as the 
+    // synchronous path.
+    if(myReadbackColorTarget != NULL)
+    {
+        int bpp = myReadbackColorTarget->getFormat() == PixelData::FormatRgb ? 3 : 4;
+        GLenum format = bpp == 3 ? GL_RGB : GL_RGBA;
+        size_t size = ((w * bpp + 3) & ~3) * h;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.colorPbo);
+        if(rb.colorSize != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            rb.colorSize = size;
+        }
+        glReadPixels(myReadbackViewport.x(), myReadbackViewport.y(), w, h, 
+            format, GL_UNSIGNED_BYTE, 0);
+    }
+    if(myReadbackDepthTarget != NULL)
+    {
+        size_t size = w * h * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.depthPbo);
+        if(rb.depthSize != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            rb.depthSize = size;
+        }
+        glReadPixels(myReadbackViewport.x(), myReadbackViewport.y(), w, h, 
+            GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Without sync objects, transfers are only collected when their buffer
+    // gets reused (glMapBuffer will block until they complete).
+    if(GLEW_ARB_sync) rb.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    rb.pending = true;
+    rb.frame = myReadbackFrame;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderTarget::completeReadback(ReadbackBuffer& rb)
+{
+    if(rb.fence != NULL)
+    {
+        glDeleteSync((GLsync)rb.fence);
+        rb.fence = NULL;
+    }
+
+    if(myReadbackColorTarget != NULL && rb.colorSize > 0)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.colorPbo);
+        void* src = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if(src != NULL)
+        {
+            byte* dst = myReadbackColorTarget->map();
+            memcpy(dst, src, std::min(rb.colorSize, myReadbackColorTarget->getSize()));
+            myReadbackColorTarget->unmap();
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            myReadbackColorTarget->setDirty();
+        }
+    }
+    if(myReadbackDepthTarget != NULL && rb.depthSize > 0)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.depthPbo);
+        void* src = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if(src != NULL)
+        {
+            byte* dst = myReadbackDepthTarget->map();
+            memcpy(dst, src, std::min(rb.depthSize, myReadbackDepthTarget->getSize()));
+            myReadbackDepthTarget->unmap();
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            myReadbackDepthTarget->setDirty();
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    rb.pending = false;
+    myCompletedReadbackFrame = rb.frame;
+    if(myReadbackListener != NULL)
+    {
+        myReadbackListener->onReadbackCompleted(this, rb.frame);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderTarget::disposeReadbackBuffers()
+{
+    foreach(ReadbackBuffer& rb, myReadbackBuffers)
+    {
+        if(rb.fence != NULL) glDeleteSync((GLsync)rb.fence);
+        glDeleteBuffers(1, &rb.colorPbo);
+        glDeleteBuffers(1, &rb.depthPbo);
+    }
+    myReadbackBuffers.clear();
+    myNextReadbackBuffer = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
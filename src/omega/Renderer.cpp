@@ -124,6 +124,10 @@ void Renderer::initialize()
 
 	StatsManager* sm = getEngine()->getSystemManager()->getStatsManager();
 	myFrameTimeStat = sm->createStat(ostr("ctx%1% frame", %getGpuContext()->getId()), StatsManager::Time);
+	myNodesDrawnStat = sm->createStat(ostr("ctx%1% nodes drawn", %getGpuContext()->getId()), StatsManager::Count1);
+	myNodesCulledStat = sm->createStat(ostr("ctx%1% nodes culled", %getGpuContext()->getId()), StatsManager::Count1);
+	myDrawBatchesStat = sm->createStat(ostr("ctx%1% draw batches", %getGpuContext()->getId()), StatsManager::Count2);
+	myDrawPrimitivesStat = sm->createStat(ostr("ctx%1% draw primitives", %getGpuContext()->getId()), StatsManager::Count2);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -138,6 +142,7 @@ void Renderer::queueCommand(IRendererCommand* cmd)
 void Renderer::startFrame(const FrameInfo& frame)
 {
 	myFrameTimeStat->startTiming();
+	myRenderer->resetDrawStats();
 	foreach(Ref<Camera> cam, myServer->getCameras())
 	{
 		cam->startFrame(frame);
@@ -165,6 +170,9 @@ void Renderer::finishFrame(const FrameInfo& frame)
 		}
 	}
 	foreach(GpuResource* gr, txlist) myResources.remove(gr);
+
+	myDrawBatchesStat->addSample(myRenderer->getNumBatches());
+	myDrawPrimitivesStat->addSample(myRenderer->getNumPrimitives());
 	myFrameTimeStat->stopTiming();
 }
 
@@ -234,10 +242,13 @@ void Renderer::innerDraw(const DrawContext& context, Camera* cam)
 		getRenderer()->beginDraw3D(context);
 
 		// Run the draw method on scene nodes (was previously in DefaultRenderPass)
-		// This will traverse the scene graph and invoke the draw method on all scene objects attached to nodes.
-		// When stereo rendering, the traversal will happen once per eye.
+		// The scene graph is flattened once per frame, then culled against
+		// the view frustum and drawn once per eye and camera.
 		SceneNode* node = getEngine()->getScene();
-		node->draw(context);
+		myDrawList.update(node, context.frameNum);
+		myDrawList.draw(context);
+		myNodesDrawnStat->addSample(myDrawList.getNumDrawn());
+		myNodesCulledStat->addSample(myDrawList.getNumCulled());
 
 		// Draw 3d pointers.
 		// We call drawPointers for scene draw tasks too because we may be drawing pointers in wand mode 
@@ -0,0 +1,133 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A flattened, frustum-culled list of the scene nodes drawn by a renderer.
+ *************************************************************************************************/
+#include "omega/SceneDrawList.h"
+#include "omega/SceneNode.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+SceneDrawList::SceneDrawList():
+	myFrame(0),
+	myBuilt(false),
+	myCullingEnabled(true),
+	myNumDrawn(0),
+	myNumCulled(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneDrawList::update(SceneNode* root, uint64 frameNum)
+{
+	if(!myBuilt || myFrame != frameNum)
+	{
+		build(root);
+		myFrame = frameNum;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneDrawList::build(SceneNode* root)
+{
+	myEntries.clear();
+	if(root != NULL) addNode(root);
+	myBuilt = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int SceneDrawList::addNode(SceneNode* node)
+{
+	// Invisible nodes hide their whole subtree.
+	if(!node->myVisible) return myEntries.size();
+
+	int index = myEntries.size();
+	Entry e;
+	e.node = node;
+	e.next = index + 1;
+	e.cullable = true;
+	foreach(NodeComponent* c, node->myObjects)
+	{
+		if(!c->hasBoundingBox()) e.cullable = false;
+	}
+	myEntries.push_back(e);
+
+	bool cullable = e.cullable;
+	foreach(Node* child, node->getChildren())
+	{
+		SceneNode* n = dynamic_cast<SceneNode*>(child);
+		if(n != NULL)
+		{
+			int first = addNode(n);
+			if(first < myEntries.size() && !myEntries[first].cullable) cullable = false;
+		}
+	}
+
+	// NOTE: addNode may reallocate the entry list.
+	myEntries[index].next = myEntries.size();
+	myEntries[index].cullable = cullable;
+	return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneDrawList::cull(const DrawContext& context, Vector<SceneNode*>& outNodes)
+{
+	myNumCulled = 0;
+	int i = 0;
+	int n = myEntries.size();
+	while(i < n)
+	{
+		const Entry& e = myEntries[i];
+		if(myCullingEnabled && e.cullable)
+		{
+			// Bounding boxes are refreshed by the engine after each scene 
+			// update, so read the cached box here.
+			const AlignedBox3& box = e.node->myBBox;
+			if(box.isNull() || (box.isFinite() && !context.isBoxVisible(box)))
+			{
+				myNumCulled += e.next - i;
+				i = e.next;
+				continue;
+			}
+		}
+		outNodes.push_back(e.node);
+		i++;
+	}
+	myNumDrawn = outNodes.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneDrawList::draw(const DrawContext& context)
+{
+	myVisibleNodes.clear();
+	cull(context, myVisibleNodes);
+	foreach(SceneNode* node, myVisibleNodes)
+	{
+		node->drawComponents(context);
+	}
+}
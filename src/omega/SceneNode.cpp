@@ -52,6 +52,12 @@ SceneNode* SceneNode::create(const String& name)
     return sn;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+SceneNode::~SceneNode()
+{
+    if(myBvhEntry >= 0) myServer->getSceneBvh()->removeNode(this);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void SceneNode::addListener(SceneNodeListener* listener)
 {
@@ -128,9 +134,25 @@ void SceneNode::setParent(Node* parent)
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void SceneNode::updateFromParent(void) const
+{
+    Node::updateFromParent();
+    // Our world transform changed: the scene query hierarchy needs to update
+    // this node bounds.
+    if(myBvhEntry >= 0) invalidateBvhEntry();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SceneNode::invalidateBvhEntry() const
+{
+    myServer->getSceneBvh()->invalidateNode(const_cast<SceneNode*>(this));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void SceneNode::onAttachedToScene()
 {
+    myServer->getSceneBvh()->addNode(this);
     foreach(SceneNodeListener* l, myListeners)
     {
         l->onAttachedToScene(this);
@@ -146,6 +168,7 @@ void SceneNode::onAttachedToScene()
 ///////////////////////////////////////////////////////////////////////////////
 void SceneNode::onDetachedFromScene()
 {
+    myServer->getSceneBvh()->removeNode(this);
     foreach(SceneNodeListener* l, myListeners)
     {
         l->onDetachedFromScene(this);
@@ -180,6 +203,8 @@ bool SceneNode::isSelected()
 ///////////////////////////////////////////////////////////////////////////////
 bool SceneNode::isAttachedToScene()
 {
+    // Nodes created without an engine are never part of a scene.
+    if(getEngine() == NULL) return false;
     Node* cur = this;
     while(cur != NULL)
     {
@@ -221,25 +246,29 @@ void SceneNode::draw(const DrawContext& context)
 {
     if(myVisible)
     {
-        //if(myChanged) updateTransform();
-
-        if(myBoundingBoxVisible) drawBoundingBox();
-
-        // Draw drawables attached to this node.
-        foreach(NodeComponent* d, myObjects)
-        {
-            d->draw(context);
-        }
+        drawComponents(context);
 
         // Draw children nodes.
         foreach(Node* child, getChildren())
         {
             SceneNode* n = dynamic_cast<SceneNode*>(child);
-            n->draw(context);
+            if(n != NULL) n->draw(context);
         }
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void SceneNode::drawComponents(const DrawContext& context)
+{
+    if(myBoundingBoxVisible) drawBoundingBox();
+
+    // Draw drawables attached to this node.
+    foreach(NodeComponent* d, myObjects)
+    {
+        d->draw(context);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void SceneNode::update(bool updateChildren, bool parentHasChanged)
 {
@@ -262,13 +291,18 @@ void SceneNode::update(const UpdateContext& context)
     // may perform other operations in this step.
     updateTraversal(context);
 
-    // Step 2: update all needed transforms in the node hierarchy
-    update(true, false);
+    // Step 2: update all needed transforms in the node hierarchy. The engine
+    // transform system does this with a linear pass over the flattened tree.
+    myServer->getTransformSystem()->update(this);
 
     // Step 3: update all node components. In this step, all nodes have 
     // up-to-date transforms, so we can consistently update all attached node
-    // components
+    // components. Thread-safe components may be queued by the component 
+    // scheduler and updated in parallel: end() waits for them.
+    ComponentScheduler* cs = myServer->getComponentScheduler();
+    cs->begin(context);
     updateComponents(context);
+    cs->end();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -297,9 +331,10 @@ void SceneNode::updateTraversal(const UpdateContext& context)
 void SceneNode::updateComponents(const UpdateContext& context)
 {
     // Update attached components
+    ComponentScheduler* cs = myServer->getComponentScheduler();
     foreach(NodeComponent* d, myObjects)
     {
-        d->update(context);
+        cs->update(d, context);
     }
     // Update components of children nodes
     foreach(Node* child, getChildren())
@@ -24,8 +24,44 @@
  *********************************************************************************************************************/
 #include "omega/SceneQuery.h"
 
+#include <algorithm>
+#include <float.h>
+
 using namespace omega;
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+	// Ray-box slab test. Returns true if the ray hits the box in front of its
+	// origin, and the distance along the ray where it enters the box.
+	inline bool intersectBox(const Vector3f& bmin, const Vector3f& bmax, 
+		const Vector3f& origin, const Vector3f& invDir, float& tmin)
+	{
+		// Empty boxes (min > max) are never hit.
+		if(bmin[0] > bmax[0]) return false;
+		float t0 = 0;
+		float t1 = FLT_MAX;
+		for(int i = 0; i < 3; i++)
+		{
+			float tnear = (bmin[i] - origin[i]) * invDir[i];
+			float tfar = (bmax[i] - origin[i]) * invDir[i];
+			if(tnear > tfar) std::swap(tnear, tfar);
+			// NaNs (ray parallel to a slab and origin on its plane) are ignored
+			// by these comparisons.
+			if(tnear > t0) t0 = tnear;
+			if(tfar < t1) t1 = tfar;
+			if(t0 > t1) return false;
+		}
+		tmin = t0;
+		return true;
+	}
+
+	// Half surface area of a box, used as the insertion cost metric.
+	inline float halfArea(const Vector3f& bmin, const Vector3f& bmax)
+	{
+		Vector3f d = bmax - bmin;
+		return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+	}
+};
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void SceneQuery::clearResults()
@@ -38,19 +74,29 @@ const SceneQueryResultList& RaySceneQuery::execute(uint flags)
 {
 	bool queryOne = ((flags & SceneQuery::QueryFirst) == SceneQuery::QueryFirst) ? true : false;
 
-	queryNode(myScene, myResults, queryOne);
+	if(myBvh != NULL)
+	{
+		myBvh->queryRay(myRay, queryOne, myResults);
+	}
+	else if(myScene != NULL)
+	{
+		SceneQueryResult nearest;
+		nearest.node = NULL;
+		nearest.distance = FLT_MAX;
+		queryNode(myScene, myResults, queryOne, nearest);
+		if(queryOne && nearest.node != NULL) myResults.push_back(nearest);
+	}
 
 	if(((flags & SceneQuery::QuerySort) == SceneQuery::QuerySort) && myResults.size() > 1)
 	{
-		myResults.sort(SceneQueryResultDistanceCompare);
+		std::sort(myResults.begin(), myResults.end(), SceneQueryResultDistanceCompare);
 	}
 	return myResults;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void RaySceneQuery::queryNode(SceneNode* node, SceneQueryResultList& list, bool queryFirst)
+void RaySceneQuery::queryNode(SceneNode* node, SceneQueryResultList& list, bool queryFirst, SceneQueryResult& nearest)
 {
-	bool selected = false;
 	if(node->isSelectable() && node->isVisible())
 	{
 		Vector3f hitPoint;
@@ -60,18 +106,499 @@ void RaySceneQuery::queryNode(SceneNode* node, SceneQueryResultList& list, bool
 			res.node = node;
 			res.hitPoint = hitPoint;
 			res.distance = (hitPoint - myRay.getOrigin()).norm();
-			list.push_back(res);
+			// When looking for the first hit, only keep the nearest one.
+			if(!queryFirst) list.push_back(res);
+			else if(res.distance < nearest.distance) nearest = res;
+		}
+	}
+
+	// Query children nodes.
+	foreach(Node* child, node->getChildren())
+	{
+		SceneNode* n = dynamic_cast<SceneNode*>(child);
+		if(n != NULL) queryNode(n, list, queryFirst, nearest);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Orders entries along an axis by the center of their bounds.
+struct SceneBvh::CentroidCompare
+{
+	CentroidCompare(const Vector<Entry>& e, int a): entries(e), axis(a) {}
+	bool operator()(int a, int b) const
+	{
+		return entries[a].min[axis] + entries[a].max[axis] < 
+			entries[b].min[axis] + entries[b].max[axis];
+	}
+	const Vector<Entry>& entries;
+	int axis;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneBvh::SceneBvh():
+	myNumEntries(0),
+	myBuildSize(0),
+	myInsertions(0),
+	myNeedsRebuild(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::addNode(SceneNode* node)
+{
+	myLock.lock();
+	if(node->myBvhEntry < 0)
+	{
+		int index;
+		if(!myFreeEntries.empty())
+		{
+			index = myFreeEntries.back();
+			myFreeEntries.pop_back();
+		}
+		else
+		{
+			index = myEntries.size();
+			myEntries.push_back(Entry());
+		}
+		Entry& e = myEntries[index];
+		e.node = node;
+		e.leaf = -1;
+		e.placed = false;
+		// The entry is placed in the hierarchy at the next update, when the
+		// node bounds are computed.
+		e.dirty = true;
+		myDirtyEntries.push_back(index);
+		node->myBvhEntry = index;
+		myNumEntries++;
+	}
+	myLock.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::removeNode(SceneNode* node)
+{
+	myLock.lock();
+	int index = node->myBvhEntry;
+	if(index >= 0)
+	{
+		Entry& e = myEntries[index];
+		if(e.placed) unplaceEntry(index);
+		e.node = NULL;
+		e.dirty = false;
+		myFreeEntries.push_back(index);
+		node->myBvhEntry = -1;
+		myNumEntries--;
+	}
+	myLock.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::invalidateNode(SceneNode* node)
+{
+	myLock.lock();
+	int index = node->myBvhEntry;
+	if(index >= 0 && !myEntries[index].dirty)
+	{
+		myEntries[index].dirty = true;
+		myDirtyEntries.push_back(index);
+	}
+	myLock.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::clear()
+{
+	myLock.lock();
+	foreach(Entry& e, myEntries)
+	{
+		if(e.node != NULL) e.node->myBvhEntry = -1;
+	}
+	myEntries.clear();
+	myFreeEntries.clear();
+	myDirtyEntries.clear();
+	myUnbounded.clear();
+	myNodes.clear();
+	myNumEntries = 0;
+	myBuildSize = 0;
+	myInsertions = 0;
+	myNeedsRebuild = false;
+	myLock.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::update()
+{
+	// Take the dirty entry list. Computing node bounds can update node 
+	// transforms and invalidate more entries, so the lock is not held while
+	// placing entries: entries invalidated again will be placed at the next
+	// update.
+	myLock.lock();
+	myUpdateEntries.swap(myDirtyEntries);
+	foreach(int index, myUpdateEntries) myEntries[index].dirty = false;
+	myLock.unlock();
+
+	// Place dirty entries using their new bounds.
+	foreach(int index, myUpdateEntries)
+	{
+		if(myEntries[index].node != NULL)
+		{
+			if(myEntries[index].placed) unplaceEntry(index);
+			placeEntry(index);
+		}
+	}
+	myUpdateEntries.clear();
+
+	// Incremental insertions degrade the hierarchy quality: rebuild it once
+	// they outnumber the entries of the last build.
+	if(myInsertions > 64 && myInsertions > myBuildSize) myNeedsRebuild = true;
+	if(myNeedsRebuild) rebuild();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBvh::updateEntryBounds(Entry& e)
+{
+	const AlignedBox3& box = e.node->getBoundingBox();
+	if(box.isNull() || !box.isFinite()) return false;
+
+	// SceneNode::hit falls back to the node bounding sphere, which is not
+	// contained in the bounding box. Use a cube that contains both.
+	float r = box.getHalfSize().maxCoeff();
+	Vector3f c = box.getCenter();
+	Vector3f h(r, r, r);
+	e.min = c - h;
+	e.max = c + h;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::placeEntry(int index)
+{
+	Entry& e = myEntries[index];
+	e.placed = true;
+	if(updateEntryBounds(e))
+	{
+		insertEntry(index);
+	}
+	else
+	{
+		e.leaf = -1;
+		myUnbounded.push_back(index);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::unplaceEntry(int index)
+{
+	Entry& e = myEntries[index];
+	e.placed = false;
+	if(e.leaf >= 0)
+	{
+		removeEntry(index);
+	}
+	else
+	{
+		Vector<int>::iterator it = std::find(myUnbounded.begin(), myUnbounded.end(), index);
+		if(it != myUnbounded.end())
+		{
+			*it = myUnbounded.back();
+			myUnbounded.pop_back();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::insertEntry(int index)
+{
+	if(myNodes.empty())
+	{
+		BvhNode root;
+		root.parent = -1;
+		root.left = root.right = -1;
+		root.count = 0;
+		myNodes.push_back(root);
+	}
+
+	const Vector3f& emin = myEntries[index].min;
+	const Vector3f& emax = myEntries[index].max;
+
+	// Descend towards the child whose bounds grow the least.
+	int n = 0;
+	while(myNodes[n].left >= 0)
+	{
+		int l = myNodes[n].left;
+		int r = myNodes[n].right;
+		float cl = halfArea(myNodes[l].min.cwiseMin(emin), myNodes[l].max.cwiseMax(emax)) - 
+			halfArea(myNodes[l].min, myNodes[l].max);
+		float cr = halfArea(myNodes[r].min.cwiseMin(emin), myNodes[r].max.cwiseMax(emax)) - 
+			halfArea(myNodes[r].min, myNodes[r].max);
+		n = (cl <= cr) ? l : r;
+	}
+
+	if(myNodes[n].count == MaxLeafSize) n = splitLeaf(n, index);
+
+	BvhNode& leaf = myNodes[n];
+	leaf.entries[leaf.count++] = index;
+	myEntries[index].leaf = n;
+	refitUp(n);
+	myInsertions++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::removeEntry(int index)
+{
+	int n = myEntries[index].leaf;
+	BvhNode& leaf = myNodes[n];
+	for(int i = 0; i < leaf.count; i++)
+	{
+		if(leaf.entries[i] == index)
+		{
+			leaf.entries[i] = leaf.entries[--leaf.count];
+			break;
+		}
+	}
+	myEntries[index].leaf = -1;
+	// Empty leaves are kept, with empty bounds. They are dropped at the next
+	// rebuild.
+	refitUp(n);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int SceneBvh::splitLeaf(int n, int index)
+{
+	// Sort the leaf entries along the axis of largest extent, and move each
+	// half to a new child leaf.
+	BvhNode leaf = myNodes[n];
+	Vector3f extent = leaf.max - leaf.min;
+	int axis = 0;
+	if(extent[1] > extent[axis]) axis = 1;
+	if(extent[2] > extent[axis]) axis = 2;
+	std::sort(leaf.entries, leaf.entries + leaf.count, CentroidCompare(myEntries, axis));
+
+	int half = leaf.count / 2;
+	BvhNode child;
+	child.parent = n;
+	child.left = child.right = -1;
+
+	int l = myNodes.size();
+	child.count = half;
+	for(int i = 0; i < half; i++) child.entries[i] = leaf.entries[i];
+	myNodes.push_back(child);
+
+	int r = myNodes.size();
+	child.count = leaf.count - half;
+	for(int i = half; i < leaf.count; i++) child.entries[i - half] = leaf.entries[i];
+	myNodes.push_back(child);
+
+	for(int i = 0; i < myNodes[l].count; i++) myEntries[myNodes[l].entries[i]].leaf = l;
+	for(int i = 0; i < myNodes[r].count; i++) myEntries[myNodes[r].entries[i]].leaf = r;
+	refitNode(l);
+	refitNode(r);
+
+	myNodes[n].left = l;
+	myNodes[n].right = r;
+	myNodes[n].count = 0;
+
+	// Return the child that grows the least when adding the new entry.
+	const Vector3f& emin = myEntries[index].min;
+	const Vector3f& emax = myEntries[index].max;
+	float cl = halfArea(myNodes[l].min.cwiseMin(emin), myNodes[l].max.cwiseMax(emax)) - 
+		halfArea(myNodes[l].min, myNodes[l].max);
+	float cr = halfArea(myNodes[r].min.cwiseMin(emin), myNodes[r].max.cwiseMax(emax)) - 
+		halfArea(myNodes[r].min, myNodes[r].max);
+	return (cl <= cr) ? l : r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::rebuild()
+{
+	myBuildEntries.clear();
+	for(int i = 0; i < myEntries.size(); i++)
+	{
+		Entry& e = myEntries[i];
+		if(e.node != NULL && e.leaf >= 0) myBuildEntries.push_back(i);
+	}
+
+	myNodes.clear();
+	if(!myBuildEntries.empty())
+	{
+		myNodes.reserve(2 * myBuildEntries.size() / MaxLeafSize + 1);
+		build(0, myBuildEntries.size(), -1);
+	}
+
+	myBuildSize = myBuildEntries.size();
+	myInsertions = 0;
+	myNeedsRebuild = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int SceneBvh::build(int first, int count, int parent)
+{
+	int n = myNodes.size();
+	BvhNode node;
+	node.parent = parent;
+	node.left = node.right = -1;
+	node.count = 0;
+	myNodes.push_back(node);
+
+	if(count <= MaxLeafSize)
+	{
+		BvhNode& leaf = myNodes[n];
+		leaf.count = count;
+		for(int i = 0; i < count; i++)
+		{
+			leaf.entries[i] = myBuildEntries[first + i];
+			myEntries[leaf.entries[i]].leaf = n;
+		}
+	}
+	else
+	{
+		// Median split along the axis of largest centroid extent.
+		Vector3f cmin = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vector3f cmax = -cmin;
+		for(int i = first; i < first + count; i++)
+		{
+			const Entry& e = myEntries[myBuildEntries[i]];
+			Vector3f c = e.min + e.max;
+			cmin = cmin.cwiseMin(c);
+			cmax = cmax.cwiseMax(c);
 		}
+		Vector3f extent = cmax - cmin;
+		int axis = 0;
+		if(extent[1] > extent[axis]) axis = 1;
+		if(extent[2] > extent[axis]) axis = 2;
+
+		int mid = first + count / 2;
+		std::nth_element(
+			myBuildEntries.begin() + first, 
+			myBuildEntries.begin() + mid, 
+			myBuildEntries.begin() + first + count, 
+			CentroidCompare(myEntries, axis));
+
+		// NOTE: build may reallocate myNodes, so do not keep references 
+		// across these calls.
+		int l = build(first, mid - first, n);
+		int r = build(mid, first + count - mid, n);
+		myNodes[n].left = l;
+		myNodes[n].right = r;
 	}
+	refitNode(n);
+	return n;
+}
 
-	// If this node has been selected, and we are returning the first node found, return immediately.
-	if(selected && queryFirst) return;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::refitNode(int n)
+{
+	BvhNode& node = myNodes[n];
+	if(node.left >= 0)
+	{
+		node.min = myNodes[node.left].min.cwiseMin(myNodes[node.right].min);
+		node.max = myNodes[node.left].max.cwiseMax(myNodes[node.right].max);
+	}
+	else
+	{
+		node.min = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
+		node.max = -node.min;
+		for(int i = 0; i < node.count; i++)
+		{
+			const Entry& e = myEntries[node.entries[i]];
+			node.min = node.min.cwiseMin(e.min);
+			node.max = node.max.cwiseMax(e.max);
+		}
+	}
+}
 
-	// Draw children nodes.
-	for(int i = 0; i < node->numChildren(); i++)
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::refitUp(int n)
+{
+	while(n >= 0)
 	{
-		SceneNode* n = (SceneNode*)node->getChild(i);
-		queryNode(n, list, queryFirst);
+		refitNode(n);
+		n = myNodes[n].parent;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::testEntry(int index, const Ray& ray, bool queryFirst, 
+	SceneQueryResult& nearest, SceneQueryResultList& results)
+{
+	SceneNode* node = myEntries[index].node;
+	if(node->isSelectable() && node->isVisible())
+	{
+		Vector3f hitPoint;
+		if(node->hit(ray, &hitPoint, SceneNode::HitBest))
+		{
+			SceneQueryResult res;
+			res.node = node;
+			res.hitPoint = hitPoint;
+			res.distance = (hitPoint - ray.getOrigin()).norm();
+			if(!queryFirst) results.push_back(res);
+			else if(res.distance < nearest.distance) nearest = res;
+		}
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBvh::queryRay(const Ray& ray, bool queryFirst, SceneQueryResultList& results)
+{
+	update();
+
+	const Vector3f& origin = ray.getOrigin();
+	const Vector3f& dir = ray.getDirection();
+	Vector3f invDir(1.0f / dir[0], 1.0f / dir[1], 1.0f / dir[2]);
+
+	SceneQueryResult nearest;
+	nearest.node = NULL;
+	nearest.distance = FLT_MAX;
+
+	// Nodes without bounds cannot be culled.
+	foreach(int index, myUnbounded) testEntry(index, ray, queryFirst, nearest, results);
+
+	float t;
+	myStack.clear();
+	if(!myNodes.empty() && intersectBox(myNodes[0].min, myNodes[0].max, origin, invDir, t))
+	{
+		StackItem root = { 0, t };
+		myStack.push_back(root);
+	}
+
+	while(!myStack.empty())
+	{
+		StackItem item = myStack.back();
+		myStack.pop_back();
+		// Entry bounds contain any hit on their node, so subtrees entered 
+		// beyond the nearest hit cannot contain a nearer one.
+		if(queryFirst && item.distance > nearest.distance) continue;
+
+		const BvhNode& node = myNodes[item.node];
+		if(node.left < 0)
+		{
+			for(int i = 0; i < node.count; i++)
+			{
+				const Entry& e = myEntries[node.entries[i]];
+				if(intersectBox(e.min, e.max, origin, invDir, t) &&
+					(!queryFirst || t <= nearest.distance))
+				{
+					testEntry(node.entries[i], ray, queryFirst, nearest, results);
+				}
+			}
+		}
+		else
+		{
+			// Push the farther child first, so the nearer one is visited first.
+			float tl, tr;
+			bool hl = intersectBox(myNodes[node.left].min, myNodes[node.left].max, origin, invDir, tl);
+			bool hr = intersectBox(myNodes[node.right].min, myNodes[node.right].max, origin, invDir, tr);
+			StackItem l = { node.left, tl };
+			StackItem r = { node.right, tr };
+			if(hl && hr)
+			{
+				if(tl < tr) { myStack.push_back(r); myStack.push_back(l); }
+				else { myStack.push_back(l); myStack.push_back(r); }
+			}
+			else if(hl) myStack.push_back(l);
+			else if(hr) myStack.push_back(r);
+		}
+	}
+
+	if(queryFirst && nearest.node != NULL) results.push_back(nearest);
+}
@@ -0,0 +1,103 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	A counting semaphore used to park worker threads while they have no work.
+ *************************************************************************************************/
+#include "omega/Semaphore.h"
+
+#ifdef OMEGA_OS_WIN
+    #include <Windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct omega::SemaphoreImpl
+{
+#ifdef OMEGA_OS_WIN
+    HANDLE semaphore;
+#else
+    int count;
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Semaphore::Semaphore()
+{
+    myImpl = new SemaphoreImpl();
+#ifdef OMEGA_OS_WIN
+    myImpl->semaphore = CreateSemaphore(NULL, 0, MAXLONG, NULL);
+#else
+    myImpl->count = 0;
+    pthread_mutex_init(&myImpl->mutex, NULL);
+    pthread_cond_init(&myImpl->condition, NULL);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Semaphore::~Semaphore()
+{
+#ifdef OMEGA_OS_WIN
+    CloseHandle(myImpl->semaphore);
+#else
+    pthread_cond_destroy(&myImpl->condition);
+    pthread_mutex_destroy(&myImpl->mutex);
+#endif
+    delete myImpl;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void Semaphore::post(int count)
+{
+    if(count <= 0) return;
+#ifdef OMEGA_OS_WIN
+    ReleaseSemaphore(myImpl->semaphore, count, NULL);
+#else
+    pthread_mutex_lock(&myImpl->mutex);
+    myImpl->count += count;
+    if(count == 1) pthread_cond_signal(&myImpl->condition);
+    else pthread_cond_broadcast(&myImpl->condition);
+    pthread_mutex_unlock(&myImpl->mutex);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void Semaphore::wait()
+{
+#ifdef OMEGA_OS_WIN
+    WaitForSingleObject(myImpl->semaphore, INFINITE);
+#else
+    pthread_mutex_lock(&myImpl->mutex);
+    while(myImpl->count == 0) pthread_cond_wait(&myImpl->condition, &myImpl->mutex);
+    myImpl->count--;
+    pthread_mutex_unlock(&myImpl->mutex);
+#endif
+}
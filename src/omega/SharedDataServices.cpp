@@ -25,6 +25,8 @@
 #include "omega/SharedDataServices.h"
 #include "eqinternal/eqinternal.h"
 
+#include "FreeImage.h"
+
 using namespace omega;
 
 SharedData* SharedDataServices::mysSharedData = NULL;
@@ -33,7 +35,16 @@ Dictionary<String, SharedObject*> SharedDataServices::mysRegistrationQueue;
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 void SharedOStream::write( const void* data, uint64_t size )
 { 
-	myStream->write(data, size); 
+	if(myBuffer != NULL)
+	{
+		const byte* bytes = static_cast<const byte*>(data);
+		myBuffer->insert(myBuffer->end(), bytes, bytes + size);
+	}
+	else
+	{
+		myStream->write(data, size); 
+	}
+	myBytesWritten += size;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -48,10 +59,26 @@ SharedOStream& SharedOStream::operator<< ( const String& str )
 	return *this;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t SharedIStream::getRemainingSize()
+{
+	if(myData != NULL) return myDataSize - myBytesRead;
+	return myStream->getRemainingBufferSize();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 void SharedIStream::read( void* data, uint64_t size )
 { 
-	myStream->read(data, size); 
+	if(myData != NULL)
+	{
+		oassert(size <= getRemainingSize());
+		memcpy(data, myData + myBytesRead, size);
+	}
+	else
+	{
+		myStream->read(data, size); 
+	}
+	myBytesRead += size;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -59,85 +86,401 @@ SharedIStream& SharedIStream::operator>> ( String& str )
 { 
 	uint64_t nElems = 0;
 	read( &nElems, sizeof( nElems ));
-	if(nElems > myStream->getRemainingBufferSize())
+	if(nElems > getRemainingSize())
 	{
 	   oferror("SHaredDataServices: nElems(%1%) > getRemainingBufferSize(%2%)",
-	   %nElems %myStream->getRemainingBufferSize());
+	   %nElems %getRemainingSize());
 	}
-	oassert( nElems <= myStream->getRemainingBufferSize());
+	oassert( nElems <= getRemainingSize());
 	if( nElems == 0 )
 		str.clear();
+	else if(myData != NULL)
+	{
+		str.assign( reinterpret_cast< const char* >( myData + myBytesRead ), nElems );
+		myBytesRead += nElems;
+	}
 	else
 	{
 		str.assign( static_cast< const char* >( myStream->getRemainingBuffer( )), 
 					nElems );
 		myStream->advanceBuffer( nElems );
+		myBytesRead += nElems;
 	}
 	return *this; 
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-void SharedData::registerObject(SharedObject* module, const String& sharedId)
+uint64_t ZLibSharedDataCompressor::getMaxCompressedSize(uint64_t size)
+{
+	// zlib needs the target buffer to be 0.1% larger than the source, plus
+	// 12 bytes.
+	return size + size / 1000 + 16;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t ZLibSharedDataCompressor::compress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize)
+{
+	return FreeImage_ZLibCompress(dst, (DWORD)dstSize, (BYTE*)src, (DWORD)srcSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+bool ZLibSharedDataCompressor::decompress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize)
+{
+	DWORD size = FreeImage_ZLibUncompress(dst, (DWORD)dstSize, (BYTE*)src, (DWORD)srcSize);
+	return size == dstSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+SharedDataCodec::SharedDataCodec(bool master):
+	myMaster(master),
+	myVersioningEnabled(false),
+	myKeyframeInterval(60),
+	myFramesSinceKeyframe(0),
+	myKeyframeRequested(true),
+	myCommitting(false),
+	myLastFrameSize(0),
+	myLastFrameObjects(0),
+	myCompressionThreshold(0),
+	myLastSentSize(0),
+	myLastCompressionTime(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedDataCodec::registerObject(SharedObject* module, const String& sharedId)
 {
 	//ofmsg("SharedData::registerObject: registering %1%", %sharedId);
 	myObjects[sharedId] = module;
+
+	Dictionary<String, uint>::iterator it = myObjectIds.find(sharedId);
+	if(it != myObjectIds.end())
+	{
+		// The object id is known already (on the master, the object has been
+		// registered before; on slaves, the master sent us its definition).
+		myObjectTable[it->second].object = module;
+	}
+	else if(myMaster)
+	{
+		// Assign a new id to the object. 
+		uint id = myObjectTable.size();
+		ObjectEntry entry;
+		entry.key = sharedId;
+		entry.object = module;
+		myObjectTable.push_back(entry);
+		myObjectIds[sharedId] = id;
+		myNewObjectIds.push_back(id);
+	}
+
+	// Make sure the new object state gets sent during the next frame.
+	module->markSharedDataChanged();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-void SharedData::unregisterObject(const String& sharedId)
+void SharedDataCodec::unregisterObject(const String& sharedId)
 {
 	//ofmsg("SharedData::unregisterObject: unregistering %1%", %sharedId);
 	myObjects.erase(sharedId);
+
+	// Keep the object id, in case an object with the same key gets registered
+	// again (i.e. after an application reset)
+	Dictionary<String, uint>::iterator it = myObjectIds.find(sharedId);
+	if(it != myObjectIds.end())
+	{
+		myObjectTable[it->second].object = NULL;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-void SharedData::getInstanceData( co::DataOStream& os )
+void SharedDataCodec::setCompressor(SharedDataCompressor* compressor, uint64_t threshold)
 {
-	//omsg("#### SharedData::getInstanceData");
-	SharedOStream out(&os);
+	myCompressor = compressor;
+	myCompressionThreshold = threshold;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedDataCodec::writeFrame(SharedOStream& header, bool committing)
+{
+	myCommitting = committing;
+
+	if(myCompressor == NULL)
+	{
+		// No compression: serialize the frame directly to the output stream.
+		header << (byte)FrameRaw;
+		writeFrameData(header);
+		if(myCommitting) myLastSentSize = header.getBytesWritten();
+		myCommitting = false;
+		return;
+	}
+
+	// Assemble the frame in memory first.
+	myFrameBuffer.clear();
+	SharedOStream out(&myFrameBuffer);
+	writeFrameData(out);
+	uint64_t rawSize = myFrameBuffer.size();
+
+	// Compress the frame if it is large enough. If compression fails or does 
+	// not reduce the frame size, send it uncompressed.
+	uint64_t compressedSize = 0;
+	if(rawSize >= myCompressionThreshold)
+	{
+		myCompressionTimer.start();
+		myCompressedBuffer.resize(myCompressor->getMaxCompressedSize(rawSize));
+		compressedSize = myCompressor->compress(
+			&myFrameBuffer[0], rawSize, 
+			&myCompressedBuffer[0], myCompressedBuffer.size());
+		myCompressionTimer.stop();
+		if(myCommitting) myLastCompressionTime = myCompressionTimer.getElapsedTimeInMilliSec();
+	}
+
+	if(compressedSize > 0 && compressedSize < rawSize)
+	{
+		header << (byte)FrameCompressed << rawSize << compressedSize;
+		header.write(&myCompressedBuffer[0], compressedSize);
+	}
+	else
+	{
+		header << (byte)FrameRaw;
+		if(rawSize > 0) header.write(&myFrameBuffer[0], rawSize);
+	}
+	if(myCommitting) myLastSentSize = header.getBytesWritten();
+	myCommitting = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedDataCodec::writeFrameData(SharedOStream& out)
+{
+	// Frame sizes do not include the frame type header.
+	uint64_t start = out.getBytesWritten();
 
 	// Serialize update context.
 	out << myUpdateContext.frameNum << myUpdateContext.dt << myUpdateContext.time;
 
-	int numObjects = myObjects.size();
+	// Decide whether this is a keyframe. When not committing (i.e. a new slave
+	// is mapping the shared data) we always send the full state.
+	bool keyframe = true;
+	if(myCommitting && myVersioningEnabled)
+	{
+		keyframe = myKeyframeRequested || 
+			(myKeyframeInterval > 0 && myFramesSinceKeyframe >= myKeyframeInterval);
+	}
+	out << keyframe;
+
+	// Without versioning every frame is a 'keyframe', but slaves already
+	// hold the previous state: only new slaves and real keyframes need the
+	// full state of incrementally updated objects.
+	bool fullState = !myCommitting || (myVersioningEnabled && keyframe);
+	out.setKeyframe(fullState);
+	out.setCommitting(myCommitting);
+
+	// Send object id definitions. The full id table is only needed by new 
+	// slaves and on real keyframes: otherwise just send new ids, so slaves do
+	// not redo string lookups every frame.
+	if(fullState)
+	{
+		uint numDefinitions = myObjectTable.size();
+		out << numDefinitions;
+		for(uint id = 0; id < numDefinitions; id++)
+		{
+			out << id << myObjectTable[id].key;
+		}
+	}
+	else
+	{
+		uint numDefinitions = myNewObjectIds.size();
+		out << numDefinitions;
+		foreach(uint id, myNewObjectIds)
+		{
+			out << id << myObjectTable[id].key;
+		}
+	}
+	if(myCommitting) myNewObjectIds.clear();
+
+	// Collect the objects that need sending. Unversioned objects are sent
+	// every frame.
+	Vector<uint> objects;
+	for(uint id = 0; id < myObjectTable.size(); id++)
+	{
+		SharedObject* obj = myObjectTable[id].object;
+		if(obj != NULL &&
+			(keyframe || !obj->isSharedDataVersioned() || obj->hasSharedDataChanged()))
+		{
+			objects.push_back(id);
+		}
+	}
+
+	int numObjects = objects.size();
 	out << numObjects;
 
-	foreach(SharedObjectItem obj, myObjects)
+	foreach(uint id, objects)
 	{
-		out << obj.getKey();
+		SharedObject* obj = myObjectTable[id].object;
+		out << id;
+		if(myCommitting)
+		{
+			// Read the revision before committing the data: changes made to 
+			// the object while we serialize it will be sent next frame.
+			obj->myCommittedRevision = obj->mySharedRevision;
+		}
+		Stat* s = obj->myCommitTimeStat;
+		if(s != NULL) s->startTiming();
 		obj->commitSharedData(out);
+		if(s != NULL) s->stopTiming();
+	}
+
+	if(myCommitting)
+	{
+		if(keyframe)
+		{
+			myFramesSinceKeyframe = 0;
+			myKeyframeRequested = false;
+		}
+		else
+		{
+			myFramesSinceKeyframe++;
+		}
+		myLastFrameSize = out.getBytesWritten() - start;
+		myLastFrameObjects = numObjects;
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-void SharedData::applyInstanceData( co::DataIStream& is )
+void SharedDataCodec::readFrame(SharedIStream& header)
 {
-	//omsg("#### SharedData::applyInstanceData");
-	SharedIStream in(&is);
+	byte frameType;
+	header >> frameType;
+	if(frameType == FrameRaw)
+	{
+		readFrameData(header);
+		myLastSentSize = header.getBytesRead();
+	}
+	else if(frameType == FrameCompressed)
+	{
+		uint64_t rawSize;
+		uint64_t compressedSize;
+		header >> rawSize >> compressedSize;
+		myLastSentSize = header.getBytesRead() + compressedSize;
+		if(myCompressor == NULL)
+		{
+			oerror("FATAL ERROR: SharedDataServices::applyInstanceData: received a compressed frame but no compressor is set");
+			return;
+		}
+
+		myCompressedBuffer.resize(compressedSize);
+		header.read(&myCompressedBuffer[0], compressedSize);
+		myFrameBuffer.resize(rawSize);
+
+		myCompressionTimer.start();
+		bool ok = myCompressor->decompress(
+			&myCompressedBuffer[0], compressedSize, &myFrameBuffer[0], rawSize);
+		myCompressionTimer.stop();
+		myLastCompressionTime = myCompressionTimer.getElapsedTimeInMilliSec();
+		if(!ok)
+		{
+			oferror("FATAL ERROR: SharedDataServices::applyInstanceData: %1% decompression failed", 
+				%myCompressor->getName());
+			return;
+		}
+
+		SharedIStream in(&myFrameBuffer[0], rawSize);
+		readFrameData(in);
+	}
+	else
+	{
+		oferror("FATAL ERROR: SharedDataServices::applyInstanceData: unknown frame type %1%", %(int)frameType);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedDataCodec::readFrameData(SharedIStream& in)
+{
+	uint64_t start = in.getBytesRead();
 
 	// Desrialize update context.
 	in >> myUpdateContext.frameNum >> myUpdateContext.dt >> myUpdateContext.time;
 
+	// Keyframes contain the full shared state. Slaves do not need to do 
+	// anything special with them, since objects not included in a delta frame
+	// simply keep their current state.
+	bool keyframe;
+	in >> keyframe;
+
+	// Read object id definitions, and bind them to locally registered objects.
+	uint numDefinitions;
+	in >> numDefinitions;
+	while(numDefinitions > 0)
+	{
+		uint id;
+		String key;
+		in >> id >> key;
+		if(id >= myObjectTable.size()) myObjectTable.resize(id + 1);
+		myObjectTable[id].key = key;
+		myObjectIds[key] = id;
+
+		Dictionary<String, SharedObject*>::iterator it = myObjects.find(key);
+		if(it != myObjects.end()) myObjectTable[id].object = it->second;
+		else myObjectTable[id].object = NULL;
+
+		numDefinitions--;
+	}
+
 	int numObjects;
 	in >> numObjects;
+	myLastFrameObjects = numObjects;
 
 	while(numObjects > 0)
 	{
-		String objId;
-		in >> objId;
+		uint id;
+		in >> id;
 
-		SharedObject* obj = myObjects[objId];
+		SharedObject* obj = NULL;
+		if(id < myObjectTable.size()) obj = myObjectTable[id].object;
 		if(obj != NULL)
 		{
+			Stat* s = obj->mySharedUpdateTimeStat;
+			if(s != NULL) s->startTiming();
 			obj->updateSharedData(in);
+			if(s != NULL) s->stopTiming();
 		}
 		else
 		{
-			oferror("FATAL ERROR: SharedDataServices::applyInstanceData: could not find object key %1%", %objId);
+			String key = id < myObjectTable.size() ? myObjectTable[id].key : "<undefined>";
+			oferror("FATAL ERROR: SharedDataServices::applyInstanceData: could not find object %1% (id %2%)", %key %id);
 		}
 
 		numObjects--;
 	};
+	myLastFrameSize = in.getBytesRead() - start;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+SharedData::SharedData():
+	SharedDataCodec(SystemManager::instance()->isMaster()),
+	myCommitting(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedData::commitFrame()
+{
+	myCommitting = true;
+	commit();
+	myCommitting = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedData::getInstanceData( co::DataOStream& os )
+{
+	//omsg("#### SharedData::getInstanceData");
+	SharedOStream out(&os);
+	writeFrame(out, myCommitting);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedData::applyInstanceData( co::DataIStream& is )
+{
+	//omsg("#### SharedData::applyInstanceData");
+	SharedIStream in(&is);
+	readFrame(in);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -167,18 +510,40 @@ void SharedDataServices::registerObject(SharedObject* module, const String& shar
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-void SharedDataServices::unregisterObject(const String& id)
-{
+void SharedDataServices::unregisterObject(const String& id)
+{
 	if(mysSharedData != NULL) 
 	{
 		mysSharedData->unregisterObject(id);
-	}
-	else
-	{
-		oferror("SharedDataServices::unregisterObject: shared data stream unavailable while unregistering %1%", %id);
-	}
-}
-
+	}
+	else
+	{
+		oferror("SharedDataServices::unregisterObject: shared data stream unavailable while unregistering %1%", %id);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedDataServices::requestKeyframe()
+{
+	if(mysSharedData != NULL) 
+	{
+		mysSharedData->requestKeyframe();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void SharedDataServices::setCompressor(SharedDataCompressor* compressor, uint64_t threshold)
+{
+	if(mysSharedData != NULL) 
+	{
+		mysSharedData->setCompressor(compressor, threshold);
+	}
+	else
+	{
+		oerror("SharedDataServices::setCompressor: shared data stream unavailable");
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 void SharedDataServices::cleanup()
 {
@@ -78,6 +78,10 @@ void StatsManager::removeStat(Stat* s)
 {
 	oassert(s != NULL);
 	myStatList.remove(s);
+	// Drop the name entry too, so a stat created later with the same name
+	// does not find this one.
+	Dictionary<String, Stat*>::iterator it = myStatDictionary.find(s->getName());
+	if(it != myStatDictionary.end() && it->second == s) myStatDictionary.erase(it);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -27,6 +27,9 @@
 #include "omega/Texture.h"
 #include "omega/PixelData.h"
 #include "omega/glheaders.h"
+#include "omega/SystemManager.h"
+
+#include <string.h>
 
 using namespace omega;
 
@@ -56,13 +59,6 @@ void Texture::initialize(int width, int height, uint format)
 	glBindTexture(GL_TEXTURE_2D, myId);
 	glTexImage2D(GL_TEXTURE_2D, 0, myGlFormat, myWidth, myHeight, 0, myGlFormat, GL_UNSIGNED_BYTE, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	
-	if(sUsePbo)
-	{
-		glGenBuffers(1, &myPboId);
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, myPboId);
-        glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * 4, 0, GL_STREAM_DRAW);
-	}
 
 	GLenum glErr = glGetError();
 
@@ -79,30 +75,37 @@ void Texture::initialize(int width, int height, uint format)
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 void Texture::writePixels(PixelData* data)
 {
-	if(myInitialized && data != NULL)
+	if(data != NULL)
 	{
-		if(sUsePbo)
-		{
-			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, myPboId);
-		}
+		writePixels(data, Rect(0, 0, data->getWidth(), data->getHeight()));
+	}
+}
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void Texture::writePixels(PixelData* data, const Rect& region)
+{
+	if(myInitialized && data != NULL)
+	{
 		glBindTexture(GL_TEXTURE_2D, myId);
-		int xoffset = 0;
-		int yoffset = 0;
 		int h = data->getHeight();
 		int w = data->getWidth();
-		// If needed, resize the texture.
+		// If needed, resize the texture. Resized textures need a full upload.
+		Rect r = region;
 		if(h != myHeight || w != myWidth)
 		{
 			myHeight = h;
 			myWidth = w;
 			glTexImage2D(GL_TEXTURE_2D, 0, myGlFormat, myWidth, myHeight, 0, myGlFormat, GL_UNSIGNED_BYTE, NULL);
+			r = Rect(0, 0, w, h);
 		}
 
-		byte* pixels = data->bind(getContext());
-
 		GLenum format = GL_RGBA;
-		if(data->getFormat() == PixelData::FormatRgb) format = GL_RGB;
+		int pixelSize = 4;
+		if(data->getFormat() == PixelData::FormatRgb) 
+		{
+			format = GL_RGB;
+			pixelSize = 3;
+		}
 		if(format == GL_RGB)
 		{
 			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
@@ -112,7 +115,26 @@ void Texture::writePixels(PixelData* data)
 			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 		}
 
-		glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, w, h, format, GL_UNSIGNED_BYTE,(GLvoid*)pixels);
+		// pixels is NULL (an offset in the bound buffer) for pixel data 
+		// stored in pixel buffer objects.
+		byte* pixels = data->bind(getContext());
+		int pitch = data->getPitch();
+		size_t offset = r.y() * pitch + r.x() * pixelSize;
+
+		if(sUsePbo && pixels != NULL)
+		{
+			TextureUploadRing* ring = TextureUploadRing::getInstance(getContext());
+			ring->upload(r.x(), r.y(), r.width(), r.height(), format, pixelSize, pixels + offset, pitch);
+		}
+		else
+		{
+			// Use the pixel data row length, so sub-regions can be uploaded 
+			// straight from the source image.
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, r.x(), r.y(), r.width(), r.height(), 
+				format, GL_UNSIGNED_BYTE, (GLvoid*)(pixels + offset));
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		}
 		data->unbind();
 		GLenum glErr = glGetError();
 
@@ -138,3 +160,90 @@ void Texture::unbind()
 {
 	myTextureUnit = GpuContext::TextureUnitInvalid;
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+Ref<TextureUploadRing> TextureUploadRing::sRings[GpuContext::MaxContexts];
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+TextureUploadRing* TextureUploadRing::getInstance(GpuContext* context)
+{
+	uint id = context->getId();
+	if(sRings[id].isNull()) sRings[id] = new TextureUploadRing(context);
+	return sRings[id];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+TextureUploadRing::TextureUploadRing(GpuContext* context):
+	myNextBuffer(0)
+{
+	glGenBuffers(NumBuffers, myBuffers);
+
+	StatsManager* sm = SystemManager::instance()->getStatsManager();
+	myUploadStat = sm->createStat(ostr("ctx%1% upload", %context->getId()), StatsManager::Memory);
+	myUploadTimeStat = sm->createStat(ostr("ctx%1% upload time", %context->getId()), StatsManager::Time);
+	myStallStat = sm->createStat(ostr("ctx%1% upload stalls", %context->getId()), StatsManager::Count1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void TextureUploadRing::upload(int x, int y, int width, int height, uint format, 
+	int pixelSize, const byte* src, int srcPitch)
+{
+	myTimer.start();
+
+	// Rows in the buffer are tightly packed, padded to the current unpack
+	// alignment.
+	GLint alignment = 4;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	int rowSize = width * pixelSize;
+	int dstPitch = (rowSize + alignment - 1) / alignment * alignment;
+	size_t size = dstPitch * height;
+
+	GLuint buffer = myBuffers[myNextBuffer];
+	myNextBuffer = (myNextBuffer + 1) % NumBuffers;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	// Orphan the previous buffer storage: if the GPU is still reading it
+	// the driver hands us fresh memory instead of blocking.
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	byte* dst = NULL;
+	if(GLEW_ARB_map_buffer_range)
+	{
+		dst = (byte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, 
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+	else
+	{
+		dst = (byte*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	}
+	double mapTime = myTimer.getElapsedTimeInMilliSec();
+
+	if(dst != NULL)
+	{
+		if(dstPitch == srcPitch)
+		{
+			memcpy(dst, src, size);
+		}
+		else
+		{
+			for(int i = 0; i < height; i++) memcpy(dst + i * dstPitch, src + i * srcPitch, rowSize);
+		}
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, GL_UNSIGNED_BYTE, 0);
+	}
+	else
+	{
+		// Mapping failed: fall back to a client memory upload.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, srcPitch / pixelSize);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, GL_UNSIGNED_BYTE, src);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	myTimer.stop();
+	myUploadStat->addSample(size);
+	myUploadTimeStat->addSample(myTimer.getElapsedTimeInMilliSec());
+	// A map that takes more than a millisecond means the driver waited for
+	// the GPU instead of orphaning.
+	myStallStat->addSample(mapTime > 1.0 ? 1 : 0);
+}
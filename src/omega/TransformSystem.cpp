@@ -0,0 +1,204 @@
+/**************************************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-------------------------------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-------------------------------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory, University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, are permitted 
+ * provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions 
+ * and the following disclaimer. Redistributions in binary form must reproduce the above copyright 
+ * notice, this list of conditions and the following disclaimer in the documentation and/or other 
+ * materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF 
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN 
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-------------------------------------------------------------------------------------------------
+ * What's in this file
+ *	Updates scene node world transforms with passes over flat arrays.
+ *************************************************************************************************/
+#include "omega/TransformSystem.h"
+#include "omega/SceneNode.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+TransformSystem::TransformSystem():
+	myEnabled(true),
+	myRoot(NULL),
+	myHierarchyVersion(0),
+	myLastUpdateCount(0),
+	myJobSystem(NULL)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void TransformSystem::update(Node* root)
+{
+	if(!myEnabled)
+	{
+		root->update(true, false);
+		return;
+	}
+
+	myLastUpdateCount = 0;
+	if(!prepare(root)) return;
+
+	bool parallel = (myJobSystem != NULL && myJobSystem->getThreads() > 0);
+
+	// Visit the hierarchy one depth level at a time, like Node::update: only
+	// nodes that requested an update, and children of nodes that changed, 
+	// are visited.
+	myVisit.clear();
+	myVisit.push_back(0);
+	while(!myVisit.empty())
+	{
+		int count = myVisit.size();
+		if(parallel && count >= ParallelLevelSize)
+		{
+			myJobSystem->parallelFor(count, ParallelBatchSize, this);
+		}
+		else
+		{
+			myLastUpdateCount += updateRange(0, count);
+		}
+
+		// Collect the nodes to visit in the next level.
+		myNextVisit.clear();
+		foreach(int i, myVisit)
+		{
+			Node* n = myNodes[i];
+			if(myPropagate[i])
+			{
+				for(int c = myChildStart[i]; c < myChildEnd[i]; c++) myNextVisit.push_back(c);
+			}
+			else
+			{
+				foreach(Node* child, n->mChildrenToUpdate) myNextVisit.push_back(child->mTransformIndex);
+			}
+			n->mChildrenToUpdate.clear();
+		}
+		myVisit.swap(myNextVisit);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+bool TransformSystem::prepare(Node* root)
+{
+	if(root != myRoot || root->mHierarchyVersion != myHierarchyVersion) rebuild(root);
+
+	// Same short circuit as Node::update: if nothing below the root requested
+	// an update, there is nothing to do.
+	return root->mNeedParentUpdate || root->mNeedChildUpdate || 
+		!root->mChildrenToUpdate.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void TransformSystem::rebuild(Node* root)
+{
+	myRoot = root;
+	myHierarchyVersion = root->mHierarchyVersion;
+
+	myNodes.clear();
+	mySceneNodes.clear();
+	myParents.clear();
+	myChildStart.clear();
+	myChildEnd.clear();
+
+	// Breadth-first flattening: each level is stored after the previous one,
+	// so the children of a node are contiguous.
+	myNodes.push_back(root);
+	myParents.push_back(-1);
+	for(int i = 0; i < myNodes.size(); i++)
+	{
+		Node* n = myNodes[i];
+		n->mTransformIndex = i;
+		myChildStart.push_back(myNodes.size());
+		foreach(Node* child, n->getChildren())
+		{
+			myNodes.push_back(child);
+			myParents.push_back(i);
+		}
+		myChildEnd.push_back(myNodes.size());
+	}
+
+	int n = myNodes.size();
+	mySceneNodes.resize(n);
+	for(int i = 0; i < n; i++) mySceneNodes[i] = dynamic_cast<SceneNode*>(myNodes[i]);
+
+	myPositions.resize(n);
+	myOrientations.resize(n);
+	myScales.resize(n);
+	myPropagate.resize(n);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int TransformSystem::updateRange(int first, int end)
+{
+	int updated = 0;
+	for(int v = first; v < end; v++)
+	{
+		int i = myVisit[v];
+		Node* n = myNodes[i];
+		int p = myParents[i];
+		// Same rules as Node::update: a node updates its transform if it
+		// asked for it or if its parent propagated a change. Parents of 
+		// visited nodes have been visited in the previous level, so their
+		// entries in the arrays are up to date.
+		bool parentHasChanged = (p >= 0 && myPropagate[p]);
+
+		if(n->mNeedParentUpdate || parentHasChanged)
+		{
+			if(p >= 0)
+			{
+				// Same math as Node::updateFromParent, reading the parent 
+				// world transform from the arrays.
+				const Quaternion& po = myOrientations[p];
+				const Vector3f& ps = myScales[p];
+				n->mDerivedOrientation = n->mInheritOrientation ? po * n->mOrientation : n->mOrientation;
+				n->mDerivedScale = n->mInheritScale ? ps.cwiseProduct(n->mScale) : n->mScale;
+				n->mDerivedPosition = po * ps.cwiseProduct(n->mPosition) + myPositions[p];
+				n->mCachedTransformOutOfDate = true;
+				n->mNeedParentUpdate = false;
+
+				SceneNode* sn = mySceneNodes[i];
+				if(sn != NULL && sn->myBvhEntry >= 0) sn->invalidateBvhEntry();
+			}
+			else
+			{
+				// The root may have a parent outside the flattened hierarchy:
+				// let it update itself.
+				n->updateFromParent();
+			}
+			updated++;
+		}
+
+		myPositions[i] = n->mDerivedPosition;
+		myOrientations[i] = n->mDerivedOrientation;
+		myScales[i] = n->mDerivedScale;
+
+		myPropagate[i] = n->mNeedChildUpdate || parentHasChanged;
+		n->mNeedChildUpdate = false;
+		n->mParentNotified = false;
+	}
+	return updated;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void TransformSystem::run(int first, int end)
+{
+	int updated = updateRange(first, end);
+	myCountLock.lock();
+	myLastUpdateCount += updated;
+	myCountLock.unlock();
+}
@@ -42,6 +42,7 @@ WandCameraController::WandCameraController():
 	myNavigateButton(Event::Button6)
 {
 	myAxisCorrection = Quaternion::Identity(); 
+	addEventServiceType(Service::Wand);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -35,62 +35,42 @@ using namespace omega;
 using namespace co::base;
 using namespace std;
 
-///////////////////////////////////////////////////////////////////////////////////////////////
-void EventUtils::serializeEvent(Event& evt, co::DataOStream& os)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+ConfigImpl::ConfigImpl( co::base::RefPtr< eq::Server > parent): 
+    eq::Config(parent) 
 {
-    os << evt.myTimestamp;
-    os << evt.mySourceId;
-    os << evt.myServiceId;
-    os << evt.myServiceType;
-    os << evt.myType;
-    os << evt.myFlags;
-    os << evt.myPosition[0] << evt.myPosition[1] << evt.myPosition[2];
-    os << evt.myOrientation.x() << evt.myOrientation.y() << evt.myOrientation.z() << evt.myOrientation.w();
+    omsg("[EQ] ConfigImpl::ConfigImpl");
+    SharedDataServices::setSharedData(&mySharedData);
 
-    // Serialize extra data
-    os << evt.myExtraDataType;
-    os << evt.myExtraDataItems;
-    if(evt.myExtraDataType != Event::ExtraDataNull)
+    // Read shared data options. This runs on all nodes, since slaves need to
+    // use the same compressor as the master.
+    Config* syscfg = SystemManager::instance()->getSystemConfig();
+    if(syscfg->exists("config/sharedData"))
     {
-        os << evt.myExtraDataValidMask;
-        os.write(evt.myExtraData, evt.getExtraDataSize());
-    }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////
-void EventUtils::deserializeEvent(Event& evt, co::DataIStream& is)
-{
-    is >> evt.myTimestamp;
-    is >> evt.mySourceId;
-    is >> evt.myServiceId;
-    is >> evt.myServiceType;
-    is >> evt.myType;
-    is >> evt.myFlags;
-    is >> evt.myPosition[0] >> evt.myPosition[1] >> evt.myPosition[2];
-    is >> evt.myOrientation.x() >> evt.myOrientation.y() >> evt.myOrientation.z() >> evt.myOrientation.w();
+        Setting& s = syscfg->lookup("config/sharedData");
+        mySharedData.setVersioningEnabled(Config::getBoolValue("versioning", s, false));
+        mySharedData.setKeyframeInterval(Config::getIntValue("keyframeInterval", s, 60));
 
-    // Deserialize extra data
-    is >> evt.myExtraDataType;
-    is >> evt.myExtraDataItems;
-    if(evt.myExtraDataType != Event::ExtraDataNull)
-    {
-        is >> evt.myExtraDataValidMask;
-        is.read(evt.myExtraData, evt.getExtraDataSize());
+        String compression = Config::getStringValue("compression", s, "none");
+        int threshold = Config::getIntValue("compressionThreshold", s, 65536);
+        if(compression == "zlib")
+        {
+            mySharedData.setCompressor(new ZLibSharedDataCompressor(), threshold);
+        }
+        else if(compression != "none")
+        {
+            ofwarn("[EQ] unknown shared data compression %1%. Compression disabled.", %compression);
+        }
     }
-    if(evt.myExtraDataType == Event::ExtraDataString)
+    ofmsg("[EQ] Shared data versioning: %1% (keyframe interval: %2%)", 
+        %mySharedData.isVersioningEnabled() %mySharedData.getKeyframeInterval());
+    if(mySharedData.getCompressor() != NULL)
     {
-        evt.myExtraData[evt.getExtraDataSize()] = '\0';
+        ofmsg("[EQ] Shared data compression: %1% (threshold: %2% bytes)", 
+            %mySharedData.getCompressor()->getName() %mySharedData.getCompressionThreshold());
     }
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-ConfigImpl::ConfigImpl( co::base::RefPtr< eq::Server > parent): 
-    eq::Config(parent) 
-{
-    omsg("[EQ] ConfigImpl::ConfigImpl");
-    SharedDataServices::setSharedData(&mySharedData);
-}
-
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ConfigImpl::~ConfigImpl()
 {
@@ -127,6 +107,9 @@ bool ConfigImpl::init()
 
     StatsManager* sm = SystemManager::instance()->getStatsManager();
     myFpsStat = sm->createStat("fps", StatsManager::Fps);
+    mySharedDataSizeStat = sm->createStat("Shared data size", StatsManager::Memory);
+    mySharedDataSentStat = sm->createStat("Shared data sent", StatsManager::Memory);
+    mySharedDataCompressionStat = sm->createStat("Shared data compression", StatsManager::Time);
 
     myGlobalTimer.start();
 
@@ -276,7 +259,13 @@ uint32_t ConfigImpl::startFrame( const uint128_t& version )
     }
 
     // Send shared data.
-    mySharedData.commit();
+    mySharedData.commitFrame();
+    mySharedDataSizeStat->addSample(mySharedData.getLastFrameSize());
+    mySharedDataSentStat->addSample(mySharedData.getLastSentSize());
+    if(mySharedData.getCompressor() != NULL)
+    {
+        mySharedDataCompressionStat->addSample(mySharedData.getLastCompressionTime());
+    }
 
     myServer->update(uc);
 
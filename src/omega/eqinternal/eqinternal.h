@@ -40,6 +40,7 @@
 #include "omega/Application.h"
 #include "omega/RenderTarget.h"
 #include "omega/EqualizerDisplaySystem.h"
+#include "omega/EventUtils.h"
 
 #define EQ_IGNORE_GLEW
 
@@ -67,30 +68,16 @@ using namespace omega;
 using namespace co::base;
 using namespace std;
 
-namespace omicron {
-	///////////////////////////////////////////////////////////////////////////
-	//! This class provides utility methods for converting omegalib events into
-	//! the stream format used by Equalizer to share data between nodes.
-    class EventUtils
-    {
-    public:
-        static void serializeEvent(Event& evt, co::DataOStream& os);
-        static void deserializeEvent(Event& evt, co::DataIStream& is);
-    private:
-        EventUtils() {}
-    };
-};
-
 namespace omega {
     class RenderTarget;
 	class Camera;
 
 ///////////////////////////////////////////////////////////////////////////////
-class SharedData: public co::Object
+class SharedData: public co::Object, public SharedDataCodec
 {
 public:
-	void registerObject(SharedObject* object, const String& id);
-	void unregisterObject(const String& id);
+	SharedData();
+
     // The shared data is unbuffered: we do not store multiple versions of it.
     // This reduces the memory footprint of large serialized objects (like
     // the frames generated by the omegaToolkit::ImageBroadcastModule)
@@ -98,18 +85,20 @@ public:
     // HINT: to support frame latencym change this to INSTANCE, and modify
     // setAutoObsolete to be = to latency, or more.
 	virtual ChangeType getChangeType() const { return UNBUFFERED; }
-	void setUpdateContext(const UpdateContext& ctx) { myUpdateContext = ctx; }
-	const UpdateContext& getUpdateContext() { return myUpdateContext; }
 
+	//! Commits a new frame of shared data. This should be used instead of
+	//! co::Object::commit, since it takes care of shared object versioning.
+	void commitFrame();
 
 protected:
 	virtual void getInstanceData( co::DataOStream& os );
 	virtual void applyInstanceData( co::DataIStream& is );
 
 private:
-	Dictionary<String, SharedObject*> myObjects;
-	typedef Dictionary<String, SharedObject*>::Item SharedObjectItem;
-	UpdateContext myUpdateContext;
+	// Set to true while a frame is being committed. getInstanceData is also
+	// called by collage when mapping the object on a new slave: in that case
+	// we always send a keyframe and we do not touch object revisions.
+	bool myCommitting;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -140,6 +129,11 @@ private:
 	Timer myGlobalTimer;
 	//! Global fps counter.
 	Ref<Stat> myFpsStat;
+	//! Size in bytes of each committed shared data frame, before and after
+	//! compression, and compression time.
+	Ref<Stat> mySharedDataSizeStat;
+	Ref<Stat> mySharedDataSentStat;
+	Ref<Stat> mySharedDataCompressionStat;
 
     omicron::Ref<Engine> myServer;
 };
@@ -885,6 +885,31 @@ int getImageLoaderThreads()
     return ImageUtils::getImageLoaderThreads();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void setImageCacheEnabled(bool enabled)
+{
+    ImageUtils::setCacheEnabled(enabled);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool isImageCacheEnabled()
+{
+    return ImageUtils::isCacheEnabled();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sets the image cache budget in megabytes.
+void setImageCacheSize(int megabytes)
+{
+    ImageUtils::setCacheSize((size_t)megabytes * 1024 * 1024);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void clearImageCache()
+{
+    ImageUtils::clearCache();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void printModules()
 {
@@ -922,6 +947,24 @@ void printModules()
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void setModuleTimingEnabled(bool value)
+{
+    ModuleServices::setTimingEnabled(value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool isModuleTimingEnabled()
+{
+    return ModuleServices::isTimingEnabled();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void printSlowestModules(int n)
+{
+    ModuleServices::printSlowestModules(n);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //! The ActorWrapper adds support for python overloading to the Actor class
 class ActorPythonWrapper: public Actor, public wrapper<Actor>
@@ -1007,6 +1050,7 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(NodePitchOverloads, pitch, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(NodeRollOverloads, roll, 1, 2) 
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CameraOutputReadbackOverloads, setReadbackTarget, 1, 2) 
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CameraOutputAsyncReadbackOverloads, setAsyncReadback, 1, 2) 
 ///////////////////////////////////////////////////////////////////////////////
 BOOST_PYTHON_MODULE(omega)
 {
@@ -1238,6 +1282,8 @@ BOOST_PYTHON_MODULE(omega)
         PYAPI_METHOD(CameraOutput, setEnabled)
         PYAPI_METHOD(CameraOutput, isEnabled)
         .def("setReadbackTarget", &CameraOutput::setReadbackTarget, CameraOutputReadbackOverloads())
+        .def("setAsyncReadback", &CameraOutput::setAsyncReadback, CameraOutputAsyncReadbackOverloads())
+        PYAPI_METHOD(CameraOutput, isAsyncReadbackEnabled)
         ;
 
     // Camera
@@ -1506,10 +1552,17 @@ BOOST_PYTHON_MODULE(omega)
 
     def("setImageLoaderThreads", setImageLoaderThreads);
     def("getImageLoaderThreads", getImageLoaderThreads);
+    def("setImageCacheEnabled", setImageCacheEnabled);
+    def("isImageCacheEnabled", isImageCacheEnabled);
+    def("setImageCacheSize", setImageCacheSize);
+    def("clearImageCache", clearImageCache);
     def("getHostname", getHostname, PYAPI_RETURN_VALUE);
     def("isHostInTileSection", isHostInTileSection);
     def("setTilesEnabled", setTilesEnabled);
     def("printModules", printModules);
+    def("setModuleTimingEnabled", setModuleTimingEnabled);
+    def("isModuleTimingEnabled", isModuleTimingEnabled);
+    def("printSlowestModules", printSlowestModules);
 
     def("isEventDispatchEnabled", isEventDispatchEnabled);
     def("setEventDispatchEnabled", setEventDispatchEnabled);
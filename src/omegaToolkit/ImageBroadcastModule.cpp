@@ -33,9 +33,83 @@
  *	A module to share pixel data between master and slave nodes
  ******************************************************************************/
 #include "omegaToolkit/ImageBroadcastModule.h"
+#include "omega/SystemManager.h"
+
+#include <string.h>
+#include <algorithm>
 
 using namespace omega;
 
+////////////////////////////////////////////////////////////////////////////////
+// Hashes a rectangular region of an image, used to detect changed tiles.
+static uint64_t hashImageRegion(const byte* pixels, int pitch, int rowSize, int rows)
+{
+    // FNV-1a over 64 bit words, with a byte loop for the row tails.
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t h = 14695981039346656037ULL;
+    for(int y = 0; y < rows; y++)
+    {
+        const byte* row = pixels + y * pitch;
+        int x = 0;
+        for(; x + 8 <= rowSize; x += 8)
+        {
+            uint64_t v;
+            memcpy(&v, row + x, 8);
+            h = (h ^ v) * prime;
+        }
+        for(; x < rowSize; x++) h = (h ^ row[x]) * prime;
+    }
+    return h;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Encodes channel snapshots queued by the image broadcast module.
+class ImageBroadcastModule::EncoderThread: public Thread
+{
+public:
+    EncoderThread(ImageBroadcastModule* owner): myOwner(owner)
+    {}
+
+    virtual void threadProc()
+    {
+        while(true)
+        {
+            myOwner->myJobSignal.wait();
+
+            myOwner->myJobLock.lock();
+            if(myOwner->myShutdownEncoders)
+            {
+                myOwner->myJobLock.unlock();
+                break;
+            }
+            if(myOwner->myJobs.empty())
+            {
+                myOwner->myJobLock.unlock();
+                continue;
+            }
+            Ref<Channel> ch = myOwner->myJobs.front();
+            myOwner->myJobs.pop();
+            myOwner->myJobLock.unlock();
+
+            Timer t;
+            t.start();
+            Ref<ByteArray> data = ImageUtils::encode(ch->snapshot, ch->encoding, ch->quality);
+            t.stop();
+
+            myOwner->myJobLock.lock();
+            ch->encoded = data;
+            ch->encodeTime = t.getElapsedTimeInMilliSec();
+            ch->encoderDone = true;
+            myOwner->myJobLock.unlock();
+
+            myOwner->myDoneSignal.post();
+        }
+    }
+
+private:
+    ImageBroadcastModule* myOwner;
+};
+
 ImageBroadcastModule* ImageBroadcastModule::mysInstance = NULL;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -52,33 +126,99 @@ ImageBroadcastModule* ImageBroadcastModule::instance()
 
 ////////////////////////////////////////////////////////////////////////////////
 ImageBroadcastModule::ImageBroadcastModule():
-    EngineModule("ImageBroadcastModule")
+    EngineModule("ImageBroadcastModule"),
+    myShutdownEncoders(false),
+    myMaxEncoderLatency(0),
+    myCommitCount(0)
 {
     enableSharedData();
+    setSharedDataVersioned(true);
     mysInstance = this;
     
     // Setup stats
-    StatsManager* sm = getEngine()->getSystemManager()->getStatsManager();
+    StatsManager* sm = SystemManager::instance()->getStatsManager();
     myEncodingTime = sm->createStat("Image broadcast encoding", StatsManager::Time);
     myDecodingTime = sm->createStat("Image broadcast decoding", StatsManager::Time);
+    myBroadcastSize = sm->createStat("Image broadcast size", StatsManager::Memory);
+    myTilesSent = sm->createStat("Image broadcast tiles", StatsManager::Count1);
+    myEncoderQueue = sm->createStat("Image broadcast encoder queue", StatsManager::Count1);
+    myEncoderWait = sm->createStat("Image broadcast encoder wait", StatsManager::Time);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ImageBroadcastModule::~ImageBroadcastModule()
 {
+    stopEncoders();
     mysInstance = NULL;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void ImageBroadcastModule::addChannel(PixelData* channel, const String& channelName, ImageUtils::ImageFormat format, int quality)
+void ImageBroadcastModule::setEncoderThreads(int threads)
+{
+    stopEncoders();
+    for(int i = 0; i < threads; i++)
+    {
+        Thread* t = new EncoderThread(this);
+        t->start();
+        myEncoderThreads.push_back(t);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ImageBroadcastModule::stopEncoders()
+{
+    if(myEncoderThreads.size() == 0) return;
+
+    myJobLock.lock();
+    myShutdownEncoders = true;
+    myJobLock.unlock();
+
+    myJobSignal.post(myEncoderThreads.size());
+    foreach(Thread* t, myEncoderThreads)
+    {
+        t->stop();
+        delete t;
+    }
+    myEncoderThreads.clear();
+    myShutdownEncoders = false;
+
+    // Drop jobs that did not run, and mark their channels dirty so they get
+    // sent again. Finished jobs are still sent during the next commit.
+    while(!myJobs.empty()) myJobs.pop();
+    foreach(ChannelDictionary::Item ch, myChannels)
+    {
+        if(ch->encoderBusy && !ch->encoderDone)
+        {
+            ch->encoderBusy = false;
+            ch->snapshot = NULL;
+            ch->data->setDirty();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ImageBroadcastModule::isPooled(Channel* ch)
+{
+    return myEncoderThreads.size() > 0 && ch->tileSize == 0 && 
+        ch->encoding != ImageUtils::FormatNone;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ImageBroadcastModule::addChannel(PixelData* channel, const String& channelName, ImageUtils::ImageFormat format, int quality, int tileSize)
 {
     Channel* ch = new Channel();
     ch->name = channelName;
     ch->data = channel;
     ch->encoding = format;
     ch->quality = quality;
+    ch->tileSize = tileSize;
     myChannels[channelName] = ch;
 
+    StatsManager* sm = SystemManager::instance()->getStatsManager();
+    String statName = "Image broadcast encode " + channelName;
+    ch->encodeStat = sm->findStat(statName);
+    if(ch->encodeStat == NULL) ch->encodeStat = sm->createStat(statName, StatsManager::Time);
+
     // We will be in charge of marking the pixel data as clean.
     channel->requireExplicitClean(true);
 }
@@ -89,51 +229,259 @@ void ImageBroadcastModule::removeChannel(const String& channel)
     myChannels.erase(channel);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool ImageBroadcastModule::hasSharedDataChanged()
+{
+    // We need to send data only when at least one channel is dirty.
+    foreach(ChannelDictionary::Item ch, myChannels)
+    {
+        if(ch->data->isDirty()) return true;
+        // Channels being encoded will send their data once done.
+        if(ch->encoderBusy) return true;
+    }
+    return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void ImageBroadcastModule::commitSharedData(SharedOStream& out)
 {
+    // A new slave is mapping the shared data: send it the current image of
+    // all channels, encoded here. This frame only reaches the new slave, so
+    // the encoder pool is left alone: its results go to all slaves during
+    // the next commits.
+    if(!out.isCommitting())
+    {
+        int numChannels = myChannels.size();
+        out << numChannels;
+        foreach(ChannelDictionary::Item ch, myChannels)
+        {
+            commitChannel(ch.getValue(), out);
+        }
+        return;
+    }
+
     myEncodingTime->startTiming();
+    uint64_t startSize = out.getBytesWritten();
+    myCommitCount++;
     
-    int numChannels = 0;
+    // Tiled channels send their full image on keyframes, since receivers 
+    // may not have the previous tiles.
+    bool keyframe = out.isKeyframe();
+
+    // Queue dirty pooled channels for encoding. Channels that are still 
+    // being encoded stay dirty and get queued again once their previous
+    // update has been sent.
+    int queued = 0;
     foreach(ChannelDictionary::Item ch, myChannels)
     {
-        // Count the number of channels that need sending.
-        // NOTE: The PixelData dirty flag is also used to refresh textures
-        // attached to the pixel data: we need to use and reset it here.
-        // It is possible that textures attached to a PixelData object used as
-        // an image broadcast object will not work correctly. 
-        if(ch->data->isDirty()) numChannels++;
+        if(isPooled(ch.getValue()) && ch->data->isDirty() && !ch->encoderBusy)
+        {
+            PixelData* pd = ch->data;
+            if(ch->snapshot == NULL || ch->snapshot->getWidth() != pd->getWidth() ||
+                ch->snapshot->getHeight() != pd->getHeight() || ch->snapshot->getFormat() != pd->getFormat())
+            {
+                ch->snapshot = new PixelData(pd->getFormat(), pd->getWidth(), pd->getHeight());
+            }
+            memcpy(ch->snapshot->map(), pd->map(), pd->getSize());
+            ch->snapshot->unmap();
+            pd->unmap();
+            pd->setDirty(false);
+
+            ch->encoderBusy = true;
+            ch->encoderDone = false;
+            ch->dispatchFrame = myCommitCount;
+            myJobLock.lock();
+            myJobs.push(ch.getValue());
+            myJobLock.unlock();
+            queued++;
+        }
     }
+    myJobSignal.post(queued);
 
-    out << numChannels;
+    // Wait for channels that would exceed the maximum encoder latency.
+    myEncoderWait->startTiming();
+    foreach(ChannelDictionary::Item ch, myChannels)
+    {
+        if(!ch->encoderBusy) continue;
+        while(myCommitCount - ch->dispatchFrame >= (uint64_t)myMaxEncoderLatency)
+        {
+            myJobLock.lock();
+            bool done = ch->encoderDone;
+            myJobLock.unlock();
+            if(done) break;
+            myDoneSignal.wait();
+        }
+    }
+    myEncoderWait->stopTiming();
 
+    // Collect the channels to send. Encoder results are collected under the
+    // job lock, so channels finishing while we write go out next frame.
+    // NOTE: The PixelData dirty flag is also used to refresh textures
+    // attached to the pixel data: we need to use and reset it here.
+    // It is possible that textures attached to a PixelData object used as
+    // an image broadcast object will not work correctly. 
+    Vector<Channel*> encoded;
+    Vector<Channel*> dirty;
+    int pending = 0;
+    myJobLock.lock();
     foreach(ChannelDictionary::Item ch, myChannels)
     {
-        // If the channel pixel data is marked as dirty, encode and send it.
-        if(ch->data->isDirty())
+        if(ch->encoderBusy)
         {
-            out << ch->name;
-            out << ch->encoding;
-            //ofmsg("sending %1%", %ch->name);
-            if(ch->encoding != ImageUtils::FormatNone)
-            {
-                Ref<ByteArray> data = ImageUtils::encode(ch->data, ch->encoding);
-                out << data->getSize();
-                out.write(data->getData(), data->getSize());
-            }
-            else
-            {
-                out << ch->data->getSize();
-                out.write(ch->data->map(), ch->data->getSize());
-                ch->data->unmap();
-            }
-            ch->data->setDirty(false);
+            if(ch->encoderDone) encoded.push_back(ch.getValue());
+            else pending++;
         }
+        else if(!isPooled(ch.getValue()) && 
+            (ch->data->isDirty() || (keyframe && ch->tileSize > 0)))
+        {
+            dirty.push_back(ch.getValue());
+        }
+    }
+    myJobLock.unlock();
+    myEncoderQueue->addSample(pending);
+
+    int numChannels = encoded.size() + dirty.size();
+    out << numChannels;
+
+    // Send channels encoded by the encoder pool.
+    foreach(Channel* ch, encoded)
+    {
+        out << ch->name;
+        out << ch->encoding;
+        bool tiled = false;
+        out << tiled;
+        out << ch->encoded->getSize();
+        out.write(ch->encoded->getData(), ch->encoded->getSize());
+
+        ch->encodeStat->addSample(ch->encodeTime);
+        ch->encoded = NULL;
+        ch->encoderBusy = false;
+        ch->encoderDone = false;
+    }
+
+    // Encode and send dirty channels.
+    foreach(Channel* ch, dirty)
+    {
+        commitChannel(ch, out);
     }
     
+    myBroadcastSize->addSample(out.getBytesWritten() - startSize);
     myEncodingTime->stopTiming();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void ImageBroadcastModule::commitChannel(Channel* ch, SharedOStream& out)
+{
+    out << ch->name;
+    out << ch->encoding;
+    //ofmsg("sending %1%", %ch->name);
+    bool tiled = ch->tileSize > 0;
+    out << tiled;
+    if(tiled)
+    {
+        commitTiles(ch, out);
+    }
+    else if(ch->encoding != ImageUtils::FormatNone)
+    {
+        ch->encodeStat->startTiming();
+        Ref<ByteArray> data = ImageUtils::encode(ch->data, ch->encoding, ch->quality);
+        ch->encodeStat->stopTiming();
+        out << data->getSize();
+        out.write(data->getData(), data->getSize());
+    }
+    else
+    {
+        out << ch->data->getSize();
+        out.write(ch->data->map(), ch->data->getSize());
+        ch->data->unmap();
+    }
+    // Frames sent to a new slave leave the channel dirty: the other slaves
+    // still need the changes.
+    if(out.isCommitting()) ch->data->setDirty(false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ImageBroadcastModule::commitTiles(Channel* ch, SharedOStream& out)
+{
+    PixelData* pd = ch->data;
+    int width = pd->getWidth();
+    int height = pd->getHeight();
+    int ts = ch->tileSize;
+    int pitch = pd->getPitch();
+    int pixelSize = pd->getBpp() / 8;
+    int tilesX = (width + ts - 1) / ts;
+    int tilesY = (height + ts - 1) / ts;
+    int numTiles = tilesX * tilesY;
+
+    // Hash all tiles and find the ones that changed since the last broadcast.
+    // A new slave mapping the shared data gets all the tiles. The tile hashes
+    // track what the other slaves hold, so they are only updated on commits.
+    byte* pixels = pd->map();
+    bool committing = out.isCommitting();
+    bool keyframe = out.isKeyframe() || ch->tileHashes.size() != numTiles;
+    if(committing) ch->tileHashes.resize(numTiles);
+
+    Vector<int> changed;
+    for(int i = 0; i < numTiles; i++)
+    {
+        if(!committing)
+        {
+            changed.push_back(i);
+            continue;
+        }
+        int x = (i % tilesX) * ts;
+        int y = (i / tilesX) * ts;
+        int w = std::min(ts, width - x);
+        int h = std::min(ts, height - y);
+        uint64_t hash = hashImageRegion(pixels + y * pitch + x * pixelSize, pitch, w * pixelSize, h);
+        if(keyframe || hash != ch->tileHashes[i])
+        {
+            ch->tileHashes[i] = hash;
+            changed.push_back(i);
+        }
+    }
+
+    int numChanged = changed.size();
+    out << ts << numChanged;
+
+    Ref<PixelData> tile;
+    foreach(int i, changed)
+    {
+        int x = (i % tilesX) * ts;
+        int y = (i / tilesX) * ts;
+        int w = std::min(ts, width - x);
+        int h = std::min(ts, height - y);
+        int rowSize = w * pixelSize;
+        byte* src = pixels + y * pitch + x * pixelSize;
+
+        out << i;
+        if(ch->encoding != ImageUtils::FormatNone)
+        {
+            // Copy the tile to its own pixel buffer and encode it.
+            if(tile == NULL || tile->getWidth() != w || tile->getHeight() != h)
+            {
+                tile = new PixelData(pd->getFormat(), w, h);
+            }
+            byte* dst = tile->map();
+            for(int r = 0; r < h; r++) memcpy(dst + r * rowSize, src + r * pitch, rowSize);
+            tile->unmap();
+
+            Ref<ByteArray> data = ImageUtils::encode(tile, ch->encoding, ch->quality);
+            out << data->getSize();
+            out.write(data->getData(), data->getSize());
+        }
+        else
+        {
+            size_t size = rowSize * h;
+            out << size;
+            for(int r = 0; r < h; r++) out.write(src + r * pitch, rowSize);
+        }
+    }
+    pd->unmap();
+
+    if(committing) myTilesSent->addSample(numChanged);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void ImageBroadcastModule::updateSharedData(SharedIStream& in)
 {
@@ -151,11 +499,19 @@ void ImageBroadcastModule::updateSharedData(SharedIStream& in)
         {
             //ofmsg("receiving %1%", %name);
             ImageUtils::ImageFormat fmt;
-            size_t size;
+            bool tiled;
             in >> fmt;
-            in >> size;
+            in >> tiled;
             oassert(fmt == ch->encoding);
-            
+
+            if(tiled)
+            {
+                updateTiles(ch, fmt, in);
+                continue;
+            }
+
+            size_t size;
+            in >> size;
             if(ch->encoding != ImageUtils::FormatNone)
             {
                 ByteArray a(size);
@@ -179,3 +535,71 @@ void ImageBroadcastModule::updateSharedData(SharedIStream& in)
     
     myDecodingTime->stopTiming();
 }
+
+////////////////////////////////////////////////////////////////////////////////
+void ImageBroadcastModule::updateTiles(Channel* ch, ImageUtils::ImageFormat fmt, SharedIStream& in)
+{
+    int ts;
+    int numTiles;
+    in >> ts >> numTiles;
+
+    PixelData* pd = ch->data;
+    int width = pd->getWidth();
+    int height = pd->getHeight();
+    int pitch = pd->getPitch();
+    int pixelSize = pd->getBpp() / 8;
+    int tilesX = (width + ts - 1) / ts;
+
+    // Patch received tiles into the channel pixel data.
+    byte* pixels = pd->map();
+    for(int t = 0; t < numTiles; t++)
+    {
+        int i;
+        size_t size;
+        in >> i >> size;
+
+        int x = (i % tilesX) * ts;
+        int y = (i / tilesX) * ts;
+        int w = std::min(ts, width - x);
+        int h = std::min(ts, height - y);
+        byte* dst = pixels + y * pitch + x * pixelSize;
+
+        if(fmt != ImageUtils::FormatNone)
+        {
+            ByteArray a(size);
+            in.read(a.getData(), size);
+            Ref<PixelData> tile = ImageUtils::decode(a.getData(), a.getSize());
+            if(tile == NULL || tile->getWidth() != w || tile->getHeight() != h) continue;
+
+            // Jpeg tiles are always decoded as rgb: convert formats if needed.
+            byte* src = tile->map();
+            int srcPixelSize = tile->getBpp() / 8;
+            int srcPitch = tile->getPitch();
+            for(int r = 0; r < h; r++)
+            {
+                byte* srcRow = src + r * srcPitch;
+                byte* dstRow = dst + r * pitch;
+                if(srcPixelSize == pixelSize)
+                {
+                    memcpy(dstRow, srcRow, w * pixelSize);
+                }
+                else
+                {
+                    int n = std::min(srcPixelSize, pixelSize);
+                    for(int c = 0; c < w; c++)
+                    {
+                        memcpy(dstRow + c * pixelSize, srcRow + c * srcPixelSize, n);
+                        if(pixelSize == 4 && srcPixelSize == 3) dstRow[c * 4 + 3] = 255;
+                    }
+                }
+            }
+            tile->unmap();
+        }
+        else
+        {
+            for(int r = 0; r < h; r++) in.read(dst + r * pitch, w * pixelSize);
+        }
+    }
+    pd->unmap();
+    pd->setDirty();
+}
@@ -52,6 +52,14 @@ UiRenderPass::UiRenderPass(Renderer* client, const String& name):
 {
 	StatsManager* sm = getClient()->getEngine()->getSystemManager()->getStatsManager();
 	myDrawTimeStat = sm->createStat("ui draw", StatsManager::Time);
+
+	// Batched ui drawing is opt-in: the immediate mode path is the default.
+	if(SystemManager::settingExists("config/ui"))
+	{
+		Setting& sUi = SystemManager::settingLookup("config/ui");
+		bool batching = Config::getBoolValue("batchingEnabled", sUi, false);
+		client->getRenderer()->setBatchingEnabled(batching);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -74,7 +82,10 @@ void UiRenderPass::render(Renderer* client, const DrawContext& context)
 		Renderable* uiRenderable = ui->getRenderable(client);
 		if(uiRenderable != NULL)
 		{
+			DrawInterface* di = client->getRenderer();
+			di->beginBatch();
 			uiRenderable->draw(context);
+			di->endBatch();
 		}
 
 		glPopAttrib();
@@ -101,7 +112,10 @@ void UiRenderPass::render(Renderer* client, const DrawContext& context)
 		Renderable* uiRenderable = myUiRoot->getRenderable(client);
 		if(uiRenderable != NULL)
 		{
+			DrawInterface* di = client->getRenderer();
+			di->beginBatch();
 			uiRenderable->draw(context);
+			di->endBatch();
 		}
 
 		glPopAttrib();
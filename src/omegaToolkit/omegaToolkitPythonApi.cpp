@@ -53,7 +53,7 @@ using namespace omegaToolkit::ui;
 #include <boost/python.hpp>
 using namespace boost::python;
 
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ImageBroadcastModule_addChannel, addChannel, 2, 4) 
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ImageBroadcastModule_addChannel, addChannel, 2, 5) 
 ///////////////////////////////////////////////////////////////////////////////
 BOOST_PYTHON_MODULE(omegaToolkit)
 {
@@ -61,6 +61,10 @@ BOOST_PYTHON_MODULE(omegaToolkit)
 		PYAPI_STATIC_REF_GETTER(ImageBroadcastModule, instance)
 		.def("addChannel", &ImageBroadcastModule::addChannel, ImageBroadcastModule_addChannel())
 		PYAPI_METHOD(ImageBroadcastModule, removeChannel)
+		PYAPI_METHOD(ImageBroadcastModule, setEncoderThreads)
+		PYAPI_METHOD(ImageBroadcastModule, getEncoderThreads)
+		PYAPI_METHOD(ImageBroadcastModule, setMaxEncoderLatency)
+		PYAPI_METHOD(ImageBroadcastModule, getMaxEncoderLatency)
 		;
 
 	// Container
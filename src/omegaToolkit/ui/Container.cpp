@@ -40,6 +40,8 @@
 
 #include "omegaGl.h"
 
+#include <float.h>
+
 using namespace omega;
 using namespace omegaToolkit;
 using namespace omegaToolkit::ui;
@@ -63,7 +65,10 @@ Container::Container(Engine* server):
         myGridRows(1),
         myGridColumns(1),
         myClipping(false),
-        myPixelOutputEnabled(false)
+        myPixelOutputEnabled(false),
+        myHitIndexValid(false),
+        myHitGridColumns(0),
+        myHitGridRows(0)
 {
     // Containers have autosize enabled by default.
     setAutosize(true);
@@ -150,6 +155,12 @@ void Container::addChild(Widget* child)
 {
     requestLayoutRefresh();
     myChildren.push_back(child);
+    myChildIndex.push_back(child);
+    if(myChildNames.find(child->getName()) == myChildNames.end())
+    {
+        myChildNames[child->getName()] = child;
+    }
+    invalidateHitIndex();
     child->setContainer(this);
     if(child->isNavigationEnabled()) updateChildrenNavigation();
 }
@@ -159,6 +170,12 @@ void Container::removeChild(Widget* child)
 {
     requestLayoutRefresh();
     myChildren.remove(child);
+    for(int i = 0; i < myChildIndex.size(); i++)
+    {
+        if(myChildIndex[i] == child) myChildIndex.erase(myChildIndex.begin() + i--);
+    }
+    refreshChildName(child->getName());
+    invalidateHitIndex();
     child->setContainer(NULL);
     if(child->isNavigationEnabled())  updateChildrenNavigation();
 }
@@ -166,11 +183,32 @@ void Container::removeChild(Widget* child)
 ///////////////////////////////////////////////////////////////////////////////
 Widget* Container::getChildByName(const String& name)
 {
+    Dictionary<String, Widget*>::iterator it = myChildNames.find(name);
+    if(it != myChildNames.end()) return it->second;
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Container::updateChildName(const String& oldName, const String& newName)
+{
+    refreshChildName(oldName);
+    refreshChildName(newName);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Container::refreshChildName(const String& name)
+{
+    // Renames and removals are rare: just look for the first child with this
+    // name again.
     foreach(Widget* w, myChildren)
     {
-        if(w->getName() == name) return w;
+        if(w->getName() == name)
+        {
+            myChildNames[name] = w;
+            return;
+        }
     }
-    return NULL;
+    myChildNames.erase(name);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -206,15 +244,7 @@ Widget* Container::getChildAfter(const Widget* child)
 ///////////////////////////////////////////////////////////////////////////////
 Widget* Container::getChildByIndex(int index)
 {
-    if(getNumChildren() > index)
-    {
-        int i = 0;
-        foreach(Widget* w, myChildren)
-        {
-            if(i == index) return w;
-            i++;
-        }
-    }
+    if(index >= 0 && getNumChildren() > index) return myChildIndex[index];
     return NULL;
 }
 
@@ -287,12 +317,31 @@ void Container::autosize()
 ///////////////////////////////////////////////////////////////////////////////
 void Container::updateChildrenNavigation()
 {
+    // Collect navigable children first, so links can be set up in one pass
+    // instead of searching the child list for each widget.
+    Vector<Widget*> navChildren;
+    foreach(Widget* w, myChildren)
+    {
+        if(w->isNavigationEnabled()) navChildren.push_back(w);
+    }
+
+    int navIndex = 0;
     foreach(Widget* w, myChildren)
     {
+        // Widgets with navigation disabled get no links.
+        Widget* next = NULL;
+        Widget* prev = NULL;
+        if(navIndex < navChildren.size() && navChildren[navIndex] == w)
+        {
+            if(navIndex > 0) prev = navChildren[navIndex - 1];
+            if(navIndex < navChildren.size() - 1) next = navChildren[navIndex + 1];
+            navIndex++;
+        }
+
         if(myLayout == LayoutHorizontal)
         {
-            w->setHorizontalNextWidget(getChildAfter(w));
-            w->setHorizontalPrevWidget(getChildBefore(w));
+            w->setHorizontalNextWidget(next);
+            w->setHorizontalPrevWidget(prev);
             //Container* parent = getContainer();
             //if(parent != NULL)
             //{
@@ -302,8 +351,8 @@ void Container::updateChildrenNavigation()
         }
         else
         {
-            w->setVerticalNextWidget(getChildAfter(w));
-            w->setVerticalPrevWidget(getChildBefore(w));
+            w->setVerticalNextWidget(next);
+            w->setVerticalPrevWidget(prev);
             Container* parent = getContainer();
             //if(parent != NULL)
             //{
@@ -315,16 +364,19 @@ void Container::updateChildrenNavigation()
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-int Container::expandStep(int availableSpace, Orientation orientation)
+int Container::expandStep(int availableSpace, Orientation orientation, bool& outChanged)
 {
     // Check space constraints for each child
     int childSpace = availableSpace / getNumChildren();
     int spaceLeft = availableSpace;
 
+    outChanged = false;
     foreach(Widget* w, myChildren)
     {
-        int size = w->getSize()[orientation] + childSpace;
+        float prevSize = w->getSize()[orientation];
+        int size = prevSize + childSpace;
         w->setActualSize(size, orientation);
+        if(w->getSize()[orientation] != prevSize) outChanged = true;
         spaceLeft -= (orientation == Horizontal ? w->getWidth(): w->getHeight());
     }
     return spaceLeft;
@@ -421,9 +473,15 @@ void Container::computeLinearLayout(Orientation orientation)
     int availableSpace = getSize()[orientation] - myPadding * 2 - (nc - 1) * myMargin;
 
     resetChildrenSize(orientation);
-    while(availableSpace > 0)
+    // Each step reduces the available space by the total children size. 
+    // Once a step leaves all children sizes unchanged (children are at their
+    // maximum size, or the space is less than a pixel per child) no further
+    // step can change them, so stop instead of consuming the remaining space
+    // one step at a time.
+    bool changed = true;
+    while(availableSpace > 0 && changed)
     {
-        availableSpace = expandStep(availableSpace, orientation) - 1;
+        availableSpace = expandStep(availableSpace, orientation, changed) - 1;
     }
     updateChildrenLayoutPosition(orientation);
     updateChildrenFreeBounds(oppositeOrientation);
@@ -478,10 +536,16 @@ void Container::computeGridLayout(Orientation orientation)
 ///////////////////////////////////////////////////////////////////////////////
 void Container::layout()
 {
-    if(getNumChildren() != 0)
+    if(needLayoutRefresh())
     {
-        if(needLayoutRefresh())
+        if(getNumChildren() != 0)
         {
+            // Remember children sizes, so we can tell which children have
+            // been resized by this layout.
+            Vector<Vector2f> childSizes;
+            childSizes.reserve(getNumChildren());
+            foreach(Widget* w, myChildren) childSizes.push_back(w->getSize());
+
             if(myLayout == LayoutHorizontal)
             {
                 computeLinearLayout(Horizontal);
@@ -499,14 +563,20 @@ void Container::layout()
                 computeGridLayout(Vertical);
             }
 
-            // Layout children.
+            // Layout children. Only children that requested a layout refresh
+            // or that have been resized need to lay out their content again.
+            int i = 0;
             foreach(Widget* w, myChildren)
             {
-                w->layout();
+                if(w->getSize() != childSizes[i++]) w->myNeedLayoutRefresh = true;
+                if(w->needLayoutRefresh()) w->layout();
             }
-
-            Widget::layout();
         }
+        // Children may have moved: rebuild the hit index on the next event.
+        invalidateHitIndex();
+        // NOTE: empty containers need to clear their refresh flag too, or
+        // they would stay dirty forever.
+        Widget::layout();
     }
 }
 
@@ -647,10 +717,7 @@ void Container::handleEvent(const Event& evt)
             Event newEvt;
             if(rayToPointerEvent(evt, newEvt))
             {
-                foreach(Widget* w, myChildren)
-                {
-                    w->handleEvent(newEvt);
-                }
+                dispatchPointerEvent(newEvt);
             }
             // Copy back processe flag into original event.
             if(newEvt.isProcessed()) evt.setProcessed();
@@ -659,11 +726,7 @@ void Container::handleEvent(const Event& evt)
         {
             if(isPointerInteractionEnabled())
             {
-                // For pointer interaction, just dispatch the event to all children
-                foreach(Widget* w, myChildren)
-                {
-                    w->handleEvent(evt);
-                }
+                dispatchPointerEvent(evt);
             }
         }
         // If this container is draggable, let the widget base class handle
@@ -672,6 +735,148 @@ void Container::handleEvent(const Event& evt)
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void Container::dispatchPointerEvent(const Event& evt)
+{
+    // Only pointer moves are culled using the hit index: other events (like 
+    // button releases) may change the state of widgets that are not under the
+    // pointer, so they are dispatched to all children. While a layout refresh
+    // is pending child bounds may be out of date, so we do the same.
+    if((evt.getType() != Event::Move && evt.getType() != Event::Update) ||
+        needLayoutRefresh())
+    {
+        foreach(Widget* w, myChildren)
+        {
+            w->handleEvent(evt);
+        }
+        return;
+    }
+
+    if(!myHitIndexValid) updateHitIndex();
+
+    // Find the grid cell containing the event, in the same coordinate space
+    // children use for hit testing.
+    Vector2f point = transformPoint(
+        Vector2f(evt.getPosition().x(), evt.getPosition().y()));
+    const Vector<int>* cell = NULL;
+    if(myHitGridColumns > 0)
+    {
+        int cx = (int)floor((point[0] - myHitGridMin[0]) / myHitCellSize[0]);
+        int cy = (int)floor((point[1] - myHitGridMin[1]) / myHitCellSize[1]);
+        if(cx >= 0 && cx < myHitGridColumns && cy >= 0 && cy < myHitGridRows)
+        {
+            cell = &myHitCells[cy * myHitGridColumns + cx];
+        }
+    }
+
+    // Merge the cell list with the always-dispatched list. Both are sorted by
+    // child index, so children still get the event in their original order.
+    // Candidates are collected first since event handlers may change the 
+    // children of this container.
+    Vector<Widget*> candidates;
+    int numCell = (cell != NULL ? cell->size() : 0);
+    int numAlways = myHitAlwaysList.size();
+    int a = 0;
+    int c = 0;
+    while(a < numAlways || c < numCell)
+    {
+        if(c == numCell || (a < numAlways && myHitAlwaysList[a] < (*cell)[c]))
+        {
+            candidates.push_back(myChildIndex[myHitAlwaysList[a++]]);
+        }
+        else
+        {
+            candidates.push_back(myChildIndex[(*cell)[c++]]);
+        }
+    }
+
+    foreach(Widget* w, candidates)
+    {
+        w->handleEvent(evt);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Container::updateHitIndex()
+{
+    static const int MaxGridSize = 64;
+
+    myHitIndexValid = true;
+    myHitAlwaysList.clear();
+    myHitCells.clear();
+    myHitGridColumns = 0;
+    myHitGridRows = 0;
+
+    // Compute child bounds in container coordinates. This is the inverse of
+    // the transform applied by Widget::transformPoint. Bounds are padded by
+    // one pixel to stay conservative with respect to rounding.
+    Vector<int> indexed;
+    Vector<Vector2f> boundsMin;
+    Vector<Vector2f> boundsMax;
+    Vector2f gridMin(FLT_MAX, FLT_MAX);
+    Vector2f gridMax(-FLT_MAX, -FLT_MAX);
+    for(int i = 0; i < myChildIndex.size(); i++)
+    {
+        Widget* w = myChildIndex[i];
+        float scale = w->getScale();
+        // Containers do their own culling and may have content outside their
+        // bounds (or be drawn in 3d), rotated widgets use a different hit 
+        // test, and dragged widgets follow the pointer anywhere.
+        if(dynamic_cast<Container*>(w) != NULL || w->getRotation() != 0 ||
+            scale <= 0 || w->myDragging)
+        {
+            myHitAlwaysList.push_back(i);
+        }
+        else
+        {
+            const Vector2f& pos = w->getPosition();
+            const Vector2f& size = w->getSize();
+            Vector2f bmin = pos + size * (1 - scale) * 0.5f;
+            Vector2f bmax = bmin + size * scale;
+            bmin -= Vector2f(1, 1);
+            bmax += Vector2f(1, 1);
+
+            indexed.push_back(i);
+            boundsMin.push_back(bmin);
+            boundsMax.push_back(bmax);
+            gridMin = gridMin.cwiseMin(bmin);
+            gridMax = gridMax.cwiseMax(bmax);
+        }
+    }
+
+    if(indexed.empty()) return;
+
+    // Use about one cell per child, up to a maximum grid size.
+    int gridSize = (int)sqrt((float)indexed.size());
+    if(gridSize < 1) gridSize = 1;
+    if(gridSize > MaxGridSize) gridSize = MaxGridSize;
+    myHitGridColumns = gridSize;
+    myHitGridRows = gridSize;
+    myHitGridMin = gridMin;
+    myHitCellSize = (gridMax - gridMin) / gridSize;
+    myHitCells.resize(myHitGridColumns * myHitGridRows);
+
+    // Children are added in order, so cell lists stay sorted by child index.
+    for(int i = 0; i < indexed.size(); i++)
+    {
+        int x1 = (int)((boundsMin[i][0] - gridMin[0]) / myHitCellSize[0]);
+        int y1 = (int)((boundsMin[i][1] - gridMin[1]) / myHitCellSize[1]);
+        int x2 = (int)((boundsMax[i][0] - gridMin[0]) / myHitCellSize[0]);
+        int y2 = (int)((boundsMax[i][1] - gridMin[1]) / myHitCellSize[1]);
+        if(x1 >= myHitGridColumns) x1 = myHitGridColumns - 1;
+        if(y1 >= myHitGridRows) y1 = myHitGridRows - 1;
+        if(x2 >= myHitGridColumns) x2 = myHitGridColumns - 1;
+        if(y2 >= myHitGridRows) y2 = myHitGridRows - 1;
+        for(int y = y1; y <= y2; y++)
+        {
+            for(int x = x1; x <= x2; x++)
+            {
+                myHitCells[y * myHitGridColumns + x].push_back(indexed[i]);
+            }
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void Container::activate()
 {
@@ -751,6 +956,7 @@ void ContainerRenderable::draw3d(const DrawContext& context)
 {
     if(myTexture != NULL)
     {
+        getRenderer()->flush();
         glPushAttrib(GL_ENABLE_BIT);
         glDisable(GL_COLOR_MATERIAL);
         glDisable(GL_LIGHTING);
@@ -864,6 +1070,9 @@ void ContainerRenderable::beginDraw(const DrawContext& context)
             pixels->setDirty(true);
         }
 
+        // We are about to switch render target and projection: draw 
+        // pending batched primitives first.
+        getRenderer()->flush();
         glPushAttrib(GL_VIEWPORT_BIT);
         glViewport(0, 0, myOwner->getWidth(), myOwner->getHeight());
                 
@@ -901,6 +1110,7 @@ void ContainerRenderable::beginDraw(const DrawContext& context)
             float width = this->myOwner->getWidth();
             float height = this->myOwner->getHeight();
 
+            getRenderer()->flush();
             glPushAttrib(GL_ENABLE_BIT);
             glPushAttrib(GL_STENCIL_BUFFER_BIT);
 
@@ -935,6 +1145,7 @@ void ContainerRenderable::endDraw(const DrawContext& context)
 {
     if(myOwner->get3dSettings().enable3d || myOwner->isPixelOutputEnabled())
     {
+        getRenderer()->flush();
         glMatrixMode(GL_PROJECTION);
         glPopMatrix();
         glMatrixMode(GL_MODELVIEW);
@@ -951,6 +1162,7 @@ void ContainerRenderable::endDraw(const DrawContext& context)
         // end stencil buffer for clipping
         if(myOwner->isClippingEnabled())
         {
+            getRenderer()->flush();
             glPopAttrib();
             glPopAttrib();
         }
@@ -123,7 +123,9 @@ void ImageRenderable::drawContent(const DrawContext& context)
 		di->fillTexture(tex);
 		di->textureRegion(0, 0, 1, 1);
 
-		if(myTextureUniform != 0)
+		// When batching the program is not bound yet. Sampler uniforms 
+		// default to texture unit 0, so we can skip this.
+		if(myTextureUniform != 0 && !di->isBatching())
 		{
 			glUniform1i(myTextureUniform, 0);
 		}
@@ -197,8 +197,10 @@ void LabelRenderable::drawContent(const DrawContext& context)
 
 	if(myFont)
 	{
-		// Set the texture uniform used by label
-		if(myTextureUniform != 0)
+		// Set the texture uniform used by label. When batching the program 
+		// is not bound yet: sampler uniforms default to texture unit 0, so 
+		// we can skip this.
+		if(myTextureUniform != 0 && !getRenderer()->isBatching())
 		{
 			glUniform1i(myTextureUniform, 0);
 		}
@@ -285,6 +285,9 @@ void Widget::handleEvent(const Event& evt)
                         evt.setProcessed();
                         myDragging = true;
                         myActive = true;
+                        // Dragged widgets receive pointer moves even when the
+                        // pointer is outside of them.
+                        invalidateContainerHitIndex();
                     }
                 }
             }
@@ -407,6 +410,20 @@ void Widget::requestLayoutRefresh()
         myContainer->requestLayoutRefresh(); 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void Widget::invalidateContainerHitIndex()
+{
+    if(myContainer != NULL) myContainer->invalidateHitIndex();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Widget::setName(const String& name)
+{
+    String oldName = myName;
+    myName = name;
+    if(myContainer != NULL) myContainer->updateChildName(oldName, name);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 bool Widget::needLayoutRefresh() 
 { 
@@ -602,10 +619,10 @@ void WidgetRenderable::postDraw()
 ///////////////////////////////////////////////////////////////////////////////
 void WidgetRenderable::pushDrawAttributes()
 {
+    DrawInterface* di = getRenderer();
     if(myShaderProgram != 0)
     {
-        glUseProgram(myShaderProgram);
-        glUniform1f(myAlphaUniform, myOwner->getAlpha());
+        di->useProgram(myShaderProgram, myAlphaUniform, myOwner->getAlpha());
     }
     // Set default color to white.
     glColor4ub(255,255,255,255);
@@ -613,6 +630,9 @@ void WidgetRenderable::pushDrawAttributes()
     Widget::BlendMode bm = myOwner->getBlendMode();
     if(bm != Widget::BlendInherit)
     {
+        // Blend state is not part of the batch state: draw pending 
+        // primitives before changing it.
+        di->flush();
         glPushAttrib(GL_ENABLE_BIT);
         if(bm == Widget::BlendDisabled)
         {
@@ -636,12 +656,14 @@ void WidgetRenderable::pushDrawAttributes()
 ///////////////////////////////////////////////////////////////////////////////
 void WidgetRenderable::popDrawAttributes()
 {
+    DrawInterface* di = getRenderer();
     if(myShaderProgram != 0)
     {
-        glUseProgram(0);
+        di->useProgram(0);
     }
     if(myOwner->getBlendMode() != Widget::BlendInherit)
     {
+        di->flush();
         glDisable(GL_BLEND);
         glPopAttrib();
     }
@@ -681,37 +703,23 @@ void WidgetRenderable::drawContent(const DrawContext& context)
     {
         di->drawRect(Vector2f::Zero(), myOwner->mySize, myOwner->myFillColor);
     }
-    if(myOwner->myBorders[0].width != 0)
+    const Vector2f& size = myOwner->mySize;
+    const Widget::BorderStyle* borders = myOwner->myBorders;
+    if(borders[0].width != 0)
     {
-        glLineWidth(myOwner->myBorders[0].width);
-        glColor4fv(myOwner->myBorders[0].color.data());
-        glBegin(GL_LINES);
-        glVertex2f(0, 0); glVertex2f(myOwner->mySize[0], 0);
-        glEnd();
+        di->drawLine(Vector2f(0, 0), Vector2f(size[0], 0), borders[0].color, borders[0].width);
     }
-    if(myOwner->myBorders[1].width != 0)
+    if(borders[1].width != 0)
     {
-        glLineWidth(myOwner->myBorders[1].width);
-        glColor4fv(myOwner->myBorders[1].color.data());
-        glBegin(GL_LINES);
-        glVertex2f(myOwner->mySize[0], 0); glVertex2f(myOwner->mySize[0], myOwner->mySize[1]);
-        glEnd();
+        di->drawLine(Vector2f(size[0], 0), size, borders[1].color, borders[1].width);
     }
-    if(myOwner->myBorders[2].width != 0)
+    if(borders[2].width != 0)
     {
-        glLineWidth(myOwner->myBorders[2].width);
-        glColor4fv(myOwner->myBorders[2].color.data());
-        glBegin(GL_LINES);
-        glVertex2f(myOwner->mySize[0], myOwner->mySize[1]); glVertex2f(0, myOwner->mySize[1]);
-        glEnd();
+        di->drawLine(size, Vector2f(0, size[1]), borders[2].color, borders[2].width);
     }
-    if(myOwner->myBorders[3].width != 0)
+    if(borders[3].width != 0)
     {
-        glLineWidth(myOwner->myBorders[3].width);
-        glColor4fv(myOwner->myBorders[3].color.data());
-        glBegin(GL_LINES);
-        glVertex2f(0, myOwner->mySize[1]); glVertex2f(0, 0);
-        glEnd();
+        di->drawLine(Vector2f(0, size[1]), Vector2f(0, 0), borders[3].color, borders[3].width);
     }
     if(myOwner->myDebugModeEnabled)
     {
@@ -0,0 +1,109 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Component scheduler benchmark: times frames of CPU-heavy thread-safe 
+ *	component updates, serially and on the job system. Pass the number of
+ *	components, worker threads and batch size on the command line (default:
+ *	2000 components, 4 threads, batch size 4).
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/ComponentScheduler.h"
+#include "omega/NodeComponent.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// A thread-safe component doing a fixed amount of math on each update.
+class WorkComponent: public NodeComponent
+{
+public:
+	WorkComponent(): myValue(1) {}
+	virtual void update(const UpdateContext& context)
+	{
+		for(int i = 0; i < 5000; i++) myValue = sqrt(myValue * myValue + (float)i) * 0.5f;
+	}
+	virtual bool isThreadSafe() { return true; }
+	virtual bool isInitialized() { return true; }
+	virtual void initialize(Engine* server) {}
+
+private:
+	float myValue;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+double timeFrames(ComponentScheduler& cs, Vector< Ref<WorkComponent> >& components, int numFrames)
+{
+	Timer timer;
+	timer.start();
+	for(int f = 0; f < numFrames; f++)
+	{
+		UpdateContext context;
+		context.frameNum = f;
+		context.time = f * 0.016f;
+		context.dt = 0.016f;
+		cs.begin(context);
+		foreach(WorkComponent* c, components) cs.update(c, context);
+		cs.end();
+	}
+	return timer.getElapsedTimeInMilliSec() / numFrames;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	int numComponents = argc > 1 ? atoi(argv[1]) : 2000;
+	int numThreads = argc > 2 ? atoi(argv[2]) : 4;
+	int batchSize = argc > 3 ? atoi(argv[3]) : 4;
+	int numFrames = 50;
+
+	Vector< Ref<WorkComponent> > components;
+	for(int i = 0; i < numComponents; i++) components.push_back(new WorkComponent());
+
+	JobSystem js;
+	js.setThreads(numThreads);
+	ComponentScheduler cs;
+	cs.setJobSystem(&js);
+	cs.setBatchSize(batchSize);
+
+	cs.setParallelUpdateEnabled(false);
+	double serialTime = timeFrames(cs, components, numFrames);
+	cs.setParallelUpdateEnabled(true);
+	double parallelTime = timeFrames(cs, components, numFrames);
+
+	printf("%d components, %d cores\n", numComponents, JobSystem::getNumCores());
+	printf("serial:                %8.2f ms per frame\n", serialTime);
+	printf("%d threads, batch %d:   %8.2f ms per frame (%.2fx)\n", 
+		numThreads, batchSize, parallelTime, serialTime / parallelTime);
+	return 0;
+}
@@ -0,0 +1,102 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Headless text layout benchmark: lays out the strings of a stats overlay
+ *	every frame, with and without the font glyph run cache. A few strings 
+ *	change every frame, like stat values do. Pass the number of strings and
+ *	how many of them change per frame on the command line (default: 200 
+ *	strings, 20 changing).
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/Font.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the text of a string in a frame. The first numChanging strings 
+// change every frame.
+String frameText(int i, int frame, int numChanging)
+{
+	if(i < numChanging) return ostr("stat %1%: %2% ms", %i %((frame * 7 + i) % 1000));
+	return ostr("Label number %1%", %i);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Lays out every string of every frame. When cached is false, each frame 
+// uses a new font, so runs are laid out again (glyphs stay in the atlas).
+double timeFrames(GlyphAtlas* atlas, GlyphAtlas::Face* face, int numStrings, int numChanging, int numFrames, bool cached)
+{
+	Ref<Font> font = new Font(atlas, face);
+	Timer timer;
+	timer.start();
+	double size = 0;
+	atlas->lock();
+	for(int f = 0; f < numFrames; f++)
+	{
+		if(!cached) font = new Font(atlas, face);
+		for(int i = 0; i < numStrings; i++)
+		{
+			size += font->getGlyphRun(frameText(i, f, numChanging)).size[0];
+		}
+	}
+	atlas->unlock();
+	double t = timer.getElapsedTimeInMilliSec() / numFrames;
+	// Use the result, so layout is not optimized away.
+	if(size < 0) printf("%f\n", size);
+	return t;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	int numStrings = argc > 1 ? atoi(argv[1]) : 200;
+	int numChanging = argc > 2 ? atoi(argv[2]) : 20;
+	int numFrames = 500;
+
+	Ref<GlyphAtlas> atlas = new GlyphAtlas();
+	GlyphAtlas::Face* face = atlas->loadFace(OTEST_FONT_PATH, 16);
+	if(face == NULL) return 1;
+
+	// Warm up the atlas, so both runs find all glyphs rasterized.
+	timeFrames(atlas, face, numStrings, numChanging, 10, false);
+
+	double uncachedTime = timeFrames(atlas, face, numStrings, numChanging, numFrames, false);
+	double cachedTime = timeFrames(atlas, face, numStrings, numChanging, numFrames, true);
+
+	printf("%d strings, %d changing per frame\n", numStrings, numChanging);
+	printf("layout every frame:  %8.3f ms per frame\n", uncachedTime);
+	printf("cached runs:         %8.3f ms per frame (%.2fx)\n", 
+		cachedTime, uncachedTime / cachedTime);
+	return 0;
+}
@@ -0,0 +1,114 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Image broadcast benchmark: commits frames where every channel changed, 
+ *	without any rendering or networking, and reports the commit time per 
+ *	frame. Pass the number of channels, encoder threads and maximum encoder
+ *	latency on the command line (default: 8 channels, 4 threads, latency 1).
+ ******************************************************************************/
+#include <omega.h>
+#include <omegaToolkit.h>
+#include "omegaToolkit/ImageBroadcastModule.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Fills an image with a moving gradient, so every frame has new content.
+void drawFrame(PixelData* pd, int channel, int frame)
+{
+	byte* p = pd->map();
+	int pitch = pd->getPitch();
+	for(int y = 0; y < pd->getHeight(); y++)
+	{
+		for(int x = 0; x < pd->getWidth(); x++)
+		{
+			byte* px = p + y * pitch + x * 3;
+			px[0] = (x + frame) & 255;
+			px[1] = (y + frame * 2) & 255;
+			px[2] = (x + y + channel * 32) & 255;
+		}
+	}
+	pd->unmap();
+	pd->setDirty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	int numChannels = argc > 1 ? atoi(argv[1]) : 8;
+	int numThreads = argc > 2 ? atoi(argv[2]) : 4;
+	int latency = argc > 3 ? atoi(argv[3]) : 1;
+	int numFrames = 100;
+
+	ImageUtils::internalInitialize();
+
+	Ref<ImageBroadcastModule> ibm = new ImageBroadcastModule();
+	ibm->setEncoderThreads(numThreads);
+	ibm->setMaxEncoderLatency(latency);
+
+	Vector< Ref<PixelData> > images;
+	for(int i = 0; i < numChannels; i++)
+	{
+		images.push_back(new PixelData(PixelData::FormatRgb, 1024, 768));
+		ibm->addChannel(images[i], ostr("channel%1%", %i));
+	}
+
+	Timer timer;
+	double totalTime = 0;
+	double maxTime = 0;
+	uint64_t totalBytes = 0;
+	Vector<byte> frame;
+	for(int f = 0; f < numFrames; f++)
+	{
+		for(int i = 0; i < numChannels; i++) drawFrame(images[i], i, f);
+
+		frame.clear();
+		SharedOStream out(&frame);
+		timer.start();
+		ibm->commitSharedData(out);
+		double time = timer.getElapsedTimeInMilliSec();
+		totalTime += time;
+		maxTime = std::max(maxTime, time);
+		totalBytes += frame.size();
+	}
+
+	printf("%d channels, 1024x768 jpeg, %d encoder threads, latency %d\n", 
+		numChannels, numThreads, latency);
+	printf("commit:  %8.2f ms average, %8.2f ms max\n", totalTime / numFrames, maxTime);
+	printf("sent:    %8.2f KB per frame\n", totalBytes / 1024.0 / numFrames);
+
+	ibm = NULL;
+	ImageUtils::internalDispose();
+	return 0;
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Image loader benchmark: times loading a set of png files synchronously, 
+ *	and through the asynchronous loader threads. Pass the number of loader
+ *	threads and images on the command line (default: 4 threads, 64 images).
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+void writeTestImage(const String& path, int width, int height)
+{
+	Ref<PixelData> pixels = new PixelData(PixelData::FormatRgba, width, height);
+	byte* p = pixels->map();
+	for(int i = 0; i < pixels->getSize(); i++) p[i] = (i / 4 + i / 512) % 256;
+	pixels->unmap();
+
+	Ref<ByteArray> png = ImageUtils::encode(pixels, ImageUtils::FormatPng);
+	FILE* f = fopen(path.c_str(), "wb");
+	fwrite(png->getData(), 1, png->getSize(), f);
+	fclose(f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+	int numImages = argc > 2 ? atoi(argv[2]) : 64;
+
+	ImageUtils::internalInitialize();
+	ImageUtils::setImageLoaderThreads(numThreads);
+
+	Vector<String> paths;
+	for(int i = 0; i < numImages; i++)
+	{
+		paths.push_back(ostr("benchImageLoader_%1%.png", %i));
+		writeTestImage(paths[i], 512, 512);
+	}
+
+	Timer timer;
+	timer.start();
+	foreach(String p, paths) ImageUtils::loadImage(p, true);
+	double syncTime = timer.getElapsedTimeInMilliSec();
+
+	timer.start();
+	Vector< Ref<ImageUtils::LoadImageAsyncTask> > tasks;
+	foreach(String p, paths) tasks.push_back(ImageUtils::loadImageAsync(p, true));
+	foreach(ImageUtils::LoadImageAsyncTask* t, tasks) while(!t->isComplete()) osleep(0);
+	double asyncTime = timer.getElapsedTimeInMilliSec();
+
+	printf("%d images, 512x512\n", numImages);
+	printf("synchronous:  %8.2f ms (%.1f images/s)\n", syncTime, numImages * 1000.0 / syncTime);
+	printf("%d threads:    %8.2f ms (%.1f images/s)\n", numThreads, asyncTime, numImages * 1000.0 / asyncTime);
+
+	ImageUtils::internalDispose();
+	foreach(String p, paths) remove(p.c_str());
+	return 0;
+}
@@ -0,0 +1,153 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	ImagePyramid request trace benchmark: replays a zoom and pan trace over a
+ *	synthetic pyramid and times getTiles, without any rendering. Reports the
+ *	request cost per frame and how many frames had to draw coarser tiles 
+ *	while finer ones loaded. Pass the number of frames and loader threads on 
+ *	the command line (default: 600 frames, 4 threads).
+ ******************************************************************************/
+#include <omega.h>
+#include <sys/stat.h>
+#ifdef OMEGA_OS_WIN
+	#include <direct.h>
+	#define makeDir(path) _mkdir(path)
+	#define removeDir(path) _rmdir(path)
+#else
+	#include <unistd.h>
+	#define makeDir(path) mkdir(path, 0755)
+	#define removeDir(path) rmdir(path)
+#endif
+
+#include "otest.h"
+
+using namespace omega;
+
+static const int sImageSize = 4096;
+static const int sTileSize = 256;
+static const char* sTilePath = "benchImagePyramid_files";
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	int numFrames = argc > 1 ? atoi(argv[1]) : 600;
+	int numThreads = argc > 2 ? atoi(argv[2]) : 4;
+
+	ImageUtils::internalInitialize();
+	ImageUtils::setImageLoaderThreads(numThreads);
+
+	Ref<ImagePyramid> pyramid = new ImagePyramid();
+	pyramid->initialize(sTilePath, sImageSize, sImageSize, sTileSize, 0, "png");
+
+	// Write the levels the trace can reach: from the single tile base level
+	// to full resolution.
+	Vector<String> files;
+	Vector<String> dirs;
+	makeDir(sTilePath);
+	int maxLevel = pyramid->getNumLevels() - 1;
+	int baseLevel = maxLevel - 4;
+	Ref<PixelData> pixels = new PixelData(PixelData::FormatRgb, sTileSize, sTileSize);
+	memset(pixels->map(), 128, pixels->getSize());
+	pixels->unmap();
+	Ref<ByteArray> png = ImageUtils::encode(pixels, ImageUtils::FormatPng);
+	for(int level = baseLevel; level <= maxLevel; level++)
+	{
+		dirs.push_back(ostr("%1%/%2%", %sTilePath %level));
+		makeDir(dirs.back().c_str());
+		Vector2i tiles = pyramid->getLevelTiles(level);
+		for(int row = 0; row < tiles[1]; row++)
+		{
+			for(int col = 0; col < tiles[0]; col++)
+			{
+				files.push_back(pyramid->getTilePath(level, col, row));
+				FILE* f = fopen(files.back().c_str(), "wb");
+				fwrite(png->getData(), 1, png->getSize(), f);
+				fclose(f);
+			}
+		}
+	}
+
+	// The view zooms from the full image to 1/16th of it and back, while
+	// circling around the image center. Frames are paced at 60Hz.
+	Vector2i screen(1920, 1080);
+	Timer timer;
+	double totalTime = 0;
+	double maxTime = 0;
+	int totalTiles = 0;
+	int fallbackFrames = 0;
+	ImagePyramid::TileList tiles;
+	for(int i = 0; i < numFrames; i++)
+	{
+		float t = (float)i / numFrames;
+		float zoom = 1.0f + 15.0f * (0.5f - 0.5f * cos(t * 4 * Math::Pi));
+		int w = (int)(sImageSize / zoom);
+		int h = w * screen[1] / screen[0];
+		int cx = sImageSize / 2 + (int)(sImageSize / 4 * cos(t * 2 * Math::Pi));
+		int cy = sImageSize / 2 + (int)(sImageSize / 4 * sin(t * 2 * Math::Pi));
+		int x = std::max(0, std::min(sImageSize - w, cx - w / 2));
+		int y = std::max(0, std::min(sImageSize - h, cy - h / 2));
+		Rect region(x, y, w, h);
+
+		tiles.clear();
+		timer.start();
+		pyramid->getTiles(region, screen, tiles);
+		double time = timer.getElapsedTimeInMilliSec();
+		totalTime += time;
+		maxTime = std::max(maxTime, time);
+		totalTiles += tiles.size();
+
+		int level = pyramid->getLevelForView(region, screen);
+		foreach(const ImagePyramid::Tile& tile, tiles)
+		{
+			if(tile.level != level) 
+			{
+				fallbackFrames++;
+				break;
+			}
+		}
+		osleep(16);
+	}
+
+	printf("%d frames, %dx%d image, %d pixel tiles, %d loader threads\n", 
+		numFrames, sImageSize, sImageSize, sTileSize, numThreads);
+	printf("getTiles:        %8.4f ms average, %8.4f ms max\n", totalTime / numFrames, maxTime);
+	printf("tiles per frame: %8.2f\n", (float)totalTiles / numFrames);
+	printf("fallback frames: %8d (%.1f%%)\n", fallbackFrames, fallbackFrames * 100.0f / numFrames);
+	printf("tile memory:     %8.2f MB\n", pyramid->getCacheMemoryUsage() / (1024.0f * 1024.0f));
+
+	pyramid = NULL;
+	ImageUtils::internalDispose();
+	foreach(String f, files) remove(f.c_str());
+	foreach(String d, dirs) removeDir(d.c_str());
+	removeDir(sTilePath);
+	return 0;
+}
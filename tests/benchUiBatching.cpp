@@ -0,0 +1,173 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Ui draw call benchmark: draws a synthetic widget-heavy ui with immediate
+ *	mode drawing and then with batching, and reports the draw calls 
+ *	(DrawInterface::getNumBatches), primitives and frame time of each mode.
+ *	This is an application: it needs a display and the default system 
+ *	config. Pass the number of grid rows and columns on the command line 
+ *	(default: 20x20 cells, each with a label, a button and a slider).
+ ******************************************************************************/
+#include <omega.h>
+#include <omegaToolkit.h>
+
+using namespace omega;
+using namespace omegaToolkit;
+using namespace omegaToolkit::ui;
+
+// Frames drawn after switching mode, before we start measuring. Stats are
+// read on the update thread, one frame after they are collected.
+const int SettleFrames = 10;
+const int MeasuredFrames = 200;
+
+int sRows = 20;
+int sColumns = 20;
+
+///////////////////////////////////////////////////////////////////////////////
+class UiBatchingBenchmark: public EngineModule
+{
+public:
+	UiBatchingBenchmark(): EngineModule("UiBatchingBenchmark"), 
+		myMode(0), myFrame(0) 
+	{
+		for(int i = 0; i < 2; i++) myBatches[i] = myPrimitives[i] = myFrameTime[i] = 0;
+	}
+
+	virtual void initialize()
+	{
+		myUiModule = UiModule::createAndInitialize();
+		Container* root = myUiModule->getUi();
+
+		myGrid = Container::create(Container::LayoutGridHorizontal, root);
+		myGrid->setGridRows(sRows);
+		myGrid->setGridColumns(sColumns);
+		myGrid->setStyle("border: 1 #ffffff; fill: #00000080");
+		for(int i = 0; i < sRows * sColumns; i++)
+		{
+			Container* cell = Container::create(Container::LayoutVertical, myGrid);
+			cell->setStyle("border: 1 #808080; fill: #20202080");
+
+			Label* l = Label::create(cell);
+			l->setText(ostr("Cell %1%", %i));
+			Button* b = Button::create(cell);
+			b->setText("Button");
+			Slider* s = Slider::create(cell);
+			s->setTicks(10);
+			s->setValue(i % 10);
+		}
+		setBatchingEnabled(false);
+	}
+
+	virtual void update(const UpdateContext& context)
+	{
+		myFrame++;
+		if(myFrame > SettleFrames)
+		{
+			foreach(Renderer* r, getEngine()->getRendererList())
+			{
+				uint id = r->getGpuContext()->getId();
+				myBatches[myMode] += statCur(ostr("ctx%1% draw batches", %id));
+				myPrimitives[myMode] += statCur(ostr("ctx%1% draw primitives", %id));
+				myFrameTime[myMode] += statCur(ostr("ctx%1% frame", %id));
+			}
+		}
+		if(myFrame == SettleFrames + MeasuredFrames)
+		{
+			if(myMode == 0)
+			{
+				myMode = 1;
+				myFrame = 0;
+				setBatchingEnabled(true);
+			}
+			else
+			{
+				report();
+				SystemManager::instance()->postExitRequest("benchmark done");
+			}
+		}
+	}
+
+private:
+	void setBatchingEnabled(bool value)
+	{
+		foreach(Renderer* r, getEngine()->getRendererList())
+		{
+			r->getRenderer()->setBatchingEnabled(value);
+		}
+	}
+
+	double statCur(const String& name)
+	{
+		Stat* s = Stat::find(name);
+		return (s != NULL && s->isValid()) ? s->getCur() : 0;
+	}
+
+	void report()
+	{
+		int numRenderers = getEngine()->getRendererList().size();
+		double n = MeasuredFrames * numRenderers;
+		printf("%dx%d cells, %d widgets, %d renderers\n", 
+			sRows, sColumns, sRows * sColumns * 4, numRenderers);
+		const char* names[] = { "immediate", "batched" };
+		for(int i = 0; i < 2; i++)
+		{
+			printf("%-10s %8.1f draw calls %8.1f primitives %8.2f ms per frame\n", 
+				names[i], myBatches[i] / n, myPrimitives[i] / n, myFrameTime[i] / n);
+		}
+	}
+
+	Ref<UiModule> myUiModule;
+	Ref<Container> myGrid;
+
+	// 0: immediate, 1: batched
+	int myMode;
+	int myFrame;
+	double myBatches[2];
+	double myPrimitives[2];
+	double myFrameTime[2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	if(argc > 2)
+	{
+		sRows = atoi(argv[1]);
+		sColumns = atoi(argv[2]);
+		// Do not pass the benchmark arguments on to omain.
+		argv[2] = argv[0];
+		argv += 2;
+		argc -= 2;
+	}
+	Application<UiBatchingBenchmark> app("benchUiBatching");
+	return omain(app, argc, argv);
+}
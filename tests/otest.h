@@ -0,0 +1,68 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Minimal helpers shared by the omegalib unit tests. Each test is a small 
+ *	executable returning 0 on success, run through ctest.
+ ******************************************************************************/
+#ifndef __OTEST_H__
+#define __OTEST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Number of failed checks in the current test executable.
+static int sTestFailures = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks a condition. Failures are reported but do not stop the test.
+#define OTEST_CHECK(cond) \
+	do { \
+		if(!(cond)) { \
+			printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #cond); \
+			sTestFailures++; \
+		} \
+	} while(0)
+
+///////////////////////////////////////////////////////////////////////////////
+// Test executable return value.
+#define OTEST_RESULT() (sTestFailures == 0 ? 0 : 1)
+
+///////////////////////////////////////////////////////////////////////////////
+// Deterministic random numbers, so failures can be reproduced.
+inline void otestSeed(unsigned int seed) { srand(seed); }
+inline float otestRandom(float min, float max) 
+{ return min + (max - min) * ((float)rand() / (float)RAND_MAX); }
+inline int otestRandomInt(int max) 
+{ return rand() % max; }
+
+#endif
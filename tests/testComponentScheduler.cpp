@@ -0,0 +1,240 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that parallel component updates give the same results as serial
+ *	updates: component state, update order of components that are not 
+ *	thread-safe, and node bounding boxes updated from requests made during
+ *	parallel updates. Also checks that components detached before the end
+ *	of a parallel update are skipped.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/ComponentScheduler.h"
+#include "omega/NodeComponent.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// A thread-safe component doing some work on its own state. Its bounding 
+// box grows with the state, and it requests bounding box updates.
+class WorkComponent: public NodeComponent
+{
+public:
+	WorkComponent(uint64_t seed): state(seed), updates(0)
+	{ myBox.setExtents(Vector3f(-1, -1, -1), Vector3f(1, 1, 1)); }
+
+	virtual void update(const UpdateContext& context)
+	{
+		for(int i = 0; i < 200; i++)
+		{
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL + context.frameNum;
+		}
+		updates++;
+		if(state % 4 == 0)
+		{
+			float size = 1 + (float)(state % 1000) / 100;
+			myBox.setExtents(Vector3f(-size, -size, -size), Vector3f(size, size, size));
+			requestBoundingBoxUpdate();
+		}
+	}
+	virtual bool isThreadSafe() { return true; }
+	virtual const AlignedBox3* getBoundingBox() { return &myBox; }
+	virtual bool hasBoundingBox() { return true; }
+	virtual bool isInitialized() { return true; }
+	virtual void initialize(Engine* server) {}
+
+	uint64_t state;
+	int updates;
+
+private:
+	AlignedBox3 myBox;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A component that is not thread-safe: it records its update order.
+class SerialComponent: public NodeComponent
+{
+public:
+	SerialComponent(int id, Vector<int>* log): myId(id), myLog(log) {}
+	virtual void update(const UpdateContext& context) { myLog->push_back(myId); }
+	virtual bool isInitialized() { return true; }
+	virtual void initialize(Engine* server) {}
+
+private:
+	int myId;
+	Vector<int>* myLog;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A scene updated by a component scheduler. Nodes are not parented, and 
+// components are updated in node order, like a scene traversal.
+struct TestScene
+{
+	Vector< Ref<SceneNode> > nodes;
+	Vector< Ref<WorkComponent> > work;
+	// All components, in traversal order.
+	Vector<NodeComponent*> components;
+	Vector<int> serialLog;
+	int numSerial;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void buildScene(TestScene& s, int numNodes)
+{
+	s.numSerial = 0;
+	for(int i = 0; i < numNodes; i++)
+	{
+		SceneNode* node = new SceneNode(NULL);
+		node->setPosition(i, 0, 0);
+		int numComponents = 1 + otestRandomInt(3);
+		for(int j = 0; j < numComponents; j++)
+		{
+			NodeComponent* c;
+			if(otestRandomInt(4) == 0)
+			{
+				c = new SerialComponent(s.numSerial++, &s.serialLog);
+			}
+			else
+			{
+				WorkComponent* wc = new WorkComponent(otestRandomInt(1000000));
+				s.work.push_back(wc);
+				c = wc;
+			}
+			node->addComponent(c);
+			s.components.push_back(c);
+		}
+		s.nodes.push_back(node);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void updateScene(TestScene& s, ComponentScheduler& cs, const UpdateContext& context)
+{
+	cs.begin(context);
+	foreach(NodeComponent* c, s.components) cs.update(c, context);
+	cs.end();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testSameResults(int threads, int batchSize)
+{
+	// Two copies of the same scene.
+	TestScene serial;
+	TestScene parallel;
+	unsigned int seed = otestRandomInt(1000000);
+	otestSeed(seed);
+	buildScene(serial, 200);
+	otestSeed(seed);
+	buildScene(parallel, 200);
+
+	JobSystem js;
+	js.setThreads(threads);
+	ComponentScheduler serialScheduler;
+	ComponentScheduler parallelScheduler;
+	parallelScheduler.setJobSystem(&js);
+	parallelScheduler.setParallelUpdateEnabled(true);
+	parallelScheduler.setBatchSize(batchSize);
+
+	for(int frame = 0; frame < 20; frame++)
+	{
+		UpdateContext context;
+		context.frameNum = frame;
+		context.time = frame * 0.016f;
+		context.dt = 0.016f;
+		updateScene(serial, serialScheduler, context);
+		updateScene(parallel, parallelScheduler, context);
+		OTEST_CHECK(serialScheduler.getLastParallelCount() == 0);
+		OTEST_CHECK(parallelScheduler.getLastParallelCount() == parallel.work.size());
+
+		for(int i = 0; i < serial.work.size(); i++)
+		{
+			OTEST_CHECK(serial.work[i]->state == parallel.work[i]->state);
+			OTEST_CHECK(parallel.work[i]->updates == frame + 1);
+		}
+		OTEST_CHECK(serial.serialLog == parallel.serialLog);
+		for(int i = 0; i < serial.nodes.size(); i++)
+		{
+			const AlignedBox3& a = serial.nodes[i]->getBoundingBox();
+			const AlignedBox3& b = parallel.nodes[i]->getBoundingBox();
+			OTEST_CHECK(a.getMinimum() == b.getMinimum() && a.getMaximum() == b.getMaximum());
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testDetach()
+{
+	JobSystem js;
+	js.setThreads(2);
+	ComponentScheduler cs;
+	cs.setJobSystem(&js);
+	cs.setParallelUpdateEnabled(true);
+
+	Ref<SceneNode> node = new SceneNode(NULL);
+	WorkComponent* kept = new WorkComponent(1);
+	WorkComponent* detached = new WorkComponent(2);
+	node->addComponent(kept);
+	node->addComponent(detached);
+	// Only the scheduler queue references the detached component.
+	Ref<WorkComponent> detachedRef = detached;
+
+	UpdateContext context;
+	context.frameNum = 0;
+	context.time = 0;
+	context.dt = 0;
+	cs.begin(context);
+	cs.update(kept, context);
+	cs.update(detached, context);
+	node->removeComponent(detached);
+	detachedRef = NULL;
+	cs.end();
+
+	OTEST_CHECK(kept->updates == 1);
+	OTEST_CHECK(cs.getLastParallelCount() == 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(18);
+
+	int threads[] = { 1, 2, 4, 8 };
+	int batchSizes[] = { 1, 4, 64 };
+	foreach(int t, threads)
+		foreach(int b, batchSizes)
+			testSameResults(t, b);
+
+	testDetach();
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,276 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that container linear layouts give the same child sizes and 
+ *	positions as the old layout loop, which expanded children until all 
+ *	the available space was consumed and laid out every child each time.
+ ******************************************************************************/
+#include <omega.h>
+#include <omegaToolkit.h>
+#include <float.h>
+
+#include "otest.h"
+
+using namespace omega;
+using namespace omegaToolkit;
+using namespace omegaToolkit::ui;
+
+///////////////////////////////////////////////////////////////////////////////
+// Child sizes and positions computed by a container layout.
+struct LayoutResult
+{
+	Vector<Vector2f> sizes;
+	Vector<Vector2f> positions;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Same rule as Widget::setActualSize.
+float clampSize(float size, int value, float minSize, float maxSize)
+{
+	if(size != value)
+	{
+		if(value < minSize) value = minSize;
+		if(value > maxSize) value = maxSize;
+		size = value;
+	}
+	return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The old Container::computeLinearLayout, run on the container children 
+// minimum and maximum sizes. The expand loop runs until the available 
+// space is consumed, with no early termination.
+void referenceLinearLayout(Container* c, Orientation o, LayoutResult& r)
+{
+	Orientation co = (o == Vertical) ? Horizontal : Vertical;
+	int nc = c->getNumChildren();
+	float margin = c->getMargin();
+	float padding = c->getPadding();
+	Vector<Widget*> children;
+	for(int i = 0; i < nc; i++) children.push_back(c->getChildByIndex(i));
+
+	r.sizes.resize(nc);
+	r.positions.resize(nc);
+
+	// Main axis sizes
+	int availableSpace = c->getSize()[o] - padding * 2 - (nc - 1) * margin;
+	for(int i = 0; i < nc; i++) r.sizes[i][o] = 0;
+	while(availableSpace > 0)
+	{
+		int childSpace = availableSpace / nc;
+		int spaceLeft = availableSpace;
+		for(int i = 0; i < nc; i++)
+		{
+			Widget* w = children[i];
+			int size = r.sizes[i][o] + childSpace;
+			r.sizes[i][o] = clampSize(r.sizes[i][o], size, 
+				w->getMinimumSize()[o], w->getMaximumSize()[o]);
+			spaceLeft -= r.sizes[i][o];
+		}
+		availableSpace = spaceLeft - 1;
+	}
+
+	// Main axis positions
+	int p = 0;
+	if((o == Horizontal && c->getHorizontalAlign() == Container::AlignRight) ||
+		(o == Vertical && c->getVerticalAlign() == Container::AlignBottom))
+	{
+		float size = c->getSize()[o];
+		p = size - margin;
+		for(int i = 0; i < nc; i++) p -= (r.sizes[i][o] + margin);
+	}
+	else
+	{
+		p = margin;
+	}
+	for(int i = 0; i < nc; i++)
+	{
+		r.positions[i][o] = p;
+		p += r.sizes[i][o] + padding;
+	}
+
+	// Cross axis sizes and positions.
+	int available = c->getSize()[co] - margin * 2;
+	for(int i = 0; i < nc; i++)
+	{
+		Widget* w = children[i];
+		// setActualSize leaves the size alone if it is already the requested
+		// one, so the result depends on the previous size. The current size 
+		// gives the same result.
+		r.sizes[i][co] = clampSize(w->getSize()[co], available,
+			w->getMinimumSize()[co], w->getMaximumSize()[co]);
+		float csize = r.sizes[i][co];
+		int pos = 0;
+		if((co == Horizontal && c->getHorizontalAlign() == Container::AlignLeft) ||
+			(co == Vertical && c->getVerticalAlign() == Container::AlignTop))
+		{
+			pos = margin;
+		}
+		else if((co == Horizontal && c->getHorizontalAlign() == Container::AlignRight) ||
+			(co == Vertical && c->getVerticalAlign() == Container::AlignBottom))
+		{
+			float size = c->getSize()[co];
+			pos = size - csize - margin;
+		}
+		else
+		{
+			pos = (available - csize) / 2 + margin;
+		}
+		r.positions[i][co] = pos;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks a container and all the containers below it.
+void check(Container* c)
+{
+	if(c->getNumChildren() == 0) return;
+
+	LayoutResult expected;
+	referenceLinearLayout(c, 
+		c->getLayout() == Container::LayoutHorizontal ? Horizontal : Vertical,
+		expected);
+	for(int i = 0; i < c->getNumChildren(); i++)
+	{
+		Widget* w = c->getChildByIndex(i);
+		OTEST_CHECK(w->getSize() == expected.sizes[i]);
+		OTEST_CHECK(w->getPosition() == expected.positions[i]);
+		Container* cc = dynamic_cast<Container*>(w);
+		if(cc != NULL) check(cc);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void randomSizeRange(Widget* w)
+{
+	// Integer sizes, as layouts work in whole pixels. Some widgets have a 
+	// fixed size, some a range, some no maximum.
+	for(int o = 0; o < 2; o++)
+	{
+		int minSize = otestRandomInt(100);
+		int kind = otestRandomInt(3);
+		float maxSize = FLT_MAX;
+		if(kind == 0) maxSize = minSize;
+		else if(kind == 1) maxSize = minSize + otestRandomInt(200);
+		if(o == 0) { w->setMinimumWidth(minSize); w->setMaximumWidth(maxSize); }
+		else { w->setMinimumHeight(minSize); w->setMaximumHeight(maxSize); }
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void randomOptions(Container* c)
+{
+	c->setLayout(otestRandomInt(2) == 0 ? 
+		Container::LayoutHorizontal : Container::LayoutVertical);
+	c->setPadding(otestRandomInt(10));
+	c->setMargin(otestRandomInt(10));
+	c->setHorizontalAlign((Container::HorizontalAlign)otestRandomInt(3));
+	c->setVerticalAlign((Container::VerticalAlign)otestRandomInt(3));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Container* createContainer()
+{
+	Container* c = new Container(NULL);
+	c->setAutosize(false);
+	randomOptions(c);
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(24);
+
+	for(int scene = 0; scene < 50; scene++)
+	{
+		// A root container with widgets and nested containers.
+		Ref<Container> root = createContainer();
+		root->setSize(Vector2f(200 + otestRandomInt(2000), 200 + otestRandomInt(2000)));
+
+		Vector< Ref<Widget> > widgets;
+		Vector< Ref<Container> > containers;
+		containers.push_back(root);
+		int numChildren = 1 + otestRandomInt(12);
+		for(int i = 0; i < numChildren; i++)
+		{
+			if(otestRandomInt(3) == 0)
+			{
+				Container* c = createContainer();
+				randomSizeRange(c);
+				root->addChild(c);
+				containers.push_back(c);
+				int n = otestRandomInt(6);
+				for(int j = 0; j < n; j++)
+				{
+					Widget* w = new Widget(NULL);
+					randomSizeRange(w);
+					c->addChild(w);
+					widgets.push_back(w);
+				}
+			}
+			else
+			{
+				Widget* w = new Widget(NULL);
+				randomSizeRange(w);
+				root->addChild(w);
+				widgets.push_back(w);
+			}
+		}
+		root->layout();
+		check(root);
+
+		// Change some widget sizes, container options or the root size, and
+		// lay out again. Only the changed parts of the tree are laid out 
+		// now, but the result must be the same as a full layout.
+		for(int round = 0; round < 10; round++)
+		{
+			int change = otestRandomInt(3);
+			if(change == 0) 
+			{
+				if(!widgets.empty()) randomSizeRange(widgets[otestRandomInt(widgets.size())]);
+			}
+			else if(change == 1) 
+			{
+				randomOptions(containers[otestRandomInt(containers.size())]);
+			}
+			else
+			{
+				root->setSize(Vector2f(200 + otestRandomInt(2000), 200 + otestRandomInt(2000)));
+			}
+			root->layout();
+			check(root);
+		}
+	}
+
+	return OTEST_RESULT();
+}
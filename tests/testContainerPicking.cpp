@@ -0,0 +1,208 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that containers using the hit test grid deliver pointer events to
+ *	the same widgets, in the same order, as dispatching to all children.
+ ******************************************************************************/
+#include <omega.h>
+#include <omegaToolkit.h>
+
+#include "otest.h"
+
+using namespace omega;
+using namespace omegaToolkit;
+using namespace omegaToolkit::ui;
+
+///////////////////////////////////////////////////////////////////////////////
+// Widgets hit by the last event, in the order they received it.
+Vector<Widget*> sHits;
+// Number of widgets that received the last event.
+int sReceived = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+class TestWidget: public Widget
+{
+public:
+	TestWidget(): Widget(NULL) {}
+	virtual void handleEvent(const Event& evt)
+	{
+		sReceived++;
+		if(hitTest(Vector2f(evt.getPosition().x(), evt.getPosition().y())))
+		{
+			sHits.push_back(this);
+		}
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Dispatch to all children: widgets hit by a point, in dispatch order.
+void referenceHits(Container* c, const Vector2f& point, Vector<Widget*>& hits, int& count)
+{
+	for(int i = 0; i < c->getNumChildren(); i++)
+	{
+		Widget* w = c->getChildByIndex(i);
+		Container* cc = dynamic_cast<Container*>(w);
+		if(cc != NULL) 
+		{
+			referenceHits(cc, point, hits, count);
+		}
+		else
+		{
+			count++;
+			if(w->hitTest(point)) hits.push_back(w);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void randomizeWidget(Widget* w)
+{
+	w->setPosition(Vector2f(otestRandom(-50, 1000), otestRandom(-50, 1000)));
+	w->setSize(Vector2f(otestRandom(1, 200), otestRandom(1, 200)));
+	// Some widgets are scaled, and a few rotated. Rotated widgets are not
+	// in the grid.
+	w->setScale(otestRandomInt(4) == 0 ? otestRandom(0.5f, 1.5f) : 1.0f);
+	w->setRotation(otestRandomInt(20) == 0 ? otestRandom(-90, 90) : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Container* createContainer()
+{
+	Container* c = new Container(NULL);
+	c->setAutosize(false);
+	c->setLayout(Container::LayoutFree);
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void addWidgets(Container* c, int count, Vector< Ref<Widget> >& widgets)
+{
+	for(int i = 0; i < count; i++)
+	{
+		Widget* w = new TestWidget();
+		randomizeWidget(w);
+		c->addChild(w);
+		widgets.push_back(w);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void checkEvents(Container* root, int numEvents)
+{
+	for(int i = 0; i < numEvents; i++)
+	{
+		Vector2f point(otestRandom(-100, 1300), otestRandom(-100, 1300));
+		Vector<Widget*> expected;
+		int numWidgets = 0;
+		referenceHits(root, point, expected, numWidgets);
+
+		// Pointer moves are culled with the grid.
+		Event evt;
+		evt.reset(Event::Move, Service::Pointer);
+		evt.setPosition(point[0], point[1]);
+		sHits.clear();
+		sReceived = 0;
+		root->handleEvent(evt);
+		OTEST_CHECK(sHits == expected);
+		OTEST_CHECK(sReceived <= numWidgets);
+
+		// Other events go to all the children.
+		Event down;
+		down.reset(Event::Down, Service::Pointer);
+		down.setPosition(point[0], point[1]);
+		sHits.clear();
+		sReceived = 0;
+		root->handleEvent(down);
+		OTEST_CHECK(sHits == expected);
+		OTEST_CHECK(sReceived == numWidgets);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(25);
+
+	// Widgets ask the ui module whether pointer interaction is enabled.
+	Ref<UiModule> ui = new UiModule();
+
+	for(int scene = 0; scene < 20; scene++)
+	{
+		Ref<Container> root = createContainer();
+		root->setSize(Vector2f(1200, 1200));
+
+		Vector< Ref<Widget> > widgets;
+		Vector< Ref<Container> > containers;
+		addWidgets(root, 10 + otestRandomInt(500), widgets);
+		// Nested containers are always dispatched to, and cull their own 
+		// children.
+		int numContainers = otestRandomInt(4);
+		for(int i = 0; i < numContainers; i++)
+		{
+			Container* c = createContainer();
+			c->setPosition(Vector2f(otestRandom(0, 600), otestRandom(0, 600)));
+			c->setSize(Vector2f(600, 600));
+			root->addChild(c);
+			containers.push_back(c);
+			addWidgets(c, otestRandomInt(200), widgets);
+		}
+		root->layout();
+		checkEvents(root, 200);
+
+		for(int round = 0; round < 10; round++)
+		{
+			// Move, resize, scale or rotate some widgets. Remove and add 
+			// others, so the index is rebuilt.
+			int changes = 1 + otestRandomInt(20);
+			for(int i = 0; i < changes; i++)
+			{
+				Widget* w = widgets[otestRandomInt(widgets.size())];
+				randomizeWidget(w);
+			}
+			for(int i = 0; i < changes && !widgets.empty(); i++)
+			{
+				int index = otestRandomInt(widgets.size());
+				Widget* w = widgets[index];
+				if(w->getContainer() != NULL) w->getContainer()->removeChild(w);
+				widgets.erase(widgets.begin() + index);
+			}
+			addWidgets(root, changes, widgets);
+			// Events are checked both while a layout refresh is pending (no
+			// culling) and after layout.
+			checkEvents(root, 20);
+			root->layout();
+			checkEvents(root, 200);
+		}
+	}
+
+	return OTEST_RESULT();
+}
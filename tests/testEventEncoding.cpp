@@ -0,0 +1,179 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Round-trips events through the compact event encoding, for every 
+ *	combination of optional fields, with and without quantization. 
+ *	Quantized positions and orientations must be within the quantization
+ *	step of the original values.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/EventUtils.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Optional event fields, matching the compact encoding field mask.
+enum TestField
+{
+	FieldSourceId = 1 << 0,
+	FieldServiceId = 1 << 1,
+	FieldFlags = 1 << 2,
+	FieldPosition = 1 << 3,
+	FieldOrientation = 1 << 4,
+	FieldExtraData = 1 << 5,
+	NumFieldCombinations = 1 << 6
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void makeEvent(Event& evt, int fields, bool farPosition)
+{
+	uint sourceId = (fields & FieldSourceId) ? 1 + otestRandomInt(1000) : 0;
+	uint serviceId = (fields & FieldServiceId) ? 1 + otestRandomInt(100) : 0;
+	evt.reset(otestRandomInt(2) ? Event::Update : Event::Down, Service::Wand, sourceId, serviceId);
+	if(fields & FieldFlags) evt.setFlags(Event::Button1 | Event::Left);
+	if(fields & FieldPosition)
+	{
+		// Far positions do not fit in 16 bits at any of the tested steps.
+		float range = farPosition ? 100000 : 10;
+		float x = farPosition ? otestRandom(50000, range) : otestRandom(-range, range);
+		evt.setPosition(Vector3f(x, otestRandom(-range, range), otestRandom(-range, range)));
+	}
+	if(fields & FieldOrientation)
+	{
+		Quaternion q(otestRandom(-1, 1), otestRandom(-1, 1), otestRandom(-1, 1), otestRandom(-1, 1));
+		q.normalize();
+		evt.setOrientation(q);
+	}
+	if(fields & FieldExtraData)
+	{
+		evt.setExtraDataType(Event::ExtraDataFloatArray);
+		for(int i = 0; i < 4; i++) evt.setExtraDataFloat(i, otestRandom(-1, 1));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Makes an event with all fields set, to check decoding resets fields that 
+// are not in the encoded event.
+void makeDirtyEvent(Event& evt)
+{
+	evt.reset(Event::Up, Service::Pointer, 77, 33);
+	evt.setFlags(Event::Right);
+	evt.setPosition(Vector3f(1, 2, 3));
+	evt.setOrientation(Quaternion(0, 1, 0, 0));
+	evt.setExtraDataType(Event::ExtraDataFloatArray);
+	evt.setExtraDataFloat(0, 5);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testRoundTrip(int fields, float positionStep, bool quantizeOrientation, bool farPosition)
+{
+	Event src;
+	makeEvent(src, fields, farPosition);
+
+	Vector<byte> buffer;
+	SharedOStream out(&buffer);
+	EventUtils::serializeCompactEvent(src, out, positionStep, quantizeOrientation);
+
+	Event dst;
+	makeDirtyEvent(dst);
+	SharedIStream in(&buffer[0], buffer.size());
+	EventUtils::deserializeCompactEvent(dst, in, positionStep);
+	OTEST_CHECK(in.getRemainingSize() == 0);
+
+	OTEST_CHECK(dst.getType() == src.getType());
+	OTEST_CHECK(dst.getServiceType() == src.getServiceType());
+	OTEST_CHECK(dst.getSourceId() == src.getSourceId());
+	OTEST_CHECK(dst.getServiceId() == src.getServiceId());
+	OTEST_CHECK(dst.getFlags() == src.getFlags());
+
+	// Positions are quantized only when they fit in 16 bits at the 
+	// quantization step.
+	bool positionQuantized = positionStep > 0 && !farPosition;
+	float positionTolerance = positionQuantized ? positionStep * 0.5f + 1e-5f : 0;
+	for(int i = 0; i < 3; i++)
+	{
+		OTEST_CHECK(fabs(dst.getPosition()[i] - src.getPosition()[i]) <= positionTolerance);
+	}
+
+	float orientationTolerance = quantizeOrientation ? 1e-4f : 0;
+	const Quaternion& so = src.getOrientation();
+	const Quaternion& dq = dst.getOrientation();
+	OTEST_CHECK(fabs(dq.x() - so.x()) <= orientationTolerance);
+	OTEST_CHECK(fabs(dq.y() - so.y()) <= orientationTolerance);
+	OTEST_CHECK(fabs(dq.z() - so.z()) <= orientationTolerance);
+	OTEST_CHECK(fabs(dq.w() - so.w()) <= orientationTolerance);
+
+	OTEST_CHECK(dst.getExtraDataType() == src.getExtraDataType());
+	OTEST_CHECK(dst.getExtraDataItems() == src.getExtraDataItems());
+	if(!src.isExtraDataNull())
+	{
+		for(int i = 0; i < src.getExtraDataItems(); i++)
+		{
+			OTEST_CHECK(dst.getExtraDataFloat(i) == src.getExtraDataFloat(i));
+		}
+	}
+
+	// Events with default fields only are smaller than with the full 
+	// encoding.
+	if(fields == 0)
+	{
+		Vector<byte> fullBuffer;
+		SharedOStream fullOut(&fullBuffer);
+		EventUtils::serializeEvent(src, fullOut);
+		OTEST_CHECK(buffer.size() < fullBuffer.size() / 2);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(4);
+
+	float steps[] = { 0, 0.001f, 0.5f };
+	for(int fields = 0; fields < NumFieldCombinations; fields++)
+	{
+		foreach(float step, steps)
+		{
+			for(int i = 0; i < 20; i++)
+			{
+				testRoundTrip(fields, step, false, false);
+				testRoundTrip(fields, step, true, false);
+				testRoundTrip(fields, step, false, true);
+				testRoundTrip(fields, step, true, true);
+			}
+		}
+	}
+
+	return OTEST_RESULT();
+}
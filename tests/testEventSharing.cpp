@@ -0,0 +1,253 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Floods the event sharing queue and decodes the frames it sends. Discrete
+ *	events must never be dropped, and Update events must be coalesced per
+ *	service type, service id and source id, without reordering the events of
+ *	a source.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/EventUtils.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// A shared event. The position x holds the event sequence number.
+struct TestEvent
+{
+	Event::Type type;
+	Service::ServiceType serviceType;
+	uint serviceId;
+	uint sourceId;
+	int sequence;
+
+	bool sameSource(const TestEvent& e) const
+	{ return serviceType == e.serviceType && serviceId == e.serviceId && sourceId == e.sourceId; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+TestEvent randomEvent(int sequence, int numSources)
+{
+	TestEvent e;
+	int r = otestRandomInt(20);
+	e.type = (r == 0) ? Event::Down : ((r == 1) ? Event::Up : Event::Update);
+	// Sources with the same id on different services or service types are 
+	// different sources.
+	e.serviceType = otestRandomInt(2) ? Service::Wand : Service::Mocap;
+	e.serviceId = 1 + otestRandomInt(2);
+	e.sourceId = otestRandomInt(numSources);
+	e.sequence = sequence;
+	return e;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void share(EventSharingModule* esm, const TestEvent& e)
+{
+	Event evt;
+	evt.reset(e.type, e.serviceType, e.sourceId, e.serviceId);
+	evt.setPosition(Vector3f((float)e.sequence, 0, 0));
+	esm->queueEvent(evt);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Commits a frame and decodes the events it contains.
+void commit(EventSharingModule* esm, Vector<TestEvent>& events)
+{
+	Vector<byte> buffer;
+	SharedOStream out(&buffer);
+	esm->commitSharedData(out);
+
+	SharedIStream in(&buffer[0], buffer.size());
+	byte encoding;
+	int numEvents;
+	float positionStep;
+	uint blockSize;
+	in >> encoding >> numEvents >> positionStep >> blockSize;
+	OTEST_CHECK(encoding == EventSharingModule::EncodingCompact);
+	OTEST_CHECK(in.getRemainingSize() == blockSize);
+
+	events.clear();
+	for(int i = 0; i < numEvents; i++)
+	{
+		Event evt;
+		EventUtils::deserializeCompactEvent(evt, in, positionStep);
+		TestEvent e;
+		e.type = evt.getType();
+		e.serviceType = evt.getServiceType();
+		e.serviceId = evt.getServiceId();
+		e.sourceId = evt.getSourceId();
+		e.sequence = (int)evt.getPosition()[0];
+		events.push_back(e);
+	}
+	OTEST_CHECK(in.getRemainingSize() == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Expected queue content: Update events replace the queued Update of their
+// source, unless a discrete event of the same source was queued after it.
+void coalesce(const Vector<TestEvent>& shared, Vector<TestEvent>& expected)
+{
+	expected.clear();
+	foreach(TestEvent e, shared)
+	{
+		bool replaced = false;
+		if(e.type == Event::Update)
+		{
+			for(int i = expected.size() - 1; i >= 0; i--)
+			{
+				if(expected[i].sameSource(e))
+				{
+					if(expected[i].type == Event::Update)
+					{
+						expected[i] = e;
+						replaced = true;
+					}
+					break;
+				}
+			}
+		}
+		if(!replaced) expected.push_back(e);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void checkEqual(const Vector<TestEvent>& a, const Vector<TestEvent>& b)
+{
+	OTEST_CHECK(a.size() == b.size());
+	if(a.size() != b.size()) return;
+	for(int i = 0; i < a.size(); i++)
+	{
+		OTEST_CHECK(a[i].type == b[i].type && a[i].sameSource(b[i]) && a[i].sequence == b[i].sequence);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testCoalescing(EventSharingModule* esm)
+{
+	esm->setCoalesceUpdates(true);
+	Vector<TestEvent> shared;
+	Vector<TestEvent> expected;
+	Vector<TestEvent> received;
+	int sequence = 0;
+	for(int frame = 0; frame < 20; frame++)
+	{
+		shared.clear();
+		int numEvents = 100 + otestRandomInt(400);
+		for(int i = 0; i < numEvents; i++)
+		{
+			TestEvent e = randomEvent(sequence++, 8);
+			share(esm, e);
+			shared.push_back(e);
+		}
+		coalesce(shared, expected);
+		commit(esm, received);
+		checkEqual(received, expected);
+	}
+
+	// Without coalescing, all events are sent.
+	esm->setCoalesceUpdates(false);
+	shared.clear();
+	for(int i = 0; i < 500; i++)
+	{
+		TestEvent e = randomEvent(sequence++, 8);
+		share(esm, e);
+		shared.push_back(e);
+	}
+	commit(esm, received);
+	checkEqual(received, shared);
+	esm->setCoalesceUpdates(true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testFlood(EventSharingModule* esm)
+{
+	// Flood the queue with Update events from distinct sources, so they can't
+	// be coalesced, mixed with discrete events.
+	Vector<TestEvent> discrete;
+	int sequence = 0;
+	int numUpdates = 0;
+	for(int i = 0; i < 10000; i++)
+	{
+		TestEvent e = randomEvent(sequence++, 100000);
+		share(esm, e);
+		if(e.type != Event::Update) discrete.push_back(e);
+		else numUpdates++;
+	}
+
+	Vector<TestEvent> received;
+	commit(esm, received);
+
+	// Discrete events are all sent, in order. Update events are dropped once
+	// the queue is full.
+	Vector<TestEvent> receivedDiscrete;
+	int receivedUpdates = 0;
+	foreach(TestEvent e, received)
+	{
+		if(e.type != Event::Update) receivedDiscrete.push_back(e);
+		else receivedUpdates++;
+	}
+	checkEqual(receivedDiscrete, discrete);
+	OTEST_CHECK(receivedUpdates < numUpdates);
+	OTEST_CHECK(receivedUpdates <= EventSharingModule::MaxSharedEventsQueue);
+	OTEST_CHECK(received.size() >= EventSharingModule::MaxSharedEventsQueue);
+
+	// The queue is empty after each commit.
+	commit(esm, received);
+	OTEST_CHECK(received.size() == 0);
+
+	// Discrete events alone are never dropped, whatever their number.
+	discrete.clear();
+	for(int i = 0; i < 5000; i++)
+	{
+		TestEvent e = randomEvent(sequence++, 8);
+		e.type = (i % 2) ? Event::Up : Event::Down;
+		share(esm, e);
+		discrete.push_back(e);
+	}
+	commit(esm, received);
+	checkEqual(received, discrete);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(5);
+
+	Ref<EventSharingModule> esm = new EventSharingModule();
+	testCoalescing(esm);
+	testFlood(esm);
+	esm->dispose();
+
+	return OTEST_RESULT();
+}
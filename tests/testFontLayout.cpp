@@ -0,0 +1,142 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks glyph run layout and Font::computeSize against fixed metrics of 
+ *	the bundled arial font, and checks that cached runs match fresh ones.
+ *	Reference metrics were taken from FreeType 2.13 with the same load flags
+ *	as GlyphAtlas; positions and sizes are allowed one pixel of difference 
+ *	across FreeType versions.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/Font.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+bool near(float a, float b)
+{ return fabs(a - b) <= 1.0f; }
+
+///////////////////////////////////////////////////////////////////////////////
+bool sizeIs(const Vector2f& s, float w, float h)
+{ return near(s[0], w) && near(s[1], h); }
+
+///////////////////////////////////////////////////////////////////////////////
+bool sameRun(const GlyphRun& a, const GlyphRun& b)
+{
+	if(a.size != b.size || a.quads.size() != b.quads.size()) return false;
+	for(int i = 0; i < a.quads.size(); i++)
+	{
+		const GlyphRun::Quad& qa = a.quads[i];
+		const GlyphRun::Quad& qb = b.quads[i];
+		if(qa.x0 != qb.x0 || qa.y0 != qb.y0 || qa.x1 != qb.x1 || qa.y1 != qb.y1 ||
+			qa.u0 != qb.u0 || qa.v0 != qb.v0 || qa.u1 != qb.u1 || qa.v1 != qb.v1 ||
+			qa.page != qb.page) return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	Ref<GlyphAtlas> atlas = new GlyphAtlas();
+	GlyphAtlas::Face* face16 = atlas->loadFace(OTEST_FONT_PATH, 16);
+	GlyphAtlas::Face* face24 = atlas->loadFace(OTEST_FONT_PATH, 24);
+	OTEST_CHECK(face16 != NULL && face24 != NULL);
+	if(face16 == NULL || face24 == NULL) return OTEST_RESULT();
+
+	// Both fonts share the atlas.
+	Ref<Font> font16 = new Font(atlas, face16);
+	Ref<Font> font24 = new Font(atlas, face24);
+
+	OTEST_CHECK(sizeIs(font16->computeSize("Hello World"), 81, 12));
+	OTEST_CHECK(sizeIs(font24->computeSize("Hello World"), 122, 18));
+	OTEST_CHECK(sizeIs(font16->computeSize("Cell 42"), 49, 12));
+	OTEST_CHECK(sizeIs(font16->computeSize("W"), 15, 12));
+	OTEST_CHECK(sizeIs(font16->computeSize(""), 0, 0));
+	// Empty glyphs extend the text to the pen position, with no height.
+	OTEST_CHECK(sizeIs(font16->computeSize("  "), 4, 0));
+	// Kerning: three 11 pixel glyphs, pulled together by the AV and VA pairs.
+	OTEST_CHECK(sizeIs(font16->computeSize("AVA"), 29, 12));
+	// computeSize reads the size of the cached run.
+	Vector2f helloSize = font16->computeSize("Hello World");
+
+	atlas->lock();
+	{
+		// One quad per visible glyph: the space has none.
+		const GlyphRun& run = font16->getGlyphRun("Hello World");
+		OTEST_CHECK(run.quads.size() == 10);
+		if(run.quads.size() == 10)
+		{
+			// 'H' is on the pen origin, y points down from the baseline.
+			const GlyphRun::Quad& h = run.quads[0];
+			OTEST_CHECK(near(h.x0, 1) && near(h.x1, 11));
+			OTEST_CHECK(near(h.y0, -12) && near(h.y1, 0));
+			// 'W' is after 'Hello ' and kerning.
+			const GlyphRun::Quad& w = run.quads[5];
+			OTEST_CHECK(near(w.x0, 41) && near(w.x1, 56));
+			OTEST_CHECK(near(w.y0, -12) && near(w.y1, 0));
+		}
+		OTEST_CHECK(run.size == helloSize);
+		foreach(const GlyphRun::Quad& q, run.quads)
+		{
+			OTEST_CHECK(q.page >= 0 && q.page < atlas->getNumPages());
+			OTEST_CHECK(q.u0 >= 0 && q.u0 < q.u1 && q.u1 <= 1);
+			OTEST_CHECK(q.v0 >= 0 && q.v0 < q.v1 && q.v1 <= 1);
+			// Quad size matches its atlas region.
+			OTEST_CHECK(fabs((q.x1 - q.x0) - (q.u1 - q.u0) * GlyphAtlas::PageSize) < 0.01f);
+			OTEST_CHECK(fabs((q.y1 - q.y0) - (q.v1 - q.v0) * GlyphAtlas::PageSize) < 0.01f);
+		}
+
+		// The same string returns the cached run.
+		OTEST_CHECK(&font16->getGlyphRun("Hello World") == &run);
+		// Glyphs are shared, so a new font on the same face gives the same
+		// layout and quads.
+		Ref<Font> fresh = new Font(atlas, face16);
+		OTEST_CHECK(sameRun(fresh->getGlyphRun("Hello World"), run));
+	}
+
+	// Overflow the run cache: runs laid out again after the cache is dropped
+	// match runs from a font that never dropped its cache.
+	Ref<Font> reference = new Font(atlas, face16);
+	GlyphRun first = font16->getGlyphRun("Line 0");
+	for(int i = 0; i < (int)Font::MaxCachedRuns + 10; i++)
+	{
+		String text = ostr("Line %1%", %i);
+		OTEST_CHECK(sameRun(font16->getGlyphRun(text), reference->getGlyphRun(text)));
+	}
+	OTEST_CHECK(sameRun(font16->getGlyphRun("Line 0"), first));
+	atlas->unlock();
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,221 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks the image broadcast encoder pool: every dirty channel is sent 
+ *	exactly once, no later than the maximum encoder latency, and channels 
+ *	changed while they are being encoded still send their latest image. 
+ *	Runs with different encoder thread counts and latencies.
+ ******************************************************************************/
+#include <omega.h>
+#include <omegaToolkit.h>
+#include "omegaToolkit/ImageBroadcastModule.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+static const int sNumChannels = 8;
+
+///////////////////////////////////////////////////////////////////////////////
+// Stores a version number in the first pixel of an image and marks it dirty.
+void setVersion(PixelData* pd, int version)
+{
+	byte* p = pd->map();
+	memcpy(p, &version, sizeof(int));
+	pd->unmap();
+	pd->setDirty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Commits a frame and returns the image version sent for each channel, or
+// -1 for channels that were not sent.
+Vector<int> commit(ImageBroadcastModule* ibm)
+{
+	Vector<byte> frame;
+	SharedOStream out(&frame);
+	ibm->commitSharedData(out);
+
+	Vector<int> versions;
+	versions.resize(sNumChannels);
+	for(int i = 0; i < sNumChannels; i++) versions[i] = -1;
+
+	SharedIStream in(&frame[0], frame.size());
+	int numChannels;
+	in >> numChannels;
+	for(int c = 0; c < numChannels; c++)
+	{
+		String name;
+		ImageUtils::ImageFormat fmt;
+		bool tiled;
+		size_t size;
+		in >> name >> fmt >> tiled >> size;
+		OTEST_CHECK(!tiled);
+
+		ByteArray data(size);
+		in.read(data.getData(), size);
+		Ref<PixelData> pixels = ImageUtils::decode(data.getData(), size);
+		int index = atoi(name.c_str());
+		OTEST_CHECK(index >= 0 && index < sNumChannels);
+		OTEST_CHECK(pixels != NULL);
+		if(pixels == NULL || index < 0 || index >= sNumChannels) continue;
+
+		// Each channel is sent at most once per frame.
+		OTEST_CHECK(versions[index] == -1);
+		memcpy(&versions[index], pixels->map(), sizeof(int));
+		pixels->unmap();
+	}
+	OTEST_CHECK(in.getRemainingSize() == 0);
+	return versions;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testEncoders(int threads, int latency)
+{
+	Ref<ImageBroadcastModule> ibm = new ImageBroadcastModule();
+	ibm->setEncoderThreads(threads);
+	ibm->setMaxEncoderLatency(latency);
+
+	Vector< Ref<PixelData> > images;
+	for(int i = 0; i < sNumChannels; i++)
+	{
+		PixelData* pd = new PixelData(PixelData::FormatRgba, 64, 64);
+		memset(pd->map(), 0, pd->getSize());
+		pd->unmap();
+		images.push_back(pd);
+		ibm->addChannel(pd, ostr("%1%", %i), ImageUtils::FormatPng);
+	}
+	int version = 0;
+	for(int i = 0; i < sNumChannels; i++) setVersion(images[i], version++);
+	commit(ibm);
+	// The maximum number of frames a channel can take to be sent.
+	int maxDelay = threads > 0 ? latency : 0;
+	for(int i = 0; i <= maxDelay; i++) commit(ibm);
+
+	// Channels changed only after their previous image was sent: each change
+	// is sent once, at most maxDelay frames after the change.
+	Vector<int> pending;
+	Vector<int> dirtyFrame;
+	pending.resize(sNumChannels);
+	dirtyFrame.resize(sNumChannels);
+	for(int i = 0; i < sNumChannels; i++) pending[i] = -1;
+	for(int frame = 0; frame < 100; frame++)
+	{
+		if(frame < 100 - maxDelay - 1)
+		{
+			for(int i = 0; i < sNumChannels; i++)
+			{
+				if(pending[i] == -1 && otestRandomInt(3) == 0)
+				{
+					pending[i] = version;
+					dirtyFrame[i] = frame;
+					setVersion(images[i], version++);
+				}
+			}
+		}
+
+		Vector<int> sent = commit(ibm);
+		for(int i = 0; i < sNumChannels; i++)
+		{
+			if(sent[i] != -1)
+			{
+				OTEST_CHECK(sent[i] == pending[i]);
+				OTEST_CHECK(frame - dirtyFrame[i] <= maxDelay);
+				pending[i] = -1;
+			}
+			else
+			{
+				OTEST_CHECK(pending[i] == -1 || frame - dirtyFrame[i] < maxDelay);
+			}
+		}
+	}
+	for(int i = 0; i < sNumChannels; i++) OTEST_CHECK(pending[i] == -1);
+
+	// Channels changed every frame: intermediate images may be skipped, but 
+	// images are sent in order, never twice, and the last image is sent.
+	Vector<int> lastSent;
+	Vector<int> latest;
+	lastSent.resize(sNumChannels);
+	latest.resize(sNumChannels);
+	for(int i = 0; i < sNumChannels; i++) lastSent[i] = -1;
+	for(int frame = 0; frame < 100; frame++)
+	{
+		for(int i = 0; i < sNumChannels; i++)
+		{
+			latest[i] = version;
+			setVersion(images[i], version++);
+		}
+		Vector<int> sent = commit(ibm);
+		for(int i = 0; i < sNumChannels; i++)
+		{
+			if(sent[i] != -1)
+			{
+				OTEST_CHECK(sent[i] > lastSent[i]);
+				lastSent[i] = sent[i];
+			}
+		}
+	}
+	// Channels still queued with an older image get sent again, so allow 
+	// two rounds of encoding.
+	for(int frame = 0; frame < 2 * (maxDelay + 1); frame++)
+	{
+		Vector<int> sent = commit(ibm);
+		for(int i = 0; i < sNumChannels; i++)
+		{
+			if(sent[i] != -1)
+			{
+				OTEST_CHECK(sent[i] > lastSent[i]);
+				lastSent[i] = sent[i];
+			}
+		}
+	}
+	for(int i = 0; i < sNumChannels; i++) OTEST_CHECK(lastSent[i] == latest[i]);
+	OTEST_CHECK(!ibm->hasSharedDataChanged());
+
+	ibm->setEncoderThreads(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(11);
+	ImageUtils::internalInitialize();
+
+	testEncoders(0, 0);
+	int threads[] = { 1, 4 };
+	int latencies[] = { 0, 1, 3 };
+	foreach(int t, threads)
+		foreach(int l, latencies)
+			testEncoders(t, l);
+
+	ImageUtils::internalDispose();
+	return OTEST_RESULT();
+}
@@ -0,0 +1,234 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks tiled image broadcast channels: commits only carry the tiles that
+ *	changed since the last commit, and receivers patching those tiles into 
+ *	their previous image end up with the source image. Runs on raw and png
+ *	channels, with image sizes that are not a multiple of the tile size.
+ ******************************************************************************/
+#include <omega.h>
+#include <omegaToolkit.h>
+#include "omegaToolkit/ImageBroadcastModule.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+static const int sWidth = 300;
+static const int sHeight = 200;
+static const int sTileSize = 64;
+static const int sTilesX = 5;
+static const int sTilesY = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the indices of tiles sent in a frame for the specified channel.
+Vector<int> getSentTiles(const Vector<byte>& frame, const String& channel)
+{
+	Vector<int> result;
+	SharedIStream in(&frame[0], frame.size());
+	int numChannels;
+	in >> numChannels;
+	for(int c = 0; c < numChannels; c++)
+	{
+		String name;
+		ImageUtils::ImageFormat fmt;
+		bool tiled;
+		int ts;
+		int numTiles;
+		in >> name >> fmt >> tiled;
+		OTEST_CHECK(tiled);
+		in >> ts >> numTiles;
+		OTEST_CHECK(ts == sTileSize);
+		for(int t = 0; t < numTiles; t++)
+		{
+			int i;
+			size_t size;
+			in >> i >> size;
+			Vector<byte> data;
+			data.resize(size);
+			if(size > 0) in.read(&data[0], size);
+			if(name == channel) result.push_back(i);
+		}
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the indices of tiles that differ between two images.
+Vector<int> getChangedTiles(PixelData* a, PixelData* b)
+{
+	Vector<int> result;
+	int pitch = a->getPitch();
+	int pixelSize = a->getBpp() / 8;
+	byte* pa = a->map();
+	byte* pb = b->map();
+	for(int i = 0; i < sTilesX * sTilesY; i++)
+	{
+		int x = (i % sTilesX) * sTileSize;
+		int y = (i / sTilesX) * sTileSize;
+		int w = std::min(sTileSize, sWidth - x);
+		int h = std::min(sTileSize, sHeight - y);
+		for(int r = 0; r < h; r++)
+		{
+			int offset = (y + r) * pitch + x * pixelSize;
+			if(memcmp(pa + offset, pb + offset, w * pixelSize) != 0)
+			{
+				result.push_back(i);
+				break;
+			}
+		}
+	}
+	a->unmap();
+	b->unmap();
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool sameImage(PixelData* a, PixelData* b)
+{
+	bool same = a->getSize() == b->getSize() && memcmp(a->map(), b->map(), a->getSize()) == 0;
+	a->unmap();
+	b->unmap();
+	return same;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Fills a random rectangle of the image with random pixels. 
+void changeRandomRect(PixelData* pd)
+{
+	int x = otestRandomInt(sWidth);
+	int y = otestRandomInt(sHeight);
+	int w = 1 + otestRandomInt(std::min(100, sWidth - x));
+	int h = 1 + otestRandomInt(std::min(100, sHeight - y));
+	int pitch = pd->getPitch();
+	int pixelSize = pd->getBpp() / 8;
+	byte* p = pd->map();
+	for(int r = y; r < y + h; r++)
+	{
+		for(int c = x * pixelSize; c < (x + w) * pixelSize; c++) p[r * pitch + c] = otestRandomInt(256);
+	}
+	pd->unmap();
+	pd->setDirty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void copyImage(PixelData* dst, PixelData* src)
+{
+	memcpy(dst->map(), src->map(), src->getSize());
+	dst->unmap();
+	src->unmap();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Commits a frame from the source module and applies it to a receiver.
+void sendFrame(ImageBroadcastModule* source, ImageBroadcastModule* receiver, 
+	bool committing, Vector<byte>& frame)
+{
+	frame.clear();
+	SharedOStream out(&frame);
+	out.setKeyframe(false);
+	out.setCommitting(committing);
+	source->commitSharedData(out);
+
+	SharedIStream in(&frame[0], frame.size());
+	receiver->updateSharedData(in);
+	OTEST_CHECK(in.getRemainingSize() == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testChannel(ImageUtils::ImageFormat format)
+{
+	String name = "tiles";
+	Ref<ImageBroadcastModule> source = new ImageBroadcastModule();
+	Ref<ImageBroadcastModule> receiver = new ImageBroadcastModule();
+	Ref<ImageBroadcastModule> newReceiver = new ImageBroadcastModule();
+
+	Ref<PixelData> image = new PixelData(PixelData::FormatRgba, sWidth, sHeight);
+	Ref<PixelData> received = new PixelData(PixelData::FormatRgba, sWidth, sHeight);
+	Ref<PixelData> newReceived = new PixelData(PixelData::FormatRgba, sWidth, sHeight);
+	Ref<PixelData> previous = new PixelData(PixelData::FormatRgba, sWidth, sHeight);
+	memset(image->map(), 0, image->getSize());
+	image->unmap();
+	memset(received->map(), 0, received->getSize());
+	received->unmap();
+
+	source->addChannel(image, name, format, 75, sTileSize);
+	receiver->addChannel(received, name, format, 75, sTileSize);
+	newReceiver->addChannel(newReceived, name, format, 75, sTileSize);
+
+	// The first commit sends all tiles.
+	Vector<byte> frame;
+	changeRandomRect(image);
+	sendFrame(source, receiver, true, frame);
+	OTEST_CHECK(getSentTiles(frame, name).size() == sTilesX * sTilesY);
+	OTEST_CHECK(sameImage(image, received));
+
+	for(int i = 0; i < 50; i++)
+	{
+		copyImage(previous, image);
+		int numChanges = otestRandomInt(4);
+		for(int j = 0; j < numChanges; j++) changeRandomRect(image);
+		// Dirty images with no changed pixels send no tiles.
+		image->setDirty();
+
+		// Every few frames a new slave maps the shared data. It gets all the
+		// tiles, and the other receivers still get the changed tiles after it.
+		if(i % 10 == 5)
+		{
+			memset(newReceived->map(), 0, newReceived->getSize());
+			newReceived->unmap();
+			sendFrame(source, newReceiver, false, frame);
+			OTEST_CHECK(getSentTiles(frame, name).size() == sTilesX * sTilesY);
+			OTEST_CHECK(sameImage(image, newReceived));
+		}
+
+		sendFrame(source, receiver, true, frame);
+		Vector<int> sent = getSentTiles(frame, name);
+		Vector<int> expected = getChangedTiles(previous, image);
+		OTEST_CHECK(sent.size() == expected.size());
+		for(int j = 0; j < sent.size() && j < expected.size(); j++) OTEST_CHECK(sent[j] == expected[j]);
+		OTEST_CHECK(sameImage(image, received));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(10);
+	ImageUtils::internalInitialize();
+
+	testChannel(ImageUtils::FormatNone);
+	testChannel(ImageUtils::FormatPng);
+
+	ImageUtils::internalDispose();
+	return OTEST_RESULT();
+}
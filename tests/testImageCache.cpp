@@ -0,0 +1,158 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks the decoded image cache: least recently used images are evicted
+ *	first when the memory budget is exceeded, and cached images are reloaded
+ *	when their file modification time changes.
+ ******************************************************************************/
+#include <omega.h>
+#include <sys/stat.h>
+#ifdef OMEGA_OS_WIN
+	#include <sys/utime.h>
+#else
+	#include <utime.h>
+#endif
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes a png file filled with a single color.
+void writeTestImage(const String& path, int width, int height, byte value)
+{
+	Ref<PixelData> pixels = new PixelData(PixelData::FormatRgba, width, height);
+	memset(pixels->map(), value, pixels->getSize());
+	pixels->unmap();
+
+	Ref<ByteArray> png = ImageUtils::encode(pixels, ImageUtils::FormatPng);
+	FILE* f = fopen(path.c_str(), "wb");
+	fwrite(png->getData(), 1, png->getSize(), f);
+	fclose(f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Moves the file modification time, so the change is seen even if the file
+// is rewritten within the file system time resolution.
+void touch(const String& path, int seconds)
+{
+	struct stat info;
+	stat(path.c_str(), &info);
+	struct utimbuf times;
+	times.actime = info.st_atime;
+	times.modtime = info.st_mtime + seconds;
+	utime(path.c_str(), &times);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	ImageUtils::internalInitialize();
+
+	const char* names[] = { "testImageCache_a.png", "testImageCache_b.png", 
+		"testImageCache_c.png", "testImageCache_d.png" };
+	foreach(const char* name, names) writeTestImage(name, 64, 64, 10);
+	String a = names[0];
+	String b = names[1];
+	String c = names[2];
+	String d = names[3];
+
+	// Without the cache, every load decodes the image again.
+	Ref<PixelData> pa = ImageUtils::loadImage(a, true);
+	OTEST_CHECK(pa != NULL);
+	OTEST_CHECK(ImageUtils::loadImage(a, true) != pa);
+	size_t imageSize = pa->getSize();
+
+	// Room for 3 images.
+	ImageUtils::setCacheEnabled(true);
+	ImageUtils::setCacheSize(imageSize * 3);
+	pa = ImageUtils::loadImage(a, true);
+	Ref<PixelData> pb = ImageUtils::loadImage(b, true);
+	Ref<PixelData> pc = ImageUtils::loadImage(c, true);
+	OTEST_CHECK(ImageUtils::getCacheMemoryUsage() == imageSize * 3);
+	OTEST_CHECK(ImageUtils::loadImage(a, true) == pa);
+	OTEST_CHECK(ImageUtils::loadImage(b, true) == pb);
+	OTEST_CHECK(ImageUtils::loadImage(c, true) == pc);
+
+	// Use a, so b becomes the least recently used image. Loading d evicts b.
+	OTEST_CHECK(ImageUtils::loadImage(a, true) == pa);
+	Ref<PixelData> pd = ImageUtils::loadImage(d, true);
+	OTEST_CHECK(ImageUtils::getCacheMemoryUsage() == imageSize * 3);
+	OTEST_CHECK(ImageUtils::loadImage(c, true) == pc);
+	OTEST_CHECK(ImageUtils::loadImage(a, true) == pa);
+	OTEST_CHECK(ImageUtils::loadImage(d, true) == pd);
+	// Reloading b evicts c, now the least recently used.
+	Ref<PixelData> pb2 = ImageUtils::loadImage(b, true);
+	OTEST_CHECK(pb2 != pb);
+	OTEST_CHECK(ImageUtils::loadImage(a, true) == pa);
+	OTEST_CHECK(ImageUtils::loadImage(d, true) == pd);
+	OTEST_CHECK(ImageUtils::loadImage(b, true) == pb2);
+	OTEST_CHECK(ImageUtils::loadImage(c, true) != pc);
+
+	// Shrinking the budget evicts the least recently used images first.
+	ImageUtils::setCacheSize(imageSize * 3);
+	pa = ImageUtils::loadImage(a, true);
+	pb = ImageUtils::loadImage(b, true);
+	pc = ImageUtils::loadImage(c, true);
+	ImageUtils::setCacheSize(imageSize * 1);
+	OTEST_CHECK(ImageUtils::getCacheMemoryUsage() == imageSize);
+	OTEST_CHECK(ImageUtils::loadImage(c, true) == pc);
+
+	// Images larger than the budget are not cached.
+	ImageUtils::setCacheSize(imageSize / 2);
+	OTEST_CHECK(ImageUtils::getCacheMemoryUsage() == 0);
+	pa = ImageUtils::loadImage(a, true);
+	OTEST_CHECK(ImageUtils::loadImage(a, true) != pa);
+	OTEST_CHECK(ImageUtils::getCacheMemoryUsage() == 0);
+
+	// Changing the file invalidates its cached image.
+	ImageUtils::setCacheSize(imageSize * 4);
+	pa = ImageUtils::loadImage(a, true);
+	OTEST_CHECK(ImageUtils::loadImage(a, true) == pa);
+	writeTestImage(a, 64, 64, 200);
+	touch(a, 10);
+	Ref<PixelData> pa2 = ImageUtils::loadImage(a, true);
+	OTEST_CHECK(pa2 != pa);
+	OTEST_CHECK(pa2->map()[0] == 200);
+	pa2->unmap();
+	OTEST_CHECK(ImageUtils::loadImage(a, true) == pa2);
+	OTEST_CHECK(ImageUtils::getCacheMemoryUsage() == imageSize);
+
+	// Disabling the cache empties it.
+	ImageUtils::setCacheEnabled(false);
+	OTEST_CHECK(ImageUtils::getCacheMemoryUsage() == 0);
+
+	ImageUtils::internalDispose();
+	foreach(const char* name, names) remove(name);
+
+	return OTEST_RESULT();
+}
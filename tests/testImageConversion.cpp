@@ -0,0 +1,146 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that decoded images are converted to PixelData byte for byte like
+ *	the original per-pixel conversion loop, for 8, 24 and 32 bit images and
+ *	widths whose FreeImage scanlines are padded.
+ ******************************************************************************/
+#include <omega.h>
+#define FREEIMAGE_BIGENDIAN
+#include "FreeImage.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// The conversion loop ImageUtils used before scanlines were copied with 
+// memcpy. Converts image in place if it is palettized, like ImageUtils does.
+Vector<byte> referenceConversion(FIBITMAP*& image)
+{
+	if(FreeImage_GetBPP(image) == 8)
+	{
+		FIBITMAP* temp = image;
+		image = FreeImage_ConvertTo24Bits(image);
+		FreeImage_Unload(temp);
+	}
+	int bpp = FreeImage_GetBPP(image);
+	int width = FreeImage_GetWidth(image);
+	int height = FreeImage_GetHeight(image);
+	int pixelOffset = bpp / 8;
+
+	Vector<byte> data;
+	data.resize(width * height * pixelOffset);
+	for(int i = 0; i < height; i++)
+	{
+		char* pixels = (char*)FreeImage_GetScanLine(image, i);
+		for(int j = 0; j < width; j++)
+		{
+			int k = i * width + j;
+			data[k * pixelOffset + 0] = pixels[j * pixelOffset + 0];
+			data[k * pixelOffset + 1] = pixels[j * pixelOffset + 1];
+			data[k * pixelOffset + 2] = pixels[j * pixelOffset + 2];
+			if(bpp == 32) data[k * pixelOffset + 3] = pixels[j * pixelOffset + 3];
+		}
+	}
+	return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Encodes a random image as png, decodes it through ImageUtils and compares 
+// the result with the reference conversion of the same png. Returns true if
+// the decoded scanlines were padded.
+bool checkConversion(int width, int height, int bpp)
+{
+	FIBITMAP* source = FreeImage_Allocate(width, height, bpp);
+	int rowSize = width * bpp / 8;
+	for(int i = 0; i < height; i++)
+	{
+		BYTE* line = FreeImage_GetScanLine(source, i);
+		for(int j = 0; j < rowSize; j++) line[j] = otestRandomInt(256);
+	}
+	FIMEMORY* png = FreeImage_OpenMemory();
+	FreeImage_SaveToMemory(FIF_PNG, source, png);
+	FreeImage_Unload(source);
+
+	BYTE* pngData = NULL;
+	DWORD pngSize = 0;
+	FreeImage_AcquireMemory(png, &pngData, &pngSize);
+
+	FreeImage_SeekMemory(png, 0, SEEK_SET);
+	FIBITMAP* image = FreeImage_LoadFromMemory(FIF_PNG, png);
+	Vector<byte> expected = referenceConversion(image);
+	bool padded = FreeImage_GetPitch(image) != FreeImage_GetWidth(image) * FreeImage_GetBPP(image) / 8;
+	FreeImage_Unload(image);
+
+	Ref<PixelData> pixels = ImageUtils::decode(pngData, pngSize);
+	OTEST_CHECK(pixels != NULL);
+	if(pixels != NULL)
+	{
+		OTEST_CHECK(pixels->getWidth() == width);
+		OTEST_CHECK(pixels->getHeight() == height);
+		OTEST_CHECK(pixels->getSize() == expected.size());
+		if(pixels->getSize() == expected.size())
+		{
+			bool same = memcmp(pixels->map(), &expected[0], expected.size()) == 0;
+			pixels->unmap();
+			if(!same) printf("conversion mismatch: %dx%d, %d bpp\n", width, height, bpp);
+			OTEST_CHECK(same);
+		}
+	}
+	FreeImage_CloseMemory(png);
+	return padded;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(8);
+	ImageUtils::internalInitialize();
+
+	int widths[] = { 1, 2, 3, 5, 7, 64, 101 };
+	int heights[] = { 1, 3, 17 };
+	int bpps[] = { 8, 24, 32 };
+
+	bool paddedChecked = false;
+	foreach(int bpp, bpps)
+		foreach(int width, widths)
+			foreach(int height, heights)
+				if(checkConversion(width, height, bpp)) paddedChecked = true;
+
+	// Make sure the row by row copy path was exercised.
+	OTEST_CHECK(paddedChecked);
+
+	ImageUtils::internalDispose();
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,168 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that asynchronous image loads are served in priority order, that
+ *	cancelled loads are skipped, and that loads whose caller only kept a raw
+ *	task pointer still complete.
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes a png file filled with random pixels.
+void writeTestImage(const String& path, int width, int height)
+{
+	Ref<PixelData> pixels = new PixelData(PixelData::FormatRgba, width, height);
+	byte* p = pixels->map();
+	for(int i = 0; i < pixels->getSize(); i++) p[i] = otestRandomInt(256);
+	pixels->unmap();
+
+	Ref<ByteArray> png = ImageUtils::encode(pixels, ImageUtils::FormatPng);
+	FILE* f = fopen(path.c_str(), "wb");
+	fwrite(png->getData(), 1, png->getSize(), f);
+	fclose(f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Records the order in which loads complete.
+class CompletionRecorder: public ImageUtils::LoadImageAsyncTask::IAsyncTaskHandler
+{
+public:
+	virtual void onTaskCompleted(AsyncTask<ImageUtils::LoadImageAsyncTaskData>* task)
+	{
+		myLock.lock();
+		myOrder.push_back(task->getData().path);
+		myLock.unlock();
+	}
+
+	int getCount()
+	{
+		myLock.lock();
+		int count = myOrder.size();
+		myLock.unlock();
+		return count;
+	}
+
+	Vector<String> getOrder()
+	{
+		myLock.lock();
+		Vector<String> order = myOrder;
+		myLock.unlock();
+		return order;
+	}
+
+private:
+	Lock myLock;
+	Vector<String> myOrder;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(6);
+	ImageUtils::internalInitialize();
+	// A single loader thread, so loads complete in the order they are served.
+	ImageUtils::setImageLoaderThreads(1);
+
+	String blockerPath = "testImageLoader_blocker.png";
+	writeTestImage(blockerPath, 1024, 1024);
+	int numImages = 12;
+	Vector<String> paths;
+	for(int i = 0; i < numImages; i++)
+	{
+		paths.push_back(ostr("testImageLoader_%1%.png", %i));
+		writeTestImage(paths[i], 64, 64);
+	}
+	String unreferencedPath = "testImageLoader_unreferenced.png";
+	writeTestImage(unreferencedPath, 64, 64);
+
+	CompletionRecorder recorder;
+
+	// Keeps the loader thread busy while the other requests are queued.
+	Ref<ImageUtils::LoadImageAsyncTask> blocker = 
+		ImageUtils::loadImageAsync(blockerPath, true, ImageUtils::PriorityHigh);
+	blocker->setCompletionHandler(&recorder);
+
+	Vector< Ref<ImageUtils::LoadImageAsyncTask> > tasks;
+	int priorities[] = { ImageUtils::PriorityLow, ImageUtils::PriorityNormal, ImageUtils::PriorityHigh };
+	for(int i = 0; i < numImages; i++)
+	{
+		tasks.push_back(ImageUtils::loadImageAsync(paths[i], true, priorities[i % 3]));
+		tasks[i]->setCompletionHandler(&recorder);
+	}
+
+	// The caller keeps no reference to this task: it must still be served.
+	ImageUtils::LoadImageAsyncTask* unreferenced = 
+		ImageUtils::loadImageAsync(unreferencedPath, true, ImageUtils::PriorityNormal);
+	unreferenced->setCompletionHandler(&recorder);
+
+	// Cancelled loads are skipped.
+	tasks[3]->cancel();
+	tasks[4]->cancel();
+
+	// High priority loads first, then normal and low. Loads with the same 
+	// priority are served in the order they were queued.
+	Vector<String> expected;
+	expected.push_back(blockerPath);
+	int expectedOrder[] = { 2, 5, 8, 11, 1, 7, 10, -1, 0, 6, 9 };
+	foreach(int i, expectedOrder) expected.push_back(i >= 0 ? paths[i] : unreferencedPath);
+
+	Timer timer;
+	timer.start();
+	while(recorder.getCount() < expected.size() && timer.getElapsedTimeInSec() < 30) osleep(10);
+	while(ImageUtils::getImageQueueLength() > 0 && timer.getElapsedTimeInSec() < 30) osleep(10);
+	osleep(100);
+
+	Vector<String> order = recorder.getOrder();
+	OTEST_CHECK(order.size() == expected.size());
+	for(int i = 0; i < order.size() && i < expected.size(); i++) OTEST_CHECK(order[i] == expected[i]);
+
+	OTEST_CHECK(blocker->isComplete() && blocker->getData().image != NULL);
+	OTEST_CHECK(blocker->getData().image->getWidth() == 1024);
+	for(int i = 0; i < numImages; i++)
+	{
+		bool cancelled = (i == 3 || i == 4);
+		OTEST_CHECK(tasks[i]->isComplete() != cancelled);
+		OTEST_CHECK((tasks[i]->getData().image != NULL) != cancelled);
+	}
+
+	ImageUtils::internalDispose();
+
+	remove(blockerPath.c_str());
+	remove(unreferencedPath.c_str());
+	foreach(String p, paths) remove(p.c_str());
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,293 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks level selection and tile requests of ImagePyramid on a synthetic 
+ *	Deep Zoom pyramid: the tiles returned for a view match the tiles found by
+ *	brute force, and missing tiles fall back to the closest loaded coarser 
+ *	tiles, ordered coarse to fine.
+ ******************************************************************************/
+#include <omega.h>
+#include <sys/stat.h>
+#ifdef OMEGA_OS_WIN
+	#include <direct.h>
+	#define makeDir(path) _mkdir(path)
+	#define removeDir(path) _rmdir(path)
+#else
+	#include <unistd.h>
+	#define makeDir(path) mkdir(path, 0755)
+	#define removeDir(path) rmdir(path)
+#endif
+
+#include "otest.h"
+
+using namespace omega;
+
+// Pyramid layout: 11 levels, level 7 is the coarsest level with a single tile.
+static const int sWidth = 1000;
+static const int sHeight = 600;
+static const int sTileSize = 128;
+static const int sOverlap = 1;
+static const int sMaxLevel = 10;
+static const int sBaseLevel = 7;
+static const char* sTilePath = "testImagePyramid_files";
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes all tiles of a level. Tiles include overlap borders with their 
+// neighbors, and their first pixel stores the tile level, column and row.
+void writeLevel(ImagePyramid* pyramid, int level, Vector<String>& outFiles)
+{
+	makeDir(ostr("%1%/%2%", %sTilePath %level).c_str());
+	Vector2i size = pyramid->getLevelSize(level);
+	Vector2i tiles = pyramid->getLevelTiles(level);
+	for(int row = 0; row < tiles[1]; row++)
+	{
+		for(int col = 0; col < tiles[0]; col++)
+		{
+			int x0 = std::max(0, col * sTileSize - sOverlap);
+			int y0 = std::max(0, row * sTileSize - sOverlap);
+			int x1 = std::min(size[0], (col + 1) * sTileSize + sOverlap);
+			int y1 = std::min(size[1], (row + 1) * sTileSize + sOverlap);
+
+			Ref<PixelData> pixels = new PixelData(PixelData::FormatRgba, x1 - x0, y1 - y0);
+			byte* p = pixels->map();
+			memset(p, 255, pixels->getSize());
+			p[0] = level;
+			p[1] = col;
+			p[2] = row;
+			pixels->unmap();
+
+			Ref<ByteArray> png = ImageUtils::encode(pixels, ImageUtils::FormatPng);
+			String path = pyramid->getTilePath(level, col, row);
+			outFiles.push_back(path);
+			FILE* f = fopen(path.c_str(), "wb");
+			fwrite(png->getData(), 1, png->getSize(), f);
+			fclose(f);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reference level selection: the coarsest level that still has at least one
+// level pixel per screen pixel.
+int referenceLevel(const Rect& region, const Vector2i& screen)
+{
+	float ratio = std::max(
+		(float)region.width() / screen[0], (float)region.height() / screen[1]);
+	for(int up = sMaxLevel; up > 0; up--)
+	{
+		if(ratio / (1 << up) >= 1.0f) return sMaxLevel - up;
+	}
+	return sMaxLevel;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reference tile selection: all tiles of a level whose image area overlaps 
+// the region.
+int referenceTiles(ImagePyramid* pyramid, int level, const Rect& region, Dictionary<int, bool>& outTiles)
+{
+	int scale = 1 << (sMaxLevel - level);
+	Vector2i tiles = pyramid->getLevelTiles(level);
+	for(int row = 0; row < tiles[1]; row++)
+	{
+		for(int col = 0; col < tiles[0]; col++)
+		{
+			int x0 = col * sTileSize * scale;
+			int y0 = row * sTileSize * scale;
+			int x1 = std::min(sWidth, (col + 1) * sTileSize * scale);
+			int y1 = std::min(sHeight, (row + 1) * sTileSize * scale);
+			if(x0 < region.x() + region.width() && x1 > region.x() &&
+				y0 < region.y() + region.height() && y1 > region.y())
+			{
+				outTiles[col * 1000 + row] = true;
+			}
+		}
+	}
+	return outTiles.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Calls getTiles until it returns count tiles at the view level and total 
+// tiles overall, or a timeout expires.
+void waitForTiles(ImagePyramid* pyramid, const Rect& region, const Vector2i& screen, 
+	int level, int count, int total, ImagePyramid::TileList& outTiles)
+{
+	Timer timer;
+	timer.start();
+	while(timer.getElapsedTimeInSec() < 30)
+	{
+		outTiles.clear();
+		pyramid->getTiles(region, screen, outTiles);
+		int found = 0;
+		foreach(const ImagePyramid::Tile& t, outTiles) if(t.level == level) found++;
+		if(found == count && outTiles.size() == total) return;
+		osleep(10);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks that a loaded tile has consistent bounds, pixel region and pixels.
+void checkTile(const ImagePyramid::Tile& t)
+{
+	OTEST_CHECK(t.pixels != NULL);
+	if(t.pixels == NULL) return;
+
+	int scale = 1 << (sMaxLevel - t.level);
+	OTEST_CHECK(t.bounds.x() == t.column * sTileSize * scale);
+	OTEST_CHECK(t.bounds.y() == t.row * sTileSize * scale);
+	OTEST_CHECK(t.bounds.x() + t.bounds.width() <= sWidth);
+	OTEST_CHECK(t.bounds.y() + t.bounds.height() <= sHeight);
+	OTEST_CHECK(t.pixelRegion.x() == (t.column > 0 ? sOverlap : 0));
+	OTEST_CHECK(t.pixelRegion.y() == (t.row > 0 ? sOverlap : 0));
+	OTEST_CHECK(t.pixelRegion.x() + t.pixelRegion.width() <= t.pixels->getWidth());
+	OTEST_CHECK(t.pixelRegion.y() + t.pixelRegion.height() <= t.pixels->getHeight());
+
+	// The right file was loaded.
+	byte* p = t.pixels->map();
+	OTEST_CHECK(p[0] == t.level && p[1] == t.column && p[2] == t.row);
+	t.pixels->unmap();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(9);
+	ImageUtils::internalInitialize();
+
+	Ref<ImagePyramid> pyramid = new ImagePyramid();
+	pyramid->initialize(sTilePath, sWidth, sHeight, sTileSize, sOverlap, "png");
+
+	// Layout
+	OTEST_CHECK(pyramid->getNumLevels() == sMaxLevel + 1);
+	OTEST_CHECK(pyramid->getLevelSize(sMaxLevel) == Vector2i(1000, 600));
+	OTEST_CHECK(pyramid->getLevelSize(sMaxLevel - 1) == Vector2i(500, 300));
+	OTEST_CHECK(pyramid->getLevelSize(sBaseLevel) == Vector2i(125, 75));
+	OTEST_CHECK(pyramid->getLevelSize(0) == Vector2i(1, 1));
+	OTEST_CHECK(pyramid->getLevelTiles(sMaxLevel) == Vector2i(8, 5));
+	OTEST_CHECK(pyramid->getLevelTiles(sBaseLevel) == Vector2i(1, 1));
+	OTEST_CHECK(pyramid->getLevelTiles(sBaseLevel + 1) == Vector2i(2, 2));
+
+	// Level selection against random views.
+	OTEST_CHECK(pyramid->getLevelForView(Rect(0, 0, sWidth, sHeight), Vector2i(sWidth, sHeight)) == sMaxLevel);
+	OTEST_CHECK(pyramid->getLevelForView(Rect(0, 0, sWidth, sHeight), Vector2i(250, 150)) == sMaxLevel - 2);
+	OTEST_CHECK(pyramid->getLevelForView(Rect(0, 0, sWidth, sHeight), Vector2i(4000, 4000)) == sMaxLevel);
+	OTEST_CHECK(pyramid->getLevelForView(Rect(0, 0, sWidth, sHeight), Vector2i(0, 0)) == sMaxLevel);
+	for(int i = 0; i < 1000; i++)
+	{
+		int x = otestRandomInt(sWidth);
+		int y = otestRandomInt(sHeight);
+		Rect region(x, y, 1 + otestRandomInt(sWidth - x), 1 + otestRandomInt(sHeight - y));
+		Vector2i screen(1 + otestRandomInt(2000), 1 + otestRandomInt(2000));
+		OTEST_CHECK(pyramid->getLevelForView(region, screen) == referenceLevel(region, screen));
+	}
+
+	Vector<String> files;
+	makeDir(sTilePath);
+	for(int level = sBaseLevel; level <= sMaxLevel; level++) writeLevel(pyramid, level, files);
+	// A missing tile: views needing it fall back to the base level.
+	String missingTile = pyramid->getTilePath(sBaseLevel + 1, 1, 1);
+	remove(missingTile.c_str());
+
+	// Nothing is loaded yet, so the first request returns no tiles.
+	ImagePyramid::TileList tiles;
+	Rect full(0, 0, sWidth, sHeight);
+	Vector2i smallScreen(250, 150);
+	pyramid->getTiles(full, smallScreen, tiles);
+	OTEST_CHECK(tiles.size() == 0);
+
+	// Level 8 view: 3 loaded tiles, and the base tile in place of the missing one.
+	waitForTiles(pyramid, full, smallScreen, sBaseLevel + 1, 3, 4, tiles);
+	OTEST_CHECK(tiles.size() == 4);
+	if(tiles.size() == 4)
+	{
+		OTEST_CHECK(tiles.front().level == sBaseLevel);
+		foreach(const ImagePyramid::Tile& t, tiles)
+		{
+			checkTile(t);
+			OTEST_CHECK(t.level == sBaseLevel || !(t.column == 1 && t.row == 1));
+		}
+	}
+
+	// Full resolution view: nothing at that level is loaded, so every tile 
+	// is replaced by its closest loaded ancestor, coarse to fine.
+	Vector2i fullScreen(sWidth, sHeight);
+	tiles.clear();
+	pyramid->getTiles(full, fullScreen, tiles);
+	OTEST_CHECK(tiles.size() == 4);
+	int lastLevel = 0;
+	foreach(const ImagePyramid::Tile& t, tiles)
+	{
+		checkTile(t);
+		OTEST_CHECK(t.level >= lastLevel);
+		OTEST_CHECK(t.level == sBaseLevel || t.level == sBaseLevel + 1);
+		lastLevel = t.level;
+	}
+
+	// Random regions at random levels return the brute force tile set once
+	// loaded.
+	for(int i = 0; i < 20; i++)
+	{
+		int x = otestRandomInt(sWidth);
+		int y = otestRandomInt(sHeight);
+		Rect region(x, y, 1 + otestRandomInt(sWidth - x), 1 + otestRandomInt(sHeight - y));
+		Vector2i screen(1 + otestRandomInt(sWidth), 1 + otestRandomInt(sHeight));
+		int level = pyramid->getLevelForView(region, screen);
+		// Views at level 8 may need the missing tile, and coarser levels have
+		// no tiles on disk.
+		if(level <= sBaseLevel + 1) continue;
+
+		Dictionary<int, bool> expected;
+		int count = referenceTiles(pyramid, level, region, expected);
+		waitForTiles(pyramid, region, screen, level, count, count, tiles);
+
+		Dictionary<int, bool> found;
+		foreach(const ImagePyramid::Tile& t, tiles)
+		{
+			OTEST_CHECK(t.level == level);
+			checkTile(t);
+			found[t.column * 1000 + t.row] = true;
+		}
+		OTEST_CHECK(found.size() == expected.size());
+		foreach(Dictionary<int, bool>::Item t, expected) OTEST_CHECK(found.find(t.getKey()) != found.end());
+	}
+
+	pyramid = NULL;
+	ImageUtils::internalDispose();
+
+	foreach(String f, files) remove(f.c_str());
+	for(int level = sBaseLevel; level <= sMaxLevel; level++)
+	{
+		removeDir(ostr("%1%/%2%", %sTilePath %level).c_str());
+	}
+	removeDir(sTilePath);
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,211 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that the job system runs jobs after their dependencies, that 
+ *	wait returns once a job is done, and that parallelFor covers its range.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/JobSystem.h"
+#include <algorithm>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Gives each finished job a sequence number.
+Lock sSequenceLock;
+int sSequence = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+class RecordJob: public Job
+{
+public:
+	RecordJob(): sequence(-1), runs(0), depsDoneAtStart(true) {}
+	virtual void execute()
+	{
+		// All dependencies must be done before the job starts.
+		foreach(RecordJob* d, deps) if(!d->isDone()) depsDoneAtStart = false;
+		runs++;
+		sSequenceLock.lock();
+		sequence = sSequence++;
+		sSequenceLock.unlock();
+	}
+
+	Vector<RecordJob*> deps;
+	int sequence;
+	int runs;
+	bool depsDoneAtStart;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Sums [first, end) by forking two child jobs and waiting for them.
+class SumJob: public Job
+{
+public:
+	SumJob(JobSystem* js, int first, int end): 
+		myJobSystem(js), myFirst(first), myEnd(end), result(0) {}
+	virtual void execute()
+	{
+		if(myEnd - myFirst <= 16)
+		{
+			for(int i = myFirst; i < myEnd; i++) result += i;
+			return;
+		}
+		int mid = (myFirst + myEnd) / 2;
+		Ref<SumJob> a = new SumJob(myJobSystem, myFirst, mid);
+		Ref<SumJob> b = new SumJob(myJobSystem, mid, myEnd);
+		myJobSystem->submit(a);
+		myJobSystem->submit(b);
+		myJobSystem->wait(a);
+		myJobSystem->wait(b);
+		result = a->result + b->result;
+	}
+
+private:
+	JobSystem* myJobSystem;
+	int myFirst;
+	int myEnd;
+
+public:
+	long long result;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class CountLoop: public ParallelLoop
+{
+public:
+	CountLoop(int count) { counts.resize(count, 0); }
+	virtual void run(int first, int end)
+	{
+		// Ranges are disjoint, so there is no need to lock.
+		for(int i = first; i < end; i++) counts[i]++;
+	}
+	Vector<int> counts;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void testDependencies(JobSystem& js)
+{
+	// A random graph of jobs, each depending on some earlier ones.
+	int numJobs = 500;
+	Vector< Ref<RecordJob> > jobs;
+	for(int i = 0; i < numJobs; i++)
+	{
+		RecordJob* j = new RecordJob();
+		int numDeps = (i == 0) ? 0 : otestRandomInt(4);
+		for(int k = 0; k < numDeps; k++)
+		{
+			RecordJob* d = jobs[otestRandomInt(i)];
+			j->addDependency(d);
+			j->deps.push_back(d);
+		}
+		jobs.push_back(j);
+	}
+
+	// Submit in random order, so jobs are often submitted before their 
+	// dependencies.
+	Vector<int> order;
+	for(int i = 0; i < numJobs; i++) order.push_back(i);
+	for(int i = numJobs - 1; i > 0; i--) std::swap(order[i], order[otestRandomInt(i + 1)]);
+	foreach(int i, order) js.submit(jobs[i]);
+
+	// Waiting for the last job must not require waiting for the others.
+	js.wait(jobs[numJobs - 1]);
+	OTEST_CHECK(jobs[numJobs - 1]->isDone());
+	for(int i = 0; i < numJobs; i++) js.wait(jobs[i]);
+
+	foreach(RecordJob* j, jobs)
+	{
+		OTEST_CHECK(j->isDone());
+		OTEST_CHECK(j->runs == 1);
+		OTEST_CHECK(j->depsDoneAtStart);
+		foreach(RecordJob* d, j->deps) OTEST_CHECK(d->sequence < j->sequence);
+	}
+
+	// Depending on a job that is already done does not block.
+	Ref<RecordJob> late = new RecordJob();
+	late->addDependency(jobs[0]);
+	js.submit(late);
+	js.wait(late);
+	OTEST_CHECK(late->runs == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testForkJoin(JobSystem& js)
+{
+	int count = 10000;
+	Ref<SumJob> sum = new SumJob(&js, 0, count);
+	js.submit(sum);
+	js.wait(sum);
+	OTEST_CHECK(sum->result == (long long)count * (count - 1) / 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testParallelFor(JobSystem& js)
+{
+	int sizes[] = { 0, 1, 7, 64, 1000, 4099 };
+	int batches[] = { 0, 1, 16, 1000 };
+	foreach(int count, sizes)
+	{
+		foreach(int batch, batches)
+		{
+			CountLoop loop(count);
+			js.parallelFor(count, batch, &loop);
+			// Every item processed exactly once.
+			foreach(int c, loop.counts) OTEST_CHECK(c == 1);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(19);
+
+	// With no threads, jobs run on the waiting thread.
+	int threads[] = { 0, 1, 4 };
+	foreach(int t, threads)
+	{
+		JobSystem js;
+		js.setThreads(t);
+		OTEST_CHECK(js.getThreads() == t);
+		for(int i = 0; i < 5; i++)
+		{
+			testDependencies(js);
+			testForkJoin(js);
+			testParallelFor(js);
+		}
+	}
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,186 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that events reach modules in the same order as the module loop 
+ *	used before the event routing table, with and without event filters.
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Modules that received the last event, in order.
+Vector<EngineModule*> sReceived;
+
+///////////////////////////////////////////////////////////////////////////////
+class TestModule: public EngineModule
+{
+public:
+	TestModule(): markProcessed(false) {}
+	// Modules are tested without an engine: consider them initialized.
+	virtual bool isInitialized() { return true; }
+	virtual void handleEvent(const Event& evt)
+	{
+		sReceived.push_back(this);
+		if(markProcessed) evt.setProcessed();
+	}
+	bool markProcessed;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+Service::ServiceType sServiceTypes[] = { 
+	Service::Pointer, Service::Mocap, Service::Keyboard, Service::Controller, 
+	Service::Ui, Service::Generic, Service::Wand, 
+	// Out of the filter range
+	(Service::ServiceType)(EngineModule::MaxFilterType + 10) };
+const int NumServiceTypes = sizeof(sServiceTypes) / sizeof(Service::ServiceType);
+
+Event::Type sEventTypes[] = { 
+	Event::Move, Event::Down, Event::Up, Event::Click, Event::Zoom, Event::Toggle };
+const int NumEventTypes = sizeof(sEventTypes) / sizeof(Event::Type);
+
+EngineModule::Priority sPriorities[] = { 
+	EngineModule::PriorityHighest, EngineModule::PriorityHigh, 
+	EngineModule::PriorityNormal, EngineModule::PriorityLow, 
+	EngineModule::PriorityLowest };
+
+///////////////////////////////////////////////////////////////////////////////
+// Dispatches an event with the same priority sequence as Engine::handleEvent.
+void dispatch(const Event& evt)
+{
+	foreach(EngineModule::Priority p, sPriorities)
+	{
+		if(!evt.isProcessed()) ModuleServices::handleEvent(evt, p);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The dispatch loop used before the routing table: every module is checked
+// at every priority level.
+void dispatchReference(const Event& evt, Vector<EngineModule*>& received)
+{
+	bool processed = false;
+	Vector<EngineModule*> modules = ModuleServices::getModules();
+	foreach(EngineModule::Priority p, sPriorities)
+	{
+		if(processed) break;
+		foreach(EngineModule* module, modules)
+		{
+			if(module->isInitialized() && module->getPriority() == p &&
+				module->isEventAccepted(evt))
+			{
+				received.push_back(module);
+				if(((TestModule*)module)->markProcessed) processed = true;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void randomFilters(TestModule* m)
+{
+	m->clearEventFilters();
+	// Most modules accept everything, as modules without filters do.
+	int f = otestRandomInt(6);
+	if(f == 1 || f == 4)
+	{
+		m->addEventServiceType(sServiceTypes[otestRandomInt(NumServiceTypes - 1)]);
+		if(otestRandomInt(2) == 0) 
+			m->addEventServiceType(sServiceTypes[otestRandomInt(NumServiceTypes - 1)]);
+	}
+	if(f == 2 || f == 4)
+	{
+		m->addEventType(sEventTypes[otestRandomInt(NumEventTypes)]);
+	}
+	if(f == 3)
+	{
+		uint first = otestRandomInt(4);
+		m->setEventSourceRange(first, first + otestRandomInt(4));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void checkEvents(int numEvents)
+{
+	for(int i = 0; i < numEvents; i++)
+	{
+		Event evt;
+		evt.reset(
+			sEventTypes[otestRandomInt(NumEventTypes)], 
+			sServiceTypes[otestRandomInt(NumServiceTypes)], 
+			otestRandomInt(8));
+
+		Vector<EngineModule*> expected;
+		dispatchReference(evt, expected);
+
+		sReceived.clear();
+		dispatch(evt);
+		OTEST_CHECK(sReceived == expected);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(21);
+
+	Vector<TestModule*> modules;
+	for(int round = 0; round < 20; round++)
+	{
+		// Add modules, then change priorities, filters and which modules 
+		// mark events as processed. Routes must follow all the changes.
+		int toAdd = 1 + otestRandomInt(10);
+		for(int i = 0; i < toAdd; i++)
+		{
+			TestModule* m = new TestModule();
+			m->setPriority(sPriorities[otestRandomInt(5)]);
+			randomFilters(m);
+			ModuleServices::addModule(m);
+			modules.push_back(m);
+		}
+		checkEvents(200);
+
+		foreach(TestModule* m, modules)
+		{
+			int change = otestRandomInt(4);
+			if(change == 0) m->setPriority(sPriorities[otestRandomInt(5)]);
+			else if(change == 1) randomFilters(m);
+			else if(change == 2) m->markProcessed = (otestRandomInt(8) == 0);
+		}
+		checkEvents(200);
+	}
+
+	ModuleServices::disposeAll();
+	return OTEST_RESULT();
+}
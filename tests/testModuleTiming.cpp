@@ -0,0 +1,142 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks module timing stats and the getSlowestModules ranking with modules
+ *	that sleep for known times in update and handleEvent.
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+class SleepModule: public EngineModule
+{
+public:
+	SleepModule(const String& name, int updateMs, int eventMs): 
+		EngineModule(name), myUpdateMs(updateMs), myEventMs(eventMs) {}
+	// Modules are tested without an engine: consider them initialized.
+	virtual bool isInitialized() { return true; }
+	virtual void update(const UpdateContext& context)
+	{ if(myUpdateMs > 0) osleep(myUpdateMs); }
+	virtual void handleEvent(const Event& evt)
+	{ if(myEventMs > 0) osleep(myEventMs); }
+
+	int myUpdateMs;
+	int myEventMs;
+};
+
+const int NumFrames = 10;
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	ModuleServices::setTimingEnabled(true);
+
+	// Expected totals over NumFrames frames: C 120ms, E 80ms, B 50ms, A 20ms,
+	// D 0ms. Modules are added out of order so the ranking comes from the 
+	// stats, not from the module list.
+	SleepModule* a = new SleepModule("A", 2, 0);
+	SleepModule* b = new SleepModule("B", 0, 5);
+	SleepModule* c = new SleepModule("C", 12, 0);
+	SleepModule* d = new SleepModule("D", 0, 0);
+	SleepModule* e = new SleepModule("E", 4, 4);
+	ModuleServices::addModule(a);
+	ModuleServices::addModule(b);
+	ModuleServices::addModule(c);
+	ModuleServices::addModule(d);
+	ModuleServices::addModule(e);
+
+	Vector<SleepModule*> modules;
+	modules.push_back(a);
+	modules.push_back(b);
+	modules.push_back(c);
+	modules.push_back(d);
+	modules.push_back(e);
+
+	foreach(SleepModule* m, modules)
+	{
+		OTEST_CHECK(m->getUpdateTimeStat() != NULL);
+		OTEST_CHECK(m->getEventTimeStat() != NULL);
+	}
+
+	UpdateContext context;
+	for(int frame = 0; frame < NumFrames; frame++)
+	{
+		// ModuleServices::update needs an engine to initialize modules: 
+		// run the same timed update call it uses for serial modules.
+		foreach(SleepModule* m, modules) m->doUpdate(context);
+
+		Event evt;
+		evt.reset(Event::Update, Service::Generic, 0, 0);
+		ModuleServices::handleEvent(evt, EngineModule::PriorityNormal);
+	}
+
+	// Stats are in milliseconds and include at least the sleep time.
+	foreach(SleepModule* m, modules)
+	{
+		if(m->myUpdateMs > 0) 
+			OTEST_CHECK(m->getUpdateTimeStat()->getAvg() >= m->myUpdateMs * 0.9f);
+		if(m->myEventMs > 0) 
+			OTEST_CHECK(m->getEventTimeStat()->getAvg() >= m->myEventMs * 0.9f);
+	}
+	OTEST_CHECK(b->getUpdateTimeStat()->getAvg() < 1.0f);
+	OTEST_CHECK(c->getTotalTime() >= 12 * NumFrames * 0.9);
+
+	Vector<EngineModule*> slowest = ModuleServices::getSlowestModules(5);
+	OTEST_CHECK(slowest.size() == 5);
+	if(slowest.size() == 5)
+	{
+		OTEST_CHECK(slowest[0] == c);
+		OTEST_CHECK(slowest[1] == e);
+		OTEST_CHECK(slowest[2] == b);
+		OTEST_CHECK(slowest[3] == a);
+		OTEST_CHECK(slowest[4] == d);
+	}
+
+	slowest = ModuleServices::getSlowestModules(3);
+	OTEST_CHECK(slowest.size() == 3);
+	if(slowest.size() == 3) OTEST_CHECK(slowest[2] == b);
+
+	// Disabling timing drops the stats.
+	ModuleServices::setTimingEnabled(false);
+	foreach(SleepModule* m, modules)
+	{
+		OTEST_CHECK(m->getUpdateTimeStat() == NULL);
+		OTEST_CHECK(m->getEventTimeStat() == NULL);
+		OTEST_CHECK(m->getTotalTime() == 0);
+	}
+
+	ModuleServices::disposeAll();
+	return OTEST_RESULT();
+}
@@ -0,0 +1,210 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks Node child management: indexed access, name lookup with duplicate
+ *	names, removal by index, pointer and name, renaming and reparenting.
+ ******************************************************************************/
+#include <omega.h>
+#include <algorithm>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Children a node is expected to have, in order.
+typedef Vector< Ref<Node> > ChildModel;
+
+///////////////////////////////////////////////////////////////////////////////
+String randomName()
+{
+	// Few names, so siblings often share one. Some nodes have no name.
+	int n = otestRandomInt(6);
+	if(n == 0) return "";
+	return ostr("node%1%", %n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int findChild(ChildModel& model, Node* child)
+{
+	for(int i = 0; i < model.size(); i++) if(model[i] == child) return i;
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void check(Node* parent, ChildModel& model)
+{
+	OTEST_CHECK(parent->numChildren() == model.size());
+
+	for(int i = 0; i < model.size(); i++)
+	{
+		OTEST_CHECK(parent->getChild(i) == model[i]);
+		OTEST_CHECK(model[i]->getParent() == parent);
+	}
+	OTEST_CHECK(parent->getChild(model.size()) == NULL);
+
+	// The child list keeps the same order as indexed access.
+	int i = 0;
+	foreach(Node* child, parent->getChildren())
+	{
+		OTEST_CHECK(i < model.size() && child == model[i]);
+		i++;
+	}
+	OTEST_CHECK(i == model.size());
+
+	// Name lookup returns one of the children with that name, and finds 
+	// every name in use.
+	for(int n = 1; n < 6; n++)
+	{
+		String name = ostr("node%1%", %n);
+		bool used = false;
+		foreach(Node* child, model) if(child->getName() == name) used = true;
+		if(used)
+		{
+			Node* found = parent->getChild(name);
+			OTEST_CHECK(found != NULL && found->getName() == name);
+			OTEST_CHECK(findChild(model, found) >= 0);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void removeFirstLoop()
+{
+	// Removing the first child repeatedly was the common teardown pattern.
+	Ref<Node> parent = new Node();
+	ChildModel model;
+	for(int i = 0; i < 2000; i++)
+	{
+		Node* child = new Node(randomName());
+		parent->addChild(child);
+		model.push_back(child);
+	}
+	while(parent->numChildren() > 0)
+	{
+		OTEST_CHECK(parent->getChild(0) == model[0]);
+		Ref<Node> removed = model[0];
+		parent->removeChild((unsigned short)0);
+		model.erase(model.begin());
+		OTEST_CHECK(removed->getParent() == NULL);
+		if(model.size() % 97 == 0) check(parent, model);
+	}
+	check(parent, model);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void randomOperations()
+{
+	Ref<Node> parent = new Node();
+	Ref<Node> other = new Node();
+	ChildModel model;
+	ChildModel otherModel;
+
+	for(int i = 0; i < 20000; i++)
+	{
+		int op = otestRandomInt(8);
+		if(op <= 2 || model.empty())
+		{
+			Node* child = new Node(randomName());
+			parent->addChild(child);
+			model.push_back(child);
+		}
+		else if(op == 3)
+		{
+			int index = otestRandomInt(model.size());
+			Ref<Node> removed = model[index];
+			parent->removeChild((unsigned short)index);
+			model.erase(model.begin() + index);
+			OTEST_CHECK(removed->getParent() == NULL);
+		}
+		else if(op == 4)
+		{
+			int index = otestRandomInt(model.size());
+			Ref<Node> removed = model[index];
+			Node* child = removed;
+			parent->removeChild(child);
+			model.erase(model.begin() + index);
+			OTEST_CHECK(removed->getParent() == NULL);
+			// Removing a node that is not a child does nothing.
+			parent->removeChild(child);
+		}
+		else if(op == 5)
+		{
+			String name = model[otestRandomInt(model.size())]->getName();
+			if(!name.empty())
+			{
+				Ref<Node> removed = parent->getChild(name);
+				parent->removeChild(name);
+				int index = findChild(model, removed);
+				OTEST_CHECK(index >= 0);
+				if(index >= 0) model.erase(model.begin() + index);
+				OTEST_CHECK(removed->getParent() == NULL);
+			}
+		}
+		else if(op == 6)
+		{
+			model[otestRandomInt(model.size())]->setName(randomName());
+		}
+		else
+		{
+			// Move a child to another parent and back.
+			int index = otestRandomInt(model.size());
+			Ref<Node> child = model[index];
+			other->addChild(child);
+			model.erase(model.begin() + index);
+			otherModel.push_back(child);
+			check(other, otherModel);
+			if(otestRandomInt(2) == 0)
+			{
+				parent->addChild(child);
+				otherModel.pop_back();
+				model.push_back(child);
+			}
+		}
+		check(parent, model);
+	}
+	check(other, otherModel);
+
+	parent->removeAllChildren();
+	foreach(Node* child, model) OTEST_CHECK(child->getParent() == NULL);
+	model.clear();
+	check(parent, model);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(17);
+	removeFirstLoop();
+	randomOperations();
+	return OTEST_RESULT();
+}
@@ -0,0 +1,202 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks PixelData dirty region tracking: each GPU context gets the union 
+ *	of the regions changed since its last refresh, and copying only those
+ *	regions into a per-context copy of the image keeps it equal to a full 
+ *	copy.
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+static const int sWidth = 100;
+static const int sHeight = 80;
+
+///////////////////////////////////////////////////////////////////////////////
+// A copy of the image, standing in for the texture of a GPU context.
+struct ContextImage
+{
+	uint id;
+	Vector<byte> pixels;
+	// Bounding box of the changes made since the last refresh.
+	int x0, y0, x1, y1;
+	bool full;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+bool isRect(const Rect& r, int x, int y, int width, int height)
+{
+	return r.x() == x && r.y() == y && r.width() == width && r.height() == height;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void addChange(Vector<ContextImage>& contexts, int x, int y, int w, int h)
+{
+	foreach(ContextImage& c, contexts)
+	{
+		if(c.x1 <= c.x0)
+		{
+			c.x0 = x; c.y0 = y; c.x1 = x + w; c.y1 = y + h;
+		}
+		else
+		{
+			c.x0 = std::min(c.x0, x); c.y0 = std::min(c.y0, y);
+			c.x1 = std::max(c.x1, x + w); c.y1 = std::max(c.y1, y + h);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Copies the dirty region of the image into a context image, like a texture
+// refresh, and checks it matches the changes made since the last refresh.
+void refresh(PixelData* pd, ContextImage& c)
+{
+	Rect r = pd->takeDirtyRegion(c.id);
+	if(c.full)
+	{
+		OTEST_CHECK(isRect(r, 0, 0, sWidth, sHeight));
+	}
+	else if(c.x1 > c.x0)
+	{
+		OTEST_CHECK(isRect(r, c.x0, c.y0, c.x1 - c.x0, c.y1 - c.y0));
+	}
+	c.full = false;
+	c.x0 = c.y0 = c.x1 = c.y1 = 0;
+
+	int pitch = pd->getPitch();
+	int rowSize = r.width() * 4;
+	byte* src = pd->map();
+	for(int y = r.y(); y < r.y() + r.height(); y++)
+	{
+		memcpy(&c.pixels[y * pitch + r.x() * 4], src + y * pitch + r.x() * 4, rowSize);
+	}
+	pd->unmap();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(13);
+	Ref<PixelData> pd = new PixelData(PixelData::FormatRgba, sWidth, sHeight);
+	memset(pd->map(), 0, pd->getSize());
+	pd->unmap();
+
+	// New images are fully dirty on all contexts.
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(0), 0, 0, sWidth, sHeight));
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(1), 0, 0, sWidth, sHeight));
+
+	// Each context accumulates the changes since its own last refresh.
+	pd->setDirtyRegion(10, 10, 5, 5);
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(0), 10, 10, 5, 5));
+	pd->setDirtyRegion(50, 50, 10, 10);
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(0), 50, 50, 10, 10));
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(1), 10, 10, 50, 50));
+
+	// Regions are clipped to the image, and regions outside are ignored.
+	pd->setDirtyRegion(-5, 70, 20, 20);
+	pd->setDirtyRegion(200, 200, 5, 5);
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(0), 0, 70, 15, 10));
+
+	// setPixel only marks the changed pixel.
+	pd->takeDirtyRegion(1);
+	pd->beginPixelAccess();
+	pd->setPixel(3, 4, 1, 2, 3, 4);
+	pd->endPixelAccess();
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(0), 3, 4, 1, 1));
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(1), 3, 4, 1, 1));
+
+	// setDirty marks the whole image.
+	pd->setDirtyRegion(10, 10, 5, 5);
+	pd->setDirty();
+	pd->setDirtyRegion(10, 10, 5, 5);
+	OTEST_CHECK(isRect(pd->takeDirtyRegion(0), 0, 0, sWidth, sHeight));
+
+	// Random changes, with contexts refreshed at different rates. Copying 
+	// dirty regions keeps every context copy equal to the image.
+	Vector<ContextImage> contexts;
+	contexts.resize(3);
+	for(int i = 0; i < contexts.size(); i++)
+	{
+		ContextImage& c = contexts[i];
+		c.id = i;
+		c.pixels.resize(pd->getSize());
+		c.full = true;
+		c.x0 = c.y0 = c.x1 = c.y1 = 0;
+		refresh(pd, c);
+	}
+	for(int frame = 0; frame < 200; frame++)
+	{
+		int numChanges = otestRandomInt(4);
+		for(int i = 0; i < numChanges; i++)
+		{
+			if(otestRandomInt(2) == 0)
+			{
+				int x = otestRandomInt(sWidth);
+				int y = otestRandomInt(sHeight);
+				pd->beginPixelAccess();
+				pd->setPixel(x, y, otestRandomInt(256), otestRandomInt(256), otestRandomInt(256), 255);
+				pd->endPixelAccess();
+				addChange(contexts, x, y, 1, 1);
+			}
+			else
+			{
+				int x = otestRandomInt(sWidth);
+				int y = otestRandomInt(sHeight);
+				int w = 1 + otestRandomInt(sWidth - x);
+				int h = 1 + otestRandomInt(sHeight - y);
+				byte* p = pd->map();
+				for(int r = y; r < y + h; r++) memset(p + r * pd->getPitch() + x * 4, otestRandomInt(256), w * 4);
+				pd->unmap();
+				pd->setDirtyRegion(x, y, w, h);
+				addChange(contexts, x, y, w, h);
+			}
+		}
+		if(otestRandomInt(50) == 0)
+		{
+			pd->setDirty();
+			foreach(ContextImage& c, contexts) c.full = true;
+		}
+
+		for(int i = 0; i < contexts.size(); i++)
+		{
+			if(frame % (i + 1) != 0) continue;
+			refresh(pd, contexts[i]);
+			OTEST_CHECK(memcmp(&contexts[i].pixels[0], pd->map(), pd->getSize()) == 0);
+			pd->unmap();
+		}
+	}
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,194 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks SceneBvh ray queries against brute force hit tests on all nodes,
+ *	with random scenes, and after nodes are removed, moved and re-added.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/SceneQuery.h"
+#include "omega/NodeComponent.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// A component with a fixed bounding box.
+class BoxComponent: public NodeComponent
+{
+public:
+	BoxComponent(const Vector3f& halfSize)
+	{ myBox.setExtents(-halfSize, halfSize); }
+	virtual void update(const UpdateContext& context) {}
+	virtual const AlignedBox3* getBoundingBox() { return &myBox; }
+	virtual bool hasBoundingBox() { return true; }
+	virtual bool isInitialized() { return true; }
+	virtual void initialize(Engine* server) {}
+
+private:
+	AlignedBox3 myBox;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void randomizeNode(SceneNode* node)
+{
+	node->setPosition(
+		otestRandom(-50, 50), otestRandom(-50, 50), otestRandom(-50, 50));
+	// Compute the node bounds now: nodes are tested without an engine, so 
+	// they must not be moved while in the hierarchy.
+	node->getBoundingBox();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Ray randomRay()
+{
+	Vector3f origin(
+		otestRandom(-80, 80), otestRandom(-80, 80), otestRandom(-80, 80));
+	Vector3f target(
+		otestRandom(-50, 50), otestRandom(-50, 50), otestRandom(-50, 50));
+	Vector3f dir = target - origin;
+	dir.normalize();
+	return Ray(origin, dir);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void checkQueries(SceneBvh& bvh, Vector< Ref<SceneNode> >& nodes, Vector<bool>& queryable, int numRays)
+{
+	for(int i = 0; i < numRays; i++)
+	{
+		Ray ray = randomRay();
+
+		// Brute force
+		Vector<SceneNode*> expected;
+		float nearest = FLT_MAX;
+		for(int j = 0; j < nodes.size(); j++)
+		{
+			Vector3f hitPoint;
+			if(queryable[j] && nodes[j]->hit(ray, &hitPoint, SceneNode::HitBest))
+			{
+				expected.push_back(nodes[j]);
+				float d = (hitPoint - ray.getOrigin()).norm();
+				if(d < nearest) nearest = d;
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+
+		SceneQueryResultList results;
+		bvh.queryRay(ray, false, results);
+		Vector<SceneNode*> actual;
+		foreach(const SceneQueryResult& r, results) actual.push_back(r.node);
+		std::sort(actual.begin(), actual.end());
+		OTEST_CHECK(actual == expected);
+
+		SceneQueryResultList first;
+		bvh.queryRay(ray, true, first);
+		if(expected.empty())
+		{
+			OTEST_CHECK(first.empty());
+		}
+		else
+		{
+			OTEST_CHECK(first.size() == 1);
+			if(first.size() == 1) 
+			{
+				OTEST_CHECK(fabs(first[0].distance - nearest) < 1e-3f);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(14);
+
+	for(int scene = 0; scene < 10; scene++)
+	{
+		int numNodes = 50 + otestRandomInt(500);
+		SceneBvh bvh;
+		Vector< Ref<SceneNode> > nodes;
+		Vector<bool> queryable;
+		for(int i = 0; i < numNodes; i++)
+		{
+			SceneNode* node = new SceneNode(NULL);
+			node->setSelectable(true);
+			node->addComponent(new BoxComponent(Vector3f(
+				otestRandom(0.1f, 5), otestRandom(0.1f, 5), otestRandom(0.1f, 5))));
+			randomizeNode(node);
+			// Some nodes are not selectable, and must never be returned.
+			if(i % 10 == 0) node->setSelectable(false);
+			nodes.push_back(node);
+			queryable.push_back(node->isSelectable());
+			bvh.addNode(node);
+		}
+		OTEST_CHECK(bvh.getNumNodes() == numNodes);
+		checkQueries(bvh, nodes, queryable, 200);
+
+		// Remove some nodes, move others (remove, move, add back) and add 
+		// new ones, so both incremental updates and rebuilds are covered.
+		for(int i = 0; i < numNodes; i++)
+		{
+			int op = otestRandomInt(3);
+			if(op == 0)
+			{
+				bvh.removeNode(nodes[i]);
+				queryable[i] = false;
+			}
+			else if(op == 1)
+			{
+				bvh.removeNode(nodes[i]);
+				randomizeNode(nodes[i]);
+				bvh.addNode(nodes[i]);
+			}
+		}
+		for(int i = 0; i < numNodes; i++)
+		{
+			SceneNode* node = new SceneNode(NULL);
+			node->setSelectable(true);
+			node->addComponent(new BoxComponent(Vector3f(1, 1, 1)));
+			randomizeNode(node);
+			nodes.push_back(node);
+			queryable.push_back(true);
+			bvh.addNode(node);
+		}
+		checkQueries(bvh, nodes, queryable, 200);
+
+		// Nodes must leave the hierarchy before being destroyed, since they
+		// have no engine to remove themselves from.
+		bvh.clear();
+	}
+
+	return OTEST_RESULT();
+}
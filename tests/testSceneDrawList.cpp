@@ -0,0 +1,280 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks SceneDrawList build and cull on random scenes against synthetic
+ *	view frusta. Culled lists must match a recursive traversal of the scene,
+ *	and never drop a node with a component that brute force sampling finds 
+ *	inside the frustum, or a node with a component without bounding box.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/SceneDrawList.h"
+#include "omega/NodeComponent.h"
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// A component with a fixed bounding box.
+class BoxComponent: public NodeComponent
+{
+public:
+	BoxComponent(const Vector3f& halfSize)
+	{ myBox.setExtents(-halfSize, halfSize); }
+	virtual void update(const UpdateContext& context) {}
+	virtual const AlignedBox3* getBoundingBox() { return &myBox; }
+	virtual bool hasBoundingBox() { return true; }
+	virtual bool isInitialized() { return true; }
+	virtual void initialize(Engine* server) {}
+
+private:
+	AlignedBox3 myBox;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A component without bounding box: its node can never be culled.
+class UnboundedComponent: public NodeComponent
+{
+public:
+	virtual void update(const UpdateContext& context) {}
+	virtual const AlignedBox3* getBoundingBox() { return NULL; }
+	virtual bool hasBoundingBox() { return false; }
+	virtual bool isInitialized() { return true; }
+	virtual void initialize(Engine* server) {}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct TestScene
+{
+	Vector< Ref<SceneNode> > nodes;
+	Vector<int> parents;
+	Vector< Vector<int> > children;
+	// Local boxes of the bounded components of each node.
+	Vector< Vector<AlignedBox3> > boxes;
+	Vector<bool> unbounded;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void buildScene(TestScene& s, int numNodes)
+{
+	for(int i = 0; i < numNodes; i++)
+	{
+		SceneNode* node = new SceneNode(NULL);
+		int parent = i > 0 ? otestRandomInt(i) : -1;
+		s.nodes.push_back(node);
+		s.parents.push_back(parent);
+		s.children.push_back(Vector<int>());
+		s.boxes.push_back(Vector<AlignedBox3>());
+		s.unbounded.push_back(false);
+		if(i == 0) continue;
+
+		node->setPosition(otestRandom(-20, 20), otestRandom(-20, 20), otestRandom(-20, 20));
+		int kind = otestRandomInt(20);
+		// Most nodes have one or two bounded components, some are just
+		// groups, and a few have a component without bounding box.
+		int numBoxes = kind < 14 ? 1 : (kind < 16 ? 2 : 0);
+		for(int j = 0; j < numBoxes; j++)
+		{
+			Vector3f halfSize(otestRandom(0.1f, 5), otestRandom(0.1f, 5), otestRandom(0.1f, 5));
+			node->addComponent(new BoxComponent(halfSize));
+			AlignedBox3 box;
+			box.setExtents(-halfSize, halfSize);
+			s.boxes[i].push_back(box);
+		}
+		if(kind == 19)
+		{
+			node->addComponent(new UnboundedComponent());
+			s.unbounded[i] = true;
+		}
+		if(otestRandomInt(20) == 0) node->setVisible(false);
+
+		s.nodes[parent]->addChild(node);
+		s.children[parent].push_back(i);
+	}
+
+	// Update transforms, then world bounding boxes from the leaves up, like
+	// the engine does after the scene update.
+	s.nodes[0]->update(true, false);
+	for(int i = numNodes - 1; i >= 0; i--)
+	{
+		s.nodes[i]->requestBoundingBoxUpdate();
+		s.nodes[i]->getBoundingBox();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns true if the visible part of a subtree has no unbounded components.
+bool isCullable(TestScene& s, int node)
+{
+	if(!s.nodes[node]->isVisible()) return true;
+	if(s.unbounded[node]) return false;
+	foreach(int c, s.children[node]) if(!isCullable(s, c)) return false;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Recursive reference traversal. With a NULL context, nothing is culled.
+void referenceCull(TestScene& s, int node, const DrawContext* context, Vector<SceneNode*>& outNodes)
+{
+	SceneNode* n = s.nodes[node];
+	if(!n->isVisible()) return;
+	if(context != NULL && isCullable(s, node))
+	{
+		const AlignedBox3& box = n->getBoundingBox();
+		if(box.isNull() || (box.isFinite() && !context->isBoxVisible(box))) return;
+	}
+	outNodes.push_back(n);
+	foreach(int c, s.children[node]) referenceCull(s, c, context, outNodes);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool isInside(const Eigen::Matrix4f& m, const Vector3f& p)
+{
+	Vector4f c = m * Vector4f(p[0], p[1], p[2], 1);
+	return c[3] > 0 && 
+		fabs(c[0]) <= c[3] && fabs(c[1]) <= c[3] && fabs(c[2]) <= c[3];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Brute force visibility: samples the corners, center and random points of a
+// world space box and checks if any of them is inside the frustum.
+bool sampleBoxVisible(const Eigen::Matrix4f& m, const AlignedBox3& box)
+{
+	Vector3f bmin = box.getMinimum();
+	Vector3f bmax = box.getMaximum();
+	for(int i = 0; i < 8; i++)
+	{
+		Vector3f p(i & 1 ? bmax[0] : bmin[0], i & 2 ? bmax[1] : bmin[1], i & 4 ? bmax[2] : bmin[2]);
+		if(isInside(m, p)) return true;
+	}
+	if(isInside(m, box.getCenter())) return true;
+	for(int i = 0; i < 20; i++)
+	{
+		Vector3f p(
+			otestRandom(bmin[0], bmax[0]), otestRandom(bmin[1], bmax[1]), otestRandom(bmin[2], bmax[2]));
+		if(isInside(m, p)) return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sets up a random, possibly off-axis, perspective view.
+void randomView(DrawContext& context)
+{
+	Vector3f eye(otestRandom(-80, 80), otestRandom(-80, 80), otestRandom(-80, 80));
+	Quaternion q(otestRandom(-1, 1), otestRandom(-1, 1), otestRandom(-1, 1), otestRandom(-1, 1));
+	q.normalize();
+	context.modelview.setIdentity();
+	context.modelview.rotate(q);
+	context.modelview.translate(-eye);
+
+	float nearZ = otestRandom(0.1f, 2);
+	float farZ = otestRandom(30, 300);
+	float l = -otestRandom(0.1f, 2) * nearZ;
+	float r = otestRandom(-0.05f, 2) * nearZ;
+	float b = -otestRandom(0.1f, 2) * nearZ;
+	float t = otestRandom(-0.05f, 2) * nearZ;
+	if(r <= l) r = l + 0.1f;
+	if(t <= b) t = b + 0.1f;
+
+	Transform3 p;
+	p.setIdentity();
+	p(0,0) = 2 * nearZ / (r - l);
+	p(0,2) = (r + l) / (r - l);
+	p(1,1) = 2 * nearZ / (t - b);
+	p(1,2) = (t + b) / (t - b);
+	p(2,2) = - (farZ + nearZ) / (farZ - nearZ);
+	p(2,3) = - (2 * farZ * nearZ) / (farZ - nearZ);
+	p(3,2) = - 1;
+	p(3,3) = 0;
+	context.projection = p;
+
+	context.updateFrustum();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(15);
+
+	for(int scene = 0; scene < 10; scene++)
+	{
+		TestScene s;
+		buildScene(s, 50 + otestRandomInt(500));
+
+		SceneDrawList list;
+		list.build(s.nodes[0]);
+
+		// Without culling, the list holds all the visible nodes in draw order.
+		Vector<SceneNode*> all;
+		referenceCull(s, 0, NULL, all);
+		OTEST_CHECK(list.getNumNodes() == all.size());
+		DrawContext context;
+		Vector<SceneNode*> nodes;
+		list.setCullingEnabled(false);
+		list.cull(context, nodes);
+		OTEST_CHECK(nodes == all);
+		list.setCullingEnabled(true);
+
+		for(int view = 0; view < 50; view++)
+		{
+			randomView(context);
+			nodes.clear();
+			list.cull(context, nodes);
+			OTEST_CHECK(list.getNumDrawn() == nodes.size());
+			OTEST_CHECK(list.getNumDrawn() + list.getNumCulled() == list.getNumNodes());
+
+			Vector<SceneNode*> expected;
+			referenceCull(s, 0, &context, expected);
+			OTEST_CHECK(nodes == expected);
+
+			// No node whose components may be visible gets culled.
+			Dictionary<SceneNode*, bool> drawn;
+			foreach(SceneNode* n, nodes) drawn[n] = true;
+			Eigen::Matrix4f m = context.projection.matrix() * context.modelview.matrix();
+			foreach(SceneNode* n, all)
+			{
+				int i = 0;
+				while(s.nodes[i] != n) i++;
+				bool mustDraw = s.unbounded[i];
+				foreach(AlignedBox3 box, s.boxes[i])
+				{
+					box.transformAffine(n->getFullTransform());
+					if(sampleBoxVisible(m, box)) mustDraw = true;
+				}
+				if(mustDraw) OTEST_CHECK(drawn.find(n) != drawn.end());
+			}
+		}
+	}
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,186 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Round-trips shared data frames with and without compression. Checks that
+ *	frames under the compression threshold, or that do not shrink, are sent
+ *	raw, and that slaves read both kinds of frames.
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+class PayloadObject: public SharedObject
+{
+public:
+	virtual void commitSharedData(SharedOStream& out) 
+	{ 
+		uint64_t size = payload.size();
+		out << size;
+		if(size > 0) out.write(&payload[0], size);
+	}
+	virtual void updateSharedData(SharedIStream& in) 
+	{ 
+		uint64_t size;
+		in >> size;
+		payload.resize(size);
+		if(size > 0) in.read(&payload[0], size);
+	}
+
+	Vector<byte> payload;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Wraps the zlib compressor, counting calls. Can also fail compression, or
+// make data grow.
+class TestCompressor: public SharedDataCompressor
+{
+public:
+	enum Mode { Compress, Fail, Grow };
+
+	TestCompressor(): mode(Compress), compressions(0), myName("test") {}
+
+	virtual const String& getName() { return myName; }
+	virtual uint64_t getMaxCompressedSize(uint64_t size) 
+	{ return myZLib.getMaxCompressedSize(size); }
+
+	virtual uint64_t compress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize)
+	{
+		compressions++;
+		if(mode == Fail) return 0;
+		if(mode == Grow)
+		{
+			memcpy(dst, src, srcSize);
+			dst[srcSize] = 0;
+			return srcSize + 1;
+		}
+		return myZLib.compress(src, srcSize, dst, dstSize);
+	}
+
+	virtual bool decompress(const byte* src, uint64_t srcSize, byte* dst, uint64_t dstSize)
+	{ return myZLib.decompress(src, srcSize, dst, dstSize); }
+
+	Mode mode;
+	int compressions;
+
+private:
+	String myName;
+	ZLibSharedDataCompressor myZLib;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Frame types, from the first byte of each frame.
+enum FrameType { FrameRaw = 0, FrameCompressed = 1 };
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes a frame on the master and reads it back on a slave. Returns the 
+// frame type.
+int sendFrame(SharedDataCodec& master, SharedDataCodec& slave)
+{
+	Vector<byte> buffer;
+	SharedOStream out(&buffer);
+	master.writeFrame(out, true);
+	OTEST_CHECK(master.getLastSentSize() == buffer.size());
+
+	SharedIStream in(&buffer[0], buffer.size());
+	slave.readFrame(in);
+	OTEST_CHECK(in.getRemainingSize() == 0);
+	OTEST_CHECK(slave.getLastSentSize() == buffer.size());
+	OTEST_CHECK(slave.getLastFrameSize() == master.getLastFrameSize());
+	return buffer[0];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(3);
+
+	Ref<TestCompressor> compressor = new TestCompressor();
+	SharedDataCodec master(true);
+	SharedDataCodec slave(false);
+	uint64_t threshold = 4096;
+	master.setCompressor(compressor, threshold);
+	slave.setCompressor(compressor, threshold);
+
+	Ref<PayloadObject> mo = new PayloadObject();
+	Ref<PayloadObject> so = new PayloadObject();
+	master.registerObject(mo, "payload");
+	slave.registerObject(so, "payload");
+
+	// Compressible frame above the threshold.
+	mo->payload.resize(64 * 1024);
+	for(int i = 0; i < mo->payload.size(); i++) mo->payload[i] = (i / 64) % 7;
+	OTEST_CHECK(sendFrame(master, slave) == FrameCompressed);
+	OTEST_CHECK(compressor->compressions == 1);
+	OTEST_CHECK(master.getLastSentSize() < master.getLastFrameSize() / 4);
+	OTEST_CHECK(so->payload == mo->payload);
+
+	// Frames under the threshold are not compressed.
+	mo->payload.resize(1024);
+	OTEST_CHECK(sendFrame(master, slave) == FrameRaw);
+	OTEST_CHECK(compressor->compressions == 1);
+	OTEST_CHECK(master.getLastSentSize() == master.getLastFrameSize() + 1);
+	OTEST_CHECK(so->payload == mo->payload);
+
+	// Incompressible frames are sent raw.
+	mo->payload.resize(64 * 1024);
+	for(int i = 0; i < mo->payload.size(); i++) mo->payload[i] = otestRandomInt(256);
+	compressor->mode = TestCompressor::Grow;
+	OTEST_CHECK(sendFrame(master, slave) == FrameRaw);
+	OTEST_CHECK(compressor->compressions == 2);
+	OTEST_CHECK(so->payload == mo->payload);
+
+	// So are frames the compressor fails on.
+	compressor->mode = TestCompressor::Fail;
+	OTEST_CHECK(sendFrame(master, slave) == FrameRaw);
+	OTEST_CHECK(compressor->compressions == 3);
+	OTEST_CHECK(so->payload == mo->payload);
+
+	// Compressed and raw frames carry the same data as frames written with 
+	// no compressor.
+	compressor->mode = TestCompressor::Compress;
+	for(int i = 0; i < mo->payload.size(); i++) mo->payload[i] = (i % 100 < 50) ? 0 : otestRandomInt(256);
+	OTEST_CHECK(sendFrame(master, slave) == FrameCompressed);
+	uint64_t compressedFrameSize = master.getLastFrameSize();
+	OTEST_CHECK(so->payload == mo->payload);
+
+	master.setCompressor(NULL, 0);
+	so->payload.clear();
+	OTEST_CHECK(sendFrame(master, slave) == FrameRaw);
+	OTEST_CHECK(master.getLastFrameSize() == compressedFrameSize);
+	OTEST_CHECK(master.getLastSentSize() == compressedFrameSize + 1);
+	OTEST_CHECK(so->payload == mo->payload);
+
+	return OTEST_RESULT();
+}
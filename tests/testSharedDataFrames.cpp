@@ -0,0 +1,205 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Round-trips versioned shared data frames through memory streams. Checks
+ *	that unchanged versioned objects are skipped, that keyframes and frames
+ *	for new slaves resend the full state, and that frames for new slaves do
+ *	not change what is tracked as sent.
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+class TestObject: public SharedObject
+{
+public:
+	TestObject(bool versioned): value(0), commits(0), updates(0), lastKeyframe(false)
+	{ setSharedDataVersioned(versioned); }
+
+	virtual void commitSharedData(SharedOStream& out)
+	{
+		out << value;
+		commits++;
+		lastKeyframe = out.isKeyframe();
+	}
+
+	virtual void updateSharedData(SharedIStream& in)
+	{
+		in >> value;
+		updates++;
+	}
+
+	void set(int v) { value = v; markSharedDataChanged(); }
+
+	int value;
+	int commits;
+	int updates;
+	bool lastKeyframe;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes a frame on the master and reads it back on a slave.
+void sendFrame(SharedDataCodec& master, SharedDataCodec& slave, bool committing = true)
+{
+	Vector<byte> buffer;
+	SharedOStream out(&buffer);
+	master.writeFrame(out, committing);
+	OTEST_CHECK(out.getBytesWritten() == buffer.size());
+
+	SharedIStream in(&buffer[0], buffer.size());
+	slave.readFrame(in);
+	OTEST_CHECK(in.getRemainingSize() == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testVersioning()
+{
+	SharedDataCodec master(true);
+	SharedDataCodec slave(false);
+	master.setVersioningEnabled(true);
+	master.setKeyframeInterval(4);
+
+	Ref<TestObject> ma = new TestObject(true);
+	Ref<TestObject> mb = new TestObject(true);
+	Ref<TestObject> mc = new TestObject(false);
+	Ref<TestObject> sa = new TestObject(true);
+	Ref<TestObject> sb = new TestObject(true);
+	Ref<TestObject> sc = new TestObject(false);
+	master.registerObject(ma, "a");
+	master.registerObject(mb, "b");
+	master.registerObject(mc, "c");
+	slave.registerObject(sa, "a");
+	slave.registerObject(sb, "b");
+	slave.registerObject(sc, "c");
+
+	ma->set(1);
+	mb->set(2);
+	mc->set(3);
+
+	// The first frame is a keyframe.
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 3);
+	OTEST_CHECK(slave.getLastFrameObjects() == 3);
+	OTEST_CHECK(ma->lastKeyframe);
+	OTEST_CHECK(sa->value == 1 && sb->value == 2 && sc->value == 3);
+
+	// Unchanged versioned objects are skipped, unversioned ones are not.
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 1);
+	OTEST_CHECK(ma->commits == 1 && mb->commits == 1 && mc->commits == 2);
+	OTEST_CHECK(sa->updates == 1 && sb->updates == 1 && sc->updates == 2);
+	OTEST_CHECK(!mc->lastKeyframe);
+
+	// Changed objects are sent once.
+	mb->set(20);
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 2);
+	OTEST_CHECK(sb->value == 20 && sb->updates == 2);
+	OTEST_CHECK(!mb->lastKeyframe);
+	sendFrame(master, slave);
+	OTEST_CHECK(sb->updates == 2);
+
+	// Three delta frames since the keyframe so far: the keyframe interval
+	// resends everything once 4 delta frames have been sent.
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 1);
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 3);
+	OTEST_CHECK(ma->lastKeyframe && mb->lastKeyframe);
+	OTEST_CHECK(sa->updates == 2 && sb->updates == 3);
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 1);
+
+	// Requested keyframes resend everything too.
+	master.requestKeyframe();
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 3);
+	OTEST_CHECK(sa->value == 1 && sb->value == 20 && sc->value == 3);
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 1);
+
+	// Changes are still sent after a frame written for a new slave. 
+	SharedDataCodec newSlave(false);
+	Ref<TestObject> na = new TestObject(true);
+	Ref<TestObject> nb = new TestObject(true);
+	Ref<TestObject> nc = new TestObject(false);
+	newSlave.registerObject(na, "a");
+	newSlave.registerObject(nb, "b");
+	newSlave.registerObject(nc, "c");
+
+	ma->set(10);
+	sendFrame(master, newSlave, false);
+	OTEST_CHECK(ma->lastKeyframe);
+	OTEST_CHECK(na->value == 10 && nb->value == 20 && nc->value == 3);
+	sendFrame(master, slave);
+	OTEST_CHECK(master.getLastFrameObjects() == 2);
+	OTEST_CHECK(sa->value == 10);
+	OTEST_CHECK(!ma->lastKeyframe);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void testNoVersioning()
+{
+	// Without versioning, every object is sent every frame, but objects do
+	// not need to send their full state.
+	SharedDataCodec master(true);
+	SharedDataCodec slave(false);
+
+	Ref<TestObject> ma = new TestObject(true);
+	Ref<TestObject> sa = new TestObject(true);
+	master.registerObject(ma, "a");
+	slave.registerObject(sa, "a");
+
+	for(int i = 0; i < 5; i++)
+	{
+		sendFrame(master, slave);
+		OTEST_CHECK(master.getLastFrameObjects() == 1);
+		OTEST_CHECK(!ma->lastKeyframe);
+	}
+	OTEST_CHECK(sa->updates == 5);
+
+	// New slaves always get the full state.
+	sendFrame(master, slave, false);
+	OTEST_CHECK(ma->lastKeyframe);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	testVersioning();
+	testNoVersioning();
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that the integer object ids used in shared data frames resolve
+ *	to the right objects: for objects registered between keyframes, on new
+ *	slaves, and after objects are unregistered and registered again.
+ ******************************************************************************/
+#include <omega.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+class TestObject: public SharedObject
+{
+public:
+	TestObject(int v = 0): value(v), updates(0) {}
+
+	virtual void commitSharedData(SharedOStream& out) { out << value; }
+	virtual void updateSharedData(SharedIStream& in) { in >> value; updates++; }
+
+	int value;
+	int updates;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes a frame on the master and reads it on all the slaves.
+void sendFrame(SharedDataCodec& master, const Vector<SharedDataCodec*>& slaves, bool committing = true)
+{
+	Vector<byte> buffer;
+	SharedOStream out(&buffer);
+	master.writeFrame(out, committing);
+
+	foreach(SharedDataCodec* slave, slaves)
+	{
+		SharedIStream in(&buffer[0], buffer.size());
+		slave->readFrame(in);
+		OTEST_CHECK(in.getRemainingSize() == 0);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	SharedDataCodec master(true);
+	SharedDataCodec slave(false);
+	Vector<SharedDataCodec*> slaves;
+	slaves.push_back(&slave);
+
+	Ref<TestObject> ma = new TestObject(1);
+	Ref<TestObject> mb = new TestObject(2);
+	Ref<TestObject> sa = new TestObject();
+	Ref<TestObject> sb = new TestObject();
+	master.registerObject(ma, "a");
+	master.registerObject(mb, "b");
+	// Registration order on slaves does not matter.
+	slave.registerObject(sb, "b");
+	slave.registerObject(sa, "a");
+
+	sendFrame(master, slaves);
+	OTEST_CHECK(sa->value == 1 && sb->value == 2);
+
+	// Id definitions are sent once: later frames only carry ids.
+	sendFrame(master, slaves);
+	uint64_t baseSize = master.getLastFrameSize();
+
+	// Objects registered between keyframes get their definition in the next
+	// frame only.
+	Ref<TestObject> mc = new TestObject(3);
+	Ref<TestObject> sc = new TestObject();
+	master.registerObject(mc, "c");
+	slave.registerObject(sc, "c");
+	sendFrame(master, slaves);
+	uint64_t objectSize = sizeof(uint) + sizeof(int);
+	uint64_t definitionSize = sizeof(uint) + sizeof(uint64_t) + 1;
+	OTEST_CHECK(master.getLastFrameSize() == baseSize + objectSize + definitionSize);
+	OTEST_CHECK(sa->value == 1 && sb->value == 2 && sc->value == 3);
+	sendFrame(master, slaves);
+	OTEST_CHECK(master.getLastFrameSize() == baseSize + objectSize);
+
+	// A new slave gets the full id table when mapping the shared data, then
+	// resolves ids in regular frames.
+	SharedDataCodec newSlave(false);
+	Ref<TestObject> na = new TestObject();
+	Ref<TestObject> nb = new TestObject();
+	Ref<TestObject> nc = new TestObject();
+	newSlave.registerObject(nc, "c");
+	newSlave.registerObject(na, "a");
+	newSlave.registerObject(nb, "b");
+	Vector<SharedDataCodec*> mapping;
+	mapping.push_back(&newSlave);
+	sendFrame(master, mapping, false);
+	OTEST_CHECK(na->value == 1 && nb->value == 2 && nc->value == 3);
+
+	// The mapping frame does not consume definitions pending for the other
+	// slaves.
+	Ref<TestObject> md = new TestObject(4);
+	Ref<TestObject> sd = new TestObject();
+	Ref<TestObject> nd = new TestObject();
+	master.registerObject(md, "d");
+	slave.registerObject(sd, "d");
+	newSlave.registerObject(nd, "d");
+	sendFrame(master, mapping, false);
+	slaves.push_back(&newSlave);
+	ma->value = 10;
+	mb->value = 20;
+	sendFrame(master, slaves);
+	OTEST_CHECK(sa->value == 10 && sb->value == 20 && sc->value == 3 && sd->value == 4);
+	OTEST_CHECK(na->value == 10 && nb->value == 20 && nc->value == 3 && nd->value == 4);
+
+	// Unregistered objects are not sent anymore.
+	master.unregisterObject("b");
+	int updates = sb->updates;
+	sendFrame(master, slaves);
+	OTEST_CHECK(sb->updates == updates);
+	OTEST_CHECK(master.getLastFrameObjects() == 3);
+
+	// Registering a key again reuses its id, on the master and on slaves.
+	Ref<TestObject> mb2 = new TestObject(200);
+	Ref<TestObject> sb2 = new TestObject();
+	master.registerObject(mb2, "b");
+	slave.unregisterObject("b");
+	slave.registerObject(sb2, "b");
+	sendFrame(master, slaves);
+	OTEST_CHECK(master.getLastFrameSize() == baseSize + 2 * objectSize);
+	OTEST_CHECK(sb2->value == 200 && sb->updates == updates);
+	OTEST_CHECK(nb->value == 200);
+
+	return OTEST_RESULT();
+}
@@ -0,0 +1,231 @@
+/******************************************************************************
+ * THE OMEGA LIB PROJECT
+ *-----------------------------------------------------------------------------
+ * Copyright 2010-2013		Electronic Visualization Laboratory, 
+ *							University of Illinois at Chicago
+ * Authors:										
+ *  Alessandro Febretti		febret@gmail.com
+ *-----------------------------------------------------------------------------
+ * Copyright (c) 2010-2013, Electronic Visualization Laboratory,  
+ * University of Illinois at Chicago
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ * 
+ * Redistributions of source code must retain the above copyright notice, this 
+ * list of conditions and the following disclaimer. Redistributions in binary 
+ * form must reproduce the above copyright notice, this list of conditions and 
+ * the following disclaimer in the documentation and/or other materials provided 
+ * with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *-----------------------------------------------------------------------------
+ * What's in this file
+ *	Checks that TransformSystem computes the same world transforms as the 
+ *	recursive Node::update, on random hierarchies that are then modified.
+ ******************************************************************************/
+#include <omega.h>
+#include "omega/TransformSystem.h"
+#include "omega/JobSystem.h"
+#include <math.h>
+
+#include "otest.h"
+
+using namespace omega;
+
+///////////////////////////////////////////////////////////////////////////////
+// Two copies of the same hierarchy: one updated recursively, one updated by 
+// a transform system.
+struct TwinScene
+{
+	Vector< Ref<Node> > recursive;
+	Vector< Ref<Node> > flat;
+	Vector<int> parents;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void randomizeTransform(Node* a, Node* b)
+{
+	Vector3f pos(otestRandom(-10, 10), otestRandom(-10, 10), otestRandom(-10, 10));
+	Quaternion q(otestRandom(-1, 1), otestRandom(-1, 1), otestRandom(-1, 1), otestRandom(-1, 1));
+	q.normalize();
+	Vector3f scale(otestRandom(0.5f, 2), otestRandom(0.5f, 2), otestRandom(0.5f, 2));
+
+	int what = otestRandomInt(4);
+	if(what == 0 || what == 3) { a->setPosition(pos); b->setPosition(pos); }
+	if(what == 1 || what == 3) { a->setOrientation(q); b->setOrientation(q); }
+	if(what == 2 || what == 3) { a->setScale(scale); b->setScale(scale); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void addNode(TwinScene& s, int parent)
+{
+	Node* a = new Node();
+	Node* b = new Node();
+	// Some nodes do not inherit orientation or scale.
+	bool inheritOrientation = otestRandomInt(8) != 0;
+	bool inheritScale = otestRandomInt(8) != 0;
+	a->setInheritOrientation(inheritOrientation);
+	b->setInheritOrientation(inheritOrientation);
+	a->setInheritScale(inheritScale);
+	b->setInheritScale(inheritScale);
+	randomizeTransform(a, b);
+	randomizeTransform(a, b);
+
+	s.recursive.push_back(a);
+	s.flat.push_back(b);
+	s.parents.push_back(parent);
+	if(parent >= 0)
+	{
+		s.recursive[parent]->addChild(a);
+		s.flat[parent]->addChild(b);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool closeTo(const Vector3f& a, const Vector3f& b)
+{
+	return (a - b).norm() <= 1e-3f * (1 + a.norm());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int subtreeSize(TwinScene& s, int node)
+{
+	// Parents come before their children.
+	Vector<bool> inside;
+	inside.resize(s.parents.size(), false);
+	inside[node] = true;
+	int size = 1;
+	for(int i = node + 1; i < s.parents.size(); i++)
+	{
+		if(s.parents[i] >= 0 && inside[s.parents[i]])
+		{
+			inside[i] = true;
+			size++;
+		}
+	}
+	return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void update(TwinScene& s, TransformSystem& ts)
+{
+	s.recursive[0]->update(true, false);
+	ts.update(s.flat[0]);
+	OTEST_CHECK(ts.getNumNodes() == s.flat.size());
+	OTEST_CHECK(ts.getLastUpdateCount() <= s.flat.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void check(TwinScene& s)
+{
+	for(int i = 0; i < s.recursive.size(); i++)
+	{
+		Node* a = s.recursive[i];
+		Node* b = s.flat[i];
+		OTEST_CHECK(closeTo(a->getDerivedPosition(), b->getDerivedPosition()));
+		OTEST_CHECK(closeTo(a->getDerivedScale(), b->getDerivedScale()));
+		// q and -q are the same rotation.
+		float dot = a->getDerivedOrientation().dot(b->getDerivedOrientation());
+		OTEST_CHECK(fabs(fabs(dot) - 1) < 1e-3f);
+		const AffineTransform3& ta = a->getFullTransform();
+		const AffineTransform3& tb = b->getFullTransform();
+		OTEST_CHECK((ta.matrix() - tb.matrix()).norm() <= 1e-3f * (1 + ta.matrix().norm()));
+		OTEST_CHECK(!b->isUpdateNeeded());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void runScene(TransformSystem& ts, int numNodes, bool wide)
+{
+	TwinScene s;
+	addNode(s, -1);
+	for(int i = 1; i < numNodes; i++)
+	{
+		// Wide scenes put most nodes in the same level, so large levels are
+		// split in parallel batches.
+		int parent = wide ? otestRandomInt(2) : otestRandomInt(i);
+		addNode(s, parent);
+	}
+	update(s, ts);
+	check(s);
+
+	// Nothing changed: nothing to update.
+	update(s, ts);
+	OTEST_CHECK(ts.getLastUpdateCount() == 0);
+	check(s);
+
+	// Moving one node only updates its subtree.
+	int moved = otestRandomInt(numNodes);
+	randomizeTransform(s.recursive[moved], s.flat[moved]);
+	update(s, ts);
+	OTEST_CHECK(ts.getLastUpdateCount() == subtreeSize(s, moved));
+	check(s);
+
+	// Changing another hierarchy does not flatten this one again, and does
+	// not change what gets updated.
+	Ref<Node> otherRoot = new Node();
+	otherRoot->addChild(new Node());
+	update(s, ts);
+	OTEST_CHECK(ts.getLastUpdateCount() == 0);
+	OTEST_CHECK(ts.getNumNodes() == numNodes);
+
+	for(int round = 0; round < 10; round++)
+	{
+		// Change some transforms, including the root.
+		int changes = 1 + otestRandomInt(numNodes / 10 + 1);
+		for(int i = 0; i < changes; i++)
+		{
+			int n = otestRandomInt(numNodes);
+			randomizeTransform(s.recursive[n], s.flat[n]);
+		}
+		// Move a few nodes under the root, so the hierarchy is flattened 
+		// again.
+		if(round % 3 == 2)
+		{
+			int n = 1 + otestRandomInt(numNodes - 1);
+			int p = s.parents[n];
+			if(p != 0)
+			{
+				s.recursive[p]->removeChild(s.recursive[n]);
+				s.flat[p]->removeChild(s.flat[n]);
+				s.recursive[0]->addChild(s.recursive[n]);
+				s.flat[0]->addChild(s.flat[n]);
+				s.parents[n] = 0;
+			}
+		}
+		update(s, ts);
+		check(s);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	otestSeed(16);
+
+	TransformSystem ts;
+	for(int i = 0; i < 10; i++)
+	{
+		runScene(ts, 10 + otestRandomInt(1000), false);
+	}
+
+	// Levels larger than ParallelLevelSize are updated by the job system.
+	JobSystem js;
+	js.setThreads(4);
+	ts.setJobSystem(&js);
+	runScene(ts, TransformSystem::ParallelLevelSize * 3, true);
+	runScene(ts, 500, false);
+	ts.setJobSystem(NULL);
+
+	return OTEST_RESULT();
+}